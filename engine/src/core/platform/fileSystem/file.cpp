@@ -10,8 +10,16 @@
 #include <fstream>
 
 #include "file.h"
+#include <core/tasks/jobSystem.h>
 #include <core/tools/log.h>
 
+#if defined(__linux__) && !defined(ANDROID)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
 namespace rev { namespace core {
@@ -25,7 +33,7 @@ namespace rev { namespace core {
 #endif // ANDROID
 
 	//--------------------------------------------------------------------------------------------------------------
-	File::File(const string& _path) 
+	File::File(const string& _path, LoadMode _mode)
 		: mStream(&mBufferAdapter)
 	{
 		//mPath = _path; 
@@ -47,6 +55,9 @@ namespace rev { namespace core {
 		((char*)mBuffer)[mSize] = '\0';
 		AAsset_close(srcAsset);
 #else // !ANDROID
+		if(_mode == LoadMode::Mapped && mapFile(_path))
+			return;
+
 		ifstream srcFile(_path.c_str(), ios_base::binary);
 		if (srcFile.is_open()) {
 			// Open the file
@@ -71,7 +82,52 @@ namespace rev { namespace core {
 
 	//--------------------------------------------------------------------------------------------------------------
 	File::~File() {
+#if defined(__linux__) && !defined(ANDROID)
+		if (mMapped)
+		{
+			munmap(mBuffer, mSize);
+			return;
+		}
+#endif
 		if (mBuffer)
 			delete[] buffer<const char>(); // Cast prevents undefined behavior deleting void*
 	}
+
+	//--------------------------------------------------------------------------------------------------------------
+	bool File::mapFile(const string& _path)
+	{
+#if defined(__linux__) && !defined(ANDROID)
+		int fd = open(_path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat fileStats;
+		if (fstat(fd, &fileStats) != 0 || fileStats.st_size == 0)
+		{
+			close(fd);
+			return false;
+		}
+		// Private, writable mapping so the non const accessors stay valid. Writes never reach the file.
+		auto mapping = mmap(nullptr, (size_t)fileStats.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd); // The mapping keeps its own reference to the file
+		if (mapping == MAP_FAILED)
+			return false;
+		madvise(mapping, (size_t)fileStats.st_size, MADV_WILLNEED);
+
+		mSize = (size_t)fileStats.st_size;
+		mBuffer = mapping;
+		mMapped = true;
+		mBufferAdapter.set(buffer<char>(), &buffer<char>()[mSize]);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	//--------------------------------------------------------------------------------------------------------------
+	JobSystem::JobHandle File::readAsync(const string& _path, LoadMode _mode, ReadCallback _onCompletion)
+	{
+		return JobSystem::get()->schedule([_path, _mode, _onCompletion]() {
+			_onCompletion(std::make_unique<File>(_path, _mode));
+		});
+	}
 }}
\ No newline at end of file
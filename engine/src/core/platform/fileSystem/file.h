@@ -5,9 +5,13 @@
 //----------------------------------------------------------------------------------------------------------------------
 #pragma once
 
+#include <core/tasks/jobSystem.h>
+#include <functional>
 #include <streambuf>
 #include <iostream>
 #include <istream>
+#include <memory>
+#include <string>
 
 namespace rev {
 	namespace core {
@@ -15,14 +19,31 @@ namespace rev {
 		class File
 		{
 		public:
-			File(const std::string& _path);
+			enum class LoadMode
+			{
+				Buffered,	///< Contents are copied into a null terminated buffer
+				Mapped		///< buffer() points straight into a private memory mapping of the file. Not null terminated.
+							///< Falls back to Buffered on platforms without mmap.
+			};
+
+			File(const std::string& _path, LoadMode _mode = LoadMode::Buffered);
 			~File();
 
+			File(const File&) = delete;
+			File& operator=(const File&) = delete;
+
+			/// Read a file in the background, on the job system, and hand it to _onCompletion from the reading job.
+			/// A file that can't be opened is still passed, with size() == 0.
+			/// Wait for the returned job through JobSystem::wait, so waiting from inside a job keeps the workers busy.
+			using ReadCallback = std::function<void(std::unique_ptr<File>)>;
+			static JobSystem::JobHandle readAsync(const std::string& _path, LoadMode _mode, ReadCallback _onCompletion);
+
 			template<class T = void>
 			const T *	buffer		() const;
 			template<class T = void>
 			T *			buffer		();
 			size_t		size		() const;
+			bool		isMapped	() const { return mMapped; }
 
 			std::istream&	asStream() {				
 				return mStream;
@@ -34,8 +55,11 @@ namespace rev {
 #endif // ANDROID
 
 		private:
+			bool		mapFile		(const std::string& _path);
+
 			size_t		mSize = 0;
 			void*		mBuffer = nullptr;
+			bool		mMapped = false;
 			
 			struct  filebuf : public std::streambuf
 			{
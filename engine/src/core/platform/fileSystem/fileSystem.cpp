@@ -38,7 +38,7 @@ namespace rev {
 		}
 #endif // ANDROID
 
-#ifdef _WIN32
+#ifndef ANDROID
 		//--------------------------------------------------------------------------------------------------------------
 		FileSystem* FileSystem::sInstance = nullptr;
 
@@ -65,7 +65,7 @@ namespace rev {
 					auto fullPath = path / filename;
 					if (std::filesystem::exists(fullPath))
 					{
-						return new File(filename.generic_u8string().c_str());
+						return new File(fullPath.generic_u8string().c_str());
 					}
 				}
 			}
@@ -89,7 +89,7 @@ namespace rev {
 			delete sInstance;
 			sInstance = nullptr;
 		}
-#endif // _WIN32
+#endif // !ANDROID
 
 	} // namespace core
 }	// namespace rev
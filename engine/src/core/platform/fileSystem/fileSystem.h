@@ -27,6 +27,9 @@
 #ifdef _WIN32
 #include "windows/fileSystemWindows.h"
 #endif // _WIN32
+#if defined(__linux__) && !defined(ANDROID)
+#include "linux/fileSystemLinux.h"
+#endif // __linux__
 #ifdef ANDROID
 #include <android/asset_manager.h>
 #endif // ANDROID
@@ -36,7 +39,7 @@ namespace rev {
 
 		class File;
 
-#ifdef _WIN32
+#ifndef ANDROID
 		class FileSystem : public FileSystemBase {
 #else
 		class FileSystem {
@@ -46,7 +49,7 @@ namespace rev {
 			static void init(AAssetManager* _mgr);
 			static void end();
 #endif // ANDROID
-#ifdef _WIN32
+#ifndef ANDROID
 			static void init();
 			static void end();
 			static FileSystem*	get();
@@ -57,16 +60,16 @@ namespace rev {
 
 			// TODO: Scoped filesystem access with temporary sets of overriding paths?
 
-#endif // _WIN32
+#endif // !ANDROID
 		private:
 			FileSystem() = default;
 			~FileSystem() = default;
 
 			std::vector<std::filesystem::path> m_registedPaths;
 
-#ifdef _WIN32
+#ifndef ANDROID
 			static FileSystem*	sInstance;
-#endif // _WIN32
+#endif // !ANDROID
 		};
 	}
 }	// namespace rev
\ No newline at end of file
@@ -0,0 +1,146 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+// Created by Carmelo J. Fdez-Agera Tortosa (a.k.a. Technik)
+// 2019
+//----------------------------------------------------------------------------------------------------------------------
+// File system interface for linux
+#if defined(__linux__) && !defined(ANDROID)
+
+#include "fileSystemLinux.h"
+#include <core/tools/log.h>
+#include <filesystem>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace rev {
+	namespace core {
+
+		//------------------------------------------------------------------------------------------------------------------
+		void FileSystemLinux::update()
+		{
+			set<string> changes;
+			{
+				lock_guard<mutex> guard(mPendingLock);
+				changes.swap(mPendingChanges);
+			}
+			for (auto& fileName : changes)
+			{
+				auto res = mFileChangedEvents.find(fileName);
+				if (res != mFileChangedEvents.end())
+					res->second(fileName.c_str());
+			}
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		FileSystemLinux::FileSystemLinux()
+		{
+			mNotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			mWakeFd = eventfd(0, EFD_CLOEXEC);
+			if (mNotifyFd < 0 || mWakeFd < 0)
+			{
+				Log::error("Fail monitoring directory. File changes won't be detected");
+				return;
+			}
+
+			watchDirectoryTree(".");
+			mWatcher = thread(&FileSystemLinux::watcherRoutine, this);
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		FileSystemLinux::~FileSystemLinux()
+		{
+			if (mWatcher.joinable())
+			{
+				uint64_t signal = 1;
+				if (write(mWakeFd, &signal, sizeof(signal)) == sizeof(signal))
+					mWatcher.join();
+				else
+					mWatcher.detach();
+			}
+			if (mNotifyFd >= 0)
+				close(mNotifyFd);
+			if (mWakeFd >= 0)
+				close(mWakeFd);
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		// inotify watches are not recursive, so every directory in the tree needs its own watch
+		void FileSystemLinux::watchDirectoryTree(const string& _dir)
+		{
+			constexpr uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ATTRIB;
+			int wd = inotify_add_watch(mNotifyFd, _dir.c_str(), mask);
+			if (wd < 0)
+			{
+				Log::warning("Unable to watch directory ", _dir);
+				return;
+			}
+			mWatchedDirs[wd] = _dir;
+
+			error_code error;
+			for (auto& entry : filesystem::directory_iterator(_dir, error))
+			{
+				if (entry.is_directory(error) && !entry.is_symlink(error))
+					watchDirectoryTree(entry.path().generic_string());
+			}
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void FileSystemLinux::watcherRoutine()
+		{
+			alignas(inotify_event) char buffer[16 * 1024];
+			pollfd fds[2] = {
+				{ mNotifyFd, POLLIN, 0 },
+				{ mWakeFd, POLLIN, 0 }
+			};
+			for (;;)
+			{
+				if (poll(fds, 2, -1) < 0)
+					continue; // Interrupted
+				if (fds[1].revents & POLLIN)
+					return;
+				if (!(fds[0].revents & POLLIN))
+					continue;
+
+				// Drain every notification available
+				for (;;)
+				{
+					auto size = read(mNotifyFd, buffer, sizeof(buffer));
+					if (size <= 0)
+						break;
+					processNotifications(buffer, size);
+				}
+			}
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void FileSystemLinux::processNotifications(const char* _buffer, long _size)
+		{
+			lock_guard<mutex> guard(mPendingLock);
+			for (auto ptr = _buffer; ptr < _buffer + _size;)
+			{
+				auto event = reinterpret_cast<const inotify_event*>(ptr);
+				ptr += sizeof(inotify_event) + event->len;
+
+				auto dir = mWatchedDirs.find(event->wd);
+				if (!event->len || dir == mWatchedDirs.end())
+					continue;
+
+				// Names are reported relative to the working directory, like on windows
+				string fileName = dir->second == "." ? event->name : dir->second.substr(2) + "/" + event->name;
+				if (event->mask & IN_ISDIR)
+				{
+					if (event->mask & (IN_CREATE | IN_MOVED_TO))
+						watchDirectoryTree("./" + fileName);
+					continue;
+				}
+				mPendingChanges.insert(fileName);
+			}
+		}
+	}	// namespace core
+}	// namespace rev
+
+#endif // __linux__ && !ANDROID
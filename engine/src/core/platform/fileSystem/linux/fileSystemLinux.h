@@ -0,0 +1,59 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+// Created by Carmelo J. Fdez-Agera Tortosa (a.k.a. Technik)
+// 2019
+//----------------------------------------------------------------------------------------------------------------------
+// File system interface for linux
+#ifndef _REV_CORE_PLATFORM_FILESYSTEM_LINUX_FILESYSTEMLINUX_H_
+#define _REV_CORE_PLATFORM_FILESYSTEM_LINUX_FILESYSTEMLINUX_H_
+
+#if defined(__linux__) && !defined(ANDROID)
+
+#include <core/event.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace rev {
+	namespace core {
+		/// Watches the working directory tree with inotify.
+		/// A background thread collects change notifications. Repeated changes to the same file are merged,
+		/// and listeners are invoked from update(), once per frame, on the thread that calls it.
+		class FileSystemLinux {
+		public:
+			typedef Event<const char*> FileEvent;
+
+			void		update();
+			FileEvent&			onFileChanged(const std::string& _fileName) { return mFileChangedEvents[_fileName]; }
+
+		protected:
+			std::map<const std::string, FileEvent>	mFileChangedEvents;
+
+		protected:
+			FileSystemLinux();
+			~FileSystemLinux();
+
+		private:
+			void watchDirectoryTree(const std::string& _dir);
+			void watcherRoutine();
+			void processNotifications(const char* _buffer, long _size);
+
+			int					mNotifyFd = -1;
+			int					mWakeFd = -1; // Signaled to stop the watcher thread
+			std::thread			mWatcher;
+			std::unordered_map<int, std::string>	mWatchedDirs; // Watch descriptor -> directory relative to the working dir
+
+			std::mutex				mPendingLock;
+			std::set<std::string>	mPendingChanges;
+		};
+
+		typedef FileSystemLinux	FileSystemBase;
+	}
+}	// namespace rev
+
+#endif // __linux__ && !ANDROID
+
+#endif // _REV_CORE_PLATFORM_FILESYSTEM_LINUX_FILESYSTEMLINUX_H_
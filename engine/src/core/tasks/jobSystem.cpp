@@ -0,0 +1,234 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "jobSystem.h"
+#include <core/tools/profiler.h>
+
+namespace rev::core {
+
+	namespace {
+		// Index of the queue owned by the current thread. Threads outside the pool share the last queue.
+		constexpr size_t kExternalThread = size_t(-1);
+		thread_local size_t tWorkerNdx = kExternalThread;
+	}
+
+	JobSystem* JobSystem::sInstance = nullptr;
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::init(size_t nWorkers)
+	{
+		assert(!sInstance);
+		if(nWorkers == 0)
+		{
+			auto hwThreads = std::thread::hardware_concurrency();
+			nWorkers = hwThreads > 1 ? hwThreads - 1 : 1;
+		}
+		sInstance = new JobSystem(nWorkers);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::end()
+	{
+		assert(sInstance);
+		delete sInstance;
+		sInstance = nullptr;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	JobSystem::JobSystem(size_t nWorkers)
+		: m_numWorkers(nWorkers)
+	{
+		m_queues.resize(nWorkers + 1);
+		for(auto& queue : m_queues)
+			queue = std::make_unique<WorkQueue>();
+
+		m_workers.reserve(nWorkers);
+		for(size_t i = 0; i < nWorkers; ++i)
+			m_workers.emplace_back(&JobSystem::workerRoutine, this, i);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_sleepLock);
+			m_exit = true;
+		}
+		m_wakeUp.notify_all();
+		for(auto& worker : m_workers)
+			worker.join();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	JobSystem::JobHandle JobSystem::schedule(Task task, std::initializer_list<JobHandle> dependencies)
+	{
+		return schedule(std::move(task), std::vector<JobHandle>(dependencies));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	JobSystem::JobHandle JobSystem::schedule(Task task, const std::vector<JobHandle>& dependencies)
+	{
+		auto job = std::make_shared<Job>();
+		job->m_task = std::move(task);
+		// The extra dependency keeps the job from being queued before we're done registering it
+		job->m_pendingDependencies = int(dependencies.size()) + 1;
+
+		for(auto& dependency : dependencies)
+		{
+			if(dependency)
+			{
+				std::lock_guard<std::mutex> guard(dependency->m_continuationLock);
+				if(!dependency->finished())
+				{
+					dependency->m_continuations.push_back(job);
+					continue;
+				}
+			}
+			resolveDependency(job);
+		}
+		resolveDependency(job);
+
+		return job;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::wait(const JobHandle& job)
+	{
+		if(!job)
+			return;
+		while(!job->finished())
+		{
+			if(!runPendingJob())
+				std::this_thread::yield();
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::wait(const std::vector<JobHandle>& jobs)
+	{
+		for(auto& job : jobs)
+			wait(job);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::workerRoutine(size_t workerNdx)
+	{
+		tWorkerNdx = workerNdx;
+		Profiler::setThreadName("Worker " + std::to_string(workerNdx));
+		for(;;)
+		{
+			if(runPendingJob())
+				continue;
+
+			std::unique_lock<std::mutex> lock(m_sleepLock);
+			m_wakeUp.wait(lock, [this]() {
+				return m_exit || m_numQueuedJobs.load(std::memory_order_acquire) > 0;
+			});
+			if(m_exit)
+				return;
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::enqueue(JobHandle job)
+	{
+		auto queueNdx = tWorkerNdx == kExternalThread ? m_numWorkers : tWorkerNdx;
+		auto& queue = *m_queues[queueNdx];
+		{
+			std::lock_guard<std::mutex> guard(queue.lock);
+			queue.jobs.push_back(std::move(job));
+		}
+		m_numQueuedJobs.fetch_add(1, std::memory_order_release);
+
+		// Taking the lock guarantees sleeping workers either see the new job or get the notification
+		{
+			std::lock_guard<std::mutex> guard(m_sleepLock);
+		}
+		m_wakeUp.notify_one();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	JobSystem::JobHandle JobSystem::popOrSteal(size_t preferredQueue)
+	{
+		JobHandle job;
+		// Newest job in our own queue is most likely to be hot in cache
+		if(preferredQueue < m_numWorkers)
+		{
+			auto& ownQueue = *m_queues[preferredQueue];
+			std::lock_guard<std::mutex> guard(ownQueue.lock);
+			if(!ownQueue.jobs.empty())
+			{
+				job = std::move(ownQueue.jobs.back());
+				ownQueue.jobs.pop_back();
+			}
+		}
+		// Steal the oldest job from somebody else
+		for(size_t i = 1; !job && i <= m_queues.size(); ++i)
+		{
+			auto& victim = *m_queues[(preferredQueue + i) % m_queues.size()];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if(!victim.jobs.empty())
+			{
+				job = std::move(victim.jobs.front());
+				victim.jobs.pop_front();
+			}
+		}
+
+		if(job)
+			m_numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool JobSystem::runPendingJob()
+	{
+		auto preferredQueue = tWorkerNdx == kExternalThread ? m_numWorkers : tWorkerNdx;
+		auto job = popOrSteal(preferredQueue);
+		if(!job)
+			return false;
+		execute(job);
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::execute(const JobHandle& job)
+	{
+		{
+			REV_PROFILE_SCOPE("Job");
+			job->m_task();
+		}
+		job->m_task = nullptr; // Release captured state as soon as possible
+
+		std::vector<JobHandle> continuations;
+		{
+			std::lock_guard<std::mutex> guard(job->m_continuationLock);
+			job->m_finished.store(true, std::memory_order_release);
+			continuations.swap(job->m_continuations);
+		}
+		for(auto& next : continuations)
+			resolveDependency(next);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::resolveDependency(const JobHandle& job)
+	{
+		if(job->m_pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			enqueue(job);
+	}
+}
@@ -0,0 +1,134 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rev::core {
+
+	/// Long lived pool of worker threads.
+	/// Every worker owns a deque of jobs. Workers pop from the back of their own deque, and steal from
+	/// the front of other workers' deques when they run out of work.
+	/// Jobs can depend on other jobs. A job is only queued once all its dependencies have finished,
+	/// so continuations can be expressed by scheduling a job that depends on the previous one.
+	class JobSystem
+	{
+	public:
+		class Job;
+		using JobHandle = std::shared_ptr<Job>;
+		using Task = std::function<void()>;
+
+		class Job
+		{
+		public:
+			bool finished() const { return m_finished.load(std::memory_order_acquire); }
+
+		private:
+			friend class JobSystem;
+
+			Task m_task;
+			std::atomic<int> m_pendingDependencies = 0;
+			std::atomic<bool> m_finished = false;
+			std::mutex m_continuationLock;
+			std::vector<JobHandle> m_continuations;
+		};
+
+		/// nWorkers == 0 uses one worker per hardware thread, minus the caller's thread
+		static void init(size_t nWorkers = 0);
+		static JobSystem* get() { assert(sInstance); return sInstance; }
+		static void end();
+
+		size_t numWorkers() const { return m_numWorkers; }
+
+		/// Queue a job that will run once all its dependencies have finished
+		JobHandle schedule(Task task, std::initializer_list<JobHandle> dependencies = {});
+		JobHandle schedule(Task task, const std::vector<JobHandle>& dependencies);
+
+		/// Block until the job is finished.
+		/// The calling thread keeps running queued jobs while it waits, so it's safe to wait from inside a job.
+		void wait(const JobHandle& job);
+		void wait(const std::vector<JobHandle>& jobs);
+
+		/// Run op(i) for every i in [begin, end), in chunks of at most grainSize elements.
+		/// Returns once every chunk is done.
+		template<class Op>
+		void parallel_for(size_t begin, size_t end, size_t grainSize, const Op& op);
+
+	private:
+		JobSystem(size_t nWorkers);
+		~JobSystem();
+
+		struct WorkQueue
+		{
+			std::mutex lock;
+			std::deque<JobHandle> jobs;
+		};
+
+		void workerRoutine(size_t workerNdx);
+		void enqueue(JobHandle job);
+		JobHandle popOrSteal(size_t preferredQueue);
+		bool runPendingJob();
+		void execute(const JobHandle& job);
+		void resolveDependency(const JobHandle& job);
+
+		static JobSystem* sInstance;
+
+		const size_t m_numWorkers;
+		std::vector<std::thread> m_workers;
+		std::vector<std::unique_ptr<WorkQueue>> m_queues; // One per worker, plus one shared by external threads
+		std::atomic<size_t> m_numQueuedJobs = 0;
+		bool m_exit = false;
+		std::mutex m_sleepLock;
+		std::condition_variable m_wakeUp;
+	};
+
+	//----------------------------------------------------------------------------------------------
+	template<class Op>
+	void JobSystem::parallel_for(size_t begin, size_t end, size_t grainSize, const Op& op)
+	{
+		if(begin >= end)
+			return;
+		if(grainSize == 0)
+			grainSize = 1;
+
+		std::vector<JobHandle> chunks;
+		chunks.reserve((end - begin + grainSize - 1) / grainSize);
+		for(size_t chunkStart = begin; chunkStart < end; chunkStart += grainSize)
+		{
+			size_t chunkEnd = std::min(end, chunkStart + grainSize);
+			chunks.push_back(schedule([&op, chunkStart, chunkEnd]() {
+				for(size_t i = chunkStart; i < chunkEnd; ++i)
+					op(i);
+			}));
+		}
+		wait(chunks);
+	}
+
+}
@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "radixSort.h"
+#include "jobSystem.h"
+
+#include <type_traits>
+
+namespace rev::core {
+
+	namespace {
+		constexpr size_t cDigitBits = 8;
+		constexpr size_t cNumBuckets = size_t(1) << cDigitBits;
+		constexpr size_t cNumPasses = 64 / cDigitBits;
+		// Below this, splitting the work costs more than it saves
+		constexpr size_t cMinItemsPerChunk = 16 * 1024;
+
+		using Histogram = std::array<uint32_t, cNumBuckets>;
+		static_assert(std::is_same_v<Histogram, decltype(RadixSortScratch::histograms)::value_type>);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void radixSort(std::vector<SortItem>& items, RadixSortScratch& scratch, JobSystem* jobs)
+	{
+		const size_t n = items.size();
+		if(n < 2)
+			return;
+
+		// Bits that differ between any two keys
+		const uint64_t firstKey = items[0].key;
+		uint64_t varyingBits = 0;
+		for(auto& item : items)
+			varyingBits |= item.key ^ firstKey;
+		if(!varyingBits)
+			return;
+
+		size_t numChunks = 1;
+		if(jobs)
+			numChunks = std::max<size_t>(1, std::min(jobs->numWorkers() + 1, n / cMinItemsPerChunk));
+		const size_t chunkSize = (n + numChunks - 1) / numChunks;
+
+		// Runs op on every chunk, in parallel if there's more than one
+		auto forEachChunk = [&](auto&& op) {
+			if(numChunks == 1)
+				op(0);
+			else
+				jobs->parallel_for(0, numChunks, 1, op);
+		};
+
+		auto& histograms = scratch.histograms;
+		histograms.resize(numChunks);
+		scratch.items.resize(n);
+		SortItem* src = items.data();
+		SortItem* dst = scratch.items.data();
+
+		for(size_t pass = 0; pass < cNumPasses; ++pass)
+		{
+			const size_t shift = pass * cDigitBits;
+			if(((varyingBits >> shift) & (cNumBuckets - 1)) == 0)
+				continue;
+
+			forEachChunk([&](size_t chunk) {
+				auto& histogram = histograms[chunk];
+				histogram.fill(0);
+				const size_t end = std::min(n, (chunk + 1) * chunkSize);
+				for(size_t i = chunk * chunkSize; i < end; ++i)
+					++histogram[(src[i].key >> shift) & (cNumBuckets - 1)];
+			});
+
+			// Exclusive prefix sum, digit major. Every chunk writes each digit right after the previous
+			// chunks wrote theirs, which keeps the sort stable.
+			uint32_t offset = 0;
+			for(size_t digit = 0; digit < cNumBuckets; ++digit)
+			{
+				for(auto& histogram : histograms)
+				{
+					auto count = histogram[digit];
+					histogram[digit] = offset;
+					offset += count;
+				}
+			}
+
+			forEachChunk([&](size_t chunk) {
+				auto& offsets = histograms[chunk];
+				const size_t end = std::min(n, (chunk + 1) * chunkSize);
+				for(size_t i = chunk * chunkSize; i < end; ++i)
+					dst[offsets[(src[i].key >> shift) & (cNumBuckets - 1)]++] = src[i];
+			});
+
+			std::swap(src, dst);
+		}
+
+		// Odd number of passes leaves the result in scratch
+		if(src != items.data())
+			items.swap(scratch.items);
+	}
+}
@@ -0,0 +1,50 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace rev::core {
+
+	class JobSystem;
+
+	/// 64 bit key to sort by, and the index of the element it stands for.
+	/// Sorting keys instead of the elements themselves keeps the data moved around small.
+	struct SortItem
+	{
+		uint64_t key;
+		uint32_t index;
+	};
+
+	/// Temporary storage for radixSort. Buffers are resized as needed, so keep it around between calls to avoid allocations.
+	struct RadixSortScratch
+	{
+		std::vector<SortItem> items;
+		std::vector<std::array<uint32_t, 256>> histograms; // One per chunk of items
+	};
+
+	/// Stable least significant digit radix sort on SortItem::key, 8 bits per pass.
+	/// Passes over digits that are the same for every key are skipped, so keys that only use
+	/// a few of their bits are cheap to sort.
+	/// When a job system is provided, large arrays are counted and scattered in parallel chunks.
+	void radixSort(std::vector<SortItem>& items, RadixSortScratch& scratch, JobSystem* jobs = nullptr);
+}
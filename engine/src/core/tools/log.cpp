@@ -0,0 +1,273 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+//----------------------------------------------------------------------------------------------------------------------
+#include "log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef ANDROID
+#include <android/log.h>
+#endif
+
+namespace rev { namespace core {
+
+	namespace {
+
+		//--------------------------------------------------------------------------------------------------------------
+		struct Record
+		{
+			static constexpr size_t kMaxLength = 496;
+
+			uint64_t sequence;
+			Log::Level level;
+			uint32_t length;
+			char text[kMaxLength];
+		};
+
+		//--------------------------------------------------------------------------------------------------------------
+		// Single producer, single consumer ring of records
+		struct RecordQueue
+		{
+			static constexpr size_t kCapacity = 256;
+
+			Record records[kCapacity];
+			std::atomic<size_t> writePos = 0;
+			std::atomic<size_t> readPos = 0;
+
+			bool push(const Record& record)
+			{
+				auto pos = writePos.load(std::memory_order_relaxed);
+				if(pos - readPos.load(std::memory_order_acquire) >= kCapacity)
+					return false;
+				records[pos % kCapacity] = record;
+				writePos.store(pos+1, std::memory_order_release);
+				return true;
+			}
+
+			template<class Op>
+			void consume(Op& op)
+			{
+				auto pos = readPos.load(std::memory_order_relaxed);
+				auto end = writePos.load(std::memory_order_acquire);
+				for(; pos != end; ++pos)
+					op(records[pos % kCapacity]);
+				readPos.store(pos, std::memory_order_release);
+			}
+		};
+
+		//--------------------------------------------------------------------------------------------------------------
+		const char* levelTag(Log::Level level)
+		{
+			switch(level)
+			{
+				case Log::Level::Verbose: return "Verbose";
+				case Log::Level::Debug: return "Debug";
+				case Log::Level::Info: return "Info";
+				case Log::Level::Warning: return "Warning";
+				case Log::Level::Error: return "Error";
+			}
+			return "";
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		// Platform output
+		void writeToSink(const Record& record)
+		{
+#ifdef ANDROID
+			constexpr android_LogPriority priorities[] = {
+				ANDROID_LOG_VERBOSE,
+				ANDROID_LOG_DEBUG,
+				ANDROID_LOG_INFO,
+				ANDROID_LOG_WARN,
+				ANDROID_LOG_ERROR
+			};
+			__android_log_print(priorities[(int)record.level], "rev", "%.*s", (int)record.length, record.text);
+#else
+			FILE* stream = stdout;
+			if(record.level == Log::Level::Error)
+			{
+				fflush(stdout); // Keep errors in order with what was logged before them
+				stream = stderr;
+			}
+			fprintf(stream, "%s: %.*s\n", levelTag(record.level), (int)record.length, record.text);
+#endif
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		class AsyncWriter
+		{
+		public:
+			AsyncWriter(uint32_t _generation)
+				: generation(_generation)
+			{
+				m_thread = std::thread([this]() { run(); });
+			}
+
+			~AsyncWriter()
+			{
+				{
+					std::lock_guard<std::mutex> guard(m_wakeLock);
+					m_exit = true;
+				}
+				m_wakeUp.notify_one();
+				m_thread.join();
+				drain(); // Catch anything pushed while we were shutting down
+			}
+
+			RecordQueue* registerThread()
+			{
+				std::lock_guard<std::mutex> guard(m_queuesLock);
+				m_queues.push_back(std::make_unique<RecordQueue>());
+				return m_queues.back().get();
+			}
+
+			void notify()
+			{
+				m_wakeUp.notify_one();
+			}
+
+			const uint32_t generation;
+
+		private:
+			void run()
+			{
+				for(;;)
+				{
+					drain();
+					std::unique_lock<std::mutex> lock(m_wakeLock);
+					if(m_exit)
+						return;
+					// Producers don't take the lock to notify us, so a timeout covers missed wake ups
+					m_wakeUp.wait_for(lock, std::chrono::milliseconds(10));
+				}
+			}
+
+			void drain()
+			{
+				m_batch.clear();
+				auto collect = [this](const Record& record) { m_batch.push_back(record); };
+				{
+					std::lock_guard<std::mutex> guard(m_queuesLock);
+					for(auto& queue : m_queues)
+						queue->consume(collect);
+				}
+				if(m_batch.empty())
+					return;
+
+				// Restore global order between threads
+				std::sort(m_batch.begin(), m_batch.end(), [](const Record& a, const Record& b) {
+					return a.sequence < b.sequence;
+				});
+				for(auto& record : m_batch)
+					writeToSink(record);
+				fflush(stdout);
+			}
+
+			std::thread m_thread;
+			std::mutex m_queuesLock;
+			std::vector<std::unique_ptr<RecordQueue>> m_queues;
+			std::vector<Record> m_batch;
+
+			std::mutex m_wakeLock;
+			std::condition_variable m_wakeUp;
+			bool m_exit = false;
+		};
+
+		std::atomic<AsyncWriter*> sWriter = nullptr;
+		std::atomic<int> sActiveProducers = 0; // Threads that may still be using the writer
+		uint32_t sWriterGeneration = 0;
+		std::atomic<size_t> sDroppedMessages = 0;
+		std::atomic<uint64_t> sSequence = 0;
+		std::mutex sSyncLock;
+
+		struct ThreadQueue
+		{
+			RecordQueue* queue = nullptr;
+			uint32_t generation = 0;
+		};
+		thread_local ThreadQueue tQueue;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void Log::init()
+	{
+		assert(!sWriter);
+		sWriter = new AsyncWriter(++sWriterGeneration);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void Log::end()
+	{
+		assert(sWriter);
+		auto writer = sWriter.exchange(nullptr);
+		// New producers see no writer now, wait for the ones that got it before
+		while(sActiveProducers.load() > 0)
+			std::this_thread::yield();
+		delete writer;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	size_t Log::droppedMessages()
+	{
+		return sDroppedMessages.load();
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	std::stringstream& Log::formatBuffer()
+	{
+		thread_local std::stringstream ss;
+		ss.str(std::string());
+		ss.clear();
+		return ss;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void Log::push(Level level, std::stringstream& message)
+	{
+		Record record;
+		record.sequence = sSequence.fetch_add(1, std::memory_order_relaxed);
+		record.level = level;
+		message.read(record.text, Record::kMaxLength); // Longer messages are truncated
+		record.length = (uint32_t)message.gcount();
+
+		// Registering before loading the writer keeps end() from deleting it under our feet
+		sActiveProducers.fetch_add(1);
+		auto writer = sWriter.load();
+		if(!writer)
+		{
+			sActiveProducers.fetch_sub(1);
+			std::lock_guard<std::mutex> guard(sSyncLock);
+			writeToSink(record);
+			return;
+		}
+
+		if(tQueue.generation != writer->generation)
+		{
+			tQueue.queue = writer->registerThread();
+			tQueue.generation = writer->generation;
+		}
+		bool pushed = tQueue.queue->push(record);
+		// Errors are never dropped. Wait for the writer to make room instead.
+		while(!pushed && level == Level::Error)
+		{
+			writer->notify();
+			std::this_thread::yield();
+			pushed = tQueue.queue->push(record);
+		}
+		if(pushed)
+			writer->notify();
+		else
+			sDroppedMessages++;
+		sActiveProducers.fetch_sub(1);
+	}
+
+}}	// namespace rev::core
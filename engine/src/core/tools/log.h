@@ -3,98 +3,90 @@
 //----------------------------------------------------------------------------------------------------------------------
 #pragma once
 
-#include <string>
-#include <iostream>
-#ifdef ANDROID
-#include <android/log.h>
 #include <sstream>
+#include <string>
+
+// Messages below this level are compiled out.
+// 0: Verbose, 1: Debug, 2: Info, 3: Warning, 4: Error
+#ifndef REV_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define REV_LOG_MIN_LEVEL 2
+#else
+#define REV_LOG_MIN_LEVEL 0
+#endif
 #endif
 
 namespace rev { namespace core {
 
+	/// Messages are formatted on the calling thread into fixed size records, and pushed into a queue owned by
+	/// that thread. A background thread collects the records from every queue and writes them to the platform sink,
+	/// so logging never waits on console I/O.
+	/// Before init() and after end(), messages are written synchronously.
+	/// end() waits for threads that are still pushing, so it's safe to call while other threads log.
 	class Log {
 	public:
-		template<class ... Args_>
-		static void verbose(Args_ ... _args)
+		enum class Level
 		{
-#ifdef _WIN32
-			writeToLog("Verbose", _args ...);
-#elif defined(ANDROID)
-			writeToLog(ANDROID_LOG_VERBOSE, _args ...);
-#endif
-		}
+			Verbose,
+			Debug,
+			Info,
+			Warning,
+			Error
+		};
+
+		static constexpr Level kMinLevel = Level(REV_LOG_MIN_LEVEL);
+
+		static void init();
+		static void end();
 
 		template<class ... Args_>
-		static void debug(Args_ ... _args)
+		static void verbose(const Args_& ... _args)
 		{
-#ifdef _WIN32
-			writeToLog("Debug", _args ...);
-#elif defined(ANDROID)
-			writeToLog(ANDROID_LOG_DEBUG, _args ...);
-#endif
+			write<Level::Verbose>(_args...);
 		}
 
 		template<class ... Args_>
-		static void warning(Args_ ... _args)
+		static void debug(const Args_& ... _args)
 		{
-#ifdef _WIN32
-			writeToLog("Info", _args ...);
-#elif defined(ANDROID)
-			writeToLog(ANDROID_LOG_WARN, _args ...);
-#endif
+			write<Level::Debug>(_args...);
 		}
 
 		template<class ... Args_>
-		static void info(Args_ ... _args)
+		static void info(const Args_& ... _args)
 		{
-#ifdef _WIN32
-			writeToLog("Info", _args ...);
-#elif defined(ANDROID)
-			writeToLog(ANDROID_LOG_INFO, _args ...);
-#endif
+			write<Level::Info>(_args...);
 		}
 
 		template<class ... Args_>
-		static void error(Args_ ... _args)
+		static void warning(const Args_& ... _args)
 		{
-#ifdef _WIN32
-			writeToLog("Info", _args ...);
-#elif defined(ANDROID)
-			writeToLog(ANDROID_LOG_ERROR, _args ...);
-#endif
+			write<Level::Warning>(_args...);
 		}
 
-	private:
-#ifdef ANDROID
-		template<typename ... Args_>
-		static void writeToLog(android_LogPriority priority, Args_ ... _args)
-		{
-			std::stringstream ss;
-			writeToSS(ss, _args...);
-			__android_log_print(priority, "rev", "%s", ss.str().c_str());
-		}
-#else
-		template<typename ... Args_>
-		static void writeToLog(const char* _tag, Args_ ... _args)
+		template<class ... Args_>
+		static void error(const Args_& ... _args)
 		{
-			std::cout << _tag << ": ";
-			writeToSS(std::cout, _args...);
-			std::cout << "\n";
+			write<Level::Error>(_args...);
 		}
-#endif
 
-		template<class T, typename ... Args_>
-		static void writeToSS(std::ostream& ss, T x, Args_ ... _args)
-		{
-			ss << x;
-			writeToSS(ss, _args...);
-		}
+		/// Number of messages lost because a thread's queue was full, since the program started.
+		/// Errors are never dropped: they wait for room in the queue instead.
+		static size_t droppedMessages();
 
-		template<typename T>
-		static void writeToSS(std::ostream& ss, T x)
+	private:
+		template<Level level, class ... Args_>
+		static void write(const Args_& ... _args)
 		{
-			ss << x;
+			if constexpr(level >= kMinLevel)
+			{
+				auto& ss = formatBuffer();
+				(ss << ... << _args);
+				push(level, ss);
+			}
 		}
+
+		static std::stringstream& formatBuffer(); // Cleared thread local stream
+		static void push(Level, std::stringstream& message);
 	};
 
-}}	// namespace rev::core
\ No newline at end of file
+}}	// namespace rev::core
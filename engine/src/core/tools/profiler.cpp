@@ -0,0 +1,350 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+// Created by Carmelo J. Fdez-Aguera Tortosa (a.k.a. Technik)
+//----------------------------------------------------------------------------------------------------------------------
+#include "profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace rev {
+	namespace core {
+
+		//--------------------------------------------------------------------------------------------------------------
+		// Single producer, single consumer ring. Only the owning thread writes events, and only endFrame reads them.
+		// When the ring is full, new events are dropped rather than overwriting the ones endFrame may be reading.
+		struct Profiler::ThreadLog
+		{
+			ThreadLog(uint32_t _index, std::string _name)
+				: index(_index)
+				, name(std::move(_name))
+				, events(new Event[kRingSize])
+			{}
+
+			uint32_t index;
+			std::string name;
+			std::unique_ptr<Event[]> events;
+			std::atomic<uint64_t> writePos = 0;
+			std::atomic<uint64_t> readPos = 0;
+			std::atomic<size_t> droppedEvents = 0;
+			uint32_t depth = 0; // Owned by the producer
+		};
+
+		namespace {
+			struct ThreadRegistration
+			{
+				Profiler::ThreadLog* log = nullptr;
+				uint32_t generation = 0;
+				std::string name;
+			};
+		}
+
+		static const char* const kFrameMarker = "Frame";
+
+		Profiler* Profiler::sInstance = nullptr;
+		std::atomic<uint32_t> Profiler::sGeneration = 0;
+		static thread_local ThreadRegistration tThreadRegistration;
+
+		//--------------------------------------------------------------------------------------------------------------
+		void Profiler::init()
+		{
+			assert(!sInstance);
+			++sGeneration;
+			sInstance = new Profiler();
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		void Profiler::end()
+		{
+			assert(sInstance);
+			delete sInstance;
+			sInstance = nullptr;
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		void Profiler::setThreadName(const std::string& name)
+		{
+			tThreadRegistration.name = name;
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		Profiler::Profiler()
+			: m_frames(kTraceFrames)
+			, m_markerSlots(4 * kMaxMarkers, { nullptr, 0 })
+		{
+			m_markers.reserve(kMaxMarkers);
+			m_frameStart = now();
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		Profiler::~Profiler() = default;
+
+		//--------------------------------------------------------------------------------------------------------------
+		uint64_t Profiler::now()
+		{
+			using namespace std::chrono;
+			return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		Profiler::ThreadLog* Profiler::registerThread()
+		{
+			auto& registration = tThreadRegistration;
+			if(registration.generation != sGeneration)
+			{
+				std::lock_guard<std::mutex> guard(m_threadsLock);
+				auto index = (uint32_t)m_threads.size();
+				auto name = registration.name.empty() ? "Thread " + std::to_string(index) : registration.name;
+				m_threads.push_back(std::make_unique<ThreadLog>(index, std::move(name)));
+				registration.log = m_threads.back().get();
+				registration.generation = sGeneration;
+			}
+			return registration.log;
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		Profiler::ScopedMarker::ScopedMarker(const char* name)
+			: m_log(nullptr)
+			, m_name(name)
+		{
+			auto profiler = Profiler::get();
+			if(!profiler)
+				return;
+			m_log = profiler->registerThread();
+			m_log->depth++;
+			m_start = now();
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		Profiler::ScopedMarker::~ScopedMarker()
+		{
+			if(!m_log)
+				return;
+			auto end = now();
+			m_log->depth--;
+			auto pos = m_log->writePos.load(std::memory_order_relaxed);
+			if(pos - m_log->readPos.load(std::memory_order_acquire) >= kRingSize)
+			{
+				m_log->droppedEvents.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			m_log->events[pos % kRingSize] = { m_name, m_start, end, m_log->depth };
+			m_log->writePos.store(pos+1, std::memory_order_release);
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		void Profiler::endFrame()
+		{
+			auto& frame = m_frames[m_nextFrame];
+			m_nextFrame = (m_nextFrame + 1) % kTraceFrames;
+			m_numFrames = std::min(m_numFrames + 1, kTraceFrames);
+			frame.events.clear();
+			frame.start = m_frameStart;
+			frame.end = now();
+			m_frameStart = frame.end;
+
+			{
+				std::lock_guard<std::mutex> guard(m_threadsLock);
+				for(auto& thread : m_threads)
+				{
+					auto readPos = thread->readPos.load(std::memory_order_relaxed);
+					auto writePos = thread->writePos.load(std::memory_order_acquire);
+					for(auto i = readPos; i < writePos; ++i)
+						frame.events.emplace_back(thread->index, thread->events[i % kRingSize]);
+					// Hand the slots back to the producer only once they've been copied
+					thread->readPos.store(writePos, std::memory_order_release);
+				}
+			}
+
+			// Per frame totals
+			if(auto frameMarker = findMarker(kFrameMarker))
+			{
+				frameMarker->frameTotal = frame.end - frame.start;
+				frameMarker->hitThisFrame = true;
+			}
+			for(auto& [threadNdx, event] : frame.events)
+			{
+				if(auto marker = findMarker(event.name))
+				{
+					marker->frameTotal += event.end - event.start;
+					marker->hitThisFrame = true;
+				}
+			}
+
+			for(auto& marker : m_markers)
+			{
+				if(!marker.hitThisFrame)
+					continue;
+				marker.samples[marker.next] = float(marker.frameTotal * 1e-6);
+				marker.next = (marker.next + 1) % kStatsWindow;
+				marker.numSamples = std::min(marker.numSamples + 1, kStatsWindow);
+				marker.frameTotal = 0;
+				marker.hitThisFrame = false;
+			}
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		Profiler::MarkerHistory* Profiler::findMarker(const char* name)
+		{
+			// Open addressing, keyed by the name pointer
+			auto mask = m_markerSlots.size() - 1;
+			auto slot = (size_t(reinterpret_cast<uintptr_t>(name) >> 3) * 0x9E3779B97F4A7C15ull) >> 32;
+			for(;; ++slot)
+			{
+				auto& [key, markerNdx] = m_markerSlots[slot & mask];
+				if(key == name)
+					return &m_markers[markerNdx];
+				if(!key)
+					break;
+			}
+			if(2 * m_numMarkerSlots >= m_markerSlots.size())
+				return nullptr;
+
+			// First time we see this pointer. The same name can come from different copies of a string literal.
+			uint32_t markerNdx = 0;
+			while(markerNdx < m_markers.size() && std::strcmp(m_markers[markerNdx].name, name) != 0)
+				++markerNdx;
+			if(markerNdx == m_markers.size())
+			{
+				if(m_markers.size() == kMaxMarkers)
+					return nullptr;
+				m_markers.emplace_back();
+				m_markers.back().name = name;
+			}
+			m_markerSlots[slot & mask] = { name, markerNdx };
+			++m_numMarkerSlots;
+			return &m_markers[markerNdx];
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		const Profiler::MarkerHistory* Profiler::findMarker(const std::string& name) const
+		{
+			for(auto& marker : m_markers)
+				if(name == marker.name)
+					return &marker;
+			return nullptr;
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		const Profiler::FrameCapture* Profiler::lastFrame() const
+		{
+			if(!m_numFrames)
+				return nullptr;
+			return &m_frames[(m_nextFrame + kTraceFrames - 1) % kTraceFrames];
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		size_t Profiler::droppedEvents() const
+		{
+			std::lock_guard<std::mutex> guard(m_threadsLock);
+			size_t dropped = 0;
+			for(auto& thread : m_threads)
+				dropped += thread->droppedEvents.load(std::memory_order_relaxed);
+			return dropped;
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		Profiler::MarkerStats Profiler::stats(const std::string& markerName) const
+		{
+			MarkerStats result;
+			auto marker = findMarker(markerName);
+			if(!marker || !marker->numSamples)
+				return result;
+
+			std::vector<float> samples(marker->samples.begin(), marker->samples.begin() + marker->numSamples);
+			result.numFrames = samples.size();
+			result.minMs = *std::min_element(samples.begin(), samples.end());
+			float total = 0;
+			for(auto s : samples)
+				total += s;
+			result.avgMs = total / samples.size();
+			auto p99 = samples.begin() + (samples.size() * 99) / 100;
+			std::nth_element(samples.begin(), p99, samples.end());
+			result.p99Ms = *p99;
+
+			return result;
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		void Profiler::report(std::ostream& out) const
+		{
+			std::vector<std::string> names;
+			for(auto& marker : m_markers)
+				if(marker.numSamples)
+					names.push_back(marker.name);
+			std::sort(names.begin(), names.end());
+
+			for(auto& name : names)
+			{
+				auto markerStats = stats(name);
+				out << name << ": min " << markerStats.minMs
+					<< "ms, avg " << markerStats.avgMs
+					<< "ms, p99 " << markerStats.p99Ms
+					<< "ms (" << markerStats.numFrames << " frames)\n";
+			}
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		bool Profiler::exportChromeTrace(const std::string& fileName) const
+		{
+			std::ofstream out(fileName);
+			if(!out.is_open())
+				return false;
+
+			auto writeName = [&out](const std::string& name) {
+				out << '"';
+				for(auto c : name)
+				{
+					if(c == '"' || c == '\\')
+						out << '\\';
+					out << c;
+				}
+				out << '"';
+			};
+
+			auto firstFrame = (m_nextFrame + kTraceFrames - m_numFrames) % kTraceFrames;
+			uint64_t origin = m_numFrames ? m_frames[firstFrame].start : 0;
+			auto toUs = [origin](uint64_t ns) { return double(int64_t(ns - origin)) * 1e-3; };
+
+			out << "{\"traceEvents\":[\n";
+			bool first = true;
+			auto separator = [&]() {
+				if(!first)
+					out << ",\n";
+				first = false;
+			};
+			// Thread names
+			std::lock_guard<std::mutex> guard(m_threadsLock);
+			for(auto& thread : m_threads)
+			{
+				separator();
+				out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread->index << ",\"args\":{\"name\":";
+				writeName(thread->name);
+				out << "}}";
+			}
+			// Events
+			for(size_t i = 0; i < m_numFrames; ++i)
+			{
+				auto& frame = m_frames[(firstFrame + i) % kTraceFrames];
+				separator();
+				out << "{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" << toUs(frame.start)
+					<< ",\"dur\":" << double(frame.end - frame.start) * 1e-3 << "}";
+				for(auto& [threadNdx, event] : frame.events)
+				{
+					separator();
+					out << "{\"name\":";
+					writeName(event.name);
+					out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << threadNdx
+						<< ",\"ts\":" << toUs(event.start)
+						<< ",\"dur\":" << double(event.end - event.start) * 1e-3 << "}";
+				}
+			}
+			out << "\n]}\n";
+
+			return true;
+		}
+
+} }
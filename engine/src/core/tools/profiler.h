@@ -5,42 +5,135 @@
 #ifndef _REV_CORE_TOOLS_PROFILER_H_
 #define _REV_CORE_TOOLS_PROFILER_H_
 
-#include <fstream>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
 #include <vector>
 
 namespace rev {
 	namespace core {
 
+		/// Hierarchical cpu profiler.
+		/// Threads record scoped markers into their own ring buffer without taking any locks.
+		/// Once per frame, endFrame() collects the markers from every thread, updates the per-marker statistics
+		/// and keeps the last few frames around so they can be exported as a chrome trace (chrome://tracing).
+		/// Once warmed up, neither recording markers nor endFrame allocate memory.
 		class Profiler {
 		public:
-			Profiler(){
-				records.reserve(100);
-				std::ofstream log("profiler.txt"); // Clear the log
-			}
-
-			~Profiler() {
-				flush();
-			}
-
-			void update(float _dt) {
-				records.push_back(_dt);
-				if (records.size() == records.capacity()) {
-					flush();
-				}
-			}
+			struct ThreadLog;
+
+			struct Event
+			{
+				const char* name; // Must outlive the profiler. String literals are the expected use case.
+				uint64_t start; // Nanoseconds
+				uint64_t end;
+				uint32_t depth;
+			};
+
+			struct MarkerStats
+			{
+				float minMs = 0;
+				float avgMs = 0;
+				float p99Ms = 0;
+				size_t numFrames = 0;
+			};
+
+			class ScopedMarker
+			{
+			public:
+				ScopedMarker(const char* name);
+				~ScopedMarker();
+
+				ScopedMarker(const ScopedMarker&) = delete;
+				ScopedMarker& operator=(const ScopedMarker&) = delete;
+
+			private:
+				ThreadLog* m_log;
+				const char* m_name;
+				uint64_t m_start;
+			};
+
+			static void			init();
+			static Profiler*	get() { return sInstance; } ///< Can be null. Markers are ignored when the profiler is off
+			static void			end();
+
+			/// Name used for the calling thread in traces
+			static void setThreadName(const std::string& name);
+
+			/// Close the current frame and collect the markers recorded by every thread since the last call
+			void endFrame();
+
+			/// Per frame statistics for a marker over the last kStatsWindow frames.
+			/// If a marker is hit several times in a frame, the frame sample is the sum of all of them.
+			MarkerStats stats(const std::string& markerName) const;
+			void report(std::ostream& out) const;
+
+			bool exportChromeTrace(const std::string& fileName) const;
+
+			struct FrameCapture
+			{
+				uint64_t start;
+				uint64_t end;
+				std::vector<std::pair<uint32_t,Event>> events; // Thread index, event
+			};
+
+			/// Markers collected by the last call to endFrame. Null before the first one.
+			const FrameCapture* lastFrame() const;
+
+			/// Markers lost because their thread recorded more than kRingSize of them between calls to endFrame
+			size_t droppedEvents() const;
+
+			static constexpr size_t kRingSize = 1<<14; // Markers per thread between calls to endFrame
+			static constexpr size_t kStatsWindow = 256;
+			static constexpr size_t kTraceFrames = 300;
+			static constexpr size_t kMaxMarkers = 512; // Distinct marker names with statistics
 
 		private:
-			void flush() {
-				std::ofstream log("profiler.txt", std::ios::app);
-				for (auto r : records)
-					log << r << "\n";
-				log.close();
-				records.clear();
-			}
-
-			std::vector<float>	records;
+			Profiler();
+			~Profiler();
+
+			ThreadLog* registerThread();
+			static uint64_t now();
+
+			struct MarkerHistory
+			{
+				const char* name = nullptr;
+				std::array<float, kStatsWindow> samples; // Ring of frame times, in ms
+				size_t numSamples = 0;
+				size_t next = 0;
+				uint64_t frameTotal = 0; // Accumulated during endFrame
+				bool hitThisFrame = false;
+			};
+
+			/// Markers are identified by their name pointer. Null if the table is full.
+			MarkerHistory* findMarker(const char* name);
+			const MarkerHistory* findMarker(const std::string& name) const;
+
+			static Profiler* sInstance;
+			static std::atomic<uint32_t> sGeneration;
+
+			mutable std::mutex m_threadsLock;
+			std::vector<std::unique_ptr<ThreadLog>> m_threads;
+
+			uint64_t m_frameStart;
+			std::vector<FrameCapture> m_frames; // Ring of kTraceFrames captures, reused so their events keep their memory
+			size_t m_nextFrame = 0;
+			size_t m_numFrames = 0;
+
+			std::vector<MarkerHistory> m_markers; // Capacity reserved up front, never reallocates
+			std::vector<std::pair<const char*, uint32_t>> m_markerSlots; // Hash table from name pointer to marker index
+			size_t m_numMarkerSlots = 0;
 		};
 
 } }
 
-#endif // _REV_CORE_TOOLS_PROFILER_H_
\ No newline at end of file
+#define REV_PROFILER_CONCAT_IMPL(a,b) a##b
+#define REV_PROFILER_CONCAT(a,b) REV_PROFILER_CONCAT_IMPL(a,b)
+/// Time the rest of the current scope
+#define REV_PROFILE_SCOPE(name) rev::core::Profiler::ScopedMarker REV_PROFILER_CONCAT(_profilerMarker, __LINE__)(name)
+
+#endif // _REV_CORE_TOOLS_PROFILER_H_
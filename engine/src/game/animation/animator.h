@@ -19,17 +19,21 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 #include <vector>
+#include <game/animation/skeleton.h>
 #include <game/scene/component.h>
-#include <game/scene/sceneNode.h>
-#include <game/scene/transform/transform.h>
 #include <graphics/scene/animation/animation.h>
 #include <memory>
 
 namespace rev::game {
 
+	/// Plays animations on a skeleton. Every joint of the clip drives the matching joint of the skeleton.
 	class Animator : public Component
 	{
 	public:
+		Animator(std::shared_ptr<Skeleton> skeleton)
+			: m_skeleton(std::move(skeleton))
+		{}
+
 		void pause();
 		void resume();
 		void reset();
@@ -39,35 +43,37 @@ namespace rev::game {
 			m_anim = anim;
 			m_time = 0;
 			m_loop = loop;
+			m_cursor.reset();
+			// Start from the rest pose, for properties the animation doesn't key
+			m_skeleton->getReferencePose(m_pose);
 		}
 
 		void init() override
 		{
 			m_time = 0;
-			m_tempPose.scale = math::Vec3f::ones();
-
-			m_target = node()->component<Transform>();
+			m_skeleton->getReferencePose(m_pose);
 		}
 
 		void update(float _dt) override {
+			if(!m_anim)
+				return;
 			m_time += _dt;
 			auto duration = m_anim->duration();
-			if(m_loop)
+			if(m_loop && duration > 0)
 			{
 				while(m_time > duration)
 					m_time -= duration;
 			}
 
-			m_anim->getChannelPose(0, m_time, m_tempPose);
-
-			m_target->xForm.position() = m_tempPose.translation;
-			m_target->xForm.setRotation(m_tempPose.rotation);
+			m_anim->getPose(m_time, m_cursor, m_pose);
+			m_skeleton->setPose(m_pose);
 		}
 
 	private:
-		gfx::Pose::JointPose m_tempPose;
-		Transform* m_target = nullptr;
-		float m_time;
+		gfx::Pose m_pose;
+		gfx::Animation::Cursor m_cursor;
+		std::shared_ptr<Skeleton> m_skeleton;
+		float m_time = 0;
 		bool m_loop = false;
 		std::shared_ptr<gfx::Animation> m_anim;
 	};
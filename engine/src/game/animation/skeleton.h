@@ -18,6 +18,7 @@
 // DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
+#include <algorithm>
 #include <vector>
 #include <graphics/scene/animation/animation.h>
 #include <game/scene/transform/transform.h>
@@ -26,6 +27,7 @@
 
 namespace rev::game {
 
+	/// Scene nodes driven by the joints of an animation, in the same order as the animation's joints
 	class Skeleton
 	{
 	public:
@@ -37,20 +39,29 @@ namespace rev::game {
 				gfx::Pose::JointPose nodePose;
 				nodePose.scale = math::Vec3f::ones();
 				auto transform = n->component<Transform>();
-				nodePose.rotation = transform->xForm.rotation();
-				nodePose.translation = transform->xForm.position();
+				m_jointTransforms.push_back(transform);
+				nodePose.rotation = transform->xForm().rotation();
+				nodePose.translation = transform->xForm().position();
+				m_referencePose.joints.push_back(nodePose);
 			}
 		}
 
+		size_t numJoints() const { return m_jointTransforms.size(); }
+
+		/// Joints beyond the end of the skeleton are ignored
 		void setPose(const gfx::Pose& pose)
 		{
-			int n = 0;
-			for(auto& joint : pose.joints)
+			auto numJoints = std::min(pose.joints.size(), m_jointTransforms.size());
+			for(size_t i = 0; i < numJoints; ++i)
 			{
-				auto& node = m_jointNodes[n++];
-				auto transform = node->component<Transform>();
-				transform->xForm.position() = joint.translation;
-				transform->xForm.setRotation(joint.rotation);
+				auto& joint = pose.joints[i];
+				auto& xForm = m_jointTransforms[i]->xForm();
+				xForm.position() = joint.translation;
+				xForm.setRotation(joint.rotation);
+				math::Mat33f scale = math::Mat33f::identity();
+				for(int c = 0; c < 3; ++c)
+					scale(c,c) = joint.scale[c];
+				xForm.matrix().block<3,3,0,0>() = xForm.matrix().block<3,3,0,0>() * scale;
 			}
 		}
 		void getReferencePose(gfx::Pose& dst) const { dst = m_referencePose; }
@@ -59,6 +70,7 @@ namespace rev::game {
 		gfx::Pose m_referencePose;
 
 		std::vector<std::shared_ptr<SceneNode>> m_jointNodes;
+		std::vector<Transform*> m_jointTransforms; // Owned by m_jointNodes
 	};
 
 }
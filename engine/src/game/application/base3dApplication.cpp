@@ -20,10 +20,14 @@
 #include "base3dApplication.h"
 
 #include <iostream>
+#include <sstream>
 
 #include <core/platform/cmdLineParser.h>
 #include <core/platform/fileSystem/fileSystem.h>
 #include <core/platform/osHandler.h>
+#include <core/tasks/jobSystem.h>
+#include <core/tools/log.h>
+#include <core/tools/profiler.h>
 #include <core/time/time.h>
 
 #include <graphics/backend/device.h>
@@ -49,6 +53,8 @@ namespace rev::game {
 		// Parse command line
 		core::CmdLineParser arguments;
 		arguments.addFlag("fullscreen", m_fullScreen);
+		arguments.addOption("trace", &m_traceFile);
+		arguments.addFlag("profile", m_profileReport);
 		getCommandLineOptions(arguments);
 		arguments.parse(argc, argv);
 		// Init engine
@@ -78,9 +84,21 @@ namespace rev::game {
 			}
 			//	render
 			render(frameTime);
+			core::Profiler::get()->endFrame();
 		}
 		end();
+		if (!m_traceFile.empty())
+			core::Profiler::get()->exportChromeTrace(m_traceFile);
+		if (m_profileReport)
+		{
+			std::stringstream report;
+			core::Profiler::get()->report(report);
+			core::Log::info("Profiler report\n", report.str());
+		}
 		core::FileSystem::end();
+		core::JobSystem::end();
+		core::Profiler::end();
+		core::Log::end();
 	}
 
 	//------------------------------------------------------------------------------------------------
@@ -88,7 +106,11 @@ namespace rev::game {
 	{
 		core::OSHandler::startUp();
 		core::Time::init();
+		core::Log::init();
+		core::Profiler::init();
+		core::Profiler::setThreadName("Main");
 		core::FileSystem::init();
+		core::JobSystem::init();
 
 		// Init input systems
 		rev::input::KeyboardInput::init();
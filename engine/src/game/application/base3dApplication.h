@@ -71,6 +71,8 @@ namespace rev::game {
 		float m_accumTime = 0;
 		math::Vec2u m_windowSize = { 640, 480 };
 		bool m_fullScreen = false;
+		std::string m_traceFile; // Chrome trace of the last frames is saved here on exit
+		bool m_profileReport = false; // Log per marker timings on exit
 	};
 
 }
\ No newline at end of file
@@ -45,7 +45,7 @@ namespace rev { namespace game {
 			mTransform = node()->component<Transform>();
 		}
 
-		void update(float) override
+		void lateUpdate(float) override
 		{
 			mLight->position = mTransform->absoluteXForm().position();
 		}
@@ -48,7 +48,7 @@ namespace rev { namespace game {
 		}
 
 		//------------------------------------------------------------------------------------------
-		void update(float _dt) override {
+		void lateUpdate(float _dt) override {
 			assert(mTransform);
 			mCam->setWorldTransform(mTransform->absoluteXForm());
 		}
@@ -19,6 +19,8 @@ namespace rev { namespace game {
 
 		virtual void init	() {}
 		virtual void update(float _dt) {}
+		/// Runs after world transforms have been updated, for components that consume them
+		virtual void lateUpdate(float _dt) {}
 
 		// -- attach and dettach --
 		// TODO: Is this really necessary?
@@ -0,0 +1,98 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace rev { namespace game {
+
+	class ComponentPoolBase
+	{
+	public:
+		static constexpr uint32_t cInvalid = uint32_t(-1);
+
+		virtual ~ComponentPoolBase() = default;
+		virtual void remove(uint32_t node) = 0;
+	};
+
+	/// Every component of type T attached to a node, indexed by the node's handle.
+	/// There is one pool per component type, so the type is resolved at compile time, without RTTI.
+	/// Components are kept densely packed, for systems that iterate over every component of a type.
+	/// Lookup from a node handle is O(1) through a sparse array of indices into the dense arrays.
+	template<class T>
+	class ComponentPool : public ComponentPoolBase
+	{
+	public:
+		static ComponentPool& get()
+		{
+			static ComponentPool sPool;
+			return sPool;
+		}
+
+		/// Only the first component of each type is kept for a node
+		bool add(uint32_t node, T* component)
+		{
+			if(node >= m_denseIndex.size())
+				m_denseIndex.resize(node + 1, cInvalid);
+			if(m_denseIndex[node] != cInvalid)
+				return false;
+			m_denseIndex[node] = uint32_t(m_components.size());
+			m_components.push_back(component);
+			m_owners.push_back(node);
+			return true;
+		}
+
+		void remove(uint32_t node) override
+		{
+			assert(find(node));
+			auto index = m_denseIndex[node];
+			// Move the last element into the hole
+			auto lastOwner = m_owners.back();
+			m_components[index] = m_components.back();
+			m_owners[index] = lastOwner;
+			m_denseIndex[lastOwner] = index;
+			m_components.pop_back();
+			m_owners.pop_back();
+			m_denseIndex[node] = cInvalid;
+		}
+
+		T* find(uint32_t node) const
+		{
+			if(node >= m_denseIndex.size() || m_denseIndex[node] == cInvalid)
+				return nullptr;
+			return m_components[m_denseIndex[node]];
+		}
+
+		size_t size() const { return m_components.size(); }
+		// Dense arrays for iteration. owners()[i] is the handle of the node that owns components()[i]
+		const std::vector<T*>& components() const { return m_components; }
+		const std::vector<uint32_t>& owners() const { return m_owners; }
+		auto begin() const { return m_components.begin(); }
+		auto end() const { return m_components.end(); }
+
+	private:
+		std::vector<uint32_t> m_denseIndex; // Per node handle
+		std::vector<T*> m_components;
+		std::vector<uint32_t> m_owners;
+	};
+
+}}
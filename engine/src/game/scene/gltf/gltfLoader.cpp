@@ -21,7 +21,8 @@
 
 #include "gltf.h"
 #include <core/platform/fileSystem/file.h>
-#include <core/tasks/threadPool.h>
+#include <core/tasks/jobSystem.h>
+#include <core/tools/profiler.h>
 #include <core/tools/log.h>
 #include <core/string_util.h>
 #include <nlohmann/json.hpp>
@@ -40,6 +41,8 @@
 #include <graphics/scene/animation/skinning.h>
 #include <graphics/renderer/material/Effect.h>
 #include <graphics/renderer/material/material.h>
+#include <atomic>
+#include <chrono>
 #include <vector>
 
 using Json = nlohmann::json;
@@ -70,19 +73,19 @@ namespace rev { namespace game {
 			auto& matrixDesc = _nodeDesc.matrix;
 			for(size_t i = 0; i < 3; ++i)
 				for(size_t j = 0; j < 4; ++j)
-					nodeTransform->xForm.matrix()(i,j) = matrixDesc[i+4*j];
+					nodeTransform->xForm().matrix()(i,j) = matrixDesc[i+4*j];
 		}
 		if(!_nodeDesc.rotation.empty())
 		{
 			useTransform = true;
 			Quatf rot = *reinterpret_cast<const Quatf*>(_nodeDesc.rotation.data());
-			nodeTransform->xForm.matrix().block<3,3,0,0>() = (Mat33f)rot;
+			nodeTransform->xForm().matrix().block<3,3,0,0>() = (Mat33f)rot;
 		}
 		if(!_nodeDesc.translation.empty())
 		{
 			useTransform = true;
 			for(size_t i = 0; i < 3; ++i)
-				nodeTransform->xForm.matrix()(i,3) = _nodeDesc.translation[i];
+				nodeTransform->xForm().matrix()(i,3) = _nodeDesc.translation[i];
 		}
 		if(!_nodeDesc.scale.empty())
 		{
@@ -90,7 +93,7 @@ namespace rev { namespace game {
 			Mat33f scale = Mat33f::identity();
 			for(size_t i = 0; i < 3; ++i)
 				scale(i,i) = _nodeDesc.scale[i];
-			nodeTransform->xForm.matrix().block<3,3,0,0>() = nodeTransform->xForm.matrix().block<3,3,0,0>() * scale;
+			nodeTransform->xForm().matrix().block<3,3,0,0>() = nodeTransform->xForm().matrix().block<3,3,0,0>() * scale;
 		}
 		if(useTransform)
 			return std::move(nodeTransform);
@@ -249,6 +252,17 @@ namespace rev { namespace game {
 		return attributes;
 	}
 
+	//----------------------------------------------------------------------------------------------
+	const gfx::RenderGeom::Attribute* findAttribute(
+		const gltf::Primitive& _primitive,
+		const char* tag,
+		const vector<gfx::RenderGeom::Attribute>& _attributes)
+	{
+		if(auto posIt = _primitive.attributes.find(tag); posIt != _primitive.attributes.end())
+			return &_attributes[posIt->second];
+		return nullptr;
+	}
+
 	//----------------------------------------------------------------------------------------------
 	const gfx::RenderGeom::Attribute* registerAttribute(
 		gfx::Device& device,
@@ -256,10 +270,10 @@ namespace rev { namespace game {
 		const char* tag,
 		const vector<gfx::RenderGeom::Attribute>& _attributes)
 	{
-		if(auto posIt = _primitive.attributes.find(tag); posIt != _primitive.attributes.end())
+		auto attribute = findAttribute(_primitive, tag, _attributes);
+		if(attribute)
 		{
-			auto& attribute = _attributes[posIt->second];
-			auto& bv = *attribute.bufferView;
+			auto& bv = *attribute->bufferView;
 		
 			if (!bv.vbo.isValid())
 			{
@@ -269,134 +283,212 @@ namespace rev { namespace game {
 					Device::BufferUsageTarget::Vertex,
 					bv.data);
 			}
-
-			return &attribute;
 		}
 
-		return nullptr;
+		return attribute;
 	}
 
 	//----------------------------------------------------------------------------------------------
-	gfx::RenderGeom::Attribute* generateTangentSpace(
-		gfx::Device& device,
-		const gfx::RenderGeom::Attribute* positions,
-		const gfx::RenderGeom::Attribute* uvs,
-		const gfx::RenderGeom::Attribute* normals,
-		const gfx::RenderGeom::Attribute* indices)
+	bool needsGeneratedTangents(const gltf::Document& _document, const gltf::Primitive& _primitive)
 	{
-		if(uvs->nComponents != 2)
-		{
-			core::Log::error("Only UVs with 2 components are supported");
-			return nullptr;
-		}
-		// Accessor data
-		auto tangents = new gfx::RenderGeom::Attribute;
-		tangents->componentType = (GLenum)gltf::Accessor::ComponentType::Float;
-		tangents->count = uvs->count;
-		tangents->nComponents = 4;
-		tangents->normalized = false;
-		tangents->offset = 0;
-		tangents->stride = 0;
-		// Buffer view
-		tangents->bufferView = make_shared<gfx::RenderGeom::BufferView>();
-		auto& tanBv = *tangents->bufferView;
-		tanBv.byteLength = tangents->count * tangents->nComponents * sizeof(float);
-		tanBv.byteStride = 0;
-		auto tangentVectors = new Vec4f[tangents->count];
-		memset(tangentVectors, 0, tangents->count * sizeof(Vec4f)); // Clear the tangents
-		tanBv.data = tangentVectors;
-
-		// Actual computation
-		auto nIndices = indices->count;
-		auto indexData = new uint32_t[indices->count];
-		if(indices->componentType == (GLenum)gltf::Accessor::ComponentType::UnsignedByte)
+		if(_primitive.indices < 0 || _primitive.material < 0)
+			return false;
+		if(_document.materials[_primitive.material].normalTexture.empty())
+			return false;
+		return !_primitive.attributes.count("TANGENT");
+	}
+
+	//----------------------------------------------------------------------------------------------
+	template<class Index>
+	void accumulateTangents(
+		const gfx::RenderGeom::Attribute& positions,
+		const gfx::RenderGeom::Attribute& uvs,
+		const gfx::RenderGeom::Attribute& indices,
+		vector<Vec4f>& tangentVectors)
+	{
+		auto indexData = &indices.get<Index>(0);
+		auto numVertices = tangentVectors.size();
+		for(GLsizei i = 0; i + 2 < indices.count; i += 3) // Iterate over all triangles
 		{
-			for(int i = 0; i < nIndices; ++i)
-				indexData[i] = uint32_t(indices->get<uint8_t>(i));
+			size_t i0 = indexData[i+0];
+			size_t i1 = indexData[i+1];
+			size_t i2 = indexData[i+2];
+			if(i0 >= numVertices || i1 >= numVertices || i2 >= numVertices)
+				continue;
+
+			// Plain floats, so the compiler keeps everything in registers
+			auto uv0 = uvs.get<Vec2f>(i0).data();
+			auto uv1 = uvs.get<Vec2f>(i1).data();
+			auto uv2 = uvs.get<Vec2f>(i2).data();
+			auto p0 = positions.get<Vec3f>(i0).data();
+			auto p1 = positions.get<Vec3f>(i1).data();
+			auto p2 = positions.get<Vec3f>(i2).data();
+			float du1 = uv1[0] - uv0[0], dv1 = uv1[1] - uv0[1];
+			float du2 = uv2[0] - uv0[0], dv2 = uv2[1] - uv0[1];
+
+			auto determinant = du1*dv2-du2*dv1;
+
+			// Unnormalized tangent
+			float invDeterminant = 1 / determinant;
+			Vec4f weightedTangent(
+				((p1[0]-p0[0]) * du1 - dv1 * (p2[0]-p0[0])) * invDeterminant,
+				((p1[1]-p0[1]) * du1 - dv1 * (p2[1]-p0[1])) * invDeterminant,
+				((p1[2]-p0[2]) * du1 - dv1 * (p2[2]-p0[2])) * invDeterminant,
+				determinant);
+
+			tangentVectors[i0] = tangentVectors[i0] + weightedTangent;
+			tangentVectors[i1] = tangentVectors[i1] + weightedTangent;
+			tangentVectors[i2] = tangentVectors[i2] + weightedTangent;
 		}
-		else if(indices->componentType == (GLenum)gltf::Accessor::ComponentType::UnsignedShort)
+	}
+
+	//----------------------------------------------------------------------------------------------
+	// Cpu side only, so it can run on any thread
+	bool generateTangentSpace(
+		const gfx::RenderGeom::Attribute& positions,
+		const gfx::RenderGeom::Attribute& uvs,
+		const gfx::RenderGeom::Attribute& normals,
+		const gfx::RenderGeom::Attribute& indices,
+		vector<Vec4f>& tangentVectors)
+	{
+		if(uvs.nComponents != 2)
 		{
-			for(int i = 0; i < nIndices; ++i)
-				indexData[i] = uint32_t(indices->get<uint16_t>(i));
+			core::Log::error("Only UVs with 2 components are supported");
+			return false;
 		}
+		tangentVectors.assign(uvs.count, Vec4f::zero());
+
+		// Accumulate per-triangle tangents
+		if(indices.componentType == (GLenum)gltf::Accessor::ComponentType::UnsignedByte)
+			accumulateTangents<uint8_t>(positions, uvs, indices, tangentVectors);
+		else if(indices.componentType == (GLenum)gltf::Accessor::ComponentType::UnsignedShort)
+			accumulateTangents<uint16_t>(positions, uvs, indices, tangentVectors);
 		else
+			accumulateTangents<uint32_t>(positions, uvs, indices, tangentVectors);
+
+		// Orthonormalize per vertex
+		for(size_t i = 0; i < tangentVectors.size(); ++i)
 		{
-			for(int i = 0; i < nIndices; ++i)
-				indexData[i] = uint32_t(indices->get<uint32_t>(i));
+			auto& tangent = tangentVectors[i];
+			auto normal = normals.get<Vec3f>(i).data();
+			float tx = tangent.x(), ty = tangent.y(), tz = tangent.z();
+
+			float projection = tx*normal[0] + ty*normal[1] + tz*normal[2];
+			tx = tx - projection*normal[0]; // Orthogonal tangent
+			ty = ty - projection*normal[1];
+			tz = tz - projection*normal[2];
+			float invNorm = 1 / std::sqrt(tx*tx + ty*ty + tz*tz); // Orthonormal tangent
+			tangent = { tx*invNorm, ty*invNorm, tz*invNorm, signbit(-tangent.w()) ? -1.f : 1.f };
 		}
-		// Accumulate per-triangle normals
-		for(int i = 0; i < nIndices;i += 3) // Iterate over all triangles
-		{
-			auto i0 = indexData[i+0];
-			auto i1 = indexData[i+1];
-			auto i2 = indexData[i+2];
-
-			Vec2f localUvs[3] = { uvs->get<Vec2f>(i0), uvs->get<Vec2f>(i1), uvs->get<Vec2f>(i2) };
-			Vec3f localPos[3] = { positions->get<Vec3f>(i0), positions->get<Vec3f>(i1), positions->get<Vec3f>(i2) };
-
-			Vec2f deltaUV1 = localUvs[1] - localUvs[0];
-			Vec2f deltaUV2 = localUvs[2] - localUvs[0];
-
-			Vec3f deltaPos1 = localPos[1] - localPos[0];
-			Vec3f deltaPos2 = localPos[2] - localPos[0];
-
-			auto determinant = deltaUV1.x()*deltaUV2.y()-deltaUV2.x()*deltaUV1.y();
-
-			// Unnormalized tangent
-			Vec3f triangleTangent = (deltaPos1 * deltaUV1.x() - deltaUV1.y() * deltaPos2) * (1 / determinant);
+		return true;
+	}
 
-			tangentVectors[i0] = tangentVectors[i0] + Vec4f(triangleTangent.x(), triangleTangent.y(), triangleTangent.z(), determinant);
-			tangentVectors[i1] = tangentVectors[i1] + Vec4f(triangleTangent.x(), triangleTangent.y(), triangleTangent.z(), determinant);
-			tangentVectors[i2] = tangentVectors[i2] + Vec4f(triangleTangent.x(), triangleTangent.y(), triangleTangent.z(), determinant);
-		}
+	//----------------------------------------------------------------------------------------------
+	// Generate the missing tangent spaces on the job system, one job per primitive.
+	// _tangents gets one entry per primitive, in document order, and must outlive the jobs.
+	auto scheduleTangentSpaces(
+		const gltf::Document& _document,
+		const vector<gfx::RenderGeom::Attribute>& _attributes,
+		vector<vector<Vec4f>>& _tangents,
+		atomic<uint64_t>& _cpuTimeUs)
+	{
+		size_t numPrimitives = 0;
+		for(auto& meshDesc : _document.meshes)
+			numPrimitives += meshDesc.primitives.size();
+		_tangents.clear();
+		_tangents.resize(numPrimitives);
 
-		// Orthonormalize per vertex
-		for(int i = 0; i < tangents->count; ++i)
+		vector<core::JobSystem::JobHandle> jobs;
+		size_t primitiveNdx = 0;
+		for(auto& meshDesc : _document.meshes)
 		{
-			auto& tangent = tangentVectors[i];
-			Vec3f tangent3 = { tangent.x(), tangent.y(), tangent.z() };
-			auto& normal = normals->get<Vec3f>(i);
-			
-			tangent3 = tangent3 - (dot(tangent3, normal) * normal); // Orthogonal tangent
-			tangent3 = normalize(tangent3); // Orthonormal tangent
-			tangent = { tangent3.x(), tangent3.y(), tangent3.z(), signbit(-tangent.w()) ? -1.f : 1.f };
+			for(auto& primitive : meshDesc.primitives)
+			{
+				auto& tangents = _tangents[primitiveNdx++];
+				if(!needsGeneratedTangents(_document, primitive))
+					continue;
+				auto positions = findAttribute(primitive, "POSITION", _attributes);
+				auto normals = findAttribute(primitive, "NORMAL", _attributes);
+				auto uvs = findAttribute(primitive, "TEXCOORD_0", _attributes);
+				if(!positions || !normals || !uvs) // Reported when the primitive is created
+					continue;
+				auto indices = &_attributes[primitive.indices];
+				jobs.push_back(core::JobSystem::get()->schedule([=, &tangents, &_cpuTimeUs]() {
+					REV_PROFILE_SCOPE("GltfLoader::generateTangentSpace");
+					auto start = std::chrono::high_resolution_clock::now();
+					generateTangentSpace(*positions, *uvs, *normals, *indices, tangents);
+					auto time = std::chrono::high_resolution_clock::now() - start;
+					_cpuTimeUs += (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(time).count();
+				}));
+			}
 		}
+		return jobs;
+	}
 
-		// TODO: Allocate buffer in graphics driver
+	//----------------------------------------------------------------------------------------------
+	gfx::RenderGeom::Attribute uploadTangents(gfx::Device& device, const vector<Vec4f>& tangentVectors)
+	{
+		// Accessor data
+		gfx::RenderGeom::Attribute tangents;
+		tangents.componentType = (GLenum)gltf::Accessor::ComponentType::Float;
+		tangents.count = (GLsizei)tangentVectors.size();
+		tangents.nComponents = 4;
+		tangents.normalized = false;
+		tangents.offset = 0;
+		tangents.stride = 0;
+		tangents.bounds.clear();
+		// Buffer view
+		tangents.bufferView = make_shared<gfx::RenderGeom::BufferView>();
+		auto& tanBv = *tangents.bufferView;
+		tanBv.byteLength = tangentVectors.size() * sizeof(Vec4f);
+		tanBv.byteStride = 0;
 		tanBv.vbo = device.allocateBuffer(
 			tanBv.byteLength,
 			Device::BufferUpdateFrequency::Static,
 			Device::BufferUsageTarget::Vertex,
-			tanBv.data);
-		delete[] reinterpret_cast<const Vec4f*>(tanBv.data);
-		delete[] indexData;
-		tanBv.data = nullptr;
+			tangentVectors.data());
+		tanBv.data = nullptr; // The cpu copy doesn't outlive the load
 
 		return tangents;
 	}
 
+	//----------------------------------------------------------------------------------------------
+	// Gpu buffers for all the primitive's data. Buffers shared with other primitives are only uploaded once.
+	void uploadPrimitiveBuffers(
+		gfx::Device& device,
+		const gltf::Primitive& _primitive,
+		const vector<gfx::RenderGeom::Attribute>& _attributes)
+	{
+		if(_primitive.indices < 0)
+			return;
+
+		auto& indices = *_attributes[_primitive.indices].bufferView;
+		if(!indices.vbo.isValid())
+		{
+			indices.vbo = device.allocateBuffer(
+				indices.byteLength,
+				Device::BufferUpdateFrequency::Static,
+				Device::BufferUsageTarget::Index,
+				indices.data);
+		}
+		for(auto tag : { "POSITION", "NORMAL", "TANGENT", "TEXCOORD_0", "WEIGHTS_0", "JOINTS_0" })
+			registerAttribute(device, _primitive, tag, _attributes);
+	}
+
 	//----------------------------------------------------------------------------------------------
 	shared_ptr<RenderGeom> loadPrimitive(
 		gfx::Device& device,
 		const gltf::Document& _document,
 		const vector<gfx::RenderGeom::Attribute>& _attributes,
 		const gltf::Primitive& _primitive,
-		bool _needsTangentSpace)
+		bool _needsTangentSpace,
+		const vector<Vec4f>& _generatedTangents)
 	{
 		// Early out for invalid data
 		if(_primitive.indices < 0)
 			return nullptr;
 
 		const gfx::RenderGeom::Attribute* indices = &_attributes[_primitive.indices];
-		if(!indices->bufferView->vbo.isValid())
-		{
-			auto& bv = *indices->bufferView;
-			indices->bufferView->vbo = device.allocateBuffer(
-				bv.byteLength,
-				Device::BufferUpdateFrequency::Static,
-				Device::BufferUsageTarget::Index,
-				bv.data);
-		}
 
 		// Read primitive attributes
 		const gfx::RenderGeom::Attribute* position = registerAttribute(device, _primitive, "POSITION", _attributes);
@@ -406,6 +498,7 @@ namespace rev { namespace game {
 		const gfx::RenderGeom::Attribute* weights = registerAttribute(device, _primitive, "WEIGHTS_0", _attributes);
 		const gfx::RenderGeom::Attribute* joints = registerAttribute(device, _primitive, "JOINTS_0", _attributes);
 
+		gfx::RenderGeom::Attribute generatedTangents;
 		if(_needsTangentSpace && !tangents)
 		{
 			if(!normals || !uv0)
@@ -413,21 +506,30 @@ namespace rev { namespace game {
 				core::Log::error("Mesh requires tangent space but doesn't provide normals or uvs. Normal generation is not supported. Skipping primitive");
 				return nullptr;
 			}
-			tangents = generateTangentSpace(device, position, uv0, normals, indices);
+			if(!_generatedTangents.empty())
+			{
+				generatedTangents = uploadTangents(device, _generatedTangents);
+				tangents = &generatedTangents;
+			}
 		}
 
 		return std::make_shared<RenderGeom>(indices, position, normals, tangents, uv0, weights, joints);
 	}
 
 	//----------------------------------------------------------------------------------------------
-	auto loadBufferViews(const gltf::Document& _document, const vector<core::File*>& buffers)
+	auto loadBufferViews(const gltf::Document& _document, const vector<string_view>& buffers)
 	{
 		vector<std::shared_ptr<gfx::RenderGeom::BufferView>> bvs;
 		bvs.reserve(_document.bufferViews.size());
 
 		for(auto& bv : _document.bufferViews)
 		{
-			auto bufferData = reinterpret_cast<const uint8_t*>(buffers[bv.buffer]->buffer());
+			auto& bufferData = buffers[bv.buffer];
+			if(size_t(bv.byteOffset) + bv.byteLength > bufferData.size())
+			{
+				core::Log::error("Buffer view out of the bounds of its buffer");
+				return decltype(bvs)();
+			}
 
 			gfx::RenderGeom::BufferView bufferView;
 			bufferView.byteStride = (GLint)bv.byteStride;
@@ -448,18 +550,33 @@ namespace rev { namespace game {
 	vector<shared_ptr<RenderMesh>> GltfLoader::loadMeshes(
 		const vector<gfx::RenderGeom::Attribute>& attributes,
 		const gltf::Document& _document,
-		const vector<shared_ptr<Material>>& _materials)
+		const vector<shared_ptr<Material>>& _materials,
+		const vector<core::JobSystem::JobHandle>& _tangentJobs,
+		const vector<vector<Vec4f>>& _generatedTangents)
 	{
+		REV_PROFILE_SCOPE("GltfLoader::loadMeshes");
+		using Clock = std::chrono::high_resolution_clock;
+
+		// Upload everything that's already available while tangents are still being generated
+		auto start = Clock::now();
+		for(auto& meshDesc : _document.meshes)
+			for(auto& primitive : meshDesc.primitives)
+				uploadPrimitiveBuffers(m_gfxDevice, primitive, attributes);
+		auto waitStart = Clock::now();
+		core::JobSystem::get()->wait(_tangentJobs);
+		auto waitEnd = Clock::now();
 
 		// Load the meshes
 		vector<shared_ptr<RenderMesh>> meshes;
 		meshes.reserve(_document.meshes.size());
+		size_t primitiveNdx = 0;
 		for(auto& meshDesc : _document.meshes)
 		{
 			meshes.push_back(make_shared<RenderMesh>());
 			auto mesh = meshes.back();
 			for(auto& primitive : meshDesc.primitives)
 			{
+				auto& generatedTangents = _generatedTangents[primitiveNdx++];
 				auto material = defaultMaterial();
 				bool needsTangentSpace = false;
 				if(primitive.material >= 0)
@@ -467,12 +584,19 @@ namespace rev { namespace game {
 					material = _materials[primitive.material];
 					needsTangentSpace = !_document.materials[primitive.material].normalTexture.empty();
 				}
-				auto geometry = loadPrimitive(m_gfxDevice, _document, attributes, primitive, needsTangentSpace);
+				auto geometry = loadPrimitive(m_gfxDevice, _document, attributes, primitive, needsTangentSpace, generatedTangents);
 				mesh->mPrimitives.emplace_back(geometry, material);
+				m_loadStats.numPrimitives++;
+				if(!generatedTangents.empty())
+					m_loadStats.numGeneratedTangentSpaces++;
 			}
 			mesh->updateBBox();
 		}
 
+		std::chrono::duration<float, std::milli> waitTime = waitEnd - waitStart;
+		std::chrono::duration<float, std::milli> totalTime = Clock::now() - start;
+		m_loadStats.tangentWaitMs = waitTime.count();
+		m_loadStats.geometryMs = totalTime.count() - waitTime.count();
 		return meshes;
 	}
 
@@ -591,19 +715,78 @@ namespace rev { namespace game {
 	}
 
 	//----------------------------------------------------------------------------------------------
-	bool openAndValidateDocument(const std::string& fullPath, const std::string& folder, gltf::Document& document)
+	bool isGlb(const core::File& _file)
+	{
+		uint32_t magic;
+		if(_file.size() < sizeof(magic))
+			return false;
+		memcpy(&magic, _file.buffer(), sizeof(magic));
+		return magic == gltf::detail::GLBHeaderMagic;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	// Locate the json chunk and the optional binary chunk of a glb container, in place
+	bool readGlbChunks(const core::File& _file, string_view& _json, string_view& _bin)
+	{
+		auto data = _file.buffer<char>();
+		gltf::detail::GLBHeader header;
+		if(_file.size() < gltf::detail::HeaderSize)
+		{
+			core::Log::error("Invalid GLB file");
+			return false;
+		}
+		memcpy(&header, data, gltf::detail::HeaderSize);
+		if(header.version != 2
+			|| header.length > _file.size()
+			|| header.length < gltf::detail::HeaderSize
+			|| header.jsonHeader.chunkType != gltf::detail::GLBChunkJSON
+			|| header.jsonHeader.chunkLength > header.length - gltf::detail::HeaderSize)
+		{
+			core::Log::error("Invalid GLB header");
+			return false;
+		}
+		_json = string_view(data + gltf::detail::HeaderSize, header.jsonHeader.chunkLength);
+
+		// The binary chunk, when present, holds the first buffer
+		_bin = string_view();
+		size_t binOffset = gltf::detail::HeaderSize + header.jsonHeader.chunkLength;
+		if(binOffset + gltf::detail::ChunkHeaderSize <= header.length)
+		{
+			gltf::detail::ChunkHeader binHeader;
+			memcpy(&binHeader, data + binOffset, gltf::detail::ChunkHeaderSize);
+			size_t binBegin = binOffset + gltf::detail::ChunkHeaderSize;
+			if(binHeader.chunkType == gltf::detail::GLBChunkBIN && binHeader.chunkLength <= header.length - binBegin)
+				_bin = string_view(data + binBegin, binHeader.chunkLength);
+		}
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	// Buffers are not read here. They are left for the loader to point into, wherever they are.
+	bool openAndValidateDocument(const core::File& sceneFile, gltf::Document& document, string_view& binChunk)
 	{
-		// Open file
-		core::File sceneFile(fullPath);
 		if(!sceneFile.size()) {
 			core::Log::error("Unable to find scene asset");
 			return false;
 		}
+		string_view jsonText(sceneFile.buffer<char>(), sceneFile.size());
+		binChunk = string_view();
+		if(isGlb(sceneFile) && !readGlbChunks(sceneFile, jsonText, binChunk))
+			return false;
+
 		// Load gltf document
-		auto jsonText = sceneFile.buffer<char>();
-		document = gltf::detail::Create(
-			Json::parse(jsonText, nullptr, false),
-			{ folder, {}});
+		auto json = Json::parse(jsonText.begin(), jsonText.end(), nullptr, false);
+		if(json.is_discarded()) {
+			core::Log::error("Unable to parse scene asset");
+			return false;
+		}
+		try {
+			document = json;
+		}
+		catch(const std::exception& e) {
+			core::Log::error("Invalid gltf document: ", e.what());
+			return false;
+		}
 
 		// Verify document is supported
 		auto asset = document.asset;
@@ -623,12 +806,11 @@ namespace rev { namespace game {
 		const gltf::Document& document,
 		const vector<gfx::RenderGeom::Attribute>& accessors,
 		std::vector<std::shared_ptr<SceneNode>>& sceneNodes,
-		std::vector<std::shared_ptr<SceneNode>>& animNodes,
+		std::vector<std::shared_ptr<Skeleton>>& skeletons,
 		vector<shared_ptr<Animation>>& _animations)
 	{
 		for(auto& animDesc : document.animations)
 		{
-			auto& animation = _animations.emplace_back(make_shared<Animation>());
 			std::vector<int> usedNodes;
 			// Precompute channels (TODO: Use this to generate a real skeleton)
 
@@ -643,28 +825,38 @@ namespace rev { namespace game {
 				else
 					usedNodes.push_back(targetNode);
 			}
-			// Mark first animated node
-			animNodes.push_back(sceneNodes[usedNodes[0]]);
-			// Resize animation to fit all the channels
-			animation->m_translationChannels.resize(usedNodes.size());
-			animation->m_rotationChannels.resize(usedNodes.size());
+			// Joints follow the order in which the animation first targets each node
+			std::vector<std::shared_ptr<SceneNode>> jointNodes;
+			for(auto nodeNdx : usedNodes)
+				jointNodes.push_back(sceneNodes[nodeNdx]);
+			skeletons.push_back(make_shared<Skeleton>(jointNodes));
+			// One channel of each kind per animated node
+			vector<Animation::Channel<math::Vec3f>> translations(usedNodes.size());
+			vector<Animation::Channel<math::Quatf>> rotations(usedNodes.size());
+			vector<Animation::Channel<math::Vec3f>> scales(usedNodes.size());
+			auto loadChannel = [&](auto& channel, const gltf::Animation::Sampler& sampler) {
+				using Value = typename std::decay_t<decltype(channel.values)>::value_type;
+				auto time = accessors[sampler.input];
+				auto values = accessors[sampler.output];
+				for(int i = 0; i < time.count; ++i)
+				{
+					channel.t.push_back(time.get<float>(i));
+					channel.values.push_back(values.get<Value>(i));
+				}
+			};
 			// Load channel contents
 			for(auto& channelDesc : animDesc.channels)
 			{
 				auto channelNdx = std::find(usedNodes.begin(), usedNodes.end(), channelDesc.target.node) - usedNodes.begin();
-				if(channelDesc.target.path == "rotation")
-				{
-					auto& channel = animation->m_rotationChannels[channelNdx];
-					auto sampler = animDesc.samplers[channelDesc.sampler];
-					auto time = accessors[sampler.input];
-					auto values = accessors[sampler.output];
-					for(int i = 0; i < time.count; ++i)
-					{
-						channel.t.push_back(time.get<float>(i));
-						channel.values.push_back(values.get<math::Quatf>(i));
-					}
-				}
+				auto& sampler = animDesc.samplers[channelDesc.sampler];
+				if(channelDesc.target.path == "translation")
+					loadChannel(translations[channelNdx], sampler);
+				else if(channelDesc.target.path == "rotation")
+					loadChannel(rotations[channelNdx], sampler);
+				else if(channelDesc.target.path == "scale")
+					loadChannel(scales[channelNdx], sampler);
 			}
+			_animations.push_back(make_shared<Animation>(translations, rotations, scales));
 		}
 	}
 
@@ -673,42 +865,128 @@ namespace rev { namespace game {
 		SceneNode& _parentNode,
 		const std::string& _filePath,
 		gfx::RenderScene& _gfxWorld,
-		std::vector<std::shared_ptr<SceneNode>>& animNodes,
+		std::vector<std::shared_ptr<Skeleton>>& skeletons,
 		vector<shared_ptr<Animation>>& _animations)
 	{
+		REV_PROFILE_SCOPE("GltfLoader::load");
+		using Clock = std::chrono::high_resolution_clock;
+		m_loadStats = LoadStats();
+		auto loadStart = Clock::now();
+		auto lapStart = loadStart;
+		// Milliseconds since the last lap
+		auto lap = [&lapStart]() {
+			auto now = Clock::now();
+			std::chrono::duration<float, std::milli> time = now - lapStart;
+			lapStart = now;
+			return time.count();
+		};
+
 		// Open file
 		m_assetsFolder = core::getPathFolder(_filePath);
+		// Binary files must stay mapped until all the geometry has been uploaded to the gpu
+		core::File sceneFile(_filePath, core::File::LoadMode::Mapped);
 
 		// Load gltf document
 		gltf::Document document;
-		if(!openAndValidateDocument(_filePath, m_assetsFolder, document))
+		string_view binChunk;
+		if(!openAndValidateDocument(sceneFile, document, binChunk))
 			return;
+		m_loadStats.documentMs = lap();
 
-		// Load buffers
-		vector<core::File*> buffers;
-		for(auto b : document.buffers)
-			buffers.push_back(new core::File(m_assetsFolder +b.uri));
-		auto bufferViews = loadBufferViews(document, buffers); // // Load buffer views
-		auto attributes = readAttributes(document, bufferViews); // Load accessors
+		// Start reading external buffers in the background, mapped straight into memory.
+		vector<unique_ptr<core::File>> bufferFiles(document.buffers.size());
+		vector<core::JobSystem::JobHandle> bufferJobs;
+		for(size_t i = 0; i < document.buffers.size(); ++i)
+		{
+			auto& b = document.buffers[i];
+			if(!b.uri.empty() && !b.IsEmbeddedResource())
+			{
+				bufferJobs.push_back(core::File::readAsync(m_assetsFolder + b.uri, core::File::LoadMode::Mapped,
+					[&bufferFiles, i](unique_ptr<core::File> file) { bufferFiles[i] = std::move(file); }));
+			}
+		}
 
-		// Load resources
+		// Images don't depend on buffers, so they can load while buffer I/O is in flight
 		loadImages(document);
 		m_textures.resize(document.textures.size());
-		auto skins = loadSkins(attributes, document);
+		m_loadStats.imagesMs = lap();
+
+		// Gather buffer contents, wherever they live.
+		// Waiting through the job system keeps this thread running jobs, even when the loader itself runs in one.
+		core::JobSystem::get()->wait(bufferJobs);
+		vector<string_view> buffers(document.buffers.size());
+		for(size_t i = 0; i < document.buffers.size(); ++i)
+		{
+			auto& b = document.buffers[i];
+			if(bufferFiles[i])
+				buffers[i] = string_view(bufferFiles[i]->buffer<char>(), bufferFiles[i]->size());
+			else if(b.uri.empty()) // Only the first buffer can refer to the glb binary chunk
+				buffers[i] = i ? string_view() : binChunk;
+			else
+			{
+				try {
+					b.MaterializeData(); // Base64 encoded in the uri
+				}
+				catch(const std::exception& e) {
+					core::Log::error("Unable to decode buffer ", i, " of ", _filePath, ": ", e.what());
+				}
+				buffers[i] = string_view(reinterpret_cast<const char*>(b.data.data()), b.data.size());
+			}
+			if(buffers[i].size() < b.byteLength)
+			{
+				core::Log::error("Unable to load buffer ", i, " of ", _filePath);
+				return;
+			}
+		}
+		auto bufferViews = loadBufferViews(document, buffers); // // Load buffer views
+		if(bufferViews.size() != document.bufferViews.size())
+			return;
+		auto attributes = readAttributes(document, bufferViews); // Load accessors
+		m_loadStats.buffersMs = lap();
+
+		// Cpu only work goes to the job system: tangent space generation and skins.
+		// Meanwhile, this thread creates every gpu resource, so the device is only ever used from here.
+		atomic<uint64_t> tangentCpuTimeUs = 0;
+		vector<vector<Vec4f>> generatedTangents;
+		auto tangentJobs = scheduleTangentSpaces(document, attributes, generatedTangents, tangentCpuTimeUs);
+		vector<shared_ptr<SkinInstance>> skins;
+		auto skinsJob = core::JobSystem::get()->schedule([&]() {
+			skins = loadSkins(attributes, document);
+		});
+
+		loadEmbeddedImages(document, bufferViews);
+		m_loadStats.imagesMs += lap();
 		auto materials = loadMaterials(document);
-		auto meshes = loadMeshes(attributes, document, materials);
+		m_loadStats.materialsMs = lap();
+		auto meshes = loadMeshes(attributes, document, materials, tangentJobs, generatedTangents);
+		m_loadStats.tangentJobsMs = tangentCpuTimeUs / 1000.f;
+		lap();
 
 		// Load nodes
+		core::JobSystem::get()->wait(skinsJob);
 		auto nodes = loadNodes(document, meshes, skins, materials, _gfxWorld);
 
 		// Load animations
-		loadAnimations(document, attributes, nodes, animNodes, _animations);
+		loadAnimations(document, attributes, nodes, skeletons, _animations);
+		m_loadStats.nodesMs = lap();
 
 		// Return the right scene
 		int sceneIndex = document.scene == -1 ? 0 : document.scene;
 		auto& displayScene = document.scenes[sceneIndex];
 		for(auto nodeNdx : displayScene.nodes)
 			_parentNode.addChild(nodes[nodeNdx]);
+
+		std::chrono::duration<float, std::milli> totalTime = Clock::now() - loadStart;
+		m_loadStats.totalMs = totalTime.count();
+		auto& stats = m_loadStats;
+		core::Log::info("Loaded ", _filePath, " in ", stats.totalMs, "ms. ",
+			stats.numPrimitives, " primitives, ", stats.numGeneratedTangentSpaces, " generated tangent spaces. Stages (ms): document ", stats.documentMs,
+			", buffers ", stats.buffersMs,
+			", images ", stats.imagesMs,
+			", materials ", stats.materialsMs,
+			", geometry ", stats.geometryMs,
+			", tangents wait ", stats.tangentWaitMs, " (", stats.tangentJobsMs, " in jobs)",
+			", nodes ", stats.nodesMs);
 	}
 
 	std::shared_ptr<Effect> GltfLoader::metallicRoughnessEffect()
@@ -742,20 +1020,43 @@ namespace rev { namespace game {
 		m_loadedImages.resize(document.images.size());
 
 		// Load images in parallel
-		core::ThreadPool workers(8);
-		workers.run(document.images,
-			[this](const gltf::Image& imageDesc, size_t taskId) {
-				// Load image from file
-				m_loadedImages[taskId] = gfx::Image::load(m_assetsFolder + imageDesc.uri, 0);
-			},
-			std::cout);
+		core::JobSystem::get()->parallel_for(0, document.images.size(), 1,
+			[&](size_t i) {
+				// Load image from file. Images without uri live in buffer views.
+				if(!document.images[i].uri.empty())
+					m_loadedImages[i] = gfx::Image::load(m_assetsFolder + document.images[i].uri, 0);
+			});
 
 		// Report not found images
 		for (size_t i = 0; i < document.images.size(); ++i)
 		{
-			if (!m_loadedImages[i])
+			if (!m_loadedImages[i] && !document.images[i].uri.empty())
+			{
+				core::Log::error("Unable to load ", document.images[i].uri);
+			}
+		}
+	}
+
+	void GltfLoader::loadEmbeddedImages(
+		const gltf::Document& document,
+		const std::vector<std::shared_ptr<gfx::RenderGeom::BufferView>>& bufferViews)
+	{
+		// Decode straight from the buffers, in parallel
+		core::JobSystem::get()->parallel_for(0, document.images.size(), 1,
+			[&](size_t i) {
+				auto& imageDesc = document.images[i];
+				if(imageDesc.uri.empty() && size_t(imageDesc.bufferView) < bufferViews.size())
+				{
+					auto& bv = *bufferViews[imageDesc.bufferView];
+					m_loadedImages[i] = gfx::Image::decode(bv.data, bv.byteLength, 0);
+				}
+			});
+
+		for (size_t i = 0; i < document.images.size(); ++i)
+		{
+			if (!m_loadedImages[i] && document.images[i].uri.empty())
 			{
-				std::cout << "Unable to load " << document.images[i].uri << "\n";
+				core::Log::error("Unable to decode image ", i, " from buffer view ", document.images[i].bufferView);
 			}
 		}
 	}
@@ -21,6 +21,7 @@
 
 #include <string>
 #include "../sceneNode.h"
+#include <core/tasks/jobSystem.h>
 #include <graphics/backend/texture2d.h>
 #include <graphics/scene/renderScene.h>
 #include <graphics/scene/renderGeom.h>
@@ -29,7 +30,10 @@
 
 namespace fx::gltf { struct Document; }
 
-namespace rev::game { class SceneNode; }
+namespace rev::game {
+	class SceneNode;
+	class Skeleton;
+}
 
 namespace rev::gfx {
 	class Animation;
@@ -51,17 +55,38 @@ namespace rev::game {
 
 		~GltfLoader();
 
+		/// Time spent in each stage of the last call to load
+		struct LoadStats
+		{
+			float documentMs = 0.f; // Reading and parsing the document
+			float buffersMs = 0.f; // Waiting for buffer data, and reading accessors
+			float imagesMs = 0.f; // Loading and decoding images
+			float materialsMs = 0.f; // Materials, including the creation of their textures
+			float geometryMs = 0.f; // Gpu buffers and vertex arrays
+			float tangentWaitMs = 0.f; // Time the loading thread waited for tangent generation jobs, helping with them
+			float tangentJobsMs = 0.f; // Cpu time spent in tangent generation jobs, across all threads
+			float nodesMs = 0.f; // Scene nodes, skins and animations
+			float totalMs = 0.f;
+			size_t numPrimitives = 0;
+			size_t numGeneratedTangentSpaces = 0;
+		};
+
 		/// Load a gltf scene
 		/// Add renderable content to _gfxWorld
 		/// filePath must not contain folder, file name and extension
+		/// Both .gltf files and binary .glb containers are supported
+		/// Cpu side work runs on the job system, but gpu resources are always created on the calling thread
 		/// If parentNode is not nullptr, all the scene nodes will be added as children to it
+		/// Every animation comes with the skeleton of the nodes it drives, at the same index
 		void load(
 			SceneNode& parentNode,
 			const std::string& filePath,
 			gfx::RenderScene& _gfxWorld,
-			std::vector<std::shared_ptr<SceneNode>>& animNodes,
+			std::vector<std::shared_ptr<Skeleton>>& skeletons,
 			std::vector<std::shared_ptr<gfx::Animation>>& _animations);
 
+		const LoadStats& loadStats() const { return m_loadStats; }
+
 	private:
 		// Shared resources
 		std::shared_ptr<gfx::Effect> metallicRoughnessEffect();
@@ -80,10 +105,13 @@ namespace rev::game {
 			const fx::gltf::Document& _document
 		);
 
+		/// _generatedTangents has an entry per primitive, filled by _tangentJobs
 		std::vector<std::shared_ptr<gfx::RenderMesh>> loadMeshes(
 			const std::vector<gfx::RenderGeom::Attribute>& attributes,
 			const fx::gltf::Document& _document,
-			const std::vector<std::shared_ptr<gfx::Material>>& _materials);
+			const std::vector<std::shared_ptr<gfx::Material>>& _materials,
+			const std::vector<core::JobSystem::JobHandle>& _tangentJobs,
+			const std::vector<std::vector<math::Vec4f>>& _generatedTangents);
 
 		std::vector<std::shared_ptr<game::SceneNode>> loadNodes(
 			const fx::gltf::Document& _document,
@@ -92,11 +120,15 @@ namespace rev::game {
 			const std::vector<std::shared_ptr<gfx::Material>>& _materials,
 			gfx::RenderScene& _gfxWorld);
 
-		void loadImages(const fx::gltf::Document&);
+		void loadImages(const fx::gltf::Document&); ///< Images in their own files
+		void loadEmbeddedImages( ///< Images stored in buffer views
+			const fx::gltf::Document&,
+			const std::vector<std::shared_ptr<gfx::RenderGeom::BufferView>>& bufferViews);
 
 	private:
 		gfx::Device& m_gfxDevice;
 		std::string m_assetsFolder;
+		LoadStats m_loadStats;
 
 		// Cached resources
 		gfx::Texture2d m_invalidTexture;
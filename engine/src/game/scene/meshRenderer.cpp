@@ -24,7 +24,7 @@ namespace rev { namespace game {
 	}
 
 	//------------------------------------------------------------------------------------------------------------------
-	void MeshRenderer::update(float _dt) {
+	void MeshRenderer::lateUpdate(float _dt) {
 		mRenderable->transform = mSrcTransform->absoluteXForm().matrix();
 	}
 
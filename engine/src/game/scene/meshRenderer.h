@@ -38,7 +38,7 @@ namespace rev { namespace game {
 		}
 
 		void init		() override;
-		void update		(float _dt) override;
+		void lateUpdate	(float _dt) override;
 
 		const	gfx::RenderObj& renderObj() const { return *mRenderable; }
 				gfx::RenderObj& renderObj() { return *mRenderable; }
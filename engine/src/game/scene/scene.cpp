@@ -0,0 +1 @@
+Scene.cpp
\ No newline at end of file
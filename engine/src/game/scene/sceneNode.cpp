@@ -28,6 +28,41 @@ using namespace rev::gfx;
 
 namespace rev { namespace game {
 
+	namespace {
+		uint32_t sNextHandle = 0;
+		std::vector<uint32_t> sFreeHandles;
+
+		// Keep handles compact, so component pools stay small
+		uint32_t allocateHandle()
+		{
+			if(sFreeHandles.empty())
+				return sNextHandle++;
+			auto handle = sFreeHandles.back();
+			sFreeHandles.pop_back();
+			return handle;
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	SceneNode::SceneNode()
+		: mHandle(allocateHandle())
+	{}
+
+	//------------------------------------------------------------------------------------------------------------------
+	SceneNode::SceneNode(const std::string& _name)
+		: name(_name)
+		, mHandle(allocateHandle())
+	{}
+
+	//------------------------------------------------------------------------------------------------------------------
+	SceneNode::~SceneNode()
+	{
+		for(auto pool : mComponentPools)
+			if(pool)
+				pool->remove(mHandle);
+		sFreeHandles.push_back(mHandle);
+	}
+
 	//------------------------------------------------------------------------------------------------------------------
 	void SceneNode::init() {
 		for(auto& c : mComponents)
@@ -45,14 +80,21 @@ namespace rev { namespace game {
 	}
 
 	//------------------------------------------------------------------------------------------------------------------
-	void SceneNode::addComponent(std::unique_ptr<Component> _c)
+	void SceneNode::lateUpdate(float _dt) {
+		for(auto& c : mComponents)
+			c->lateUpdate(_dt);
+		for(auto c : mChildren)
+			c->lateUpdate(_dt);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void SceneNode::attachComponent(std::unique_ptr<Component> _c, ComponentPoolBase* pool)
 	{
-		if(!_c)
-			return;
 		assert(!_c->node());
 		assert(_c->node() != this);
 		_c->attachTo(this);
 		mComponents.emplace_back(std::move(_c));
+		mComponentPools.push_back(pool);
 	}
 
 	//--------------------------------------------------------------------------------------------------------------
@@ -18,8 +18,11 @@
 // DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
+#include <memory>
+#include <type_traits>
 #include <vector>
 #include "component.h"
+#include "componentPool.h"
 #include <iostream>
 #include <string>
 #include <nlohmann/json.hpp>
@@ -34,11 +37,11 @@ namespace rev { namespace game {
 	public:
 		void init();
 		void update(float _dt);
+		void lateUpdate(float _dt);
 
-		SceneNode() = default;
-		SceneNode(const std::string& _name)
-			: name(_name)
-		{}
+		SceneNode();
+		SceneNode(const std::string& _name);
+		~SceneNode();
 		SceneNode(const SceneNode&) = delete;
 		SceneNode& operator=(const SceneNode&) = delete;
 
@@ -47,17 +50,32 @@ namespace rev { namespace game {
 		void	addChild		(std::shared_ptr<SceneNode> child);
 		std::shared_ptr<SceneNode>	createChild(const std::string& name);
 		auto&	children		() const { return mChildren; }
-		void	addComponent	(std::unique_ptr<Component> _c);
 		auto&	components		() const { return mComponents; }
+		/// Unique among live nodes. Handles of destroyed nodes are reused.
+		uint32_t handle			() const { return mHandle; }
 
-		template<class T_>	
-		T_*					component		() const {
-			for (auto& c : mComponents) {
-				auto rawPtr = c.get();
-				if(typeid(*rawPtr) == typeid(T_))
-					return static_cast<T_*>(rawPtr);
+		/// Components are registered in the pool of their static type, T.
+		/// Components added through a plain Component pointer can't be looked up by type.
+		template<class T>
+		T* addComponent(std::unique_ptr<T> _c)
+		{
+			if(!_c)
+				return nullptr;
+			ComponentPoolBase* pool = nullptr;
+			if constexpr(!std::is_same_v<T, Component>)
+			{
+				if(ComponentPool<T>::get().add(mHandle, _c.get()))
+					pool = &ComponentPool<T>::get();
 			}
-			return nullptr;
+			auto component = _c.get();
+			attachComponent(std::move(_c), pool);
+			return component;
+		}
+
+		/// First component of type T added to this node, if any.
+		template<class T_>
+		T_*					component		() const {
+			return ComponentPool<T_>::get().find(mHandle);
 		}
 
 		// This traverse includes the node itself
@@ -74,15 +92,18 @@ namespace rev { namespace game {
 		template<class T, class ... Args>
 		T* addComponent(Args ... args)
 		{
-			addComponent(std::make_unique<T>(args...));
-			return static_cast<T*>(mComponents.back().get());
+			return addComponent(std::make_unique<T>(args...));
 		}
 
 		std::string name;
 
 	private:
+		void attachComponent(std::unique_ptr<Component> _c, ComponentPoolBase* pool);
+
+		uint32_t mHandle;
 		SceneNode* mParent = nullptr;
 		std::vector<std::shared_ptr<SceneNode>> mChildren;
 		std::vector<std::unique_ptr<Component>>	mComponents;
+		std::vector<ComponentPoolBase*>	mComponentPools; // Pool each component is registered in, if any
 	};
 }}
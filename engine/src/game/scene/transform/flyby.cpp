@@ -42,7 +42,7 @@ namespace rev {
 				velocity.y() += deltaV;
 			if (input->held(KeyboardInput::Key::KeyDown))
 				velocity.y() -= deltaV;
-			auto& transform = mSrcTransform->xForm;
+			auto& transform = mSrcTransform->xForm();
 			transform.position() = transform.position() + transform.rotateDirection(velocity) * (_dt * mSpeed);
 
 			// Rotation
@@ -69,7 +69,7 @@ namespace rev { namespace game {
 					// Recompute transform
 					auto pan = math::Quatf({0.f,0.f,1.f}, angles.x());
 					auto tilt = math::Quatf({1.f,0.f,0.f}, angles.y());
-					mSrcTransform->xForm.setRotation(pan * tilt);
+					mSrcTransform->xForm().setRotation(pan * tilt);
 				}
 				else wasDown = false;
 			}
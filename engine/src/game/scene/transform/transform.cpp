@@ -22,23 +22,47 @@
 
 namespace rev { namespace game {
 
-	void Transform::update(float _dt)
+	//----------------------------------------------------------------------------------------------
+	Transform::Transform()
 	{
-		if(node())
+		m_id = hierarchy().add(math::AffineTransform::identity());
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Transform::Transform(std::istream& _in)
+		: Transform()
+	{
+		_in.read((char*)matrix().data(), 12*sizeof(float));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Transform::~Transform()
+	{
+		hierarchy().remove(m_id);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void Transform::init()
+	{
+		if(!node())
+			return;
+		for(auto parent = node()->parent(); parent; parent = parent->parent())
 		{
-			auto parent = node()->parent();
-			while(parent)
+			if(auto pXForm = parent->component<Transform>())
 			{
-				auto pXForm = parent->component<Transform>();
-				if(pXForm)
-				{
-					mAbsoluteXForm = pXForm->absoluteXForm() * xForm;
-					return;
-				} else
-					parent = parent->parent();
+				hierarchy().setParent(m_id, pXForm->m_id);
+				return;
 			}
 		}
-		mAbsoluteXForm = xForm;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	TransformHierarchy& Transform::hierarchy()
+	{
+		// Never destroyed, on purpose. Transforms owned by other statics can be destroyed after this
+		// function's own statics would be, and still need to remove themselves from the hierarchy.
+		static TransformHierarchy* sHierarchy = new TransformHierarchy();
+		return *sHierarchy;
 	}
 
 }}
\ No newline at end of file
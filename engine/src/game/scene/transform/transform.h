@@ -4,35 +4,43 @@
 #pragma once
 
 #include "../component.h"
+#include "transformHierarchy.h"
 #include <math/algebra/affineTransform.h>
 #include <graphics/debug/debugGUI.h>
 #include <graphics/debug/imgui.h>
 
 namespace rev { namespace game {
 
+	/// Local transform of a node, relative to the closest ancestor with a Transform.
+	/// Both local and world transforms live in a single hierarchy shared by all Transform components,
+	/// in every scene. It is updated once per frame, between update and lateUpdate of components.
 	class Transform : public Component
 	{
 	public:
-		math::AffineTransform xForm;
+		Transform();
+		Transform(std::istream& _in);
+		~Transform();
 
-		math::Mat44f&			matrix() { return xForm.matrix(); }
-		const math::Mat44f&		matrix() const { return xForm.matrix(); }
+		/// Mutable access flags the transform, so it and its descendants get updated
+		math::AffineTransform&			xForm() { return hierarchy().local(m_id); }
+		const math::AffineTransform&	xForm() const { return sharedHierarchy().local(m_id); }
 
-		Transform()// = default;
-		{
-			xForm.matrix().setIdentity();
-			mAbsoluteXForm.matrix().setIdentity();
-		}
-		Transform(std::istream& _in)
-		{
-			_in.read((char*)xForm.matrix().data(), 12*sizeof(float));
-		}
+		math::Mat44f&			matrix() { return xForm().matrix(); }
+		const math::Mat44f&		matrix() const { return xForm().matrix(); }
 
-		void update(float _dt) override;
-		const math::AffineTransform& absoluteXForm() const { return mAbsoluteXForm; }
+		/// Links this transform to its parent's. Reparenting nodes after init is not tracked.
+		void init() override;
+		/// As of the last hierarchy update
+		const math::AffineTransform& absoluteXForm() const { return sharedHierarchy().world(m_id); }
+
+		/// Process wide, created on first use and intentionally leaked, so Transforms can be
+		/// destroyed at any point, including during static destruction.
+		static TransformHierarchy& hierarchy();
 
 	private:
-		math::AffineTransform mAbsoluteXForm;
+		static const TransformHierarchy& sharedHierarchy() { return hierarchy(); }
+
+		TransformHierarchy::Id m_id;
 	};
 
 } }	// namespace rev::game
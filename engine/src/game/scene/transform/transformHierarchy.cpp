@@ -0,0 +1,277 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "transformHierarchy.h"
+#include <core/tasks/jobSystem.h>
+#include <core/tools/profiler.h>
+
+#include <cassert>
+
+using namespace rev::math;
+
+namespace rev::game {
+
+	namespace {
+		// Below this, splitting a level costs more than it saves
+		constexpr size_t cMinNodesPerChunk = 4 * 1024;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	TransformHierarchy::Id TransformHierarchy::add(const AffineTransform& local, Id parent)
+	{
+		assert(parent == cInvalid || !m_removed[m_slot[parent]]);
+		Id id;
+		if(m_freeIds.empty())
+		{
+			id = Id(m_slot.size());
+			m_slot.push_back(0);
+		}
+		else
+		{
+			id = m_freeIds.back();
+			m_freeIds.pop_back();
+		}
+		m_slot[id] = uint32_t(m_local.size());
+		m_local.push_back(local);
+		m_world.push_back(local);
+		m_parent.push_back(parent);
+		m_parentSlot.push_back(cInvalid);
+		m_id.push_back(id);
+		m_dirty.push_back(1);
+		m_removed.push_back(0);
+
+		m_anyDirty = true;
+		m_structureChanged = true;
+		return id;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void TransformHierarchy::remove(Id node)
+	{
+		// Removed nodes stay in place until the next update, so their children can still find their way up
+		auto slot = m_slot[node];
+		assert(!m_removed[slot]);
+		m_removed[slot] = 1;
+		++m_numRemoved;
+		m_structureChanged = true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void TransformHierarchy::setParent(Id node, Id parent)
+	{
+		assert(node != parent);
+		assert(parent == cInvalid || !m_removed[m_slot[parent]]);
+		auto slot = m_slot[node];
+		if(m_parent[slot] == parent)
+			return;
+		m_parent[slot] = parent;
+		m_dirty[slot] = 1;
+		m_anyDirty = true;
+		m_structureChanged = true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	TransformHierarchy::Id TransformHierarchy::parent(Id node) const
+	{
+		auto parent = m_parent[m_slot[node]];
+		while(parent != cInvalid && m_removed[m_slot[parent]])
+			parent = m_parent[m_slot[parent]];
+		return parent;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	AffineTransform& TransformHierarchy::local(Id node)
+	{
+		auto slot = m_slot[node];
+		m_dirty[slot] = 1;
+		m_anyDirty = true;
+		return m_local[slot];
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void TransformHierarchy::update(core::JobSystem* jobs)
+	{
+		REV_PROFILE_SCOPE("TransformHierarchy::update");
+		if(m_structureChanged)
+			sortByDepth();
+
+		m_numUpdated = 0;
+		if(!m_anyDirty)
+			return;
+
+		for(size_t level = 0; level + 1 < m_levels.size(); ++level)
+			updateLevel(m_levels[level], m_levels[level + 1], jobs);
+
+		std::fill(m_dirty.begin(), m_dirty.end(), 0);
+		m_anyDirty = false;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void TransformHierarchy::sortByDepth()
+	{
+		const size_t numSlots = m_local.size();
+
+		// Skip removed ancestors. Nodes that get a new parent this way need their world transform updated.
+		for(size_t slot = 0; slot < numSlots; ++slot)
+		{
+			if(m_removed[slot])
+				continue;
+			auto ancestor = parent(m_id[slot]);
+			if(ancestor != m_parent[slot])
+			{
+				m_parent[slot] = ancestor;
+				m_dirty[slot] = 1;
+				m_anyDirty = true;
+			}
+		}
+
+		// Children of every slot, in compressed rows: children of slot s are in [firstChild[s], firstChild[s+1])
+		std::vector<uint32_t> firstChild(numSlots + 1, 0);
+		for(size_t slot = 0; slot < numSlots; ++slot)
+		{
+			if(!m_removed[slot] && m_parent[slot] != cInvalid)
+				++firstChild[m_slot[m_parent[slot]] + 1];
+		}
+		for(size_t slot = 0; slot < numSlots; ++slot)
+			firstChild[slot + 1] += firstChild[slot];
+		std::vector<uint32_t> children(firstChild.back());
+		std::vector<uint32_t> childCursor(firstChild.begin(), firstChild.end() - 1);
+		for(size_t slot = 0; slot < numSlots; ++slot)
+		{
+			if(!m_removed[slot] && m_parent[slot] != cInvalid)
+				children[childCursor[m_slot[m_parent[slot]]]++] = uint32_t(slot);
+		}
+
+		// Breadth first order, starting from all roots at once, so nodes end up sorted by depth.
+		// Siblings are contiguous and follow the order of their parents, so each level reads the
+		// world transforms of the previous one front to back, instead of jumping around memory.
+		const size_t numNodes = numSlots - m_numRemoved;
+		std::vector<uint32_t> order;
+		order.reserve(numNodes);
+		for(size_t slot = 0; slot < numSlots; ++slot)
+		{
+			if(!m_removed[slot] && m_parent[slot] == cInvalid)
+				order.push_back(uint32_t(slot));
+		}
+		m_levels.assign(1, 0);
+		for(size_t begin = 0; begin < order.size();)
+		{
+			size_t end = order.size();
+			m_levels.push_back(uint32_t(end));
+			for(size_t i = begin; i < end; ++i)
+			{
+				auto slot = order[i];
+				order.insert(order.end(), children.begin() + firstChild[slot], children.begin() + firstChild[slot + 1]);
+			}
+			begin = end;
+		}
+		assert(order.size() == numNodes); // Nodes in cycles are never reached from a root
+
+		for(size_t slot = 0; slot < numSlots; ++slot)
+		{
+			if(m_removed[slot])
+			{
+				m_slot[m_id[slot]] = cInvalid;
+				m_freeIds.push_back(m_id[slot]);
+			}
+		}
+
+		std::vector<AffineTransform> local(numNodes);
+		std::vector<AffineTransform> world(numNodes);
+		std::vector<Id> parents(numNodes);
+		std::vector<Id> ids(numNodes);
+		std::vector<uint8_t> dirty(numNodes);
+		for(size_t dst = 0; dst < numNodes; ++dst)
+		{
+			auto slot = order[dst];
+			local[dst] = m_local[slot];
+			world[dst] = m_world[slot];
+			parents[dst] = m_parent[slot];
+			ids[dst] = m_id[slot];
+			dirty[dst] = m_dirty[slot];
+			m_slot[m_id[slot]] = uint32_t(dst);
+		}
+
+		m_local = std::move(local);
+		m_world = std::move(world);
+		m_parent = std::move(parents);
+		m_id = std::move(ids);
+		m_dirty = std::move(dirty);
+		m_removed.assign(numNodes, 0);
+		m_parentSlot.resize(numNodes);
+		for(size_t slot = 0; slot < numNodes; ++slot)
+			m_parentSlot[slot] = m_parent[slot] == cInvalid ? cInvalid : m_slot[m_parent[slot]];
+
+		m_numRemoved = 0;
+		m_structureChanged = false;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void TransformHierarchy::updateLevel(size_t begin, size_t end, core::JobSystem* jobs)
+	{
+		// Parents live in previous levels, which are already up to date.
+		// Updated nodes stay flagged, so their children are updated in the next level.
+		// Raw pointers, so the compiler doesn't reload the arrays after every store
+		const AffineTransform* local = m_local.data();
+		AffineTransform* world = m_world.data();
+		const uint32_t* parentSlot = m_parentSlot.data();
+		uint8_t* dirty = m_dirty.data();
+		auto updateRange = [=](size_t first, size_t last) {
+			size_t numUpdated = 0;
+			for(size_t i = first; i < last; ++i)
+			{
+				auto parent = parentSlot[i];
+				if(parent == cInvalid)
+				{
+					if(!dirty[i])
+						continue;
+					world[i] = local[i];
+				}
+				else
+				{
+					if(!(dirty[i] | dirty[parent]))
+						continue;
+					world[i] = world[parent] * local[i];
+					dirty[i] = 1;
+				}
+				++numUpdated;
+			}
+			return numUpdated;
+		};
+
+		const size_t numNodes = end - begin;
+		size_t numChunks = 1;
+		if(jobs)
+			numChunks = std::max<size_t>(1, std::min(jobs->numWorkers() + 1, numNodes / cMinNodesPerChunk));
+		if(numChunks == 1)
+		{
+			m_numUpdated += updateRange(begin, end);
+			return;
+		}
+
+		const size_t chunkSize = (numNodes + numChunks - 1) / numChunks;
+		std::vector<size_t> chunkUpdates(numChunks);
+		jobs->parallel_for(0, numChunks, 1, [&](size_t chunk) {
+			auto first = begin + chunk * chunkSize;
+			chunkUpdates[chunk] = updateRange(first, std::min(end, first + chunkSize));
+		});
+		for(auto n : chunkUpdates)
+			m_numUpdated += n;
+	}
+}
@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <math/algebra/affineTransform.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace rev::core {
+	class JobSystem;
+}
+
+namespace rev::game {
+
+	/// Flat store of local and world transforms for a forest of nodes.
+	/// Transforms live in contiguous arrays sorted by depth in the hierarchy, so world transforms can be
+	/// updated one level at a time, with every parent already up to date when its children are processed.
+	/// Inside each level, siblings are stored together and in the same order as their parents.
+	/// Only nodes whose local transform changed, and their descendants, are recomputed on update.
+	/// Structural changes (add, remove, reparent) are cheap, and the arrays are re-sorted on the next update.
+	class TransformHierarchy
+	{
+	public:
+		using Id = uint32_t;
+		static constexpr Id cInvalid = Id(-1);
+
+		Id add(const math::AffineTransform& local, Id parent = cInvalid);
+		/// Children of removed nodes are attached to the removed node's parent
+		void remove(Id);
+		/// parent must not be node itself or one of its descendants
+		void setParent(Id node, Id parent);
+		Id parent(Id node) const;
+
+		/// Mutable access flags the node, so its world transform and those of its descendants are updated.
+		/// References are invalidated by add and update.
+		math::AffineTransform& local(Id node);
+		const math::AffineTransform& local(Id node) const { return m_local[m_slot[node]]; }
+		void setLocal(Id node, const math::AffineTransform& local) { this->local(node) = local; }
+		/// As of the last update
+		const math::AffineTransform& world(Id node) const { return m_world[m_slot[node]]; }
+
+		/// Recompute world transforms of flagged nodes and their descendants.
+		/// Large levels of the hierarchy are split into chunks that run in parallel on the job system.
+		void update(core::JobSystem* jobs = nullptr);
+
+		size_t size() const { return m_local.size() - m_numRemoved; }
+		size_t numLevels() const { return m_levels.empty() ? 0 : m_levels.size() - 1; }
+		/// World transforms recomputed in the last update
+		size_t numUpdated() const { return m_numUpdated; }
+
+	private:
+		void sortByDepth();
+		void updateLevel(size_t begin, size_t end, core::JobSystem* jobs);
+
+		// Per node, indexed by Id
+		std::vector<uint32_t> m_slot; // Position of the node in the arrays below
+		std::vector<Id> m_freeIds;
+
+		// Per slot, sorted by depth after an update
+		std::vector<math::AffineTransform> m_local;
+		std::vector<math::AffineTransform> m_world;
+		std::vector<Id> m_parent;
+		std::vector<uint32_t> m_parentSlot;
+		std::vector<Id> m_id;
+		std::vector<uint8_t> m_dirty; // Bytes rather than bits, so different threads can write neighbours
+		std::vector<uint8_t> m_removed;
+
+		std::vector<uint32_t> m_levels; // Slot where each level starts, plus one past the end
+		size_t m_numRemoved = 0;
+		size_t m_numUpdated = 0;
+		bool m_anyDirty = false;
+		bool m_structureChanged = false;
+	};
+}
@@ -92,6 +92,8 @@ namespace rev::gfx {
 
 		// Note: nChannels = 0 sets automatic number of channels
 		static std::unique_ptr<Image> load(std::string_view _name, unsigned nChannels);
+		// Decode an image already in memory, in any of the formats load supports
+		static std::unique_ptr<Image> decode(const void* _data, size_t _size, unsigned nChannels);
 
 	private:
 		// Base constructor from size and data
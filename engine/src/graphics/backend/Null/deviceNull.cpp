@@ -0,0 +1,243 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "deviceNull.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace rev :: gfx
+{
+	//----------------------------------------------------------------------------------------------
+	DeviceNull::DeviceNull()
+		: m_renderQueue(*this)
+	{
+		// Limits of a typical desktop GPU
+		m_deviceLimits.computeWorkGroupCount = math::Vec3i(65535, 65535, 65535);
+		m_deviceLimits.computeWorkGroupSize = math::Vec3i(1024, 1024, 64);
+		m_deviceLimits.computeWorkGruopTotalInvokes = 1024;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	TextureSampler DeviceNull::createTextureSampler(const TextureSampler::Descriptor& desc)
+	{
+		TextureSampler sampler;
+		sampler.id = m_samplers.add(desc);
+		m_resources.numSamplers++;
+		return sampler;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void DeviceNull::destroyTextureSampler(TextureSampler sampler)
+	{
+		m_samplers.remove(sampler.id);
+		m_resources.numSamplers--;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	size_t DeviceNull::textureBytes(const Texture2d::Descriptor& descriptor)
+	{
+		size_t numLevels = descriptor.mipLevels;
+		if(numLevels == 0) // Full mip chain
+		{
+			numLevels = 1;
+			for(auto side = std::max(descriptor.size.x(), descriptor.size.y()); side > 1; side /= 2)
+				++numLevels;
+		}
+
+		size_t bytes = 0;
+		math::Vec2u mipSize = descriptor.size;
+		for(size_t level = 0; level < numLevels; ++level)
+		{
+			bytes += mipSize.x() * mipSize.y() * descriptor.pixelFormat.pixelSize();
+			mipSize = math::Vec2u(std::max(1u, mipSize.x() / 2), std::max(1u, mipSize.y() / 2));
+		}
+		return bytes * descriptor.nFaces;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Texture2d DeviceNull::createTexture2d(const Texture2d::Descriptor& descriptor)
+	{
+		assert(descriptor.srcImages.size() <= descriptor.mipLevels * descriptor.nFaces
+			|| descriptor.mipLevels == 0);
+		assert(descriptor.mipLevels > 0 || descriptor.srcImages.size() > 0);
+		assert(m_samplers.isLive(descriptor.sampler.id));
+
+		auto bytes = textureBytes(descriptor);
+		m_resources.numTextures++;
+		m_resources.textureBytes += bytes;
+		for(auto& image : descriptor.srcImages)
+			m_resources.uploadedBytes += image->area() * image->format().pixelSize();
+
+		return Texture2d(m_textures.add(bytes));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void DeviceNull::destroyTexture2d(Texture2d texture)
+	{
+		m_resources.textureBytes -= m_textures[texture.id()];
+		m_resources.numTextures--;
+		m_textures.remove(texture.id());
+	}
+
+	//----------------------------------------------------------------------------------------------
+	FrameBuffer DeviceNull::createFrameBuffer(const FrameBuffer::Descriptor& desc)
+	{
+		for(size_t i = 0; i < desc.numAttachments; ++i)
+			assert(m_textures.isLive(desc.attachments[i].texture.id()));
+		m_resources.numFrameBuffers++;
+		return FrameBuffer(m_frameBuffers.add(desc));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void DeviceNull::destroyFrameBuffer(FrameBuffer fb)
+	{
+		assert(fb.id() > 0 && "Can't destroy the default frame buffer");
+		m_frameBuffers.remove(fb.id());
+		m_resources.numFrameBuffers--;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void DeviceNull::bindFrameBuffer(FrameBuffer fb)
+	{
+		assert(fb.id() == 0 || m_frameBuffers.isLive(fb.id()));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void DeviceNull::bindPass(int32_t pass, RenderQueue&)
+	{
+		assert(m_passes.isLive(pass));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	RenderPass* DeviceNull::createRenderPass(const RenderPass::Descriptor& desc)
+	{
+		// Reserve the handle first, so the pass can be constructed with it
+		auto id = m_passes.add(nullptr);
+		m_passes[id] = std::make_unique<RenderPassNull>(desc, id);
+		m_resources.numRenderPasses++;
+		return m_passes[id].get();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void DeviceNull::destroyRenderPass(const RenderPass& pass)
+	{
+		m_passes.remove(pass.id());
+		m_resources.numRenderPasses--;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Pipeline::ShaderModule DeviceNull::createShaderModule(const Pipeline::ShaderModule::Descriptor& desc)
+	{
+		Pipeline::ShaderModule shader;
+		shader.id = m_shaderModules.add(desc.stage);
+		m_resources.numShaderModules++;
+		return shader;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Pipeline DeviceNull::createPipeline(const Pipeline::Descriptor& desc)
+	{
+		assert(m_shaderModules.isLive(desc.vtxShader.id));
+		assert(m_shaderModules.isLive(desc.pxlShader.id));
+		assert(m_shaderModules[desc.vtxShader.id] == Pipeline::ShaderModule::Descriptor::Vertex);
+		assert(m_shaderModules[desc.pxlShader.id] == Pipeline::ShaderModule::Descriptor::Pixel);
+
+		Pipeline pipeline;
+		pipeline.id = m_pipelines.add(desc);
+		m_resources.numPipelines++;
+		return pipeline;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void DeviceNull::bindPipeline(int32_t pipelineId)
+	{
+		assert(m_pipelines.isLive(pipelineId));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	ComputeShader DeviceNull::createComputeShader(const std::vector<std::string>& code)
+	{
+		size_t codeLength = 0;
+		for(auto& fragment : code)
+			codeLength += fragment.size();
+		m_resources.numComputeShaders++;
+		return ComputeShader(m_computeShaders.add(codeLength));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void DeviceNull::destroyComputeShader(const ComputeShader& shader)
+	{
+		m_renderQueue.onComputeShaderDestroyed(shader);
+		m_computeShaders.remove(shader.id());
+		m_resources.numComputeShaders--;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Buffer DeviceNull::allocateBuffer(size_t byteSize, BufferUpdateFrequency, BufferUsageTarget, const void* data)
+	{
+		std::vector<uint8_t> contents(byteSize);
+		if(data)
+		{
+			std::memcpy(contents.data(), data, byteSize);
+			m_resources.uploadedBytes += byteSize;
+		}
+		m_resources.numBuffers++;
+		m_resources.bufferBytes += byteSize;
+		return Buffer(m_buffers.add(std::move(contents)));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void DeviceNull::deallocateBuffer(Buffer buffer)
+	{
+		m_resources.bufferBytes -= m_buffers[buffer.id()].size();
+		m_resources.numBuffers--;
+		m_buffers.remove(buffer.id());
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void DeviceNull::resubmitBufferData(Buffer buffer, size_t byteSize, BufferUpdateFrequency, BufferUsageTarget, const void* data)
+	{
+		auto& contents = m_buffers[buffer.id()];
+		m_resources.bufferBytes += byteSize;
+		m_resources.bufferBytes -= contents.size();
+		contents.resize(byteSize);
+		if(data)
+		{
+			std::memcpy(contents.data(), data, byteSize);
+			m_resources.uploadedBytes += byteSize;
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void* DeviceNull::mapBuffer(Buffer buffer, BufferUsageTarget, size_t offset, size_t length)
+	{
+		auto& contents = m_buffers[buffer.id()];
+		assert(offset + length <= contents.size());
+		m_resources.uploadedBytes += length; // Assume whatever is mapped gets written
+		return contents.data() + offset;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void DeviceNull::unmapBuffer(Buffer buffer, BufferUsageTarget)
+	{
+		assert(m_buffers.isLive(buffer.id()));
+	}
+}
@@ -0,0 +1,166 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include "../device.h"
+#include "renderPassNull.h"
+#include "renderQueueNull.h"
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+namespace rev :: gfx
+{
+	// Device that doesn't talk to any graphics API.
+	// Resources are just handles with some bookkeeping, and submitted command buffers are only inspected and counted.
+	// This lets renderers, render graphs and command buffers run headless, e.g. for cpu side tests and benchmarks.
+	// Like OpenGL, it still needs GL headers to compile, but never calls into GL, so no context or window is needed.
+	class DeviceNull : public Device
+	{
+	public:
+		DeviceNull();
+
+		RenderQueue& renderQueue() override
+		{
+			return m_renderQueue;
+		}
+
+		// Texture sampler
+		TextureSampler	createTextureSampler(const TextureSampler::Descriptor&) override;
+		void			destroyTextureSampler(TextureSampler) override;
+
+		// Texture
+		Texture2d	createTexture2d(const Texture2d::Descriptor&) override;
+		void		destroyTexture2d(Texture2d) override;
+
+		// Frame buffers
+		FrameBuffer createFrameBuffer(const FrameBuffer::Descriptor&) override;
+		void destroyFrameBuffer(FrameBuffer) override;
+		void bindFrameBuffer(FrameBuffer) override;
+		FrameBuffer defaultFrameBuffer() const { return FrameBuffer(0); } // Stands in for the back buffer
+
+		// Render passes
+		void bindPass(int32_t pass, RenderQueue& queue) override;
+		RenderPass* createRenderPass(const RenderPass::Descriptor& desc) override;
+		void destroyRenderPass(const RenderPass&) override;
+
+		// Pipeline
+		Pipeline::ShaderModule createShaderModule(const Pipeline::ShaderModule::Descriptor&) override;
+		Pipeline createPipeline(const Pipeline::Descriptor&) override;
+		void bindPipeline(int32_t pipelineId) override;
+
+		// Compute shaders
+		ComputeShader createComputeShader(const std::vector<std::string>& code) override;
+		void destroyComputeShader(const ComputeShader& shader) override;
+
+		// Buffers. Contents are kept in host memory, so mapped buffers can be written to.
+		Buffer allocateBuffer(size_t byteSize, BufferUpdateFrequency, BufferUsageTarget, const void* data = nullptr) override;
+		void deallocateBuffer(Buffer) override;
+		void resubmitBufferData(Buffer handle, size_t byteSize, BufferUpdateFrequency freq, BufferUsageTarget target, const void* data) override;
+		void* mapBuffer(Buffer buffer, BufferUsageTarget usage, size_t offset, size_t length) override;
+		void unmapBuffer(Buffer buffer, BufferUsageTarget usage) override;
+		const std::vector<uint8_t>& bufferContents(Buffer buffer) { return m_buffers[buffer.id()]; }
+
+		// Live resources, and the memory they would take on a real device
+		struct ResourceCounters
+		{
+			size_t numSamplers = 0;
+			size_t numTextures = 0;
+			size_t numFrameBuffers = 0;
+			size_t numRenderPasses = 0;
+			size_t numShaderModules = 0;
+			size_t numPipelines = 0;
+			size_t numComputeShaders = 0;
+			size_t numBuffers = 0;
+			size_t textureBytes = 0;
+			size_t bufferBytes = 0;
+			size_t uploadedBytes = 0; // Accumulated data sent to buffers and textures. Never decreases.
+		};
+
+		const ResourceCounters& resources() const { return m_resources; }
+
+		static size_t textureBytes(const Texture2d::Descriptor&);
+
+	private:
+		// Handles are indices into a table. Released handles are recycled, like GL names would be.
+		template<class T>
+		class HandleTable
+		{
+		public:
+			HandleTable(int32_t firstHandle = 0)
+			{
+				m_slots.resize(firstHandle); // Reserved handles are never live
+				m_live.resize(firstHandle, false);
+			}
+
+			int32_t add(T value)
+			{
+				if(m_free.empty())
+				{
+					m_slots.push_back(std::move(value));
+					m_live.push_back(true);
+					return int32_t(m_slots.size() - 1);
+				}
+				auto handle = m_free.back();
+				m_free.pop_back();
+				m_slots[handle] = std::move(value);
+				m_live[handle] = true;
+				return handle;
+			}
+
+			void remove(int32_t handle)
+			{
+				assert(isLive(handle) && "Destroying a resource that doesn't exist");
+				m_slots[handle] = T();
+				m_live[handle] = false;
+				m_free.push_back(handle);
+			}
+
+			bool isLive(int32_t handle) const
+			{
+				return handle >= 0 && size_t(handle) < m_live.size() && m_live[handle];
+			}
+
+			T& operator[](int32_t handle)
+			{
+				assert(isLive(handle));
+				return m_slots[handle];
+			}
+
+		private:
+			std::vector<T> m_slots;
+			std::vector<bool> m_live;
+			std::vector<int32_t> m_free;
+		};
+
+		RenderQueueNull m_renderQueue;
+		ResourceCounters m_resources;
+
+		HandleTable<TextureSampler::Descriptor> m_samplers;
+		HandleTable<size_t> m_textures { 1 }; // Byte size of each texture. Zero is not a valid texture name.
+		HandleTable<FrameBuffer::Descriptor> m_frameBuffers { 1 }; // Zero is the default frame buffer
+		HandleTable<std::unique_ptr<RenderPassNull>> m_passes;
+		HandleTable<Pipeline::ShaderModule::Descriptor::Stage> m_shaderModules;
+		HandleTable<Pipeline::Descriptor> m_pipelines;
+		HandleTable<size_t> m_computeShaders { 1 }; // Length of the source code
+		HandleTable<std::vector<uint8_t>> m_buffers { 1 }; // Host copy of the buffer contents
+	};
+}
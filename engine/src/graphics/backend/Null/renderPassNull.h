@@ -0,0 +1,45 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include "../renderPass.h"
+#include <vector>
+
+namespace rev :: gfx
+{
+	class RenderQueueNull;
+
+	class RenderPassNull : public RenderPass
+	{
+	public:
+		RenderPassNull(const Descriptor& desc, int32_t id);
+
+		void reset() override;
+		void setViewport(const math::Vec2u& start, const math::Vec2u& size) override;
+		void record(const CommandBuffer&) override;
+
+		void submit(RenderQueueNull& renderQueue) const;
+		const Descriptor& descriptor() const { return m_desc; }
+
+	private:
+		Descriptor m_desc;
+		std::vector<const CommandBuffer*> m_commandList;
+	};
+}
@@ -0,0 +1,190 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "renderQueueNull.h"
+#include "deviceNull.h"
+
+#include <cassert>
+#include "graphics/debug/imgui.h"
+
+namespace rev :: gfx
+{
+	using Command = CommandBuffer::Command;
+
+	//----------------------------------------------------------------------------------------------
+	RenderQueueNull::RenderQueueNull(DeviceNull& device)
+		: m_device(device)
+	{}
+
+	//----------------------------------------------------------------------------------------------
+	void RenderQueueNull::present()
+	{
+		m_counters = Counters();
+		m_state.resetCounters();
+		++m_numFrames;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void RenderQueueNull::changeState(bool needed)
+	{
+		if(needed)
+			m_counters.numStateChanges++;
+		else
+			m_counters.numElidedStateChanges++;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void RenderQueueNull::bindTexture(int pos, Texture2d texture)
+	{
+		auto slotIter = m_textureSlots.find(pos);
+		if(slotIter == m_textureSlots.end())
+			slotIter = m_textureSlots.emplace(pos, (int)m_textureSlots.size()).first;
+		int texStage = slotIter->second;
+		changeState(m_state.bindTexture(texStage, texture.id()));
+		changeState(m_state.setUniform(pos, texStage));
+		m_counters.numTextures++;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void RenderQueueNull::submitCommandBuffer(const CommandBuffer& cmdBuffer)
+	{
+		m_state.invalidate();
+		m_counters.numSubmissions++;
+		m_counters.numCommands += cmdBuffer.commands().size();
+		m_counters.commandBytes += cmdBuffer.memoryUsage();
+
+		for(auto& cmd : cmdBuffer.commands())
+		{
+			switch(cmd.command)
+			{
+				case Command::BeginPass:
+					m_device.bindPass(cmd.payload, *this);
+					m_state.invalidate();
+					m_counters.numPasses++;
+					break;
+				case Command::BindFrameBuffer:
+					m_device.bindFrameBuffer(cmd.payload);
+					break;
+				case Command::Clear:
+					if(cmd.payload & (int32_t)Clear::Depth)
+						m_state.invalidatePipeline();
+					break;
+				case Command::SetPipeline:
+				{
+					m_device.bindPipeline(cmd.payload);
+					bool changed = m_state.setPipeline(cmd.payload);
+					changeState(changed);
+					if(changed)
+						m_counters.numPipelineChanges++;
+					break;
+				}
+				case Command::SetUniformFloat:
+				{
+					auto& uniform = cmdBuffer.getUniform<float>(cmd.payload);
+					changeState(m_state.setUniform(uniform.pos, uniform.value));
+					m_counters.numUniforms++;
+					break;
+				}
+				case Command::SetUniformVec3:
+				{
+					auto& uniform = cmdBuffer.getUniform<math::Vec3f>(cmd.payload);
+					changeState(m_state.setUniform(uniform.pos, uniform.value));
+					m_counters.numUniforms++;
+					break;
+				}
+				case Command::SetUniformVec4:
+				{
+					auto& uniform = cmdBuffer.getUniform<math::Vec4f>(cmd.payload);
+					changeState(m_state.setUniform(uniform.pos, uniform.value));
+					m_counters.numUniforms++;
+					break;
+				}
+				case Command::SetUniformMat4:
+				{
+					auto& uniform = cmdBuffer.getUniform<math::Mat44f>(cmd.payload);
+					changeState(m_state.setUniform(uniform.pos, uniform.value));
+					m_counters.numUniforms++;
+					break;
+				}
+				case Command::SetUniformMat4Array:
+				case Command::SetStorageBuffer:
+				case Command::SetComputeOutput:
+					changeState(true);
+					m_counters.numUniforms++;
+					break;
+				case Command::SetUniformTexture:
+				{
+					auto& uniform = cmdBuffer.getUniform<Texture2d>(cmd.payload);
+					bindTexture(uniform.pos, uniform.value);
+					m_counters.numUniforms++;
+					break;
+				}
+				case Command::SetVtxData:
+					changeState(m_state.setVertexArray(cmd.payload));
+					break;
+				case Command::DrawTriangles:
+					m_counters.numTriangles += cmdBuffer.getDraw(cmd.payload).nIndices / 3;
+					m_counters.numInstances++;
+					m_counters.numDraws++;
+					break;
+				case Command::DrawBatches:
+				{
+					// Draw commands live in device memory, which we keep a copy of
+					auto& batchInfo = cmdBuffer.getBatch(cmd.payload);
+					auto& contents = m_device.bufferContents(batchInfo.batchBuffer);
+					auto batches = reinterpret_cast<const CommandBuffer::BatchCommand*>(contents.data());
+					assert((batchInfo.firstBatch + batchInfo.numBatches) * sizeof(CommandBuffer::BatchCommand) <= contents.size());
+					for(uint32_t i = batchInfo.firstBatch; i < batchInfo.firstBatch + batchInfo.numBatches; ++i)
+					{
+						m_counters.numTriangles += batches[i].count / 3 * batches[i].instanceCount;
+						m_counters.numInstances += batches[i].instanceCount;
+					}
+					m_counters.numIndirectDraws += batchInfo.numBatches;
+					m_counters.numDraws++;
+					break;
+				}
+				case Command::DrawLines:
+					m_counters.numDraws++;
+					break;
+				case Command::SetComputeProgram:
+					changeState(m_state.setComputeProgram(cmd.payload));
+					break;
+				case Command::DispatchCompute:
+					m_counters.numDispatches++;
+					break;
+				default: // Commands without any state worth tracking
+					break;
+			}
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void RenderQueueNull::drawPerformanceCounters() const
+	{
+		ImGui::Text("Command buffers: %d", (int)m_counters.numSubmissions);
+		ImGui::Text("Commands: %d (%.1f KB)", (int)m_counters.numCommands, m_counters.commandBytes / 1024.f);
+		ImGui::Text("Triangles: %d", (int)m_counters.numTriangles);
+		ImGui::Text("Uniforms: %d", (int)m_counters.numUniforms);
+		ImGui::Text("Textures: %d", (int)m_counters.numTextures);
+		ImGui::Text("State changes: %d (%d elided)", (int)m_counters.numStateChanges, (int)m_counters.numElidedStateChanges);
+		ImGui::Text("Draws: %d (%d indirect)", (int)m_counters.numDraws, (int)m_counters.numIndirectDraws);
+		ImGui::Text("Instances: %d", (int)m_counters.numInstances);
+		ImGui::Text("Pipelines: %d", (int)m_counters.numPipelineChanges);
+	}
+}
@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include "../renderQueue.h"
+#include "../commandBuffer.h"
+#include "../stateCache.h"
+#include "renderPassNull.h"
+#include <map>
+
+namespace rev :: gfx
+{
+	class DeviceNull;
+
+	// Consumes command buffers without executing them, validating handles and counting the work they contain.
+	class RenderQueueNull : public RenderQueue
+	{
+	public:
+		RenderQueueNull(DeviceNull&);
+
+		void present() override;
+
+		void submitPass(const RenderPass& pass) override {
+			auto& passNull = static_cast<const RenderPassNull&>(pass);
+			passNull.submit(*this);
+		}
+
+		void submitCommandBuffer(const CommandBuffer&) override;
+		void drawPerformanceCounters() const override;
+
+		// The shader's handle can be reused, so anything cached about it must go
+		void onComputeShaderDestroyed(const ComputeShader& shader) { m_state.forgetComputeProgram(shader.id()); }
+
+		// Work submitted since the last call to present
+		struct Counters
+		{
+			size_t numSubmissions = 0; // Command buffers
+			size_t numCommands = 0;
+			size_t commandBytes = 0; // Size of the command streams consumed, including payloads
+			size_t numPasses = 0;
+			size_t numStateChanges = 0; // Pipelines, vertex arrays, textures and uniforms that would reach the backend
+			size_t numElidedStateChanges = 0; // Redundant state changes that a real backend could skip
+			size_t numPipelineChanges = 0;
+			size_t numUniforms = 0;
+			size_t numTextures = 0;
+			size_t numDraws = 0; // Indirect multi-draws count as a single draw
+			size_t numIndirectDraws = 0; // Draw commands read by indirect multi-draws
+			size_t numInstances = 0;
+			size_t numTriangles = 0;
+			size_t numDispatches = 0;
+		};
+
+		const Counters& counters() const { return m_counters; }
+		size_t numPresentedFrames() const { return m_numFrames; }
+
+	private:
+		void bindTexture(int pos, Texture2d);
+		void changeState(bool needed);
+
+		DeviceNull& m_device;
+		StateCache m_state;
+		std::map<int,int> m_textureSlots; // Texture unit assigned to each sampler location
+		Counters m_counters;
+		size_t m_numFrames = 0;
+	};
+}
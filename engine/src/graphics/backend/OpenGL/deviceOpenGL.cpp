@@ -440,6 +440,7 @@ namespace rev :: gfx
 	//----------------------------------------------------------------------------------------------
 	void DeviceOpenGL::destroyComputeShader(const ComputeShader& shader)
 	{
+		static_cast<RenderQueueOpenGL*>(m_renderQueue)->onComputeShaderDestroyed(shader);
 		glDeleteProgram(shader.id());
 	}
 
@@ -692,6 +693,8 @@ namespace rev :: gfx
 			return GL_UNIFORM_BUFFER;
 		case BufferUsageTarget::ShaderStorage:
 			return GL_SHADER_STORAGE_BUFFER;
+		case BufferUsageTarget::DrawIndirect:
+			return GL_DRAW_INDIRECT_BUFFER;
 		}
 		assert(false && "Unsuported buffer target");
 		return GL_SHADER_STORAGE_BUFFER;
@@ -57,6 +57,7 @@ namespace rev :: gfx
 		// Pipeline
 		Pipeline::ShaderModule createShaderModule(const Pipeline::ShaderModule::Descriptor&) override;
 		Pipeline createPipeline(const Pipeline::Descriptor&) override;
+		void bindPipeline(int32_t pipelineId) override;
 
 		// Compute shaders
 		ComputeShader createComputeShader(const std::vector<std::string>& code) override;
@@ -64,7 +65,6 @@ namespace rev :: gfx
 
 		// OpenGL specifics
 		virtual FrameBuffer defaultFrameBuffer() = 0; // Frame buffer of the main window
-		void bindPipeline(int32_t pipelineId);
 
 		// Buffers
 		Buffer allocateBuffer(size_t byteSize, BufferUpdateFrequency, BufferUsageTarget, const void* data = nullptr) override;
@@ -26,48 +26,26 @@ namespace rev :: gfx
 {
 	using Command = CommandBuffer::Command;
 
-	void RenderQueueOpenGL::setUniforms(const CommandBuffer::UniformBucket& bucket)
+	void RenderQueueOpenGL::bindTexture(int pos, Texture2d texture)
 	{
-		// Update performance counters
-		m_numUniforms += bucket.size();
-		m_numBackendCalls+= bucket.size();
-		m_numTextures += bucket.textures.size();
-
-		// Bind uniforms per type
-		for(auto& entry : bucket.floats)
-			glUniform1f(entry.first, entry.second);
-		for(auto& entry : bucket.vec3s)
-			glUniform3f(entry.first, entry.second[0], entry.second[1], entry.second[2]);
-		for(auto& entry : bucket.vec4s)
-			glUniform4f(entry.first, entry.second[0], entry.second[1], entry.second[2], entry.second[3]);
-		for(auto& entry : bucket.mat4s)
-			glUniformMatrix4fv(entry.first, 1, !math::Mat44f::is_col_major, entry.second.data());
-		for(auto& entry : bucket.mat4vs)
-			glUniformMatrix4fv(entry.first, entry.second.size(), !math::Mat44f::is_col_major, entry.second[0].data());
-		for(auto& entry : bucket.storageBuffers)
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, entry.first, entry.second.id());
-			
-		for(auto& tex : bucket.textures)
+		auto slotIter = m_textureSlots.find(pos);
+		if(slotIter == m_textureSlots.end())
+		{
+			slotIter = m_textureSlots.emplace(pos,(int)m_textureSlots.size()).first;
+		}
+		int texStage = slotIter->second;
+		if(m_state.bindTexture(texStage, texture.id()))
 		{
-			auto slotIter = m_textureSlots.find(tex.first);
-			if(slotIter == m_textureSlots.end())
-			{
-				slotIter = m_textureSlots.emplace(tex.first,(int)m_textureSlots.size()).first;
-			}
-			int texStage = slotIter->second;
 			glActiveTexture(GL_TEXTURE0 + texStage);
-			glBindTexture(GL_TEXTURE_2D, tex.second.id());
-			glUniform1i(tex.first, texStage);
-			m_numBackendCalls+=2; // Two more backend calls than other uniforms
-			++texStage;
+			glBindTexture(GL_TEXTURE_2D, texture.id());
+			m_numBackendCalls+=2;
 		}
-
-		for(auto& out : bucket.computeOut)
+		if(m_state.setUniform(pos, texStage))
 		{
-			// Override images
-			if(out.second.isValid())
-				glBindImageTexture(out.first, out.second.id(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+			glUniform1i(pos, texStage);
+			m_numBackendCalls++;
 		}
+		m_numTextures++;
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -84,6 +62,9 @@ namespace rev :: gfx
 	//----------------------------------------------------------------------------------------------
 	void RenderQueueOpenGL::submitCommandBuffer(const CommandBuffer& cmdBuffer)
 	{
+		// Other code (e.g. the gui) may have changed the bound state since our last submission
+		m_state.invalidate();
+
 		for(auto& cmd : cmdBuffer.commands())
 		{
 			switch(cmd.command)
@@ -91,6 +72,7 @@ namespace rev :: gfx
 				case Command::BeginPass:
 				{
 					m_device.bindPass(cmd.payload, *this);
+					m_state.invalidate();
 					m_numBackendCalls++;
 					break;
 				}
@@ -123,6 +105,7 @@ namespace rev :: gfx
 					if (clearDepth)
 					{
 						glDepthMask(GL_TRUE);
+						m_state.invalidatePipeline(); // Depth mask is part of the pipeline state
 						m_numBackendCalls++;
 					}
 					glClear(clearDepth | clearColor);
@@ -145,21 +128,101 @@ namespace rev :: gfx
 				}
 				case Command::SetPipeline:
 				{
-					m_device.bindPipeline(cmd.payload);
+					if(m_state.setPipeline(cmd.payload))
+					{
+						m_device.bindPipeline(cmd.payload);
+						m_numBackendCalls++;
+						m_numPipelineChanges++;
+					}
+					break;
+				}
+				case Command::SetUniformFloat:
+				{
+					auto& uniform = cmdBuffer.getUniform<float>(cmd.payload);
+					if(m_state.setUniform(uniform.pos, uniform.value))
+					{
+						glUniform1f(uniform.pos, uniform.value);
+						m_numBackendCalls++;
+					}
+					m_numUniforms++;
+					break;
+				}
+				case Command::SetUniformVec3:
+				{
+					auto& uniform = cmdBuffer.getUniform<math::Vec3f>(cmd.payload);
+					if(m_state.setUniform(uniform.pos, uniform.value))
+					{
+						glUniform3f(uniform.pos, uniform.value[0], uniform.value[1], uniform.value[2]);
+						m_numBackendCalls++;
+					}
+					m_numUniforms++;
+					break;
+				}
+				case Command::SetUniformVec4:
+				{
+					auto& uniform = cmdBuffer.getUniform<math::Vec4f>(cmd.payload);
+					if(m_state.setUniform(uniform.pos, uniform.value))
+					{
+						glUniform4f(uniform.pos, uniform.value[0], uniform.value[1], uniform.value[2], uniform.value[3]);
+						m_numBackendCalls++;
+					}
+					m_numUniforms++;
+					break;
+				}
+				case Command::SetUniformMat4:
+				{
+					auto& uniform = cmdBuffer.getUniform<math::Mat44f>(cmd.payload);
+					if(m_state.setUniform(uniform.pos, uniform.value))
+					{
+						glUniformMatrix4fv(uniform.pos, 1, !math::Mat44f::is_col_major, uniform.value.data());
+						m_numBackendCalls++;
+					}
+					m_numUniforms++;
+					break;
+				}
+				case Command::SetUniformMat4Array:
+				{
+					auto& uniform = cmdBuffer.getPayload<CommandBuffer::UniformArray>(cmd.payload);
+					glUniformMatrix4fv(uniform.pos, uniform.count, !math::Mat44f::is_col_major, cmdBuffer.getMatrices(cmd.payload)->data());
+					m_numUniforms++;
+					m_numBackendCalls++;
+					break;
+				}
+				case Command::SetUniformTexture:
+				{
+					auto& uniform = cmdBuffer.getUniform<Texture2d>(cmd.payload);
+					bindTexture(uniform.pos, uniform.value);
+					m_numUniforms++;
+					break;
+				}
+				case Command::SetStorageBuffer:
+				{
+					auto& uniform = cmdBuffer.getUniform<Buffer>(cmd.payload);
+					glBindBufferBase(GL_SHADER_STORAGE_BUFFER, uniform.pos, uniform.value.id());
+					m_numUniforms++;
 					m_numBackendCalls++;
-					m_numPipelineChanges++;
 					break;
 				}
-				case Command::SetUniform:
+				case Command::SetComputeOutput:
 				{
-					setUniforms(cmdBuffer.getUniforms(cmd.payload));
+					auto& uniform = cmdBuffer.getUniform<Texture2d>(cmd.payload);
+					// Override images
+					if(uniform.value.isValid())
+					{
+						glBindImageTexture(uniform.pos, uniform.value.id(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+						m_numBackendCalls++;
+					}
+					m_numUniforms++;
 					break;
 				}
 				case Command::SetVtxData:
 				{
 					auto vao = cmd.payload;
-					glBindVertexArray(vao);
-					m_numBackendCalls++;
+					if(m_state.setVertexArray(vao))
+					{
+						glBindVertexArray(vao);
+						m_numBackendCalls++;
+					}
 					break;
 				}
 				case Command::DrawTriangles:
@@ -186,7 +249,8 @@ namespace rev :: gfx
 					if (batchInfo.indexType == CommandBuffer::IndexType::U32)
 						indexType = GL_UNSIGNED_INT;
 					glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batchInfo.batchBuffer.id());
-					glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, 0, batchInfo.numBatches, 0);
+					auto firstBatchOffset = (const void*)(batchInfo.firstBatch * sizeof(CommandBuffer::BatchCommand));
+					glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, firstBatchOffset, batchInfo.numBatches, 0);
 					m_numBackendCalls+=2;
 					m_numDraws++;
 					break;
@@ -213,8 +277,11 @@ namespace rev :: gfx
 				}
 				case Command::SetComputeProgram:
 				{
-					glUseProgram(cmd.payload);
-					m_numBackendCalls++;
+					if(m_state.setComputeProgram(cmd.payload))
+					{
+						glUseProgram(cmd.payload);
+						m_numBackendCalls++;
+					}
 					break;
 				}
 				case Command::DispatchCompute:
@@ -237,12 +304,13 @@ namespace rev :: gfx
 	//------------------------------------------------------------------------------------------------------------------
 	void RenderQueueOpenGL::drawPerformanceCounters() const
 	{
-		ImGui::Text("Triangles: %d", m_numTriangles);
-		ImGui::Text("Uniforms: %d", m_numUniforms);
-		ImGui::Text("Textures: %d", m_numTextures);
-		ImGui::Text("GL calls: %d", m_numBackendCalls);
-		ImGui::Text("Draws: %d", m_numDraws);
-		ImGui::Text("Pipelines: %d", m_numPipelineChanges);
+		ImGui::Text("Triangles: %d", (int)m_numTriangles);
+		ImGui::Text("Uniforms: %d", (int)m_numUniforms);
+		ImGui::Text("Textures: %d", (int)m_numTextures);
+		ImGui::Text("GL calls: %d", (int)m_numBackendCalls);
+		ImGui::Text("Elided GL calls: %d", (int)m_state.numElidedCalls());
+		ImGui::Text("Draws: %d", (int)m_numDraws);
+		ImGui::Text("Pipelines: %d", (int)m_numPipelineChanges);
 	}
 
 	//------------------------------------------------------------------------------------------------------------------
@@ -254,5 +322,6 @@ namespace rev :: gfx
 		m_numBackendCalls = 0;
 		m_numDraws = 0;
 		m_numPipelineChanges = 0;
+		m_state.resetCounters();
 	}
 }
@@ -21,6 +21,7 @@
 
 #include "../renderQueue.h"
 #include "../commandBuffer.h"
+#include "../stateCache.h"
 #include "renderPassOpenGL.h"
 #include <map>
 
@@ -43,12 +44,16 @@ namespace rev :: gfx
 		void submitCommandBuffer(const CommandBuffer&) override;
 		void drawPerformanceCounters() const override;
 
+		// The program's id can be reused, so anything cached about it must go
+		void onComputeShaderDestroyed(const ComputeShader& shader) { m_state.forgetComputeProgram(shader.id()); }
+
 	private:
-		void setUniforms(const CommandBuffer::UniformBucket& bucket);
+		void bindTexture(int pos, Texture2d);
 		void resetPerformanceCounters();
 
 		DeviceOpenGL& m_device;
 		std::map<int,int> m_textureSlots;
+		StateCache m_state; // Filters redundant state changes
 
 		// Performance counters
 		size_t m_numTriangles = 0;
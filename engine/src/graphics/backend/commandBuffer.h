@@ -22,6 +22,9 @@
 #include <math/algebra/matrix.h>
 #include <math/algebra/vector.h>
 
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 #include <vector>
 
 #include "renderQueue.h"
@@ -89,8 +92,10 @@ namespace rev :: gfx
 				vec4s.clear();
 				mat4s.clear();
 				mat4vs.clear();
+				matrixArrays.clear();
 				textures.clear();
 				computeOut.clear();
+				storageBuffers.clear();
 			}
 
 			size_t size() const {
@@ -100,16 +105,24 @@ namespace rev :: gfx
 					+ mat4s.size()
 					+ mat4vs.size()
 					+ textures.size()
-					+ computeOut.size();
+					+ computeOut.size()
+					+ storageBuffers.size();
 			}
 
 			template<class T> using ParamList = std::vector<std::pair<int,T>>;
 
+			struct MatrixRange
+			{
+				uint32_t offset; // Index of the first matrix in matrixArrays
+				uint32_t count;
+			};
+
 			ParamList<float> floats;
 			ParamList<math::Vec3f> vec3s;
 			ParamList<math::Vec4f> vec4s;
 			ParamList<math::Mat44f> mat4s;
-			ParamList<std::vector<math::Mat44f>> mat4vs;
+			ParamList<MatrixRange> mat4vs;
+			std::vector<math::Mat44f> matrixArrays; // Storage for all matrix arrays in mat4vs
 			ParamList<Texture2d>	textures;
 			ParamList<Texture2d>	computeOut;
 			ParamList<Buffer>	storageBuffers;
@@ -118,6 +131,11 @@ namespace rev :: gfx
 			size_t addParam(int pos, math::Vec3f x) { vec3s.push_back({pos, x}); return vec3s.size() -1; }
 			size_t addParam(int pos, math::Vec4f x) { vec4s.push_back({pos, x}); return vec4s.size() -1; }
 			size_t addParam(int pos, math::Mat44f x) { mat4s.push_back({pos, x}); return mat4s.size() -1; }
+			size_t addParam(int pos, const math::Mat44f* x, size_t count) {
+				mat4vs.push_back({pos, { (uint32_t)matrixArrays.size(), (uint32_t)count }});
+				matrixArrays.insert(matrixArrays.end(), x, x + count);
+				return mat4vs.size() -1;
+			}
 			size_t addParam(int pos, Texture2d x) { assert(x.isValid()); textures.push_back({pos, x}); return textures.size() -1; }
 			size_t addParam(int pos, Buffer x) { assert(x.isValid()); storageBuffers.push_back({pos, x}); return storageBuffers.size() -1; }
 			size_t addComputeOutput(int pos, Texture2d x) { computeOut.push_back({pos, x}); return computeOut.size() -1; }
@@ -132,7 +150,11 @@ namespace rev :: gfx
 			uint32_t baseInstance = 0;
 		};
 
-		// Commands
+		// Commands.
+		// Commands are recorded as a flat array of opcodes. Commands that need more than a single integer
+		// argument store their data in a linear payload stream, and reference it by byte offset.
+		// Both arrays keep their capacity across calls to clear(), so once a buffer has warmed up, recording
+		// a frame doesn't touch the heap.
 		struct Command
 		{
 			enum Opcode {
@@ -144,7 +166,14 @@ namespace rev :: gfx
 				SetViewport,
 				SetScissor,
 				SetPipeline,
-				SetUniform,
+				SetUniformFloat,
+				SetUniformVec3,
+				SetUniformVec4,
+				SetUniformMat4,
+				SetUniformMat4Array,
+				SetUniformTexture,
+				SetStorageBuffer,
+				SetComputeOutput,
 				SetVtxData,
 				DrawBatches,
 				DrawTriangles,
@@ -156,7 +185,7 @@ namespace rev :: gfx
 			};
 
 			Opcode command;
-			int32_t payload;
+			int32_t payload; // Immediate argument, or offset of the command data in the payload stream
 		};
 
 		enum class MemoryBarrier : int32_t
@@ -185,14 +214,12 @@ namespace rev :: gfx
 
 		void clearDepth(float d)
 		{
-			m_commands.push_back({ Command::ClearDepth, (int32_t)m_clearDepths.size() });
-			m_clearDepths.push_back(d);
+			m_commands.push_back({ Command::ClearDepth, pushPayload(d) });
 		}
 
 		void clearColor(const math::Vec4f& color)
 		{
-			m_commands.push_back({ Command::ClearColor, (int32_t)m_clearColors.size() });
-			m_clearColors.push_back(color);
+			m_commands.push_back({ Command::ClearColor, pushPayload(color) });
 		}
 
 		void clear(Clear flags)
@@ -202,14 +229,12 @@ namespace rev :: gfx
 
 		void setViewport(const math::Vec2u& start, const math::Vec2u& size)
 		{
-			m_commands.push_back({ Command::SetViewport, (int32_t)m_rect.size() });
-			m_rect.push_back({start, size});
+			m_commands.push_back({ Command::SetViewport, pushPayload(WindowRect{start, size}) });
 		}
 
 		void setScissor(const math::Vec2u& start, const math::Vec2u& size)
 		{
-			m_commands.push_back({ Command::SetScissor, (int32_t)m_rect.size() });
-			m_rect.push_back({start, size});
+			m_commands.push_back({ Command::SetScissor, pushPayload(WindowRect{start, size}) });
 		}
 
 		void setPipeline(Pipeline pipeline)
@@ -219,11 +244,35 @@ namespace rev :: gfx
 			m_metrics.numPipelineChanges++;
 		}
 
+		// Uniform values are copied into the payload stream, so the bucket can be reused right away
 		void setUniformData(const UniformBucket& uniformBucket)
 		{
-			m_commands.push_back({Command::SetUniform, (int32_t)m_uniforms.size() });
-			m_uniforms.push_back(uniformBucket);
+			for(auto& [pos, x] : uniformBucket.floats)
+				pushUniform(Command::SetUniformFloat, pos, x);
+			for(auto& [pos, x] : uniformBucket.vec3s)
+				pushUniform(Command::SetUniformVec3, pos, x);
+			for(auto& [pos, x] : uniformBucket.vec4s)
+				pushUniform(Command::SetUniformVec4, pos, x);
+			for(auto& [pos, x] : uniformBucket.mat4s)
+				pushUniform(Command::SetUniformMat4, pos, x);
+			for(auto& [pos, range] : uniformBucket.mat4vs)
+			{
+				UniformArray matrices;
+				matrices.pos = pos;
+				matrices.count = range.count;
+				auto arrayOffset = pushPayload(matrices);
+				auto dataOffset = pushPayload(uniformBucket.matrixArrays.data() + range.offset, range.count);
+				mutablePayload<UniformArray>(arrayOffset).dataOffset = dataOffset - arrayOffset;
+				m_commands.push_back({ Command::SetUniformMat4Array, arrayOffset });
+			}
+			for(auto& [pos, x] : uniformBucket.storageBuffers)
+				pushUniform(Command::SetStorageBuffer, pos, x);
+			for(auto& [pos, x] : uniformBucket.textures)
+				pushUniform(Command::SetUniformTexture, pos, x);
+			for(auto& [pos, x] : uniformBucket.computeOut)
+				pushUniform(Command::SetComputeOutput, pos, x);
 			m_metrics.numUniforms += uniformBucket.size();
+			m_metrics.numUniformBuckets++;
 		}
 
 		void setVertexData(const unsigned& vao)
@@ -232,25 +281,25 @@ namespace rev :: gfx
 			m_metrics.numVAO++;
 		}
 
-		void drawTrianglesBatch(uint32_t numBatches, IndexType indexType, Buffer commandBuffer)
+		// Multi-draw of numBatches consecutive BatchCommands, read from a gpu buffer starting at firstBatch
+		void drawTrianglesBatch(uint32_t numBatches, IndexType indexType, Buffer commandBuffer, uint32_t firstBatch = 0)
 		{
-			m_commands.push_back({ Command::DrawBatches, (int32_t)m_draws.size() });
-			m_batches.push_back({ numBatches, indexType, commandBuffer });
+			m_commands.push_back({ Command::DrawBatches, pushPayload(BatchPayload{ numBatches, indexType, commandBuffer, firstBatch }) });
 			m_metrics.numDraws++;
 		}
 
 		void drawTriangles(int numIndices, IndexType indexType, void* offset)
 		{
-			m_commands.push_back({Command::DrawTriangles, (int32_t)m_draws.size() });
-			m_draws.push_back({numIndices, indexType, offset});
+			m_commands.push_back({Command::DrawTriangles, pushPayload(DrawPayload{numIndices, indexType, offset}) });
 			m_metrics.numTriangles += numIndices / 3;
+			m_metrics.numDraws++;
 		}
 
 		void drawLines(int nVertices, IndexType indexType)
 		{
 			assert(false && "Not implemented, will always draw 0 lines");
-			m_commands.push_back({ Command::DrawLines, (int32_t)m_draws.size() });
-			m_draws.push_back({ 0, indexType, 0 });
+			m_commands.push_back({ Command::DrawLines, pushPayload(DrawPayload{ 0, indexType, 0 }) });
+			m_metrics.numDraws++;
 		}
 
 		void memoryBarrier(MemoryBarrier barrier)
@@ -266,16 +315,61 @@ namespace rev :: gfx
 		// Compute
 		void dispatchCompute(Texture2d targetTexture, const math::Vec3i& groupSize)
 		{
-			m_commands.push_back({Command::DispatchCompute, (int32_t)m_computes.size() });
-			m_computes.push_back({targetTexture, groupSize});
+			m_commands.push_back({Command::DispatchCompute, pushPayload(ComputePayload{targetTexture, groupSize}) });
+			m_metrics.numDispatchs++;
 		}
 
-		// Command buffer lifetime
+		// Command buffer lifetime. Keeps allocated memory for reuse.
 		void clear() {
 			m_metrics.clear();
 			m_commands.clear();
-			m_uniforms.clear();
-			m_draws.clear();
+			m_payloads.clear();
+		}
+
+		// Copy all the commands recorded in other after the ones in this buffer.
+		// Useful to merge command buffers recorded in parallel.
+		void append(const CommandBuffer& other)
+		{
+			// Keep the relative alignment of the other stream's payloads
+			size_t base = (m_payloads.size() + kPayloadAlignment - 1) & ~(kPayloadAlignment - 1);
+			m_payloads.resize(base + other.m_payloads.size());
+			if(!other.m_payloads.empty())
+				std::memcpy(&m_payloads[base], other.m_payloads.data(), other.m_payloads.size());
+
+			m_commands.reserve(m_commands.size() + other.m_commands.size());
+			for(auto cmd : other.m_commands)
+			{
+				if(hasPayload(cmd.command))
+					cmd.payload += (int32_t)base;
+				m_commands.push_back(cmd);
+			}
+
+			m_metrics.numTriangles += other.m_metrics.numTriangles;
+			m_metrics.numUniforms += other.m_metrics.numUniforms;
+			m_metrics.numUniformBuckets += other.m_metrics.numUniformBuckets;
+			m_metrics.numVAO += other.m_metrics.numVAO;
+			m_metrics.numDraws += other.m_metrics.numDraws;
+			m_metrics.numDispatchs += other.m_metrics.numDispatchs;
+			m_metrics.numPipelineChanges += other.m_metrics.numPipelineChanges;
+		}
+
+		// Whether the command's payload is an offset into the payload stream, rather than an immediate value
+		static bool hasPayload(Command::Opcode opcode)
+		{
+			switch(opcode)
+			{
+				case Command::BeginPass:
+				case Command::BindFrameBuffer:
+				case Command::Clear:
+				case Command::SetPipeline:
+				case Command::SetVtxData:
+				case Command::MemoryBarrier:
+				case Command::SetComputeProgram:
+				case Command::StreamWrite:
+					return false;
+				default:
+					return true;
+			}
 		}
 
 		struct DrawPayload
@@ -296,6 +390,7 @@ namespace rev :: gfx
 			uint32_t numBatches;
 			IndexType indexType;
 			Buffer batchBuffer;
+			uint32_t firstBatch;
 		};
 
 		struct WindowRect
@@ -303,36 +398,88 @@ namespace rev :: gfx
 			math::Vec2u pos, size;
 		};
 
+		template<class T>
+		struct Uniform
+		{
+			int32_t pos;
+			T value;
+		};
+
+		struct UniformArray
+		{
+			int32_t pos;
+			uint32_t count;
+			int32_t dataOffset; // Offset of the first matrix, relative to this payload. Keeps the payload relocatable
+		};
+
 		// Access
-		const std::vector<Command> commands() const { return m_commands; }
-		const UniformBucket& getUniforms(size_t i) const { return m_uniforms[i]; }
-		const DrawPayload& getDraw(size_t i) const { return m_draws[i]; }
-		const WindowRect& getRect(size_t i) const { return m_rect[i]; }
-		const ComputePayload& getCompute(size_t i) const { return m_computes[i]; }
-		float getFloat(size_t i) const { return m_clearDepths[i]; }
-		auto& getColor(size_t i) const { return m_clearColors[i]; }
-		auto& getBatch(size_t i) const { return m_batches[i]; }
+		const std::vector<Command>& commands() const { return m_commands; }
+		template<class T>
+		const T& getPayload(int32_t offset) const
+		{
+			assert(offset >= 0 && offset + sizeof(T) <= m_payloads.size());
+			return *reinterpret_cast<const T*>(&m_payloads[offset]);
+		}
+		template<class T>
+		const Uniform<T>& getUniform(int32_t offset) const { return getPayload<Uniform<T>>(offset); }
+		const math::Mat44f* getMatrices(int32_t arrayOffset) const
+		{
+			return &getPayload<math::Mat44f>(arrayOffset + getPayload<UniformArray>(arrayOffset).dataOffset);
+		}
+		const DrawPayload& getDraw(int32_t offset) const { return getPayload<DrawPayload>(offset); }
+		const WindowRect& getRect(int32_t offset) const { return getPayload<WindowRect>(offset); }
+		const ComputePayload& getCompute(int32_t offset) const { return getPayload<ComputePayload>(offset); }
+		float getFloat(int32_t offset) const { return getPayload<float>(offset); }
+		auto& getColor(int32_t offset) const { return getPayload<math::Vec4f>(offset); }
+		auto& getBatch(int32_t offset) const { return getPayload<BatchPayload>(offset); }
 
 		Metrics metrics() const
 		{
 			Metrics completeMetrics = m_metrics;
 			completeMetrics.numCommands = m_commands.size();
-			completeMetrics.numDraws = m_draws.size();
-			completeMetrics.numDispatchs = m_computes.size();
-			completeMetrics.numUniformBuckets = m_uniforms.size();
 			return completeMetrics;
 		}
 
+		// Bytes used by the recorded commands and their payloads
+		size_t memoryUsage() const
+		{
+			return m_commands.size() * sizeof(Command) + m_payloads.size();
+		}
+
 	private:
+		template<class T>
+		int32_t pushPayload(const T* data, size_t count)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			static_assert(alignof(T) <= kPayloadAlignment);
+			// Payloads are aligned relative to the start of the stream
+			size_t offset = (m_payloads.size() + alignof(T) - 1) & ~(alignof(T) - 1);
+			m_payloads.resize(offset + count * sizeof(T));
+			std::memcpy(&m_payloads[offset], data, count * sizeof(T));
+			return (int32_t)offset;
+		}
+
+		template<class T>
+		int32_t pushPayload(const T& data) { return pushPayload(&data, 1); }
+
+		template<class T>
+		void pushUniform(Command::Opcode opcode, int pos, const T& value)
+		{
+			m_commands.push_back({ opcode, pushPayload(Uniform<T>{ pos, value }) });
+		}
+
+		template<class T>
+		T& mutablePayload(int32_t offset)
+		{
+			assert(offset >= 0 && offset + sizeof(T) <= m_payloads.size());
+			return *reinterpret_cast<T*>(&m_payloads[offset]);
+		}
+
+		static constexpr size_t kPayloadAlignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__; // Alignment of the stream itself
+
 		Metrics m_metrics;
 
-		std::vector<math::Vec4f> m_clearColors;
-		std::vector<float> m_clearDepths;
 		std::vector<Command> m_commands;
-		std::vector<UniformBucket> m_uniforms;
-		std::vector<DrawPayload> m_draws;
-		std::vector<WindowRect> m_rect;
-		std::vector<ComputePayload> m_computes;
-		std::vector<BatchPayload> m_batches;
+		std::vector<uint8_t> m_payloads;
 	};
 }
@@ -62,6 +62,7 @@ namespace rev :: gfx
 		// Pipeline
 		virtual Pipeline::ShaderModule createShaderModule(const Pipeline::ShaderModule::Descriptor&) = 0;
 		virtual Pipeline createPipeline(const Pipeline::Descriptor&) = 0;
+		virtual void bindPipeline(int32_t pipelineId) = 0;
 
 		// Compute shaders
 		virtual ComputeShader createComputeShader(const std::vector<std::string>& code) = 0;
@@ -80,7 +81,8 @@ namespace rev :: gfx
 			Vertex,
 			Index,
 			Uniform,
-			ShaderStorage
+			ShaderStorage,
+			DrawIndirect
 		};
 
 		// Type safe buffer allocation
@@ -0,0 +1,162 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace rev::gfx {
+
+	// Tracks the state bound in the backend, so redundant state changes can be skipped during submission.
+	// Each set* method returns true when the backend actually needs to be called, and counts the call as elided
+	// otherwise. The cache doesn't know about any particular API, so it can be driven by a mock backend too.
+	class StateCache
+	{
+	public:
+		// Forget everything that is bound. Needed whenever code outside our control may have changed the state.
+		// Uniform values are stored in each program, so they are kept.
+		void invalidate()
+		{
+			m_program = cNoProgram;
+			m_vertexArray = cUnknown;
+			m_textureUnits.clear();
+		}
+
+		// Forget values of uniforms. Needed if programs are modified elsewhere.
+		void invalidateUniforms()
+		{
+			m_uniforms.clear();
+		}
+
+		// Program ids are reused after a program is destroyed, so a new program must not inherit its cached uniforms
+		void forgetComputeProgram(int32_t program)
+		{
+			forgetProgram(computeKey(program));
+		}
+
+		bool setPipeline(int32_t pipeline)
+		{
+			return setProgram(uint64_t(uint32_t(pipeline)));
+		}
+
+		// Compute programs live in their own key space, so they never alias a pipeline
+		bool setComputeProgram(int32_t program)
+		{
+			return setProgram(computeKey(program));
+		}
+
+		// Some commands change the state set by the pipeline (e.g. clearing forces depth writes)
+		void invalidatePipeline()
+		{
+			m_program = cNoProgram;
+		}
+
+		bool setVertexArray(uint32_t vao)
+		{
+			return update(m_vertexArray, uint64_t(vao));
+		}
+
+		bool bindTexture(size_t unit, int32_t texture)
+		{
+			if(m_textureUnits.size() <= unit)
+				m_textureUnits.resize(unit + 1, cUnknown);
+			return update(m_textureUnits[unit], uint64_t(uint32_t(texture)));
+		}
+
+		// Value of a uniform in the program that is currently bound
+		template<class T>
+		bool setUniform(int32_t location, const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= UniformValue::cMaxSize);
+			if(m_program == cNoProgram) // Can't tell where the value would go
+				return true;
+
+			assert(location >= 0 && location < (1 << 16));
+			auto& cached = m_uniforms[(m_program << 16) | uint64_t(location)];
+			if(cached.size == sizeof(T) && !std::memcmp(cached.data, &value, sizeof(T)))
+			{
+				++m_numElided;
+				return false;
+			}
+			cached.size = sizeof(T);
+			std::memcpy(cached.data, &value, sizeof(T));
+			return true;
+		}
+
+		size_t numElidedCalls() const { return m_numElided; }
+		void resetCounters() { m_numElided = 0; }
+
+	private:
+		static constexpr uint64_t cUnknown = uint64_t(-1);
+		static constexpr uint64_t cNoProgram = uint64_t(-1);
+
+		struct UniformValue
+		{
+			static constexpr size_t cMaxSize = 64; // Enough for a 4x4 matrix
+			uint32_t size = 0;
+			uint8_t data[cMaxSize];
+		};
+
+		static uint64_t computeKey(int32_t program)
+		{
+			return (uint64_t(1) << 32) | uint32_t(program);
+		}
+
+		bool setProgram(uint64_t program)
+		{
+			return update(m_program, program);
+		}
+
+		void forgetProgram(uint64_t program)
+		{
+			if(m_program == program)
+				m_program = cNoProgram;
+			for(auto i = m_uniforms.begin(); i != m_uniforms.end();)
+			{
+				if((i->first >> 16) == program)
+					i = m_uniforms.erase(i);
+				else
+					++i;
+			}
+		}
+
+		bool update(uint64_t& bound, uint64_t value)
+		{
+			if(bound == value)
+			{
+				++m_numElided;
+				return false;
+			}
+			bound = value;
+			return true;
+		}
+
+		uint64_t m_program = cNoProgram;
+		uint64_t m_vertexArray = cUnknown;
+		std::vector<uint64_t> m_textureUnits;
+		std::unordered_map<uint64_t, UniformValue> m_uniforms; // Keyed by program and location
+		size_t m_numElided = 0;
+	};
+
+}
@@ -145,41 +145,46 @@ namespace rev::gfx
 	{
 		core::File file(&_name[0]); //<-- Hack!
 		if(file.size() > 0)
-		{
-			bool isHDR = stbi_is_hdr_from_memory((uint8_t*)file.buffer(), file.size());
-			int width, height, realNumChannels;
-			uint8_t* imgData;
-			if(!nChannels)
-			{
-				int srcChannels;
-				stbi_info_from_memory((const uint8_t*)file.buffer(), file.size(), &width, &height, &srcChannels);
-				if(srcChannels < 3)
-					nChannels = 4;
-			}
-			// Read image data from buffer
-			if(isHDR)
-				imgData = (uint8_t*)stbi_loadf_from_memory((const uint8_t*)file.buffer(), file.size(), &width, &height, &realNumChannels, nChannels);
-			else
-				imgData= stbi_load_from_memory((const uint8_t*)file.buffer(), file.size(), &width, &height, &realNumChannels, nChannels);
-
-			// Create the actual image
-			if(imgData)
-			{
-				math::Vec2u size = { unsigned(width), unsigned(height)};
-				PixelFormat format;
-				format.numChannels = nChannels?nChannels:(unsigned)realNumChannels;
-				format.channel = isHDR ? ChannelFormat::Float32 : ChannelFormat::Byte;
-				auto result = std::make_unique<Image>(format, size);
-				memcpy(result->data<void>(), imgData, result->area() * format.pixelSize());
-
-				stbi_image_free(imgData);
-				return result;
-			}
-		}
+			return decode(file.buffer(), file.size(), nChannels);
 
 		return nullptr;
 	}
 
+	//----------------------------------------------------------------------------------------------
+	std::unique_ptr<Image> Image::decode(const void* _data, size_t _size, unsigned nChannels)
+	{
+		auto buffer = reinterpret_cast<const uint8_t*>(_data);
+		bool isHDR = stbi_is_hdr_from_memory(buffer, (int)_size);
+		int width, height, realNumChannels;
+		uint8_t* imgData;
+		if(!nChannels)
+		{
+			int srcChannels;
+			stbi_info_from_memory(buffer, (int)_size, &width, &height, &srcChannels);
+			if(srcChannels < 3)
+				nChannels = 4;
+		}
+		// Read image data from buffer
+		if(isHDR)
+			imgData = (uint8_t*)stbi_loadf_from_memory(buffer, (int)_size, &width, &height, &realNumChannels, nChannels);
+		else
+			imgData= stbi_load_from_memory(buffer, (int)_size, &width, &height, &realNumChannels, nChannels);
+
+		// Create the actual image
+		if(!imgData)
+			return nullptr;
+
+		math::Vec2u size = { unsigned(width), unsigned(height)};
+		PixelFormat format;
+		format.numChannels = nChannels?nChannels:(unsigned)realNumChannels;
+		format.channel = isHDR ? ChannelFormat::Float32 : ChannelFormat::Byte;
+		auto result = std::make_unique<Image>(format, size);
+		memcpy(result->data<void>(), imgData, result->area() * format.pixelSize());
+
+		stbi_image_free(imgData);
+		return result;
+	}
+
 	//----------------------------------------------------------------------------------------------
 	Image::Image(PixelFormat pxlFmt, const math::Vec2u& size, void* data)
 		: mSize(size)
@@ -139,5 +139,6 @@ namespace rev::gfx {
 			m_device.destroyFrameBuffer(res.handle);
 		}
 		m_frameBuffers.clear();
+		++m_generation;
 	}
 }
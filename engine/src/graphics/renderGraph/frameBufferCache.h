@@ -21,6 +21,7 @@
 
 #include <graphics/backend/gpuTypes.h>
 #include <graphics/renderGraph/types.h>
+#include <cstdint>
 #include <vector>
 
 namespace rev::gfx {
@@ -44,6 +45,8 @@ namespace rev::gfx {
 
 		// Deallocates gpu resources
 		void deallocateResources();
+		// Increased every time gpu resources are deallocated, so users can tell when their handles go stale
+		uint32_t generation() const { return m_generation; }
 
 	private:
 		struct TextureResource
@@ -64,5 +67,6 @@ namespace rev::gfx {
 		TextureSampler m_bufferSampler;
 		std::vector<TextureResource> m_textures;
 		std::vector<FBResource> m_frameBuffers;
+		uint32_t m_generation = 0;
 	};
 }
\ No newline at end of file
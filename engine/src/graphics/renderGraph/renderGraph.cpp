@@ -19,15 +19,59 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "frameBufferCache.h"
 #include "renderGraph.h"
+#include <core/tasks/jobSystem.h>
+#include <core/tools/profiler.h>
 #include <graphics/backend/commandBuffer.h>
 #include <graphics/backend/device.h>
 #include <graphics/debug/debugGUI.h>
 #include <graphics/debug/imgui.h>
 
+#include <chrono>
 #include <numeric>
+#include <type_traits>
 
 namespace rev::gfx {
 
+	namespace {
+		// FNV-1a
+		struct TopologyHasher
+		{
+			uint64_t value = 14695981039346656037ull;
+
+			void add(const void* data, size_t size)
+			{
+				auto bytes = reinterpret_cast<const uint8_t*>(data);
+				for (size_t i = 0; i < size; ++i)
+				{
+					value ^= bytes[i];
+					value *= 1099511628211ull;
+				}
+			}
+
+			template<class T>
+			void add(const T& x)
+			{
+				static_assert(std::is_trivially_copyable_v<T>);
+				add(&x, sizeof(T));
+			}
+		};
+
+		size_t textureBytes(const BufferDesc& desc)
+		{
+			size_t pixelSize = 0;
+			switch (desc.format)
+			{
+			case BufferFormat::R8: pixelSize = 1; break;
+			case BufferFormat::RGBA8:
+			case BufferFormat::sRGBA8: pixelSize = 4; break;
+			case BufferFormat::RGBA32: pixelSize = 16; break;
+			case BufferFormat::depth24:
+			case BufferFormat::depth32: pixelSize = 4; break;
+			}
+			return pixelSize * desc.size.x() * desc.size.y();
+		}
+	}
+
 	//--------------------------------------------------------------------------
 	RenderGraph::RenderGraph(Device& gfxDevice)
 		: m_gfxDevice(gfxDevice)
@@ -38,7 +82,7 @@ namespace rev::gfx {
 	{
 		m_passDescriptors.clear();
 		m_bufferLifetime.clear();
-		m_sortedPasses.clear();
+		m_virtualResources.clear();
 	}
 
 	//--------------------------------------------------------------------------
@@ -61,7 +105,9 @@ namespace rev::gfx {
 	//--------------------------------------------------------------------------
 	void RenderGraph::build(FrameBufferCache& bufferCache)
 	{
+		REV_PROFILE_SCOPE("RenderGraph::build");
 		assert(m_bufferLifetime.empty());
+		auto start = std::chrono::high_resolution_clock::now();
 
 		// For each pass stored, define graph dependencies by running the pass definition delegate
 		for (auto& desc : m_passDescriptors)
@@ -69,13 +115,89 @@ namespace rev::gfx {
 			desc.definition(desc);
 		}
 
+		// Only recompile when something structural changed since the last build.
+		// The frame buffer cache may also have deallocated the resources we were bound to.
+		auto hash = topologyHash();
+		m_buildStats.cached = m_compiledCache == &bufferCache
+			&& m_compiledCacheGeneration == bufferCache.generation()
+			&& m_compiledHash == hash;
+		if (!m_buildStats.cached)
+		{
+			compile(bufferCache);
+			m_compiledHash = hash;
+			m_compiledCache = &bufferCache;
+			m_compiledCacheGeneration = bufferCache.generation();
+			++m_buildStats.numCompilations;
+		}
+
+		std::chrono::duration<float, std::milli> buildTime = std::chrono::high_resolution_clock::now() - start;
+		m_buildStats.buildMs = buildTime.count();
+
+		drawDebugInfo();
+	}
+
+	//--------------------------------------------------------------------------
+	// Everything that affects the schedule or the resource bindings must go into the hash.
+	uint64_t RenderGraph::topologyHash() const
+	{
+		TopologyHasher hasher;
+		hasher.add(m_passDescriptors.size());
+		for (auto& pass : m_passDescriptors)
+		{
+			hasher.add(pass.name.data(), pass.name.size());
+			hasher.add(pass.targetSize);
+			hasher.add(pass.antiAliasing);
+			hasher.add(pass.m_inputs.size());
+			hasher.add(pass.m_inputs.data(), pass.m_inputs.size() * sizeof(size_t));
+			hasher.add(pass.m_outputs.size());
+			hasher.add(pass.m_outputs.data(), pass.m_outputs.size() * sizeof(size_t));
+		}
+		hasher.add(m_bufferLifetime.size());
+		for (auto& state : m_bufferLifetime)
+		{
+			hasher.add(state.virtualBufferNdx);
+			hasher.add(state.writeCounter);
+		}
+		hasher.add(m_virtualResources.size());
+		for (auto& resource : m_virtualResources)
+		{
+			hasher.add(resource.externalFramebuffer.id());
+			hasher.add(resource.externalTexture.id());
+			hasher.add(resource.cubemapSide);
+			hasher.add(resource.bufferDescriptor.size);
+			hasher.add(resource.bufferDescriptor.format);
+			hasher.add(resource.bufferDescriptor.antiAlias);
+		}
+		return hasher.value;
+	}
+
+	//--------------------------------------------------------------------------
+	void RenderGraph::compile(FrameBufferCache& bufferCache)
+	{
+		REV_PROFILE_SCOPE("RenderGraph::compile");
+
 		// Sort passes based on their dependencies
 		sortPasses();
-
-		bool showDebugInfo = ImGui::Begin("Render Graph");
+		planAliasing();
 
 		// Clear previous associations
 		m_virtualToPhysical.clear();
+		m_virtualToPhysical.resize(m_virtualResources.size());
+		// One texture per physical slot, shared by all the virtual resources aliased to it
+		std::vector<Texture2d> slotTextures(m_slotDescriptors.size());
+		for (size_t i = 0; i < m_slotDescriptors.size(); ++i)
+		{
+			slotTextures[i] = bufferCache.requestTargetTexture(m_slotDescriptors[i]);
+		}
+		for (size_t i = 0; i < m_virtualResources.size(); ++i)
+		{
+			if (m_physicalSlots[i] >= 0)
+				m_virtualToPhysical[i] = slotTextures[m_physicalSlots[i]];
+			else
+				m_virtualToPhysical[i] = m_virtualResources[i].externalTexture;
+		}
+		m_passFramebuffers.clear();
+		m_passFramebuffers.resize(m_passDescriptors.size());
 		// Associate passes with resources
 		for (auto passNdx : m_sortedPasses)
 		{
@@ -95,28 +217,15 @@ namespace rev::gfx {
 					break;
 				}
 
-				auto virtualIter = m_virtualToPhysical.find(targetResourceNdx);
-				if (virtualIter == m_virtualToPhysical.end()) // Resource not previously mapped
-				{
-					if (virtualBuffer.externalTexture.isValid())
-					{
-						targetTextures[i] = virtualBuffer.externalTexture;
-						targetTextureSide = virtualBuffer.cubemapSide;
-					}
-					else
-					{
-						targetTextures[i] = bufferCache.requestTargetTexture(virtualBuffer.bufferDescriptor);
-					}
-					m_virtualToPhysical[targetResourceNdx] = targetTextures[i];
-				}
-				else // Previously mapped resource
+				if (virtualBuffer.externalTexture.isValid())
 				{
-					targetTextures[i] = virtualIter->second;
+					targetTextureSide = virtualBuffer.cubemapSide;
 				}
+				targetTextures[i] = m_virtualToPhysical[targetResourceNdx];
 			}
 			if (passFramebuffer.isValid())
 			{
-				pass.m_cachedFb = passFramebuffer;
+				m_passFramebuffers[passNdx] = passFramebuffer;
 				continue;
 			}
 
@@ -153,7 +262,7 @@ namespace rev::gfx {
 						attachments[numAttachs].mipLevel = 0;
 						attachments[numAttachs].imageType = FrameBuffer::Attachment::ImageType::Texture;
 						attachments[numAttachs].target = FrameBuffer::Attachment::Target::Depth;
-						assert(m_virtualToPhysical.find(virtualIndex) != m_virtualToPhysical.end() && "Depth must always be written before beind used as read only");
+						assert(m_virtualToPhysical[virtualIndex].isValid() && "Depth must always be written before beind used as read only");
 						attachments[numAttachs].texture = m_virtualToPhysical[virtualIndex];
 
 						++numAttachs;
@@ -162,25 +271,116 @@ namespace rev::gfx {
 				}
 			}
 			FrameBuffer::Descriptor descriptor(numAttachs, attachments);
-			passFramebuffer = bufferCache.requestFrameBuffer(descriptor);
-			pass.m_cachedFb = passFramebuffer;
+			m_passFramebuffers[passNdx] = bufferCache.requestFrameBuffer(descriptor);
+		}
+
+		// Resolve input textures?
+		bufferCache.freeResources();
+	}
 
-			// Instrumentation
-			if(ImGui::CollapsingHeader(pass.name.c_str()))
+	//--------------------------------------------------------------------------
+	void RenderGraph::planAliasing()
+	{
+		// Lifetime of each virtual resource, as the range of sorted passes that use it
+		constexpr size_t cUnused = size_t(-1);
+		std::vector<size_t> firstUse(m_virtualResources.size(), cUnused);
+		std::vector<size_t> lastUse(m_virtualResources.size(), 0);
+		auto markUse = [&](size_t lifetimeNdx, size_t position) {
+			auto virtualNdx = m_bufferLifetime[lifetimeNdx].virtualBufferNdx;
+			firstUse[virtualNdx] = std::min(firstUse[virtualNdx], position);
+			lastUse[virtualNdx] = std::max(lastUse[virtualNdx], position);
+		};
+		for (size_t pos = 0; pos < m_sortedPasses.size(); ++pos)
+		{
+			auto& pass = m_passDescriptors[m_sortedPasses[pos]];
+			for (auto input : pass.m_inputs)
+				markUse(input, pos);
+			for (auto output : pass.m_outputs)
+				markUse(output, pos);
+		}
+
+		m_physicalSlots.assign(m_virtualResources.size(), -1);
+		m_slotDescriptors.clear();
+		m_memoryReport = MemoryReport();
+		std::vector<int> freeSlots;
+		for (size_t pos = 0; pos < m_sortedPasses.size(); ++pos)
+		{
+			auto& pass = m_passDescriptors[m_sortedPasses[pos]];
+			// Transient targets that start their lifetime in this pass take a compatible free slot, if there's any
+			for (auto output : pass.m_outputs)
 			{
-				ImVec2 previewSize = ImVec2(pass.targetSize.x() * 0.25f, pass.targetSize.y() * 0.25f);
-				for (int nAttach = 0; nAttach < pass.m_outputs.size(); ++nAttach)
+				auto virtualNdx = m_bufferLifetime[output].virtualBufferNdx;
+				auto& resource = m_virtualResources[virtualNdx];
+				if (firstUse[virtualNdx] != pos
+					|| resource.externalFramebuffer.isValid()
+					|| resource.externalTexture.isValid())
+					continue;
+
+				auto& desc = resource.bufferDescriptor;
+				auto freeSlot = std::find_if(freeSlots.begin(), freeSlots.end(), [&](int slot) {
+					return m_slotDescriptors[slot] == desc;
+				});
+				if (freeSlot != freeSlots.end())
 				{
-					ImTextureID texId = (void*)((GLuint)attachments[nAttach].texture.id());
-					ImGui::Image(texId, previewSize);
+					m_physicalSlots[virtualNdx] = *freeSlot;
+					freeSlots.erase(freeSlot);
+					m_memoryReport.aliasedBytes += textureBytes(desc);
 				}
+				else
+				{
+					m_physicalSlots[virtualNdx] = (int)m_slotDescriptors.size();
+					m_slotDescriptors.push_back(desc);
+					m_memoryReport.peakBytes += textureBytes(desc);
+				}
+				m_memoryReport.transientBytes += textureBytes(desc);
+				++m_memoryReport.numVirtualTextures;
+			}
+			// Release the slots of targets that are not used after this pass
+			for (size_t i = 0; i < m_virtualResources.size(); ++i)
+			{
+				if (lastUse[i] == pos && m_physicalSlots[i] >= 0)
+					freeSlots.push_back(m_physicalSlots[i]);
 			}
 		}
+		m_memoryReport.numPhysicalTextures = m_slotDescriptors.size();
+	}
 
-		ImGui::End();
+	//--------------------------------------------------------------------------
+	int RenderGraph::physicalSlot(BufferResource resource) const
+	{
+		assert(resource.isValid() && size_t(resource.id()) < m_bufferLifetime.size());
+		return m_physicalSlots[m_bufferLifetime[resource.id()].virtualBufferNdx];
+	}
 
-		// Resolve input textures?
-		bufferCache.freeResources();
+	//--------------------------------------------------------------------------
+	void RenderGraph::drawDebugInfo() const
+	{
+		if (ImGui::Begin("Render Graph"))
+		{
+			ImGui::Text("Build: %.3f ms (%s)", m_buildStats.buildMs, m_buildStats.cached ? "cached" : "compiled");
+			ImGui::Text("Compilations: %d", (int)m_buildStats.numCompilations);
+			ImGui::Text("Transient textures: %d virtual, %d physical",
+				(int)m_memoryReport.numVirtualTextures, (int)m_memoryReport.numPhysicalTextures);
+			ImGui::Text("Transient memory: %.2f MB (%.2f MB aliased)",
+				m_memoryReport.peakBytes / (1024.f * 1024.f), m_memoryReport.aliasedBytes / (1024.f * 1024.f));
+			for (auto passNdx : m_sortedPasses)
+			{
+				auto& pass = m_passDescriptors[passNdx];
+				if (ImGui::CollapsingHeader(pass.name.c_str()))
+				{
+					ImVec2 previewSize = ImVec2(pass.targetSize.x() * 0.25f, pass.targetSize.y() * 0.25f);
+					for (auto output : pass.m_outputs)
+					{
+						auto& texture = m_virtualToPhysical[m_bufferLifetime[output].virtualBufferNdx];
+						if (!texture.isValid()) // External frame buffer
+							continue;
+						ImTextureID texId = (void*)((GLuint)texture.id());
+						ImGui::Image(texId, previewSize);
+					}
+				}
+			}
+		}
+		ImGui::End();
 	}
 
 	//--------------------------------------------------------------------------
@@ -244,27 +444,69 @@ namespace rev::gfx {
 	}
 
 	//--------------------------------------------------------------------------
-	void RenderGraph::evaluate(CommandBuffer& dst)
+	void RenderGraph::evaluate(CommandBuffer& dst, core::JobSystem* jobs)
 	{
-		// For each pass in compiled passes
-		for (auto passNdx : m_sortedPasses)
+		REV_PROFILE_SCOPE("RenderGraph::evaluate");
+		if (!jobs)
 		{
-			auto& pass = m_passDescriptors[passNdx];
-			// Bind target frame buffer
-			dst.bindFrameBuffer(pass.m_cachedFb);
-			dst.setViewport(math::Vec2u::zero(), pass.targetSize);
-			dst.setScissor(math::Vec2u::zero(), pass.targetSize);
-			// Collapse input textures into a local array of physical textures
-			Texture2d passInputs[PassBuilder::cMaxInputs];
-			assert(pass.m_inputs.size() <= IPassBuilder::cMaxInputs);
-			for (size_t i = 0; i < pass.m_inputs.size(); ++i)
+			// For each pass in compiled passes
+			for (auto passNdx : m_sortedPasses)
 			{
-				auto& bufferState = m_bufferLifetime[pass.m_inputs[i]];
-				passInputs[i] = m_virtualToPhysical[bufferState.virtualBufferNdx].id();
+				evaluatePass(passNdx, dst);
 			}
-			// Call the evaluator
-			pass.evaluator(passInputs, pass.m_inputs.size(), dst);
+			return;
+		}
+
+		// Kick parallel passes first, so they overlap with the ones that must be recorded on this thread
+		m_passCommands.resize(m_sortedPasses.size());
+		std::vector<core::JobSystem::JobHandle> parallelPasses;
+		for (size_t i = 0; i < m_sortedPasses.size(); ++i)
+		{
+			auto passNdx = m_sortedPasses[i];
+			m_passCommands[i].clear();
+			if (m_passDescriptors[passNdx].parallelRecording)
+			{
+				parallelPasses.push_back(jobs->schedule([this, i, passNdx]() {
+					REV_PROFILE_SCOPE("RenderGraph::evaluatePass");
+					evaluatePass(passNdx, m_passCommands[i]);
+				}));
+			}
+		}
+		for (size_t i = 0; i < m_sortedPasses.size(); ++i)
+		{
+			auto passNdx = m_sortedPasses[i];
+			if (!m_passDescriptors[passNdx].parallelRecording)
+			{
+				evaluatePass(passNdx, m_passCommands[i]);
+			}
+		}
+		jobs->wait(parallelPasses);
+
+		// Merge in order
+		for (size_t i = 0; i < m_sortedPasses.size(); ++i)
+		{
+			dst.append(m_passCommands[i]);
+		}
+	}
+
+	//--------------------------------------------------------------------------
+	void RenderGraph::evaluatePass(size_t passNdx, CommandBuffer& dst)
+	{
+		auto& pass = m_passDescriptors[passNdx];
+		// Bind target frame buffer
+		dst.bindFrameBuffer(m_passFramebuffers[passNdx]);
+		dst.setViewport(math::Vec2u::zero(), pass.targetSize);
+		dst.setScissor(math::Vec2u::zero(), pass.targetSize);
+		// Collapse input textures into a local array of physical textures
+		Texture2d passInputs[PassBuilder::cMaxInputs];
+		assert(pass.m_inputs.size() <= IPassBuilder::cMaxInputs);
+		for (size_t i = 0; i < pass.m_inputs.size(); ++i)
+		{
+			auto& bufferState = m_bufferLifetime[pass.m_inputs[i]];
+			passInputs[i] = m_virtualToPhysical[bufferState.virtualBufferNdx];
 		}
+		// Call the evaluator
+		pass.evaluator(passInputs, pass.m_inputs.size(), dst);
 	}
 
 	//--------------------------------------------------------------------------
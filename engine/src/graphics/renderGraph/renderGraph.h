@@ -22,17 +22,22 @@
 #include "../backend/namedResource.h"
 #include "types.h"
 
+#include <graphics/backend/commandBuffer.h>
 #include <graphics/backend/gpuTypes.h>
 #include <graphics/backend/texture2d.h>
 #include <math/algebra/vector.h>
 
+#include <cstdint>
 #include <functional>
-#include <map>
 #include <string>
+#include <vector>
+
+namespace rev::core {
+	class JobSystem;
+}
 
 namespace rev::gfx {
 
-	class CommandBuffer;
 	class Device;
 	class FrameBufferCache;
 
@@ -60,6 +65,9 @@ namespace rev::gfx {
 			// Write to a buffer from a previous pass.
 			virtual BufferResource write(BufferResource) = 0;
 			virtual void read(BufferResource, int bindingPos) = 0;
+			// Allow the evaluator of this pass to run on a worker thread, concurrently with other passes.
+			// Such evaluators must only record commands, and not touch the device or state shared with other passes.
+			virtual void recordInParallel() = 0;
 
 			static constexpr size_t cMaxInputs = 8;
 		};
@@ -67,23 +75,54 @@ namespace rev::gfx {
 		using PassDefinition = std::function<void(IPassBuilder&)>;
 		using PassEvaluator = std::function<void(const Texture2d* inputTextures, size_t nInputTextures, CommandBuffer& dst)>;
 
+		struct BuildStats
+		{
+			float buildMs = 0.f; // Cpu time spent in the last call to build
+			bool cached = false; // Whether the last build reused the previous compiled graph
+			size_t numCompilations = 0; // Number of times the graph actually had to be compiled
+		};
+
+		// Memory used by the transient targets of the graph. Imported resources are not accounted for.
+		struct MemoryReport
+		{
+			size_t numVirtualTextures = 0;
+			size_t numPhysicalTextures = 0;
+			size_t transientBytes = 0; // Memory all transient targets would need without aliasing
+			size_t peakBytes = 0; // Memory actually backing the transient targets
+			size_t aliasedBytes = 0; // Memory saved by sharing physical textures between transient targets
+		};
+
 	public:
 
 		RenderGraph(Device&);
 
 		// Graph lifetime
-		void reset(); // Does not clear allocated GPU resources.
+		void reset(); // Does not clear allocated GPU resources, nor the compiled graph.
 		void addPass(const std::string& name, const math::Vec2u& size, PassDefinition, PassEvaluator, HWAntiAlias = HWAntiAlias::none);
+		// Passes are sorted and bound to resources only when the topology of the graph (passes, sizes, formats and
+		// dependencies) differs from the previous build. Otherwise, the previous schedule and bindings are reused.
 		void build(FrameBufferCache&);
+		const BuildStats& buildStats() const { return m_buildStats; }
+		const MemoryReport& memoryReport() const { return m_memoryReport; }
+		// Index of the physical texture backing a resource in the built graph, or -1 for imported resources.
+		// Resources whose lifetimes don't overlap may share the same physical texture.
+		int physicalSlot(BufferResource) const;
 
-		// Record graph execution into a command buffer for deferred submision
-		void evaluate(CommandBuffer& dst);
+		// Record graph execution into a command buffer for deferred submision.
+		// When a job system is provided, passes that allow it are recorded on worker threads into separate command
+		// buffers, while the rest are recorded on the calling thread. All of them are then merged in order into dst.
+		void evaluate(CommandBuffer& dst, core::JobSystem* jobs = nullptr);
 
 		// Free allocated memory resources, like textures and frame buffers. Must not be called on a built graph
 		void clearResources();
 
 	private:
+		uint64_t topologyHash() const;
+		void compile(FrameBufferCache&);
 		void sortPasses(); // Sort passes based on their dependencies
+		void planAliasing(); // Assign physical slots to transient resources, based on their lifetime in the sorted passes
+		void drawDebugInfo() const;
+		void evaluatePass(size_t passNdx, CommandBuffer& dst);
 
 	private:
 		Device& m_gfxDevice;
@@ -117,6 +156,7 @@ namespace rev::gfx {
 			BufferResource write(BufferFormat) override;
 			BufferResource write(BufferResource) override;
 			void read(BufferResource, int bindingPos) override;
+			void recordInParallel() override { parallelRecording = true; }
 
 			// References to the rendergraphs buffer state
 			std::vector<PassState>& m_bufferLifetime;
@@ -132,9 +172,7 @@ namespace rev::gfx {
 			HWAntiAlias antiAliasing;
 			PassDefinition definition;
 			PassEvaluator evaluator;
-
-			// Cached state
-			FrameBuffer m_cachedFb;
+			bool parallelRecording = false;
 
 		private:
 			BufferResource registerOutput(PassState);
@@ -156,7 +194,20 @@ namespace rev::gfx {
 
 		// Resources
 		std::vector<VirtualResource> m_virtualResources;
-		std::map<size_t, Texture2d> m_virtualToPhysical; // Mapping from virtual resource indices to frame buffer attachments
+
+		// Compiled state. Survives reset, so it can be reused by the next build if the topology doesn't change.
+		std::vector<Texture2d> m_virtualToPhysical; // Mapping from virtual resource indices to frame buffer attachments
+		std::vector<int> m_physicalSlots; // Physical slot of each virtual resource. -1 for imported resources
+		std::vector<BufferDesc> m_slotDescriptors; // Format of the texture backing each physical slot
+		MemoryReport m_memoryReport;
+		std::vector<FrameBuffer> m_passFramebuffers; // Target of each pass, indexed like m_passDescriptors
+		uint64_t m_compiledHash = 0;
+		const FrameBufferCache* m_compiledCache = nullptr;
+		uint32_t m_compiledCacheGeneration = 0;
+		BuildStats m_buildStats;
+
+		// Evaluation
+		std::vector<CommandBuffer> m_passCommands; // One per sorted pass, reused across frames
 	};
 
 }
@@ -20,17 +20,20 @@
 #include "ShadowMapPass.h"
 
 #include <core/platform/fileSystem/file.h>
+#include <core/tasks/radixSort.h>
 #include <graphics/backend/commandBuffer.h>
 #include <graphics/backend/device.h>
 #include <graphics/backend/renderPass.h>
 #include <graphics/debug/imgui.h>
 #include <graphics/driver/shaderProcessor.h>
+#include <graphics/renderer/material/material.h>
 #include <graphics/scene/camera.h>
 #include <graphics/scene/renderGeom.h>
 #include <graphics/scene/renderMesh.h>
 #include <graphics/scene/renderObj.h>
 #include <graphics/scene/renderScene.h>
 #include <math/algebra/affineTransform.h>
+#include <cstring>
 #include <string>
 
 using namespace rev::math;
@@ -39,6 +42,27 @@ using namespace std;
 
 namespace rev::gfx {
 
+	namespace {
+		constexpr unsigned cMaskedShift = 63;
+		constexpr uint64_t cDepthMask = (uint64_t(1) << 29) - 1;
+
+		// 16 bit hash, so items sharing state end up next to each other
+		uint64_t pointerKey(const void* ptr)
+		{
+			return (uint64_t(uintptr_t(ptr)) * 0x9E3779B97F4A7C15ull) >> 48;
+		}
+
+		// Shadow space depth can have either sign, so flip the bits of the float to make them
+		// sort in the same order as the float itself, then keep the top 29.
+		uint64_t depthKey(float depth)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &depth, sizeof(bits));
+			bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+			return bits >> 3;
+		}
+	}
+
 	//----------------------------------------------------------------------------------------------
 	ShadowMapPass::ShadowMapPass(Device& device, const math::Vec2u& _size)
 		: m_device(device)
@@ -83,10 +107,11 @@ namespace rev::gfx {
 		// Do this accumulation in view space to minimize the size of this bbox.
 		// If we rotated the bbox first into world space, and then again into view space,
 		// the result would be bigger.
-		m_visibleCasters.clear();
+		m_sortedCasters.clear();
 		AABB castersBBox; castersBBox.clear(); // In view space
-		for(auto& obj : shadowCasters)
+		for(uint32_t i = 0; i < shadowCasters.size(); ++i)
 		{
+			auto& obj = shadowCasters[i];
 			// Object's bounding box in shadow space
 			Mat44f shadowFromModel = shadowView * obj.world;
 			auto bbox = shadowFromModel * obj.geom->bbox();
@@ -94,7 +119,13 @@ namespace rev::gfx {
 			if(shadowSpaceRecVolume.intersect(bbox))
 			{
 				castersBBox.add(bbox);
-				m_visibleCasters.push_back(obj);
+				// Sort key, from most to least significant bits:
+				//	alpha masked (1) | material (16) | geometry (16) | depth (29), front to back.
+				// The light looks down -z, so casters closer to it have a bigger z.
+				uint64_t masked = obj.material->transparency() != Material::Transparency::Opaque;
+				uint64_t depth = cDepthMask - depthKey(bbox.center().z());
+				uint64_t key = masked << cMaskedShift | pointerKey(obj.material) << 45 | pointerKey(obj.geom) << 29 | depth;
+				m_sortedCasters.push_back({ key, i });
 			}
 		}
 		castersBBox = castersBBox.intersection(shadowSpaceRecVolume);
@@ -105,16 +136,11 @@ namespace rev::gfx {
 
 		adjustViewMatrix(shadowView, castersBBox);// Adjust view matrix
 
-		// Render
-		std::sort(m_visibleCasters.begin(), m_visibleCasters.end(), [](const gfx::RenderItem& a, const gfx::RenderItem& b){
-			if (a.material->AlphaMask == b.material->AlphaMask)
-			{
-				a.geom < b.geom;
-			}
-			else return a.material < b.material;
-			});
 		// Sort meshes to reduce API calls
-		renderMeshes(m_visibleCasters, dst); // Iterate over renderables
+		core::radixSort(m_sortedCasters, m_sortScratch);
+
+		// Render
+		renderMeshes(shadowCasters, m_sortedCasters, dst); // Iterate over renderables
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -133,19 +159,21 @@ namespace rev::gfx {
 	}
 
 	//----------------------------------------------------------------------------------------------
-	void ShadowMapPass::renderMeshes(const std::vector<gfx::RenderItem>& renderables, CommandBuffer& dst)
+	void ShadowMapPass::renderMeshes(
+		const std::vector<gfx::RenderItem>& renderables,
+		const std::vector<core::SortItem>& drawOrder,
+		CommandBuffer& dst)
 	{
 		// Reserve GPU memory
-		reserveMatrixBuffer(renderables.size());
+		reserveMatrixBuffer(drawOrder.size());
 		// Map GPU buffer to memory
 		Mat44f* mappedMatrixBuffer = m_device.mapTypedBuffer<Mat44f>(
 			m_gpuMatrixBuffer,
 			Device::BufferUsageTarget::ShaderStorage,
 			0,
-			renderables.size());
+			drawOrder.size());
 
 		// Init reusable data
-		auto worldMatrix = Mat44f::identity();
 		GeometryPass::Instance instance;
 		instance.geometryIndex = uint32_t(-1);
 		instance.instanceCode = nullptr;
@@ -174,22 +202,24 @@ namespace rev::gfx {
 		// TODO: Resubmit data
 
 		size_t baseInstance = 0;
-		for(auto& mesh : renderables)
+		for(auto& item : drawOrder)
 		{
+			auto& mesh = renderables[item.index];
 			// Raster options
-			bool mirroredGeometry = affineTransformDeterminant(worldMatrix) < 0.f;
+			bool mirroredGeometry = affineTransformDeterminant(mesh.world) < 0.f;
 			m_rasterOptions.frontFace = mirroredGeometry ? Pipeline::Winding::CW : Pipeline::Winding::CCW;
 			instance.raster = m_rasterOptions.mask();
 			// Uniforms
 			instance.uniforms.clear();
-			instance.uniforms.addParam(1, float(baseInstance++));
+			instance.uniforms.addParam(1, float(baseInstance));
 			Mat44f wvp = mShadowProj* mesh.world;
-			mappedMatrixBuffer[baseInstance] = wvp.transpose();
+			mappedMatrixBuffer[baseInstance++] = wvp.transpose();
 			// Geometry
 			if(lastGeom != mesh.geom)
 			{
 				instance.geometryIndex++;
 				geometry.push_back(mesh.geom);
+				lastGeom = mesh.geom;
 			}
 			renderList.push_back(instance);
 		}
@@ -19,6 +19,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 #include <memory>
+#include <core/tasks/radixSort.h>
 #include <math/algebra/affineTransform.h>
 #include <math/geometry/aabb.h>
 #include <graphics/backend/commandBuffer.h>
@@ -60,7 +61,11 @@ namespace rev::gfx {
 	private:
 
 		void adjustViewMatrix(const math::Mat44f& shadowView, const math::AABB& castersBBox);
-		void renderMeshes(const std::vector<gfx::RenderItem>& renderables, CommandBuffer& dst);
+		// Draws renderables in the order given by the indices in drawOrder
+		void renderMeshes(
+			const std::vector<gfx::RenderItem>& renderables,
+			const std::vector<core::SortItem>& drawOrder,
+			CommandBuffer& dst);
 		void reserveMatrixBuffer(size_t numObjects);
 
 	private:
@@ -68,7 +73,8 @@ namespace rev::gfx {
 		//RenderPass*	m_pass;
 		Pipeline::RasterOptions m_rasterOptions;
 		GeometryPass m_geomPass;
-		std::vector<RenderItem> m_visibleCasters;
+		std::vector<core::SortItem> m_sortedCasters;
+		core::RadixSortScratch m_sortScratch;
 		CommandBuffer::UniformBucket m_passWideSSBOs;
 
 		math::Mat44f		mShadowProj;
@@ -19,6 +19,9 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "DeferredRenderer.h"
+#include <core/tasks/jobSystem.h>
+#include <core/tasks/radixSort.h>
+#include <core/tools/profiler.h>
 #include <graphics/backend/renderPass.h>
 #include <graphics/debug/imgui.h>
 #include <graphics/renderGraph/frameBufferCache.h>
@@ -31,18 +34,57 @@
 #include <math/algebra/vector.h>
 #include <math/algebra/matrix.h>
 
+#include <cstring>
 #include <sstream>
 
 using namespace rev::math;
 
 namespace rev::gfx {
 
+	namespace {
+		// Render queue an item is classified into, stored in the top bits of its sort key
+		constexpr unsigned cQueueShift = 61;
+		constexpr uint64_t cTransparentQueue = 4;
+		constexpr uint64_t cDepthMask = (uint64_t(1) << 29) - 1;
+
+		uint64_t queueIndex(const Material& material)
+		{
+			switch (material.transparency())
+			{
+				case Material::Transparency::Opaque:
+					return material.isEmissive() ? 2 : 0;
+				case Material::Transparency::Mask:
+					return material.isEmissive() ? 3 : 1;
+				default:
+					return cTransparentQueue;
+			}
+		}
+
+		// 16 bit hash, so items sharing state end up next to each other
+		uint64_t pointerKey(const void* ptr)
+		{
+			return (uint64_t(uintptr_t(ptr)) * 0x9E3779B97F4A7C15ull) >> 48;
+		}
+
+		// Bits of a positive float sort in the same order as the float.
+		// The sign bit is always clear, so dropping the two lowest bits leaves 29.
+		uint64_t depthKey(float depth)
+		{
+			if(!(depth > 0.f))
+				return 0;
+			uint32_t bits;
+			std::memcpy(&bits, &depth, sizeof(bits));
+			return bits >> 2;
+		}
+	}
+
 	//----------------------------------------------------------------------------------------------
 	void DeferredRenderer::init(Device& device, const math::Vec2u& size, FrameBuffer target)
 	{
 		m_targetFb = target;
 		m_device = &device;
 		m_fbCache = std::make_unique<FrameBufferCache>(device);
+		m_frameGraph = std::make_unique<RenderGraph>(device);
 		m_viewportSize = size;
 		const unsigned shadowBufferSize = 1024;
 		m_shadowSize = Vec2u(shadowBufferSize, shadowBufferSize);
@@ -73,9 +115,10 @@ namespace rev::gfx {
 	//----------------------------------------------------------------------------------------------
 	void DeferredRenderer::render(const RenderScene& scene, const Camera& eye)
 	{
-		// TODO: maybe move the actual ownership of the framegraph to whoever calls the renderer.
-		// That way, keeping the graph alive is the callers decision, and so graphcs can be cached, etc.
-		RenderGraph frameGraph(*m_device);
+		REV_PROFILE_SCOPE("DeferredRenderer::render");
+		// The graph is kept alive between frames, so its compiled state can be reused when the topology doesn't change
+		RenderGraph& frameGraph = *m_frameGraph;
+		frameGraph.reset();
 
 		ImGui::Begin("Deferred renderer");
 
@@ -95,51 +138,39 @@ namespace rev::gfx {
 		// Cull visible objects renderQ -> visible
 		collapseSceneRenderables(scene, eye);// Consolidate renderables into geometry (i.e. extracts geom from renderObj)
 		ImGui::Text("Visible: %d", m_visibleQueue.size());
-		sortVisibleQueue();
-
-		// Classify visible objects into separate render queues
-		m_opaqueQueue.clear();
-		m_alphaMaskQueue.clear();
-		m_emissiveMaskQueue.clear();
-		m_transparentQueue.clear();
-		m_emissiveQueue.clear();
-		
-		for (auto& renderItem : m_visibleQueue)
-		{
-			AABB viewSpaceBB = (view * renderItem.world) * renderItem.geom->bbox();
-			if (viewSpaceBB.min().z() < 0)
-			{
-				switch (renderItem.material->transparency())
-				{
-					case Material::Transparency::Opaque:
-					{
-						if (renderItem.material->isEmissive())
-							m_emissiveQueue.push_back(renderItem);
-						else
-							m_opaqueQueue.push_back(renderItem);
-						break;
-					}
-					case Material::Transparency::Mask:
-					{
-						if (renderItem.material->isEmissive())
-							m_emissiveMaskQueue.push_back(renderItem);
-						else
-							m_alphaMaskQueue.push_back(renderItem);
-						break;
-					}
-					case Material::Transparency::Blend:
-					{
-						m_transparentQueue.push_back(renderItem);
-						break;
-					}
-				}
-			}
-		}
+		sortVisibleQueue(view);
+
+		// Classify visible objects into separate render queues, keeping the sorted order
+		std::vector<RenderItem>* queues[] = {
+			&m_opaqueQueue,
+			&m_alphaMaskQueue,
+			&m_emissiveQueue,
+			&m_emissiveMaskQueue,
+			&m_transparentQueue
+		};
+		for(auto queue : queues)
+			queue->clear();
+		for(auto& sortItem : m_sortedVisibleItems)
+			queues[sortItem.key >> cQueueShift]->push_back(m_visibleQueue[sortItem.index]);
 
 		bool useEmissive = !m_emissiveQueue.empty();
 		auto viewMtx = eye.view();
 		auto projMtx = eye.projection(aspectRatio);
 
+		// Passes that allow it are recorded in parallel, so anything that touches the device or shared state
+		// must happen here, before evaluating the graph.
+		auto jobs = core::JobSystem::get();
+		auto maskedOptions = m_rasterOptions;
+		maskedOptions.alphaMask = true;
+		auto transparentOptions = m_rasterOptions;
+		transparentOptions.blendMode = Pipeline::BlendMode::Additive;
+		m_gBufferPass->packIndirect(viewMtx, projMtx, m_opaqueQueue, m_rasterOptions, *m_opaqueBatches);
+		m_gBufferMaskedPass->packIndirect(viewMtx, projMtx, m_alphaMaskQueue, m_rasterOptions, *m_alphaMaskBatches);
+		m_gBufferPass->packIndirect(viewMtx, projMtx, m_emissiveQueue, m_rasterOptions, *m_emissiveBatches);
+		m_gBufferMaskedPass->packIndirect(viewMtx, projMtx, m_emissiveMaskQueue, maskedOptions, *m_emissiveMaskBatches);
+		m_gTransparentPass->preparePipelines(m_transparentQueue, transparentOptions);
+		unsigned noiseTextureNdx = m_noisePermutations(m_rng); // New noise permutation for primary light
+
 		// G-Buffer pass with emissive
 		RenderGraph::BufferResource depth, normals, pbr, albedo, hdr; // G-Pass outputs
 		if (useEmissive)
@@ -149,6 +180,7 @@ namespace rev::gfx {
 				// Pass definition
 				[&](RenderGraph::IPassBuilder& pass) {
 					hdr = pass.write(BufferFormat::RGBA32);
+					pass.recordInParallel();
 				},
 				// Pass evaluation
 				[&](const Texture2d* inputTextures, size_t nInputTextures, CommandBuffer& dst)
@@ -169,6 +201,7 @@ namespace rev::gfx {
 				albedo = pass.write(BufferFormat::sRGBA8);
 				pbr = pass.write(BufferFormat::RGBA8);
 				depth = pass.write(BufferFormat::depth32);
+				pass.recordInParallel();
 			},
 			// Pass evaluation
 				[&](const Texture2d* inputTextures, size_t nInputTextures, CommandBuffer& dst)
@@ -178,8 +211,8 @@ namespace rev::gfx {
 				dst.clearColor(Vec4f(0.f,0.f,0.f,1.f));
 				dst.clear(Clear::All);
 
-				m_gBufferPass->render(viewMtx, projMtx, m_opaqueQueue, m_rasterOptions, Material::Flags::Normals | Material::Flags::Shading, dst);
-				m_gBufferMaskedPass->render(viewMtx, projMtx, m_alphaMaskQueue, m_rasterOptions, Material::Flags::Normals | Material::Flags::Shading | Material::Flags::AlphaMask, dst);
+				m_gBufferPass->renderIndirect(*m_opaqueBatches, Material::Flags::Normals | Material::Flags::Shading, dst);
+				m_gBufferMaskedPass->renderIndirect(*m_alphaMaskBatches, Material::Flags::Normals | Material::Flags::Shading | Material::Flags::AlphaMask, dst);
 			});
 
 		if (useEmissive)
@@ -193,16 +226,15 @@ namespace rev::gfx {
 					pbr = pass.write(pbr);
 					depth = pass.write(depth);
 					hdr = pass.write(hdr);
+					pass.recordInParallel();
 				},
 				// Pass evaluation
 					[&](const Texture2d* inputTextures, size_t nInputTextures, CommandBuffer& dst)
 				{
-					m_gBufferPass->render(viewMtx, projMtx, m_emissiveQueue, m_rasterOptions,
+					m_gBufferPass->renderIndirect(*m_emissiveBatches,
 						Material::Flags::Normals | Material::Flags::Shading | Material::Flags::Emissive,
 						dst);
-					auto maskedOptions = m_rasterOptions;
-					maskedOptions.alphaMask = true;
-					m_gBufferMaskedPass->render(viewMtx, projMtx, m_emissiveMaskQueue, maskedOptions,
+					m_gBufferMaskedPass->renderIndirect(*m_emissiveMaskBatches,
 						Material::Flags::Normals | Material::Flags::Shading | Material::Flags::Emissive | Material::Flags::AlphaMask,
 						dst);
 				});
@@ -217,6 +249,7 @@ namespace rev::gfx {
 				ao = pass.write(BufferFormat::R8);
 				pass.read(normals, 0);
 				pass.read(depth, 1);
+				pass.recordInParallel();
 			},
 			// Pass evaluation
 				[&](const Texture2d* inputTextures, size_t nInputTextures, CommandBuffer& dst)
@@ -238,7 +271,6 @@ namespace rev::gfx {
 				// Textures
 				uniforms.addParam(7, inputTextures[0]);
 				uniforms.addParam(8, inputTextures[1]);
-				unsigned noiseTextureNdx = m_noisePermutations(m_rng); // New noise permutation for primary light
 				uniforms.addParam(9, m_blueNoise[noiseTextureNdx]);
 
 				m_aoSamplePass->render(uniforms, dst);
@@ -347,14 +379,13 @@ namespace rev::gfx {
 			[&](RenderGraph::IPassBuilder& pass) {
 				hdr = pass.write(hdr);
 				pass.read(depth, 0);
+				pass.recordInParallel();
 			},
 			[&](const Texture2d* inputTextures, size_t nInputTextures, CommandBuffer& dst)
 			{
-				auto maskedOptions = m_rasterOptions;
-				maskedOptions.blendMode = Pipeline::BlendMode::Additive;
-				m_gTransparentPass->render(viewMtx, projMtx, m_transparentQueue, maskedOptions,
+				m_gTransparentPass->render(viewMtx, projMtx, m_transparentQueue, transparentOptions,
 					Material::Flags::Normals | Material::Flags::Shading | Material::Flags::AlphaBlend,
-					dst);
+					dst, jobs);
 			});
 
 		frameGraph.addPass("hdr",
@@ -363,6 +394,7 @@ namespace rev::gfx {
 			[&](RenderGraph::IPassBuilder& pass) {
 				//hdr = pass.write(BufferFormat::RGBA32);
 				pass.read(hdr, 0); // Should write to hdr
+				pass.recordInParallel();
 				pass.write(m_targetFb); // Hack: Doesnt really write to it. But we need it bound in the fb
 			},
 			// Pass evaluation
@@ -379,11 +411,11 @@ namespace rev::gfx {
 
 		// Record passes
 		frameGraph.build(*m_fbCache);
-		CommandBuffer frameCommands;
+		m_frameCommands.clear();
 
-		frameGraph.evaluate(frameCommands);
+		frameGraph.evaluate(m_frameCommands, jobs);
 		// Submit
-		m_device->renderQueue().submitCommandBuffer(frameCommands);
+		m_device->renderQueue().submitCommandBuffer(m_frameCommands);
 
 		ImGui::Separator();
 		ImGui::Text("Global performance counters");
@@ -412,6 +444,10 @@ namespace rev::gfx {
 		m_gBufferPass = std::make_unique<GeometryPass>(*m_device, gBufferCode);
 		ShaderCodeFragment* gBufferMaskedCode = new ShaderCodeFragment(new ShaderCodeFragment("#define ALPHA_MASK\n"), gBufferCode);
 		m_gBufferMaskedPass = std::make_unique<GeometryPass>(*m_device, gBufferMaskedCode);
+		m_opaqueBatches = std::make_unique<GeometryPass::IndirectBatches>(*m_device);
+		m_alphaMaskBatches = std::make_unique<GeometryPass::IndirectBatches>(*m_device);
+		m_emissiveBatches = std::make_unique<GeometryPass::IndirectBatches>(*m_device);
+		m_emissiveMaskBatches = std::make_unique<GeometryPass::IndirectBatches>(*m_device);
 
 		// Shadow pass
 		m_shadowPass = std::make_unique<ShadowMapPass>(*m_device, m_shadowSize);
@@ -491,7 +527,8 @@ namespace rev::gfx {
 		float minShadowDistance;
 		m_visibleVolume.clear();
 
-		// Cull renderables in view space for maximun compactness
+		// Gather renderables and their bounds in view space for maximun compactness
+		m_viewSpaceBounds.clear();
 		for(auto obj : scene.renderables())
 		{			
 			if(!obj->visible)
@@ -503,34 +540,49 @@ namespace rev::gfx {
 				assert(mesh.first && mesh.second);
 				auto renderItem = RenderItem{ obj->transform, &*mesh.first, &*mesh.second };
 				m_renderQueue.push_back(renderItem);
-
-				AABB viewSpaceBB = viewFromObj * renderItem.geom->bbox();
-				if (math::intersect(m_cullingFrustum, viewSpaceBB))
-				{
-					m_visibleQueue.push_back(renderItem);
-					m_visibleVolume.add(viewSpaceBB);
-				}
+				m_viewSpaceBounds.push_back(viewFromObj, renderItem.geom->bbox());
 			}
 		}
 
+		// Batched culling
+		AABB frustumBBox = m_cullingFrustum.boundingBox();
+		m_visibleIndices.clear();
+		math::cull(m_cullingFrustum, frustumBBox, m_viewSpaceBounds, m_visibleIndices);
+		for(auto i : m_visibleIndices)
+		{
+			m_visibleQueue.push_back(m_renderQueue[i]);
+			m_visibleVolume.add(m_viewSpaceBounds[i]);
+		}
+
 		// Clamp visible volume to the view frustum visibility range
-		m_visibleVolume = m_visibleVolume.intersection(m_cullingFrustum.boundingBox());
+		m_visibleVolume = m_visibleVolume.intersection(frustumBBox);
 	}
 
 	//---------------------------------------------------------------------------------------------------------------------
-	void DeferredRenderer::sortVisibleQueue()
+	void DeferredRenderer::sortVisibleQueue(const Mat44f& view)
 	{
-		Vec3f viewDir = -m_cullingViewMtx.transpose().col<2>().xyz();
+		// Sort keys, from most to least significant bits:
+		//	Opaque queues: queue (3) | material (16) | geometry (16) | depth (29), front to back
+		//	Transparent queue: queue (3) | inverted depth (29), back to front
+		m_sortedVisibleItems.clear();
+		for(uint32_t i = 0; i < m_visibleQueue.size(); ++i)
+		{
+			auto& renderItem = m_visibleQueue[i];
+			AABB viewSpaceBB = (view * renderItem.world) * renderItem.geom->bbox();
+			if (viewSpaceBB.min().z() >= 0) // Behind the camera
+				continue;
 
-		std::sort(m_visibleQueue.begin(), m_visibleQueue.end(), [=](const RenderItem& a, const RenderItem& b) {
-			Vec3f aCenter = a.world.block<3, 3, 0, 0>() * a.geom->bbox().center();
-			Vec3f bCenter = b.world.block<3, 3, 0, 0>() * b.geom->bbox().center();
-			float da = dot(aCenter, viewDir);
-			float db = dot(bCenter, viewDir);
+			uint64_t queue = queueIndex(*renderItem.material);
+			uint64_t depth = depthKey(-viewSpaceBB.center().z());
+			uint64_t key = queue << cQueueShift;
+			if(queue == cTransparentQueue)
+				key |= cDepthMask - depth;
+			else
+				key |= pointerKey(renderItem.material) << 45 | pointerKey(renderItem.geom) << 29 | depth;
+			m_sortedVisibleItems.push_back({ key, i });
+		}
 
-			bool result = da < db;
-			return result;
-		});
+		core::radixSort(m_sortedVisibleItems, m_sortScratch, core::JobSystem::get());
 	}
 
 } // namespace rev::gfx
\ No newline at end of file
@@ -19,6 +19,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
+#include <core/tasks/radixSort.h>
 #include <graphics/backend/gpuTypes.h>
 #include <graphics/renderer/RenderItem.h>
 #include <graphics/renderer/renderPass/geometryPass.h>
@@ -26,6 +27,7 @@
 #include <graphics/renderer/ShadowMapPass.h>
 #include <graphics/renderGraph/renderGraph.h>
 #include <graphics/renderGraph/frameBufferCache.h>
+#include <math/geometry/culling.h>
 #include <random>
 #include <vector>
 
@@ -48,7 +50,7 @@ namespace rev::gfx {
 		void createRenderPasses(gfx::FrameBuffer target);
 		void loadNoiseTextures();
 		void collapseSceneRenderables(const RenderScene&, const Camera& eye);
-		void sortVisibleQueue();
+		void sortVisibleQueue(const math::Mat44f& view);
 
 	private:
 		Device*		m_device = nullptr;
@@ -65,6 +67,8 @@ namespace rev::gfx {
 		math::Vec2u m_shadowSize;
 		FrameBuffer m_targetFb;
 		std::unique_ptr<FrameBufferCache> m_fbCache;
+		std::unique_ptr<RenderGraph> m_frameGraph;
+		CommandBuffer m_frameCommands;
 
 		// Noise
 		static constexpr unsigned NumBlueNoiseTextures = 64;
@@ -75,6 +79,10 @@ namespace rev::gfx {
 		// Geometry arrays
 		std::vector<RenderItem> m_renderQueue;
 		std::vector<RenderItem> m_visibleQueue;
+		math::AABBSoA m_viewSpaceBounds; // One per item in m_renderQueue
+		std::vector<uint32_t> m_visibleIndices;
+		std::vector<core::SortItem> m_sortedVisibleItems; // Visible items in front of the camera, sorted by queue and state
+		core::RadixSortScratch m_sortScratch;
 		std::vector<RenderItem> m_opaqueQueue;
 		std::vector<RenderItem> m_alphaMaskQueue;
 		std::vector<RenderItem> m_emissiveQueue;
@@ -86,6 +94,11 @@ namespace rev::gfx {
 		std::unique_ptr<GeometryPass>	m_gBufferPass = nullptr;
 		std::unique_ptr<GeometryPass>	m_gBufferMaskedPass = nullptr;
 		std::unique_ptr<GeometryPass>	m_gTransparentPass = nullptr;
+		// Opaque queues are drawn with indirect draws
+		std::unique_ptr<GeometryPass::IndirectBatches> m_opaqueBatches;
+		std::unique_ptr<GeometryPass::IndirectBatches> m_alphaMaskBatches;
+		std::unique_ptr<GeometryPass::IndirectBatches> m_emissiveBatches;
+		std::unique_ptr<GeometryPass::IndirectBatches> m_emissiveMaskBatches;
 		std::unique_ptr<FullScreenPass>	m_bgPass;
 		std::unique_ptr<FullScreenPass>	m_hdrPass;
 		std::unique_ptr<FullScreenPass>	m_aoSamplePass;
@@ -32,7 +32,7 @@ namespace rev::gfx {
 	{
 		ShaderProcessor::MetaData metadata;
 		loadFromFile(_fileName.c_str(), metadata);
-#ifdef _WIN32
+#ifndef ANDROID
 		for(auto& dep : metadata.dependencies)
 			m_fileListeners.push_back(core::FileSystem::get()->onFileChanged(dep) += [this](const char* fileName){
 				this->reload();
@@ -18,13 +18,98 @@
 // DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "geometryPass.h"
+#include <algorithm>
+#include <cassert>
+#include <core/tasks/jobSystem.h>
+#include <cstring>
 #include <math/algebra/matrix.h>
+#include <graphics/backend/device.h>
 #include <graphics/renderer/material/material.h>
 
 using namespace rev::math;
 
 namespace rev::gfx {
 
+	namespace {
+		CommandBuffer::IndexType indexType(const RenderGeom& geom)
+		{
+			if (geom.indices().componentType == GL_UNSIGNED_BYTE)
+				return CommandBuffer::IndexType::U8;
+			if (geom.indices().componentType == GL_UNSIGNED_INT)
+				return CommandBuffer::IndexType::U32;
+			return CommandBuffer::IndexType::U16;
+		}
+
+		uint32_t indexSize(CommandBuffer::IndexType type)
+		{
+			switch (type)
+			{
+			case CommandBuffer::IndexType::U8: return 1;
+			case CommandBuffer::IndexType::U16: return 2;
+			case CommandBuffer::IndexType::U32: return 4;
+			}
+			return 2;
+		}
+
+		// Shaders expect column major matrices in storage buffers
+		Mat44f gpuMatrix(const Mat44f& m)
+		{
+			return Mat44f::is_col_major ? m : m.transpose();
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	GeometryPass::IndirectBatches::IndirectBatches(Device& device)
+		: m_device(device)
+	{}
+
+	//----------------------------------------------------------------------------------------------
+	GeometryPass::IndirectBatches::~IndirectBatches()
+	{
+		if (m_gpuInstances.isValid())
+			m_device.deallocateBuffer(m_gpuInstances);
+		if (m_gpuCommands.isValid())
+			m_device.deallocateBuffer(m_gpuCommands);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void GeometryPass::IndirectBatches::upload()
+	{
+		if (m_groups.empty())
+			return;
+
+		// Grow buffers when needed. Otherwise, overwrite the previous contents in place
+		if (m_gpuInstanceCapacity < m_instances.size())
+		{
+			if (m_gpuInstances.isValid())
+				m_device.deallocateBuffer(m_gpuInstances);
+			m_gpuInstanceCapacity = m_instances.capacity();
+			m_gpuInstances = m_device.allocateTypedBuffer<InstanceData>(
+				m_gpuInstanceCapacity,
+				Device::BufferUpdateFrequency::Streamming,
+				Device::BufferUsageTarget::ShaderStorage);
+		}
+		auto mappedInstances = m_device.mapTypedBuffer<InstanceData>(
+			m_gpuInstances, Device::BufferUsageTarget::ShaderStorage, 0, m_instances.size());
+		std::memcpy(mappedInstances, m_instances.data(), m_instances.size() * sizeof(InstanceData));
+		m_device.unmapBuffer(m_gpuInstances, Device::BufferUsageTarget::ShaderStorage);
+
+		if (m_gpuCommandCapacity < m_commands.size())
+		{
+			if (m_gpuCommands.isValid())
+				m_device.deallocateBuffer(m_gpuCommands);
+			m_gpuCommandCapacity = m_commands.capacity();
+			m_gpuCommands = m_device.allocateTypedBuffer<CommandBuffer::BatchCommand>(
+				m_gpuCommandCapacity,
+				Device::BufferUpdateFrequency::Streamming,
+				Device::BufferUsageTarget::DrawIndirect);
+		}
+		auto mappedCommands = m_device.mapTypedBuffer<CommandBuffer::BatchCommand>(
+			m_gpuCommands, Device::BufferUsageTarget::DrawIndirect, 0, m_commands.size());
+		std::memcpy(mappedCommands, m_commands.data(), m_commands.size() * sizeof(CommandBuffer::BatchCommand));
+		m_device.unmapBuffer(m_gpuCommands, Device::BufferUsageTarget::DrawIndirect);
+	}
+
 	//----------------------------------------------------------------------------------------------
 	GeometryPass::GeometryPass(Device& device, ShaderCodeFragment* passCommonCode)
 		: mDevice(device)
@@ -47,46 +132,127 @@ namespace rev::gfx {
 		const std::vector<RenderItem>& geometry,
 		Pipeline::RasterOptions rasterOptions,
 		Material::Flags bindingFlags,
-		CommandBuffer& out)
+		CommandBuffer& out,
+		core::JobSystem* jobs)
+	{
+		if (!jobs || geometry.size() <= cItemsPerChunk)
+		{
+			recordChunk(view, proj, geometry.data(), geometry.data() + geometry.size(), rasterOptions, bindingFlags, out);
+			return;
+		}
+
+		// Every chunk sets up its own state, so they can be recorded independently and appended in order
+		size_t numChunks = (geometry.size() + cItemsPerChunk - 1) / cItemsPerChunk;
+		if (m_chunkCommands.size() < numChunks)
+			m_chunkCommands.resize(numChunks);
+		jobs->parallel_for(0, numChunks, 1, [&](size_t i) {
+			auto begin = geometry.data() + i * cItemsPerChunk;
+			auto end = geometry.data() + std::min(geometry.size(), (i + 1) * cItemsPerChunk);
+			m_chunkCommands[i].clear();
+			recordChunk(view, proj, begin, end, rasterOptions, bindingFlags, m_chunkCommands[i]);
+		});
+		for (size_t i = 0; i < numChunks; ++i)
+		{
+			out.append(m_chunkCommands[i]);
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void GeometryPass::preparePipelines(const std::vector<RenderItem>& geometry, Pipeline::RasterOptions rasterOptions)
 	{
 		auto worldMatrix = Mat44f::identity();
-		GeometryPass::Instance instance;
-		instance.geometryIndex = uint32_t(-1);
-		instance.instanceCode = nullptr;
+		const RenderGeom* lastGeom = nullptr;
+		const Material* lastMaterial = nullptr;
+		for (auto& mesh : geometry)
+		{
+			if ((lastGeom == mesh.geom) && (lastMaterial == mesh.material))
+				continue;
+			lastGeom = mesh.geom;
+			lastMaterial = mesh.material;
+
+			bool mirroredGeometry = affineTransformDeterminant(worldMatrix) < 0.f;
+			rasterOptions.frontFace = mirroredGeometry ? Pipeline::Winding::CW : Pipeline::Winding::CCW;
+			getPipeline(rasterOptions.mask(), getMaterialCode(mesh.geom->vertexFormat(), *mesh.material));
+		}
+	}
 
-		std::vector<GeometryPass::Instance> renderList;
-		std::vector<const RenderGeom*> geoms;
+	//----------------------------------------------------------------------------------------------
+	void GeometryPass::recordChunk(
+		const Mat44f& view,
+		const Mat44f& proj,
+		const RenderItem* begin,
+		const RenderItem* end,
+		Pipeline::RasterOptions rasterOptions,
+		Material::Flags bindingFlags,
+		CommandBuffer& out) const
+	{
+		auto worldMatrix = Mat44f::identity();
+		CommandBuffer::UniformBucket uniforms;
+		ShaderCodeFragment* instanceCode = nullptr;
+
+		// Render state caches
 		const RenderGeom* lastGeom = nullptr;
 		const Material* lastMaterial = nullptr;
+		const RenderGeom* lastBoundGeom = nullptr;
+		ShaderCodeFragment* lastCode = nullptr;
+		Pipeline::RasterOptions::Mask lastMask = 0;
 
-		for (auto& mesh : geometry)
+		for (auto mesh = begin; mesh != end; ++mesh)
 		{
 			// Raster options
 			bool mirroredGeometry = affineTransformDeterminant(worldMatrix) < 0.f;
 			rasterOptions.frontFace = mirroredGeometry ? Pipeline::Winding::CW : Pipeline::Winding::CCW;
-			instance.raster = rasterOptions.mask();
+			auto rasterMask = rasterOptions.mask();
 			// Uniforms
-			instance.uniforms.clear();
-			Mat44f world = mesh.world;
+			uniforms.clear();
+			Mat44f world = mesh->world;
 			Mat44f wvp = proj * (view * world); // world/view multiplied first for improved precision
-			instance.uniforms.mat4s.push_back({ 0, wvp });
-			instance.uniforms.mat4s.push_back({ 1, world });
-			// Geometry
-			if ((lastGeom != mesh.geom) || (lastMaterial != mesh.material))
+			uniforms.mat4s.push_back({ 0, wvp });
+			uniforms.mat4s.push_back({ 1, world });
+			// Material
+			if ((lastGeom != mesh->geom) || (lastMaterial != mesh->material))
 			{
-				lastMaterial = mesh.material;
-				lastGeom = mesh.geom;
-				mesh.material->bindParams(instance.uniforms, bindingFlags);
-				instance.instanceCode = getMaterialCode(mesh.geom->vertexFormat(), *mesh.material);
-				instance.geometryIndex++;
-				geoms.push_back(mesh.geom);
+				lastMaterial = mesh->material;
+				lastGeom = mesh->geom;
+				mesh->material->bindParams(uniforms, bindingFlags);
+				instanceCode = findMaterialCode(mesh->geom->vertexFormat(), *mesh->material);
 			}
-			renderList.push_back(instance);
+
+			// Set up graphics pipeline
+			if (lastCode != instanceCode || lastMask != rasterMask)
+			{
+				auto pipeline = findPipeline(rasterMask, instanceCode);
+				if (pipeline.isValid())
+				{
+					lastCode = instanceCode;
+					lastMask = rasterMask;
+					out.setPipeline(pipeline);
+				}
+				else
+					continue;
+			}
+
+			// Set up geometry
+			auto geom = mesh->geom;
+			if (geom != lastBoundGeom)
+			{
+				lastBoundGeom = geom;
+				out.setVertexData(geom->getVao());
+			}
+
+			// Set up uniforms
+			out.setUniformData(uniforms);
+			// Draw
+			CommandBuffer::IndexType indexType = CommandBuffer::IndexType::U16;
+			if (geom->indices().componentType == GL_UNSIGNED_BYTE)
+				indexType = CommandBuffer::IndexType::U8;
+			if (geom->indices().componentType == GL_UNSIGNED_INT)
+				indexType = CommandBuffer::IndexType::U32;
+			out.drawTriangles(geom->indices().count, indexType, geom->indices().offset);
 		}
-		
-		render(geoms, renderList, out);
 	}
 
+	//----------------------------------------------------------------------------------------------
 	void GeometryPass::render(const std::vector<const RenderGeom*>& geometry,
 		const std::vector<Instance>& renderList,
 		CommandBuffer& out)
@@ -101,7 +267,7 @@ namespace rev::gfx {
 			// Set up graphics pipeline
 			if (lastCode != instance.instanceCode || lastMask != instance.raster)
 			{
-				auto pipeline = getPipeline(instance);
+				auto pipeline = getPipeline(instance.raster, instance.instanceCode);
 				if(pipeline.isValid())
 				{
 					lastCode = instance.instanceCode;
@@ -133,18 +299,107 @@ namespace rev::gfx {
 	}
 
 	//----------------------------------------------------------------------------------------------
-	Pipeline GeometryPass::getPipeline(const Instance& instance)
+	void GeometryPass::packIndirect(
+		const Mat44f& view,
+		const Mat44f& proj,
+		const std::vector<RenderItem>& geometry,
+		Pipeline::RasterOptions rasterOptions,
+		IndirectBatches& dst)
 	{
-		auto key = std::pair(instance.raster, instance.instanceCode);
+		dst.m_groups.clear();
+		dst.m_commands.clear();
+		dst.m_instances.clear();
+
+		// Pack instances and draw commands. Groups are runs of consecutive items, so the list keeps its order.
+		auto worldMatrix = Mat44f::identity();
+		const RenderGeom* lastGeom = nullptr;
+		const Material* lastMaterial = nullptr;
+		Pipeline pipeline;
+		for (auto& mesh : geometry)
+		{
+			if ((lastGeom != mesh.geom) || (lastMaterial != mesh.material))
+			{
+				lastGeom = mesh.geom;
+				lastMaterial = mesh.material;
+
+				bool mirroredGeometry = affineTransformDeterminant(worldMatrix) < 0.f;
+				rasterOptions.frontFace = mirroredGeometry ? Pipeline::Winding::CW : Pipeline::Winding::CCW;
+				auto instanceCode = getMaterialCode(mesh.geom->vertexFormat(), *mesh.material);
+				pipeline = getPipeline(rasterOptions.mask() | cIndirectPipeline, instanceCode);
+				if (pipeline.isValid())
+				{
+					auto instanceNdx = (uint32_t)dst.m_instances.size();
+					dst.m_groups.push_back({ pipeline, mesh.geom, mesh.material, instanceNdx });
+					auto& indices = mesh.geom->indices();
+					CommandBuffer::BatchCommand command;
+					command.count = indices.count;
+					command.firstIndex = uint32_t((size_t)indices.offset / indexSize(indexType(*mesh.geom)));
+					command.baseInstance = instanceNdx;
+					dst.m_commands.push_back(command);
+				}
+			}
+			if (!pipeline.isValid())
+				continue;
+			dst.m_commands.back().instanceCount++;
+
+			Mat44f wvp = proj * (view * mesh.world); // world/view multiplied first for improved precision
+			dst.m_instances.push_back({ gpuMatrix(wvp), gpuMatrix(mesh.world) });
+		}
+
+		dst.upload();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void GeometryPass::renderIndirect(const IndirectBatches& batches, Material::Flags bindingFlags, CommandBuffer& out) const
+	{
+		if (batches.m_groups.empty())
+			return;
+
+		CommandBuffer::UniformBucket uniforms;
+		uniforms.addParam(cInstanceBufferBinding, batches.m_gpuInstances);
+		out.setUniformData(uniforms);
+
+		// Render state caches
+		Pipeline::Id lastPipeline = Pipeline::InvalidId;
+		const RenderGeom* lastGeom = nullptr;
+
+		for (uint32_t i = 0; i < batches.m_groups.size(); ++i)
+		{
+			auto& group = batches.m_groups[i];
+			if (group.pipeline.id != lastPipeline)
+			{
+				lastPipeline = group.pipeline.id;
+				out.setPipeline(group.pipeline);
+			}
+			if (group.geom != lastGeom)
+			{
+				lastGeom = group.geom;
+				out.setVertexData(group.geom->getVao());
+			}
+
+			// Shaders find their instances through the draw's baseInstance
+			uniforms.clear();
+			group.material->bindParams(uniforms, bindingFlags);
+			out.setUniformData(uniforms);
+			out.drawTrianglesBatch(1, indexType(*group.geom), batches.m_gpuCommands, i);
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Pipeline GeometryPass::getPipeline(Pipeline::RasterOptions::Mask raster, ShaderCodeFragment* instanceCode)
+	{
+		auto key = std::pair(raster, instanceCode);
 		auto iter = m_pipelines.find(key);
 		if(iter == m_pipelines.end())
 		{
 			// Extract code
 			Pipeline::ShaderModule::Descriptor stageDesc;
-			if (Pipeline::RasterOptions::fromMask(instance.raster).alphaMask)
+			if (Pipeline::RasterOptions::fromMask(raster).alphaMask)
 				stageDesc.code.push_back("#define ALPHA_MASK\n");
-			if(instance.instanceCode)
-				instance.instanceCode->collapse(stageDesc.code);
+			if (raster & cIndirectPipeline)
+				stageDesc.code.push_back("#extension GL_ARB_shader_draw_parameters : require\n#define INDIRECT_INSTANCES\n");
+			if(instanceCode)
+				instanceCode->collapse(stageDesc.code);
 			mPassCommonCode->collapse(stageDesc.code);
 
 			// Build pipeline stages
@@ -158,7 +413,7 @@ namespace rev::gfx {
 			if(m_commonPipelineDesc.vtxShader.valid()
 				&& m_commonPipelineDesc.pxlShader.valid())
 			{
-				m_commonPipelineDesc.raster = Pipeline::RasterOptions::fromMask(instance.raster);
+				m_commonPipelineDesc.raster = Pipeline::RasterOptions::fromMask(raster);
 				pipeline = mDevice.createPipeline(m_commonPipelineDesc);
 			}
 
@@ -181,4 +436,25 @@ namespace rev::gfx {
 		return iter->second;
 	}
 
+	//----------------------------------------------------------------------------------------------
+	Pipeline GeometryPass::findPipeline(Pipeline::RasterOptions::Mask raster, ShaderCodeFragment* instanceCode) const
+	{
+		auto iter = m_pipelines.find(std::pair(raster, instanceCode));
+		assert(iter != m_pipelines.end() && "Pipelines must be created with preparePipelines before recording");
+		if (iter == m_pipelines.end())
+			return Pipeline();
+		return iter->second;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	ShaderCodeFragment* GeometryPass::findMaterialCode(VtxFormat vtxFormat, const Material& material) const
+	{
+		auto completeCode = vtxFormat.shaderDefines() + material.bakedOptions() + material.effect().code();
+		auto iter = m_materialCode.find(completeCode);
+		assert(iter != m_materialCode.end() && "Material code must be created with preparePipelines before recording");
+		if (iter == m_materialCode.end())
+			return nullptr;
+		return iter->second;
+	}
+
 }	// namespace rev::gfx
\ No newline at end of file
@@ -30,6 +30,10 @@
 #include <utility>
 #include <vector>
 
+namespace rev::core {
+	class JobSystem;
+}
+
 namespace rev::gfx {
 
 	class Device;
@@ -49,13 +53,19 @@ namespace rev::gfx {
 		};
 
 		// Processes the suplied geometry and uniforms, and stores the generated commands into out.
+		// When a job system is provided, large lists of geometry are recorded in chunks on worker threads.
+		// Recording only looks up pipelines, so preparePipelines must be called first on the render thread.
 		void render(
 			const math::Mat44f& view,
 			const math::Mat44f& proj,
 			const std::vector<RenderItem>& geometry,
 			Pipeline::RasterOptions rasterOptions,
 			Material::Flags bindingFlags,
-			CommandBuffer& out);
+			CommandBuffer& out,
+			core::JobSystem* jobs = nullptr);
+
+		// Create the pipelines needed to render the geometry, which may need to access the device.
+		void preparePipelines(const std::vector<RenderItem>& geometry, Pipeline::RasterOptions rasterOptions);
 
 		// Processes the suplied geometry and uniforms, and stores the generated commands into out.
 		void render(
@@ -63,12 +73,95 @@ namespace rev::gfx {
 			const std::vector<Instance>& instances,
 			CommandBuffer& out);
 
+		// Instances of a list of render items, packed for indirect drawing.
+		// Owns the gpu buffers the instances are packed into, which are reused across frames.
+		class IndirectBatches
+		{
+		public:
+			IndirectBatches(Device&);
+			~IndirectBatches();
+
+			IndirectBatches(const IndirectBatches&) = delete;
+			IndirectBatches& operator=(const IndirectBatches&) = delete;
+
+			// Consecutive items sharing pipeline, geometry and material. Each group is drawn with a single indirect draw.
+			// Materials still bind their textures as regular uniforms, so they can't be merged across groups.
+			struct Group
+			{
+				Pipeline pipeline;
+				const RenderGeom* geom;
+				const Material* material;
+				uint32_t firstInstance;
+			};
+
+			// Layout of each instance in the storage buffer, as read by the shaders
+			struct InstanceData
+			{
+				math::Mat44f worldViewProj;
+				math::Mat44f world;
+			};
+
+			const std::vector<Group>& groups() const { return m_groups; }
+			const std::vector<CommandBuffer::BatchCommand>& commands() const { return m_commands; } // One per group
+			size_t numInstances() const { return m_instances.size(); }
+			const std::vector<InstanceData>& instances() const { return m_instances; } // Host copy of the instance buffer
+
+		private:
+			friend class GeometryPass;
+
+			void upload();
+
+			Device& m_device;
+			std::vector<Group> m_groups;
+			std::vector<CommandBuffer::BatchCommand> m_commands;
+			std::vector<InstanceData> m_instances;
+
+			Buffer m_gpuInstances;
+			size_t m_gpuInstanceCapacity = 0;
+			Buffer m_gpuCommands;
+			size_t m_gpuCommandCapacity = 0;
+		};
+
+		// Groups runs of geometry that share pipeline, geometry and material, and packs per instance transforms
+		// and draw commands into gpu buffers. The order of the list is kept, so sort it by state first to get
+		// fewer, larger groups. Touches the device, so it must be called on the render thread.
+		void packIndirect(
+			const math::Mat44f& view,
+			const math::Mat44f& proj,
+			const std::vector<RenderItem>& geometry,
+			Pipeline::RasterOptions rasterOptions,
+			IndirectBatches& dst);
+
+		// Records one indirect draw per group of packed instances. Shaders are compiled with INDIRECT_INSTANCES
+		// defined, and read their transforms from the instance buffer at gl_BaseInstanceARB + gl_InstanceID.
+		// Can be called from worker threads.
+		void renderIndirect(const IndirectBatches&, Material::Flags bindingFlags, CommandBuffer& out) const;
+
 	private:
+		// Shader interface of indirect draws
+		static constexpr int cInstanceBufferBinding = 0;
+		static constexpr Pipeline::RasterOptions::Mask cIndirectPipeline = 1u << 31; // Marks indirect variants of pipelines
+
+		static constexpr size_t cItemsPerChunk = 1024; // Granularity of parallel recording
+
+		void recordChunk(
+			const math::Mat44f& view,
+			const math::Mat44f& proj,
+			const RenderItem* begin,
+			const RenderItem* end,
+			Pipeline::RasterOptions rasterOptions,
+			Material::Flags bindingFlags,
+			CommandBuffer& out) const;
 
 		ShaderCodeFragment* getMaterialCode(VtxFormat, const Material& material);
 
 		Device& mDevice;
-		Pipeline getPipeline(const Instance&);
+		Pipeline getPipeline(Pipeline::RasterOptions::Mask, ShaderCodeFragment* instanceCode);
+
+		// Read only versions of the above, safe to use from worker threads.
+		// Everything they look up must have been created by preparePipelines.
+		ShaderCodeFragment* findMaterialCode(VtxFormat, const Material& material) const;
+		Pipeline findPipeline(Pipeline::RasterOptions::Mask, ShaderCodeFragment* instanceCode) const;
 
 		ShaderCodeFragment* mPassCommonCode; // Effect containing the pass' common code
 		Pipeline::Descriptor m_commonPipelineDesc; // Config common to all shadow pipelines
@@ -78,6 +171,8 @@ namespace rev::gfx {
 		std::map<std::string, ShaderCodeFragment*> m_materialCode;
 		std::map<PipelineSrc, Pipeline> m_pipelines;
 		std::vector<std::shared_ptr<ShaderCodeFragment::ReloadListener>> m_shaderListeners;
+
+		std::vector<CommandBuffer> m_chunkCommands; // Parallel recording scratch, reused across frames
 	};
 
 }	// namespace rev::gfx
\ No newline at end of file
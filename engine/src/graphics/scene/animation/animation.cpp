@@ -0,0 +1,168 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "animation.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace rev::math;
+
+namespace rev::gfx {
+
+	namespace {
+		// Keys skipped one by one before falling back to a binary search
+		constexpr uint32_t cMaxLinearSteps = 4;
+
+		Vec3f interpolate(const Vec3f& a, const Vec3f& b, float f) { return a * (1 - f) + b * f; }
+		Quatf interpolate(const Quatf& a, const Quatf& b, float f) { return Quatf::lerp(a, b, f); }
+	}
+
+	//----------------------------------------------------------------------------------------------
+	template<class T>
+	void Animation::Track<T>::pack(const std::vector<Channel<T>>& channels, size_t numJoints)
+	{
+		offsets.resize(numJoints + 1);
+		offsets[0] = 0;
+		for(size_t i = 0; i < numJoints; ++i)
+		{
+			auto numKeys = i < channels.size() ? channels[i].t.size() : 0;
+			offsets[i + 1] = offsets[i] + uint32_t(numKeys);
+		}
+		times.reserve(offsets.back());
+		values.reserve(offsets.back());
+		for(size_t i = 0; i < channels.size(); ++i)
+		{
+			assert(channels[i].t.size() == channels[i].values.size());
+			assert(std::is_sorted(channels[i].t.begin(), channels[i].t.end()));
+			times.insert(times.end(), channels[i].t.begin(), channels[i].t.end());
+			values.insert(values.end(), channels[i].values.begin(), channels[i].values.end());
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	template<class T>
+	bool Animation::Track<T>::sample(size_t joint, float t, uint32_t& key, T& dst) const
+	{
+		auto begin = offsets[joint];
+		auto numKeys = offsets[joint + 1] - begin;
+		if(!numKeys)
+			return false;
+
+		// Clamp outside of the keyed range
+		const float* keyTimes = &times[begin];
+		if(t <= keyTimes[0])
+		{
+			key = 0;
+			dst = values[begin];
+			return true;
+		}
+		if(t >= keyTimes[numKeys - 1])
+		{
+			key = numKeys - 1;
+			dst = values[begin + numKeys - 1];
+			return true;
+		}
+
+		// Find k, so that keyTimes[k] <= t < keyTimes[k+1].
+		// Such a pair exists, because t is strictly inside the keyed range.
+		auto k = key;
+		if(k >= numKeys - 1 || keyTimes[k] > t) // No hint, or going backwards
+		{
+			k = uint32_t(std::upper_bound(keyTimes, keyTimes + numKeys, t) - keyTimes) - 1;
+		}
+		else
+		{
+			for(uint32_t step = 0; keyTimes[k + 1] <= t; ++step)
+			{
+				if(step == cMaxLinearSteps)
+				{
+					k = uint32_t(std::upper_bound(keyTimes + k + 1, keyTimes + numKeys, t) - keyTimes) - 1;
+					break;
+				}
+				++k;
+			}
+		}
+		key = k;
+
+		auto f = (t - keyTimes[k]) / (keyTimes[k + 1] - keyTimes[k]);
+		dst = interpolate(values[begin + k], values[begin + k + 1], f);
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Animation::Animation(
+		const std::vector<Channel<Vec3f>>& translations,
+		const std::vector<Channel<Quatf>>& rotations,
+		const std::vector<Channel<Vec3f>>& scales)
+	{
+		m_numJoints = std::max(translations.size(), std::max(rotations.size(), scales.size()));
+		m_translations.pack(translations, m_numJoints);
+		m_rotations.pack(rotations, m_numJoints);
+		m_scales.pack(scales, m_numJoints);
+
+		for(auto times : { &m_translations.times, &m_rotations.times, &m_scales.times })
+			for(auto t : *times)
+				m_duration = std::max(m_duration, t);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void Animation::getPose(float t, Pose& dst) const
+	{
+		dst.joints.resize(m_numJoints);
+		for(size_t i = 0; i < m_numJoints; ++i)
+		{
+			uint32_t keys[3] = { cNoKey, cNoKey, cNoKey };
+			sampleJoint(i, t, keys, dst.joints[i]);
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void Animation::getPose(float t, Cursor& cursor, Pose& dst) const
+	{
+		dst.joints.resize(m_numJoints);
+		auto keys = cursorKeys(cursor);
+		for(size_t i = 0; i < m_numJoints; ++i)
+			sampleJoint(i, t, &keys[3 * i], dst.joints[i]);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void Animation::getJointPose(size_t joint, float t, Cursor& cursor, Pose::JointPose& dst) const
+	{
+		assert(joint < m_numJoints);
+		sampleJoint(joint, t, &cursorKeys(cursor)[3 * joint], dst);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void Animation::sampleJoint(size_t joint, float t, uint32_t* keys, Pose::JointPose& dst) const
+	{
+		m_translations.sample(joint, t, keys[0], dst.translation);
+		m_rotations.sample(joint, t, keys[1], dst.rotation);
+		m_scales.sample(joint, t, keys[2], dst.scale);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint32_t* Animation::cursorKeys(Cursor& cursor) const
+	{
+		if(cursor.m_keys.size() != 3 * m_numJoints)
+			cursor.m_keys.assign(3 * m_numJoints, cNoKey);
+		return cursor.m_keys.data();
+	}
+
+}
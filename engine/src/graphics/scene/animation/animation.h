@@ -21,6 +21,7 @@
 
 #include <math/algebra/vector.h>
 #include <math/algebra/quaternion.h>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -39,9 +40,12 @@ namespace rev::gfx {
 		std::vector<JointPose> joints;
 	};
 
+	/// Keyframed translation, rotation and scale for every joint in a clip.
+	/// Keys are linearly interpolated, and clamped outside of their time range.
 	class Animation
 	{
 	public:
+		/// Keys of a single property of one joint, as provided by loaders
 		template<class T>
 		struct Channel
 		{
@@ -49,46 +53,58 @@ namespace rev::gfx {
 			std::vector<T> values;
 		};
 
-		void getPose(float t, Pose& dst) const;
-		float duration() const
+		/// Playback state of one instance of a clip.
+		/// Remembers the last key sampled for every channel, so the next key is found in constant
+		/// time while playback moves forward. Jumps and loops fall back to a binary search.
+		class Cursor
 		{
-			return m_rotationChannels[0].t.back();
-		}
-		
-		void getChannelPose(size_t channelNdx, float t, Pose::JointPose& dst)
+		public:
+			void reset() { m_keys.clear(); }
+
+		private:
+			friend class Animation;
+			std::vector<uint32_t> m_keys; // Per joint: translation, rotation, scale
+		};
+
+		Animation() = default;
+		/// One channel of each kind per joint. Channels can be empty.
+		Animation(
+			const std::vector<Channel<math::Vec3f>>& translations,
+			const std::vector<Channel<math::Quatf>>& rotations,
+			const std::vector<Channel<math::Vec3f>>& scales);
+
+		size_t numJoints() const { return m_numJoints; }
+		float duration() const { return m_duration; }
+
+		/// Sample every joint at time t.
+		/// Properties without keys are left untouched, so dst can start from a reference pose.
+		void getPose(float t, Pose& dst) const;
+		void getPose(float t, Cursor& cursor, Pose& dst) const;
+		void getJointPose(size_t joint, float t, Cursor& cursor, Pose::JointPose& dst) const;
+
+	private:
+		/// Keys of one property for every joint, in structure of arrays layout.
+		/// Joint j owns keys [offsets[j], offsets[j+1]) of both times and values.
+		template<class T>
+		struct Track
 		{
-			auto& channel = m_rotationChannels[channelNdx];
-			if(channel.t.empty())
-				return;
-			if(t <= channel.t[0])
-			{
-				dst.rotation = channel.values[0];
-				return;
-			}
-			if(t >= channel.t.back())
-			{
-				dst.rotation = channel.values.back();
-				return;
-			}
-			// Value is within two others
-			for(size_t i = 0; i < channel.t.size(); ++i)
-			{
-				if(channel.t[i+1] > t)
-				{
-					auto& v0 = channel.values[i];
-					auto& v1 = channel.values[i+1];
-					auto t0 = channel.t[i];
-					auto t1 = channel.t[i+1];
-					auto f = (t-t0)/(t1-t0);
-					auto v = math::Quatf::lerp(v0, v1, f);
-					dst.rotation = v;
-					break;
-				}
-			}
-		}
+			std::vector<uint32_t> offsets;
+			std::vector<float> times;
+			std::vector<T> values;
+
+			void pack(const std::vector<Channel<T>>& channels, size_t numJoints);
+			bool sample(size_t joint, float t, uint32_t& key, T& dst) const;
+		};
+
+		static constexpr uint32_t cNoKey = uint32_t(-1);
+		void sampleJoint(size_t joint, float t, uint32_t* keys, Pose::JointPose& dst) const;
+		uint32_t* cursorKeys(Cursor&) const;
 
-		std::vector<Channel<math::Vec3f>> m_translationChannels;
-		std::vector<Channel<math::Quatf>> m_rotationChannels;
+		size_t m_numJoints = 0;
+		float m_duration = 0.f;
+		Track<math::Vec3f> m_translations;
+		Track<math::Quatf> m_rotations;
+		Track<math::Vec3f> m_scales;
 	};
 
 }
@@ -18,10 +18,28 @@ namespace rev { namespace math {
 
 		static AffineTransform identity() { AffineTransform t; t.mMatrix.setIdentity(); return t; }
 
+		/// The last row of both transforms is (0,0,0,1), so only the first three rows need computing.
+		/// Same operations in the same order as the Mat44f product, so results are bitwise identical.
 		AffineTransform operator*(const AffineTransform& b) const
 		{
+			using namespace simd;
+			const float* pa = mMatrix.data();
+			const float* pb = b.mMatrix.data();
+			float4 b0 = load(pb), b1 = load(pb+4), b2 = load(pb+8), b3 = load(pb+12);
+
 			AffineTransform axb;
-			axb.mMatrix = mMatrix*b.mMatrix;
+			float* dst = axb.mMatrix.data();
+			for (int i = 0; i < 3; ++i)
+			{
+				// Splatting straight from memory lets AVX builds use broadcast loads instead of shuffles
+				const float* row = pa + 4*i;
+				float4 result = mul(splat(row[0]), b0);
+				result = add(result, mul(splat(row[1]), b1));
+				result = add(result, mul(splat(row[2]), b2));
+				result = add(result, mul(splat(row[3]), b3));
+				store(dst + 4*i, result);
+			}
+			store(dst + 12, b3);
 			return axb;
 		}
 
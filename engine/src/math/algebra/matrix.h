@@ -19,7 +19,10 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 // Generic matrix
 #pragma once
+#include <cmath>
 #include "matrixView.h"
+#include "simd.h"
+#include "vector.h"
 
 namespace rev {
 	namespace math {
@@ -108,6 +111,167 @@ namespace rev {
 			return result;
 		}
 
+		//------------------------------------------------------------------------------------------------------------------
+		// Generic inverse through cofactors. Returns a matrix full of infinities and NaNs if x is singular.
+		template<class T>
+		Matrix44<T> inverse(const Matrix44<T>& x)
+		{
+			const T* m = x.data();
+			Matrix44<T> result;
+			T* inv = result.data();
+
+			inv[0] = m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+			inv[4] = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+			inv[8] = m[4]*m[9]*m[15] - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+			inv[12] = -m[4]*m[9]*m[14] + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+			inv[1] = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+			inv[5] = m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+			inv[9] = -m[0]*m[9]*m[15] + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+			inv[13] = m[0]*m[9]*m[14] - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+			inv[2] = m[1]*m[6]*m[15] - m[1]*m[7]*m[14] - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7] - m[13]*m[3]*m[6];
+			inv[6] = -m[0]*m[6]*m[15] + m[0]*m[7]*m[14] + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7] + m[12]*m[3]*m[6];
+			inv[10] = m[0]*m[5]*m[15] - m[0]*m[7]*m[13] - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7] - m[12]*m[3]*m[5];
+			inv[14] = -m[0]*m[5]*m[14] + m[0]*m[6]*m[13] + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6] + m[12]*m[2]*m[5];
+			inv[3] = -m[1]*m[6]*m[11] + m[1]*m[7]*m[10] + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7] + m[9]*m[3]*m[6];
+			inv[7] = m[0]*m[6]*m[11] - m[0]*m[7]*m[10] - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7] - m[8]*m[3]*m[6];
+			inv[11] = -m[0]*m[5]*m[11] + m[0]*m[7]*m[9] + m[4]*m[1]*m[11] - m[4]*m[3]*m[9] - m[8]*m[1]*m[7] + m[8]*m[3]*m[5];
+			inv[15] = m[0]*m[5]*m[10] - m[0]*m[6]*m[9] - m[4]*m[1]*m[10] + m[4]*m[2]*m[9] + m[8]*m[1]*m[6] - m[8]*m[2]*m[5];
+
+			T invDet = 1 / (m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12]);
+			for (int i = 0; i < 16; ++i)
+				inv[i] *= invDet;
+			return result;
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		// Simd specializations for Mat44f.
+		// Non template overloads take precedence over the generic templates above.
+		//------------------------------------------------------------------------------------------------------------------
+		inline Mat44f operator*(const Mat44f& a, const Mat44f& b)
+		{
+			using namespace simd;
+			const float* pb = b.data();
+			float4 b0 = load(pb), b1 = load(pb+4), b2 = load(pb+8), b3 = load(pb+12);
+
+			Mat44f result;
+#if defined(REV_SIMD_AVX)
+			// Two rows of the result per iteration
+			float4x2 bb0 = dup(b0), bb1 = dup(b1), bb2 = dup(b2), bb3 = dup(b3);
+			for (int i = 0; i < 4; i += 2)
+				store2(result.data() + 4*i, combine2(load2(a.data() + 4*i), bb0, bb1, bb2, bb3));
+#else
+			for (int i = 0; i < 4; ++i)
+				store(result.data() + 4*i, combine(load(a.data() + 4*i), b0, b1, b2, b3));
+#endif
+			return result;
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		inline Vec4f operator*(const Mat44f& a, const Vec4f& v)
+		{
+			using namespace simd;
+			const float* pa = a.data();
+			float4 c0 = load(pa), c1 = load(pa+4), c2 = load(pa+8), c3 = load(pa+12);
+			transpose(c0, c1, c2, c3);
+
+			Vec4f result;
+			store(result.data(), combine(load(v.data()), c0, c1, c2, c3));
+			return result;
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		inline Mat44f transpose(const Mat44f& x)
+		{
+			using namespace simd;
+			const float* px = x.data();
+			float4 r0 = load(px), r1 = load(px+4), r2 = load(px+8), r3 = load(px+12);
+			transpose(r0, r1, r2, r3);
+
+			Mat44f result;
+			store(result.data(), r0);
+			store(result.data()+4, r1);
+			store(result.data()+8, r2);
+			store(result.data()+12, r3);
+			return result;
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		namespace detail {
+			// 2x2 matrices packed in a register as (m00, m01, m10, m11)
+			inline simd::float4 mat2Mul(simd::float4 a, simd::float4 b) // a*b
+			{
+				using namespace simd;
+				return add(mul(a, swizzle<0,3,0,3>(b)), mul(swizzle<1,0,3,2>(a), swizzle<2,1,2,1>(b)));
+			}
+
+			inline simd::float4 mat2AdjMul(simd::float4 a, simd::float4 b) // adjugate(a)*b
+			{
+				using namespace simd;
+				return sub(mul(swizzle<3,3,0,0>(a), b), mul(swizzle<1,1,2,2>(a), swizzle<2,3,0,1>(b)));
+			}
+
+			inline simd::float4 mat2MulAdj(simd::float4 a, simd::float4 b) // a*adjugate(b)
+			{
+				using namespace simd;
+				return sub(mul(a, swizzle<3,0,3,0>(b)), mul(swizzle<1,0,3,2>(a), swizzle<2,1,2,1>(b)));
+			}
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		// Blockwise inversion over 2x2 sub-matrices.
+		// Rounding differs from the generic version, so results only match it within tolerance.
+		inline Mat44f inverse(const Mat44f& x)
+		{
+			using namespace simd;
+			using namespace detail;
+			const float* px = x.data();
+			float4 r0 = load(px), r1 = load(px+4), r2 = load(px+8), r3 = load(px+12);
+
+			// x = | A B |
+			//     | C D |
+			float4 A = shuffle<0,1,0,1>(r0, r1);
+			float4 B = shuffle<2,3,2,3>(r0, r1);
+			float4 C = shuffle<0,1,0,1>(r2, r3);
+			float4 D = shuffle<2,3,2,3>(r2, r3);
+
+			// (|A|, |B|, |C|, |D|)
+			float4 detSub = sub(
+				mul(shuffle<0,2,0,2>(r0, r2), shuffle<1,3,1,3>(r1, r3)),
+				mul(shuffle<1,3,1,3>(r0, r2), shuffle<0,2,0,2>(r1, r3)));
+			float4 detA = broadcast<0>(detSub);
+			float4 detB = broadcast<1>(detSub);
+			float4 detC = broadcast<2>(detSub);
+			float4 detD = broadcast<3>(detSub);
+
+			float4 D_C = mat2AdjMul(D, C);
+			float4 A_B = mat2AdjMul(A, B);
+			// Adjugates of the blocks of the inverse
+			float4 X_ = sub(mul(detD, A), mat2Mul(B, D_C));
+			float4 W_ = sub(mul(detA, D), mat2Mul(C, A_B));
+			float4 Y_ = sub(mul(detB, C), mat2MulAdj(D, A_B));
+			float4 Z_ = sub(mul(detC, B), mat2MulAdj(A, D_C));
+
+			// |x| = |A|*|D| + |B|*|C| - tr((A#B)(D#C))
+			float4 tr = mul(A_B, swizzle<0,2,1,3>(D_C));
+			tr = add(tr, swizzle<2,3,0,1>(tr));
+			tr = add(tr, swizzle<1,0,3,2>(tr));
+			float4 detM = sub(add(mul(detA, detD), mul(detB, detC)), tr);
+
+			float4 rDetM = div(set(1.f, -1.f, -1.f, 1.f), detM);
+			X_ = mul(X_, rDetM);
+			Y_ = mul(Y_, rDetM);
+			Z_ = mul(Z_, rDetM);
+			W_ = mul(W_, rDetM);
+
+			// Undo the adjugates while storing
+			Mat44f result;
+			store(result.data(), shuffle<3,1,3,1>(X_, Y_));
+			store(result.data()+4, shuffle<2,0,2,0>(X_, Y_));
+			store(result.data()+8, shuffle<3,1,3,1>(Z_, W_));
+			store(result.data()+12, shuffle<2,0,2,0>(Z_, W_));
+			return result;
+		}
+
 		//------------------------------------------------------------------------------------------------------------------
 		template<typename Number_>
 		inline Matrix44<Number_> frustumMatrix(
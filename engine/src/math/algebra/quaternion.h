@@ -41,10 +41,10 @@ namespace rev { namespace math {
 		/// \param axis is assumed to be normalized
 		UnitQuaternion(const Vector3<T>& axis, T _radians)
 		{
-			auto half_sin = sin(_radians/2); // Using sine(theta/2) instead of cosine preserves the sign.
+			auto half_sin = std::sin(_radians/2); // Using sine(theta/2) instead of cosine preserves the sign.
 			UnitQuaternion q;
-			m.block<3,1,0,0>() = axis*half_sin;
-			w() = std::sqrt(1-half_sin*half_sin);
+			m.template block<3,1,0,0>() = axis*half_sin;
+			m[3] = std::sqrt(1-half_sin*half_sin);
 		}
 
 		static UnitQuaternion fromUnitVectors(const Vector3<T>& u, const Vector3<T>& v)
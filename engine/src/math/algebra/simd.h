@@ -0,0 +1,256 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+//----------------------------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+// Thin abstraction over 4-wide float registers.
+// The instruction set is selected at compile time. Define REV_NO_SIMD to force the scalar fallback.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "../linear.h"
+
+#if !defined(REV_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define REV_SIMD_SSE 1
+#include <xmmintrin.h>
+#if defined(__AVX__)
+#define REV_SIMD_AVX 1
+#include <immintrin.h>
+#endif
+#elif !defined(REV_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define REV_SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define REV_SIMD_SCALAR 1
+#endif
+
+namespace rev::math::simd {
+
+#if defined(REV_SIMD_SSE)
+	//------------------------------------------------------------------------------------------------------------------
+	using float4 = __m128;
+
+	inline float4 load(const float* x) { return _mm_loadu_ps(x); }
+	inline void store(float* dst, float4 x) { _mm_storeu_ps(dst, x); }
+	inline float4 splat(float x) { return _mm_set1_ps(x); }
+	inline float4 set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+
+	inline float4 add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+	inline float4 sub(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+	inline float4 mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+	inline float4 div(float4 a, float4 b) { return _mm_div_ps(a, b); }
+	inline float4 min(float4 a, float4 b) { return _mm_min_ps(a, b); }
+	inline float4 max(float4 a, float4 b) { return _mm_max_ps(a, b); }
+
+	/// (a[x], a[y], b[z], b[w])
+	template<int x, int y, int z, int w>
+	inline float4 shuffle(float4 a, float4 b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x)); }
+
+	inline float first(float4 x) { return _mm_cvtss_f32(x); }
+
+	// Comparisons set every bit of the lanes where they hold
+	inline float4 less(float4 a, float4 b) { return _mm_cmplt_ps(a, b); }
+	inline float4 greater(float4 a, float4 b) { return _mm_cmpgt_ps(a, b); }
+	inline float4 bitOr(float4 a, float4 b) { return _mm_or_ps(a, b); }
+	/// Bit i is set if the sign bit of lane i is
+	inline int signMask(float4 x) { return _mm_movemask_ps(x); }
+
+	inline void transpose(float4& r0, float4& r1, float4& r2, float4& r3) { _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+
+#elif defined(REV_SIMD_NEON)
+	//------------------------------------------------------------------------------------------------------------------
+	using float4 = float32x4_t;
+
+	inline float4 load(const float* x) { return vld1q_f32(x); }
+	inline void store(float* dst, float4 x) { vst1q_f32(dst, x); }
+	inline float4 splat(float x) { return vdupq_n_f32(x); }
+	inline float4 set(float x, float y, float z, float w) { float v[4] = { x, y, z, w }; return vld1q_f32(v); }
+
+	inline float4 add(float4 a, float4 b) { return vaddq_f32(a, b); }
+	inline float4 sub(float4 a, float4 b) { return vsubq_f32(a, b); }
+	inline float4 mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+	inline float4 div(float4 a, float4 b)
+	{
+		float va[4], vb[4];
+		vst1q_f32(va, a);
+		vst1q_f32(vb, b);
+		return set(va[0]/vb[0], va[1]/vb[1], va[2]/vb[2], va[3]/vb[3]); // Exact division, unlike vrecpeq
+	}
+	// vminq/vmaxq propagate NaNs differently from the scalar path, so use explicit selects
+	inline float4 min(float4 a, float4 b) { return vbslq_f32(vcltq_f32(a, b), a, b); }
+	inline float4 max(float4 a, float4 b) { return vbslq_f32(vcgtq_f32(a, b), a, b); }
+
+	template<int x, int y, int z, int w>
+	inline float4 shuffle(float4 a, float4 b)
+	{
+		float4 r = vdupq_n_f32(vgetq_lane_f32(a, x));
+		r = vsetq_lane_f32(vgetq_lane_f32(a, y), r, 1);
+		r = vsetq_lane_f32(vgetq_lane_f32(b, z), r, 2);
+		return vsetq_lane_f32(vgetq_lane_f32(b, w), r, 3);
+	}
+
+	inline float first(float4 x) { return vgetq_lane_f32(x, 0); }
+
+	inline float4 less(float4 a, float4 b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+	inline float4 greater(float4 a, float4 b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+	inline float4 bitOr(float4 a, float4 b)
+	{
+		return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+	}
+	inline int signMask(float4 x)
+	{
+		uint32x4_t signs = vshrq_n_u32(vreinterpretq_u32_f32(x), 31);
+		return int(vgetq_lane_u32(signs, 0) | (vgetq_lane_u32(signs, 1) << 1) | (vgetq_lane_u32(signs, 2) << 2) | (vgetq_lane_u32(signs, 3) << 3));
+	}
+
+	inline void transpose(float4& r0, float4& r1, float4& r2, float4& r3)
+	{
+		float32x4x2_t t01 = vtrnq_f32(r0, r1);
+		float32x4x2_t t23 = vtrnq_f32(r2, r3);
+		r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+		r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+		r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+		r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+	}
+
+#else
+	//------------------------------------------------------------------------------------------------------------------
+	struct float4 { float v[4]; };
+
+	inline float4 load(const float* x) { return { x[0], x[1], x[2], x[3] }; }
+	inline void store(float* dst, float4 x) { for(int i = 0; i < 4; ++i) dst[i] = x.v[i]; }
+	inline float4 splat(float x) { return { x, x, x, x }; }
+	inline float4 set(float x, float y, float z, float w) { return { x, y, z, w }; }
+
+	inline float4 add(float4 a, float4 b) { return { a.v[0]+b.v[0], a.v[1]+b.v[1], a.v[2]+b.v[2], a.v[3]+b.v[3] }; }
+	inline float4 sub(float4 a, float4 b) { return { a.v[0]-b.v[0], a.v[1]-b.v[1], a.v[2]-b.v[2], a.v[3]-b.v[3] }; }
+	inline float4 mul(float4 a, float4 b) { return { a.v[0]*b.v[0], a.v[1]*b.v[1], a.v[2]*b.v[2], a.v[3]*b.v[3] }; }
+	inline float4 div(float4 a, float4 b) { return { a.v[0]/b.v[0], a.v[1]/b.v[1], a.v[2]/b.v[2], a.v[3]/b.v[3] }; }
+	inline float4 min(float4 a, float4 b)
+	{
+		return { math::min(a.v[0],b.v[0]), math::min(a.v[1],b.v[1]), math::min(a.v[2],b.v[2]), math::min(a.v[3],b.v[3]) };
+	}
+	inline float4 max(float4 a, float4 b)
+	{
+		return { math::max(a.v[0],b.v[0]), math::max(a.v[1],b.v[1]), math::max(a.v[2],b.v[2]), math::max(a.v[3],b.v[3]) };
+	}
+
+	template<int x, int y, int z, int w>
+	inline float4 shuffle(float4 a, float4 b) { return { a.v[x], a.v[y], b.v[z], b.v[w] }; }
+
+	inline float first(float4 x) { return x.v[0]; }
+
+	inline float laneMask(bool x)
+	{
+		uint32_t bits = x ? ~0u : 0u;
+		float result;
+		std::memcpy(&result, &bits, sizeof(float));
+		return result;
+	}
+
+	inline uint32_t laneBits(float x)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &x, sizeof(float));
+		return bits;
+	}
+
+	inline float4 less(float4 a, float4 b)
+	{
+		return { laneMask(a.v[0]<b.v[0]), laneMask(a.v[1]<b.v[1]), laneMask(a.v[2]<b.v[2]), laneMask(a.v[3]<b.v[3]) };
+	}
+	inline float4 greater(float4 a, float4 b) { return less(b, a); }
+	inline float4 bitOr(float4 a, float4 b)
+	{
+		float4 result;
+		for(int i = 0; i < 4; ++i)
+		{
+			uint32_t bits = laneBits(a.v[i]) | laneBits(b.v[i]);
+			std::memcpy(&result.v[i], &bits, sizeof(float));
+		}
+		return result;
+	}
+	inline int signMask(float4 x)
+	{
+		int mask = 0;
+		for(int i = 0; i < 4; ++i)
+			mask |= int(laneBits(x.v[i]) >> 31) << i;
+		return mask;
+	}
+
+	inline void transpose(float4& r0, float4& r1, float4& r2, float4& r3)
+	{
+		float4 c0 = { r0.v[0], r1.v[0], r2.v[0], r3.v[0] };
+		float4 c1 = { r0.v[1], r1.v[1], r2.v[1], r3.v[1] };
+		float4 c2 = { r0.v[2], r1.v[2], r2.v[2], r3.v[2] };
+		float4 c3 = { r0.v[3], r1.v[3], r2.v[3], r3.v[3] };
+		r0 = c0; r1 = c1; r2 = c2; r3 = c3;
+	}
+#endif
+
+	//------------------------------------------------------------------------------------------------------------------
+	// Instruction set independent helpers
+	template<int x, int y, int z, int w>
+	inline float4 swizzle(float4 a) { return shuffle<x,y,z,w>(a, a); }
+
+	template<int i>
+	inline float4 broadcast(float4 a) { return shuffle<i,i,i,i>(a, a); }
+
+	/// Pairwise horizontal sum. It doesn't follow the order of the scalar loop, so the last bits may differ.
+	inline float dot(float4 a, float4 b)
+	{
+		float4 p = mul(a, b);
+		p = add(p, swizzle<2,3,0,1>(p));
+		p = add(p, swizzle<1,0,3,2>(p));
+		return first(p);
+	}
+
+	/// Linear combination of the rows r0..r3 weighted by the components of w.
+	/// Accumulates in the same order as the scalar matrix product, so results are bitwise identical
+	/// (as long as the compiler doesn't contract the scalar version into fused multiply-adds).
+	inline float4 combine(float4 w, float4 r0, float4 r1, float4 r2, float4 r3)
+	{
+		float4 result = mul(broadcast<0>(w), r0);
+		result = add(result, mul(broadcast<1>(w), r1));
+		result = add(result, mul(broadcast<2>(w), r2));
+		result = add(result, mul(broadcast<3>(w), r3));
+		return result;
+	}
+
+#if defined(REV_SIMD_AVX)
+	//------------------------------------------------------------------------------------------------------------------
+	/// Pair of float4, one in each 128 bit half
+	using float4x2 = __m256;
+
+	inline float4x2 load2(const float* x) { return _mm256_loadu_ps(x); }
+	inline void store2(float* dst, float4x2 x) { _mm256_storeu_ps(dst, x); }
+	/// x in both halves
+	inline float4x2 dup(float4 x) { return _mm256_insertf128_ps(_mm256_castps128_ps256(x), x, 1); }
+
+	/// combine() on both halves at once. Same operations in the same order, so results are bitwise identical.
+	inline float4x2 combine2(float4x2 w, float4x2 r0, float4x2 r1, float4x2 r2, float4x2 r3)
+	{
+		float4x2 result = _mm256_mul_ps(_mm256_permute_ps(w, 0x00), r0);
+		result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(w, 0x55), r1));
+		result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(w, 0xaa), r2));
+		result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(w, 0xff), r3));
+		return result;
+	}
+#endif
+
+}	// namespace rev::math::simd
@@ -6,7 +6,10 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include "matrixView.h"
+#include "simd.h"
 
 namespace rev {
 	namespace math {
@@ -131,6 +134,48 @@ namespace rev {
             return result;
         }
 
+		//--------------------------------------------------------------------------------------------------------------
+		// Simd specializations for Vec4f.
+		// Non template overloads take precedence over the expression templates.
+		//--------------------------------------------------------------------------------------------------------------
+		inline Vec4f operator+(const Vec4f& a, const Vec4f& b)
+		{
+			Vec4f result;
+			simd::store(result.data(), simd::add(simd::load(a.data()), simd::load(b.data())));
+			return result;
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		inline Vec4f operator-(const Vec4f& a, const Vec4f& b)
+		{
+			Vec4f result;
+			simd::store(result.data(), simd::sub(simd::load(a.data()), simd::load(b.data())));
+			return result;
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		inline Vec4f min(const Vec4f& a, const Vec4f& b)
+		{
+			Vec4f result;
+			simd::store(result.data(), simd::min(simd::load(a.data()), simd::load(b.data())));
+			return result;
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		inline Vec4f max(const Vec4f& a, const Vec4f& b)
+		{
+			Vec4f result;
+			simd::store(result.data(), simd::max(simd::load(a.data()), simd::load(b.data())));
+			return result;
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		// Sums in a different order than the generic dot, so results only match it within rounding
+		inline float dot(const Vec4f& a, const Vec4f& b)
+		{
+			return simd::dot(simd::load(a.data()), simd::load(b.data()));
+		}
+
         //--------------------------------------------------------------------------------------------------------------
         template<class T, size_t n>
         Vector<T, n> cross(const Vector<T, n>& a, const Vector<T, n>& b)
@@ -152,28 +152,29 @@ namespace rev::math
 
 	inline AABB operator*(const Mat44f& xform, const AABB& aabb)
 	{
-		// Initialize an empty AABB
-		Vec4f tmin = Vec4f(aabb.min(), 1.f);
-		Vec4f tmax = Vec4f(aabb.max(), 1.f);
+		using namespace simd;
+		// Transform the min and max corners along each axis, and keep the extremes of each
+		const float* m = xform.data();
+		float4 c0 = load(m), c1 = load(m+4), c2 = load(m+8), c3 = load(m+12);
+		transpose(c0, c1, c2, c3); // Rows to columns
+
+		float4 tmin = set(aabb.min().x(), aabb.min().y(), aabb.min().z(), 1.f);
+		float4 tmax = set(aabb.max().x(), aabb.max().y(), aabb.max().z(), 1.f);
 		// Compute individual products
-		Vec4f xa = xform.col<0>()*tmin.x();
-		Vec4f xb = xform.col<0>()*tmax.x();
-		Vec4f ya = xform.col<1>()*tmin.y();
-		Vec4f yb = xform.col<1>()*tmax.y();
-		Vec4f za = xform.col<2>()*tmin.z();
-		Vec4f zb = xform.col<2>()*tmax.z();
-		
-		Vec4f xmin = min(xa, xb);
-		Vec4f xmax = max(xa, xb);
-		Vec4f ymin = min(ya, yb);
-		Vec4f ymax = max(ya, yb);
-		Vec4f zmin = min(za, zb);
-		Vec4f zmax = max(za, zb);
-
-		Vec3f transformedMin = (xmin + ymin + zmin + xform.col<3>()).block<3,1,0,0>();
-		Vec3f transformedMax = (xmax + ymax + zmax + xform.col<3>()).block<3,1,0,0>();
-
-		return AABB(transformedMin, transformedMax);
+		float4 xa = mul(c0, broadcast<0>(tmin));
+		float4 xb = mul(c0, broadcast<0>(tmax));
+		float4 ya = mul(c1, broadcast<1>(tmin));
+		float4 yb = mul(c1, broadcast<1>(tmax));
+		float4 za = mul(c2, broadcast<2>(tmin));
+		float4 zb = mul(c2, broadcast<2>(tmax));
+
+		float4 transformedMin = add(add(add(min(xa, xb), min(ya, yb)), min(za, zb)), c3);
+		float4 transformedMax = add(add(add(max(xa, xb), max(ya, yb)), max(za, zb)), c3);
+
+		float result[8];
+		store(result, transformedMin);
+		store(result+4, transformedMax);
+		return AABB(Vec3f(result[0], result[1], result[2]), Vec3f(result[4], result[5], result[6]));
 	}
 
 	//---------------------------------------------------------------------------------
@@ -0,0 +1,506 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+//----------------------------------------------------------------------------------------------------------------------
+// Copyright 2018 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "bvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <limits>
+#include <numeric>
+
+#include <core/tasks/jobSystem.h>
+#include <math/algebra/simd.h>
+
+namespace rev::math
+{
+	namespace
+	{
+		// Traversal stacks are sized for this. Deeper branches are collapsed into a single leaf during the build.
+		constexpr size_t kMaxDepth = 64;
+
+		bool intersectNode(const BVH::Node& node, const Ray::Implicit& ray, float tMax, float& tEnter)
+		{
+			return AABB(node.min, node.max).intersect(ray, tMax, tEnter);
+		}
+
+		// Same test as AABB::intersect, for four rays at a time. Returns a mask of the rays that hit the node.
+		int intersectNode4(
+			const BVH::Node& node,
+			simd::float4 ox, simd::float4 oy, simd::float4 oz,
+			simd::float4 nx, simd::float4 ny, simd::float4 nz,
+			simd::float4 tMax)
+		{
+			using namespace simd;
+			float4 t1x = mul(sub(splat(node.min.x()), ox), nx);
+			float4 t1y = mul(sub(splat(node.min.y()), oy), ny);
+			float4 t1z = mul(sub(splat(node.min.z()), oz), nz);
+			float4 t2x = mul(sub(splat(node.max.x()), ox), nx);
+			float4 t2y = mul(sub(splat(node.max.y()), oy), ny);
+			float4 t2z = mul(sub(splat(node.max.z()), oz), nz);
+			float4 enter = max(min(t1x, t2x), max(min(t1y, t2y), max(min(t1z, t2z), splat(0.f))));
+			float4 leave = min(max(t2x, t1x), min(max(t2y, t1y), min(max(t2z, t1z), tMax)));
+			return ~signMask(less(leave, enter)) & 0xf;
+		}
+
+		Vec3f center(const BVH::Node& node)
+		{
+			return 0.5f * (node.min + node.max);
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	struct BVH::BuildNode
+	{
+		AABB bounds;
+		std::unique_ptr<BuildNode> children[2];
+		uint32_t first = 0;
+		uint32_t count = 0;
+	};
+
+	//------------------------------------------------------------------------------------------------------------------
+	// Top down builder. Each node sorts its own range of the primitive index array, so sibling subtrees
+	// never touch the same memory and can be built concurrently.
+	struct BVH::Builder
+	{
+		static constexpr size_t kNumBins = 16;
+		static constexpr uint32_t kParallelThreshold = 4096; // Smaller subtrees are not worth a job
+		static constexpr float kTraversalCost = 1.f; // Relative to the cost of intersecting a primitive
+
+		const std::vector<AABB>& bounds;
+		std::vector<Vec3f> centroids;
+		std::vector<uint32_t>& primitives;
+		core::JobSystem* jobs;
+		std::atomic<uint32_t> numNodes = 0;
+
+		Builder(const std::vector<AABB>& _bounds, std::vector<uint32_t>& _primitives, core::JobSystem* _jobs)
+			: bounds(_bounds)
+			, primitives(_primitives)
+			, jobs(_jobs)
+		{
+			centroids.resize(bounds.size());
+			for(size_t i = 0; i < bounds.size(); ++i)
+				centroids[i] = bounds[i].center();
+		}
+
+		std::unique_ptr<BuildNode> build(uint32_t begin, uint32_t end, size_t depth)
+		{
+			numNodes++;
+			auto node = std::make_unique<BuildNode>();
+			AABB centroidBounds;
+			for(uint32_t i = begin; i < end; ++i)
+			{
+				node->bounds.add(bounds[primitives[i]]);
+				centroidBounds.add(centroids[primitives[i]]);
+			}
+
+			const uint32_t count = end - begin;
+			node->first = begin;
+			node->count = count;
+			if(count == 1 || depth + 1 >= kMaxDepth)
+				return node;
+
+			// Evaluate the SAH at the boundaries between bins, along each axis
+			float bestCost = std::numeric_limits<float>::infinity();
+			int bestAxis = -1;
+			size_t bestSplit = 0;
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				float cMin = centroidBounds.min()[axis];
+				float extent = centroidBounds.max()[axis] - cMin;
+				if(extent <= 0.f)
+					continue;
+				float scale = kNumBins / extent;
+
+				AABB binBounds[kNumBins];
+				uint32_t binCount[kNumBins] = {};
+				for(uint32_t i = begin; i < end; ++i)
+				{
+					auto p = primitives[i];
+					auto bin = binIndex(centroids[p][axis], cMin, scale);
+					binBounds[bin].add(bounds[p]);
+					binCount[bin]++;
+				}
+
+				float leftArea[kNumBins];
+				uint32_t leftCount[kNumBins];
+				AABB accum;
+				uint32_t n = 0;
+				for(size_t b = 0; b < kNumBins - 1; ++b)
+				{
+					accum.add(binBounds[b]);
+					n += binCount[b];
+					leftArea[b] = n ? accum.area() : 0.f;
+					leftCount[b] = n;
+				}
+				accum.clear();
+				n = 0;
+				for(size_t b = kNumBins - 1; b > 0; --b)
+				{
+					accum.add(binBounds[b]);
+					n += binCount[b];
+					if(!n || !leftCount[b-1])
+						continue;
+					float cost = leftCount[b-1] * leftArea[b-1] + n * accum.area();
+					if(cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = b;
+					}
+				}
+			}
+
+			uint32_t mid;
+			if(bestAxis < 0)
+			{
+				// All centroids in the same spot. Split in half if there are too many to keep in a leaf.
+				if(count <= kMaxLeafSize)
+					return node;
+				mid = begin + count / 2;
+			}
+			else
+			{
+				float nodeArea = node->bounds.area();
+				float splitCost = kTraversalCost + (nodeArea > 0.f ? bestCost / nodeArea : 0.f);
+				if(count <= kMaxLeafSize && splitCost >= count)
+					return node;
+
+				float cMin = centroidBounds.min()[bestAxis];
+				float scale = kNumBins / (centroidBounds.max()[bestAxis] - cMin);
+				auto midIter = std::partition(primitives.begin() + begin, primitives.begin() + end, [&](uint32_t p) {
+					return binIndex(centroids[p][bestAxis], cMin, scale) < bestSplit;
+				});
+				mid = uint32_t(midIter - primitives.begin());
+			}
+
+			node->count = 0;
+			auto* children = node->children;
+			if(jobs && count >= kParallelThreshold)
+			{
+				auto job = jobs->schedule([=]() { children[0] = build(begin, mid, depth + 1); });
+				children[1] = build(mid, end, depth + 1);
+				jobs->wait(job);
+			}
+			else
+			{
+				children[0] = build(begin, mid, depth + 1);
+				children[1] = build(mid, end, depth + 1);
+			}
+			return node;
+		}
+
+		static size_t binIndex(float centroid, float cMin, float scale)
+		{
+			return std::min(kNumBins - 1, size_t((centroid - cMin) * scale));
+		}
+	};
+
+	//------------------------------------------------------------------------------------------------------------------
+	void BVH::build(const std::vector<Vec3f>& vertices, const std::vector<uint32_t>& indices, core::JobSystem* jobs)
+	{
+		const size_t numTriangles = indices.size() / 3;
+		std::vector<AABB> triangleBounds(numTriangles);
+		for(size_t i = 0; i < numTriangles; ++i)
+		{
+			triangleBounds[i].add(vertices[indices[3*i+0]]);
+			triangleBounds[i].add(vertices[indices[3*i+1]]);
+			triangleBounds[i].add(vertices[indices[3*i+2]]);
+		}
+		build(std::move(triangleBounds), jobs);
+
+		m_boxes.clear();
+		m_triangles.resize(numTriangles);
+		for(size_t i = 0; i < numTriangles; ++i)
+		{
+			auto t = m_primitives[i];
+			auto& v0 = vertices[indices[3*t+0]];
+			m_triangles[i] = { v0, Vec3f(vertices[indices[3*t+1]] - v0), Vec3f(vertices[indices[3*t+2]] - v0) };
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void BVH::build(const std::vector<AABB>& boxes, core::JobSystem* jobs)
+	{
+		build(std::vector<AABB>(boxes), jobs);
+
+		m_triangles.clear();
+		m_boxes.resize(boxes.size());
+		for(size_t i = 0; i < boxes.size(); ++i)
+			m_boxes[i] = boxes[m_primitives[i]];
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void BVH::build(std::vector<AABB>&& primitiveBounds, core::JobSystem* jobs)
+	{
+		m_nodes.clear();
+		m_primitives.resize(primitiveBounds.size());
+		std::iota(m_primitives.begin(), m_primitives.end(), 0);
+		if(primitiveBounds.empty())
+			return;
+
+		Builder builder(primitiveBounds, m_primitives, jobs);
+		auto root = builder.build(0, uint32_t(primitiveBounds.size()), 0);
+		m_nodes.reserve(builder.numNodes);
+		flatten(*root);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	uint32_t BVH::flatten(const BuildNode& buildNode)
+	{
+		auto ndx = uint32_t(m_nodes.size());
+		m_nodes.push_back({ buildNode.bounds.min(), buildNode.first, buildNode.bounds.max(), buildNode.count });
+		if(buildNode.count == 0)
+		{
+			flatten(*buildNode.children[0]); // Lands right after this node
+			auto secondChild = flatten(*buildNode.children[1]);
+			m_nodes[ndx].offset = secondChild;
+		}
+		return ndx;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	AABB BVH::bounds() const
+	{
+		return m_nodes.empty() ? AABB() : AABB(m_nodes[0].min, m_nodes[0].max);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool BVH::intersectPrimitive(uint32_t ndx, const Ray& ray, const Ray::Implicit& implicit, float tMax, Hit& hit) const
+	{
+		if(!m_boxes.empty())
+		{
+			float tEnter;
+			if(!m_boxes[ndx].intersect(implicit, tMax, tEnter) || tEnter >= tMax)
+				return false;
+			hit = { tEnter, m_primitives[ndx], 0.f, 0.f };
+			return true;
+		}
+
+		// Moller-Trumbore
+		auto& tri = m_triangles[ndx];
+		Vec3f p = cross(ray.direction(), tri.e2);
+		float det = dot(tri.e1, p);
+		if(det == 0.f) // Parallel to the triangle
+			return false;
+		float invDet = 1.f / det;
+		Vec3f s = ray.origin() - tri.v0;
+		float u = dot(s, p) * invDet;
+		if(u < 0.f || u > 1.f)
+			return false;
+		Vec3f q = cross(s, tri.e1);
+		float v = dot(ray.direction(), q) * invDet;
+		if(v < 0.f || u + v > 1.f)
+			return false;
+		float t = dot(tri.e2, q) * invDet;
+		if(t < 0.f || t >= tMax)
+			return false;
+		hit = { t, m_primitives[ndx], u, v };
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool BVH::closestHit(const Ray& ray, float tMax, Hit& hit) const
+	{
+		float tEnter;
+		auto implicit = ray.implicit();
+		if(empty() || !intersectNode(m_nodes[0], implicit, tMax, tEnter))
+			return false;
+
+		bool found = false;
+		hit.t = tMax;
+		uint32_t stack[kMaxDepth];
+		size_t stackSize = 0;
+		uint32_t current = 0;
+		for(;;)
+		{
+			auto& node = m_nodes[current];
+			if(node.isLeaf())
+			{
+				for(uint32_t i = node.offset; i < node.offset + node.count; ++i)
+					found |= intersectPrimitive(i, ray, implicit, hit.t, hit);
+			}
+			else
+			{
+				// Visit the nearest child first, so hits found there cull the other one
+				uint32_t near = current + 1, far = node.offset;
+				float tNear, tFar;
+				bool hitNear = intersectNode(m_nodes[near], implicit, hit.t, tNear);
+				bool hitFar = intersectNode(m_nodes[far], implicit, hit.t, tFar);
+				if(hitNear && hitFar)
+				{
+					if(tFar < tNear)
+						std::swap(near, far);
+					stack[stackSize++] = far;
+					current = near;
+					continue;
+				}
+				if(hitNear || hitFar)
+				{
+					current = hitNear ? near : far;
+					continue;
+				}
+			}
+			if(!stackSize)
+				break;
+			current = stack[--stackSize];
+		}
+		return found;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool BVH::anyHit(const Ray& ray, float tMax) const
+	{
+		if(empty())
+			return false;
+
+		auto implicit = ray.implicit();
+		uint32_t stack[kMaxDepth+1];
+		size_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while(stackSize)
+		{
+			auto& node = m_nodes[stack[--stackSize]];
+			float tEnter;
+			if(!intersectNode(node, implicit, tMax, tEnter))
+				continue;
+			if(node.isLeaf())
+			{
+				Hit hit;
+				for(uint32_t i = node.offset; i < node.offset + node.count; ++i)
+					if(intersectPrimitive(i, ray, implicit, tMax, hit))
+						return true;
+			}
+			else
+			{
+				stack[stackSize++] = node.offset;
+				stack[stackSize++] = uint32_t(&node - m_nodes.data()) + 1;
+			}
+		}
+		return false;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	int BVH::closestHit(const Ray (&rays)[4], float tMax, Hit (&hits)[4]) const
+	{
+		using namespace simd;
+		int hitMask = 0;
+		Ray::Implicit implicit[4];
+		float tCurrent[4];
+		for(int i = 0; i < 4; ++i)
+		{
+			implicit[i] = rays[i].implicit();
+			tCurrent[i] = tMax;
+			hits[i].t = tMax;
+		}
+		if(empty())
+			return 0;
+
+		float4 ox = set(implicit[0].o.x(), implicit[1].o.x(), implicit[2].o.x(), implicit[3].o.x());
+		float4 oy = set(implicit[0].o.y(), implicit[1].o.y(), implicit[2].o.y(), implicit[3].o.y());
+		float4 oz = set(implicit[0].o.z(), implicit[1].o.z(), implicit[2].o.z(), implicit[3].o.z());
+		float4 nx = set(implicit[0].n.x(), implicit[1].n.x(), implicit[2].n.x(), implicit[3].n.x());
+		float4 ny = set(implicit[0].n.y(), implicit[1].n.y(), implicit[2].n.y(), implicit[3].n.y());
+		float4 nz = set(implicit[0].n.z(), implicit[1].n.z(), implicit[2].n.z(), implicit[3].n.z());
+		float4 tLimit = load(tCurrent);
+
+		uint32_t stack[kMaxDepth+1];
+		size_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while(stackSize)
+		{
+			auto current = stack[--stackSize];
+			auto& node = m_nodes[current];
+			int active = intersectNode4(node, ox, oy, oz, nx, ny, nz, tLimit);
+			if(!active)
+				continue;
+
+			if(node.isLeaf())
+			{
+				for(int lane = 0; lane < 4; ++lane)
+				{
+					if(!(active & (1 << lane)))
+						continue;
+					for(uint32_t i = node.offset; i < node.offset + node.count; ++i)
+					{
+						if(intersectPrimitive(i, rays[lane], implicit[lane], tCurrent[lane], hits[lane]))
+						{
+							tCurrent[lane] = hits[lane].t;
+							hitMask |= 1 << lane;
+						}
+					}
+				}
+				tLimit = load(tCurrent);
+			}
+			else
+			{
+				// Order children along the direction of the first active ray
+				uint32_t near = current + 1, far = node.offset;
+				int firstLane = 0;
+				while(!(active & (1 << firstLane)))
+					++firstLane;
+				if(dot(center(m_nodes[far]) - center(m_nodes[near]), rays[firstLane].direction()) < 0.f)
+					std::swap(near, far);
+				stack[stackSize++] = far;
+				stack[stackSize++] = near;
+			}
+		}
+		return hitMask;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void BVH::overlaps(const AABB& box, std::vector<uint32_t>& result) const
+	{
+		if(empty())
+			return;
+
+		uint32_t stack[kMaxDepth+1];
+		size_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while(stackSize)
+		{
+			auto& node = m_nodes[stack[--stackSize]];
+			if(!box.intersect(AABB(node.min, node.max)))
+				continue;
+			if(node.isLeaf())
+			{
+				for(uint32_t i = node.offset; i < node.offset + node.count; ++i)
+				{
+					AABB primitiveBounds;
+					if(m_boxes.empty())
+					{
+						auto& tri = m_triangles[i];
+						primitiveBounds.add(tri.v0);
+						primitiveBounds.add(Vec3f(tri.v0 + tri.e1));
+						primitiveBounds.add(Vec3f(tri.v0 + tri.e2));
+					}
+					else
+						primitiveBounds = m_boxes[i];
+					if(box.intersect(primitiveBounds))
+						result.push_back(m_primitives[i]);
+				}
+			}
+			else
+			{
+				stack[stackSize++] = node.offset;
+				stack[stackSize++] = uint32_t(&node - m_nodes.data()) + 1;
+			}
+		}
+	}
+}
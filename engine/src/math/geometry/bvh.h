@@ -0,0 +1,102 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+//----------------------------------------------------------------------------------------------------------------------
+// Copyright 2018 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <math/algebra/vector.h>
+#include "aabb.h"
+#include "ray.h"
+
+namespace rev::core {
+	class JobSystem;
+}
+
+namespace rev::math
+{
+	/// Bounding volume hierarchy over triangles or boxes, built with a binned surface area heuristic.
+	/// Nodes are stored depth first in a flat array. The first child of an interior node is the node right after it,
+	/// so only the index of the second child needs to be stored.
+	class BVH
+	{
+	public:
+		struct Node
+		{
+			Vec3f min;
+			uint32_t offset; // Interior nodes: index of the second child. Leaves: first primitive in the leaf
+			Vec3f max;
+			uint32_t count; // Number of primitives in a leaf. Zero for interior nodes
+
+			bool isLeaf() const { return count > 0; }
+		};
+
+		struct Hit
+		{
+			float t; // Distance along the ray, in units of the ray's direction
+			uint32_t primitive; // Index of the triangle or box in the build input
+			float u, v; // Barycentric coordinates of the hit in the triangle. Zero for boxes
+		};
+
+		/// Build over an indexed triangle list.
+		/// When jobs is not null, big subtrees are built in parallel on it.
+		void build(const std::vector<Vec3f>& vertices, const std::vector<uint32_t>& indices, core::JobSystem* jobs = nullptr);
+		/// Build over boxes. Ray queries report the distance to the entry point of the box.
+		void build(const std::vector<AABB>& boxes, core::JobSystem* jobs = nullptr);
+
+		bool empty() const { return m_nodes.empty(); }
+		const std::vector<Node>& nodes() const { return m_nodes; }
+		AABB bounds() const;
+
+		/// Closest intersection with a primitive in [0, tMax)
+		bool closestHit(const Ray& ray, float tMax, Hit& hit) const;
+		/// Whether any primitive is hit in [0, tMax). Stops at the first hit found.
+		bool anyHit(const Ray& ray, float tMax) const;
+		/// Closest hits for a packet of four rays traced together.
+		/// Nodes are tested against the whole packet at once, so coherent rays share most of the traversal.
+		/// Returns a mask with bit i set if ray i hit something.
+		int closestHit(const Ray (&rays)[4], float tMax, Hit (&hits)[4]) const;
+		/// Append to result the indices of the primitives whose bounds overlap box
+		void overlaps(const AABB& box, std::vector<uint32_t>& result) const;
+
+		static constexpr uint32_t kMaxLeafSize = 8;
+
+	private:
+		struct Triangle
+		{
+			Vec3f v0, e1, e2;
+		};
+
+		struct BuildNode;
+		struct Builder;
+
+		void build(std::vector<AABB>&& primitiveBounds, core::JobSystem* jobs);
+		uint32_t flatten(const BuildNode& node);
+
+		bool intersectPrimitive(uint32_t ndx, const Ray& ray, const Ray::Implicit& implicit, float tMax, Hit& hit) const;
+
+		std::vector<Node> m_nodes;
+		std::vector<uint32_t> m_primitives; // Original index of the primitives, in leaf order
+		// Primitive data in leaf order, so leaves read contiguous memory. Only one of them is used.
+		std::vector<Triangle> m_triangles;
+		std::vector<AABB> m_boxes;
+	};
+}
@@ -3,11 +3,13 @@
 // Created by Carmelo J. Fdez-Agera Tortosa (a.k.a. Technik)
 //----------------------------------------------------------------------------------------------------------------------
 #include "httpMessage.h"
+#include "httpParser.h"
+#include <core/platform/fileSystem/file.h>
 
+#include <cctype>
 #include <cstdlib>
 #include <cassert>
 #include <iostream>
-#include <sstream>
 
 using namespace std;
 
@@ -19,159 +21,127 @@ namespace rev {
 			const string Message::cContentLengthLabel = "Content-Length";
 
 			//----------------------------------------------------------------------------------------------------------------------
-			int Message::operator<<(const string& _raw) {
-				// use mBody as a temporal buffer
-				mBody.append(_raw);
-				while (!mBody.empty()) {
-					switch (mState) {
-					case ParseState::MessageLine: {
-						if (!parseMessageLine())
-							return -1;
-						break;
-					}
-					case ParseState::Headers: {
-						if (!parseHeaders())
-							return -1;
-						if (mState == ParseState::Headers) // Not enough text yet
-							return 0; // Keep reading
-						break;
-					}
-					case ParseState::Body:
-						if (!mRequiredBodyLength || (mBody.size() < mRequiredBodyLength))
-							return 0; // Keep reading
-						else {
-							if (mRequiredBodyLength) {
-								unsigned notParsed = mBody.size() - mRequiredBodyLength;
-								mBody = mBody.substr(0, mRequiredBodyLength);
-								return _raw.size() - notParsed;
-							}
-							else { // Accept everything
-								return _raw.size();
-							}
-						}
-						break;
-					default:
-						return -1; // Wrong state
-					}
+			string Message::canonicalHeaderName(std::string_view _name) {
+				string name(_name);
+				bool wordStart = true;
+				for (auto& c : name) {
+					c = (char)(wordStart ? toupper((unsigned char)c) : tolower((unsigned char)c));
+					wordStart = (c == '-');
 				}
-				return 0; // Keep reading
+				return name;
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
-			bool Message::isComplete() const {
-				return mState == ParseState::Complete;
+			void Message::setBody(std::string _body) {
+				if (_body.empty()) {
+					setBody(nullptr, std::string_view());
+					return;
+				}
+				auto owned = make_shared<const string>(std::move(_body));
+				string_view view = *owned;
+				setBody(std::move(owned), view);
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
-			void Message::setBody(const std::string& _body) {
+			void Message::setBody(std::shared_ptr<const void> _owner, std::string_view _body) {
+				mBodyOwner = std::move(_owner);
 				mBody = _body;
-				stringstream ss;
-				ss << body().size();
-				mHeaders[cContentLengthLabel] = ss.str();
+				mBodyFile.reset();
+				mBodyFileOffset = 0;
+				mBodySize = _body.size();
+				mHeaders[cContentLengthLabel] = to_string(mBodySize);
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
-			string Message::serialize() const {
-				string serial;
-				serializeMessageLine(serial);
-				serializeHeaders(serial);
-				if (mBody.size())
-					serial.append(mBody + "\r\n");
-				return serial;
+			void Message::setBody(std::shared_ptr<const core::File> _file) {
+				string_view contents(_file->buffer<char>(), _file->size());
+				setBody(std::shared_ptr<const void>(std::move(_file)), contents);
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
-			bool Message::requiresClose() const {
-				auto connHeader = mHeaders.find("Connection");
-				return (connHeader != mHeaders.end()) && (connHeader->second == "close");
+			void Message::setBody(std::shared_ptr<const OpenFile> _file, size_t _offset, size_t _size) {
+				assert(_offset + _size <= _file->size());
+				mBodyOwner.reset();
+				mBody = string_view();
+				mBodyFile = std::move(_file);
+				mBodyFileOffset = _offset;
+				mBodySize = _size;
+				mHeaders[cContentLengthLabel] = to_string(mBodySize);
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
-			bool Message::addHeader(const string& _headerLine) {
-				unsigned colonPos = _headerLine.find(": ");
-				if (colonPos == string::npos)
-					return false;
-				string label = _headerLine.substr(0, colonPos);
-				string content = _headerLine.substr(colonPos + 2);
-				mHeaders.insert(make_pair(
-					label,
-					content
-				));
-				return true;
+			Payload Message::payload() const {
+				// Small bodies are cheaper to copy next to the headers than to send as a piece of their own
+				constexpr size_t cInlineBodySize = 1024;
+				bool inlineBody = !mBodyFile && mBody.size() <= cInlineBodySize;
+				string head;
+				head.reserve(256 + (inlineBody ? mBody.size() : 0));
+				serializeMessageLine(head);
+				serializeHeaders(head);
+				if (inlineBody)
+					head.append(mBody);
+
+				Payload payload;
+				payload.append(std::move(head));
+				if (mBodyFile)
+					payload.append(mBodyFile, mBodyFileOffset, mBodySize);
+				else if (!inlineBody)
+					payload.append(mBodyOwner, mBody);
+				return payload;
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
-			bool Message::processHeaders(const string& _headers) {
-				string left = _headers;
-				while (!left.empty())
-				{
-					unsigned split = left.find("\r\n");
-					string header;
-					if (split == string::npos) {
-						header = left;
-						left.clear();
-					}
-					else {
-						header = left.substr(0, split);
-						left = left.substr(split + 2);
-					}
-					if (!addHeader(header))
-						return false;
-				}
-				auto iter = mHeaders.find(cContentLengthLabel);
-				if (iter != mHeaders.end()) {
-					mRequiredBodyLength = atoi(iter->second.c_str());
+			string Message::serialize() const {
+				string serial;
+				serializeMessageLine(serial);
+				serializeHeaders(serial);
+				// Content-Length delimits the body. Anything after it would be taken for the next message
+				if (mBodyFile) {
+					size_t headSize = serial.size();
+					serial.resize(headSize + mBodySize);
+					if (!mBodyFile->read(mBodyFileOffset, mBodySize, &serial[headSize]))
+						serial.resize(headSize);
 				}
-				return true;
+				else
+					serial.append(mBody);
+				return serial;
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
-			bool Message::parseMessageLine() {
-				size_t cursor = mBody.find("\r\n");
-				if (cursor != string::npos) // Line end found
-				{
-					int consumed = processMessageLine(mBody.substr(0, cursor));
-					if (consumed > 0) // success
-					{
-						mBody = mBody.substr(consumed + 2);
-						mState = ParseState::Headers;
-						return true;
-					}
-					else { // Parsing error
-						mState = ParseState::Error;
-						return false;
-					}
-				}
-				else // No line end found, need more text
-					return true;
+			bool Message::requiresClose() const {
+				auto connHeader = mHeaders.find("Connection");
+				return (connHeader != mHeaders.end()) && (connHeader->second == "close");
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
-			bool Message::parseHeaders() {
-				bool skipHeaders = mBody.find("\r\n") == 0; // if we find a blank line right at the begining, then there are no headers
-				if (skipHeaders) {
-					mState = ParseState::Body; // Waiting for the body
-					return true;
-				}
-				size_t consumed = mBody.find("\r\n\r\n");
-				if (consumed != string::npos)
-				{
-					bool success = processHeaders(mBody.substr(0, consumed));
-					if (!success) { // Parsing error
-						mState = ParseState::Error;
-						return false;
-					}
-					mBody = mBody.substr(consumed + 4);
-					mState = ParseState::Body;
-					return true;
+			bool Message::parse(const string& _raw, Parser& _parser) {
+				if (_parser.finish(_raw) != Parser::Result::Complete)
+					return false;
+				// Chunks are joined, so the body will be delimited by its length if serialized again
+				bool chunked = !_parser.header("Transfer-Encoding").empty();
+				for (size_t i = 0; i < _parser.numHeaders(); ++i) {
+					// Header names are case insensitive. One casing keeps lookups like the one in setBody working
+					string name = canonicalHeaderName(_parser.headerName(i));
+					if (chunked && name == "Transfer-Encoding")
+						continue;
+					mHeaders.emplace(std::move(name), string(_parser.headerValue(i)));
 				}
-				return true; // End of headers not yet found
+				string body;
+				body.reserve(_parser.bodySize());
+				for (size_t i = 0; i < _parser.numBodyChunks(); ++i)
+					body.append(_parser.bodyChunk(i));
+				setBody(std::move(body));
+				mComplete = true;
+				return true;
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
 			void Message::serializeHeaders(string& _dst) const {
-				for (auto i : mHeaders) {
-					_dst.append(i.first + ": " + i.second + "\r\n");
+				for (auto& i : mHeaders) {
+					_dst.append(i.first);
+					_dst.append(": ");
+					_dst.append(i.second);
+					_dst.append("\r\n");
 				}
 				_dst.append("\r\n");
 			}
@@ -4,28 +4,48 @@
 //----------------------------------------------------------------------------------------------------------------------
 #pragma once
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
+#include <network/socket/payload.h>
 
 namespace rev {
+	namespace core {
+		class File;
+	}
+
 	namespace net {
 		namespace http {
 
+			class Parser;
+
 			class Message {
 			public:
 
 				Message() = default;
-				// Returns the number of bytes consumed in the string if the line is finished, 0 if still processing, -1 if an error occurred.
-				int operator<<(const std::string& _raw);
-				// Returns true when this message won't process any more text
-				bool isComplete() const;
+				virtual ~Message() = default;
+				// Returns true when the message was built or parsed successfully
+				bool isComplete() const { return mComplete; }
 
 				// Accessors
 				const std::unordered_map<std::string, std::string>&	headers() const { return mHeaders; }
 				std::unordered_map<std::string, std::string>&		headers() { return mHeaders; }
-				const std::string&									body() const { return mBody; }
-				void												setBody(const std::string&);
+				/// Empty for bodies sent from an OpenFile
+				std::string_view									body() const { return mBody; }
+				size_t												bodySize() const { return mBodySize; }
+				void												setBody(std::string);
+				/// Body held elsewhere, like a shared buffer. _owner keeps it alive for as long as the message needs it.
+				void												setBody(std::shared_ptr<const void> _owner, std::string_view _body);
+				/// Body in a file already loaded or mapped in memory
+				void												setBody(std::shared_ptr<const core::File>);
+				/// Body sent straight from a region of a file, without reading it into memory
+				void												setBody(std::shared_ptr<const OpenFile>, size_t _offset, size_t _size);
+
+				/// Start line, headers and body, ready to be sent. Bodies are referenced, not copied.
+				Payload												payload() const;
+				/// Copy of the whole message. Bodies in files are read.
 				std::string											serialize() const;
 
 				// Wether this message specifies that the connection must be closed.
@@ -33,38 +53,27 @@ namespace rev {
 
 				// Known header labels
 				static const std::string cContentLengthLabel;
+				/// Parsed headers are stored with this casing: "content-length" becomes "Content-Length"
+				static std::string canonicalHeaderName(std::string_view _name);
 
 			protected:
-				bool												addHeader(const std::string&);
+				// Parse a whole message, and copy its headers and body
+				bool												parse(const std::string& _raw, Parser& _parser);
 				// Force completion when derived class constructs base message without using the parse mechanism
-				void												setReady() { mState = ParseState::Complete; }
+				void												setReady() { mComplete = true; }
 
 			private:
-				enum class ParseState {
-					MessageLine,
-					Headers,
-					Body,
-					Complete,
-					Error
-				};
-
-				// Returns the number of bytes consumed in the string if the line is properly processed, 0 or negative if an error occurred.
-				virtual int		processMessageLine(const std::string& _raw) = 0;
-				// Returns the number of bytes consumed in the string if the line is finished, 0 if still processing, -1 if an error occurred.
-				bool			processHeaders(const std::string&);
-				bool			parseMessageLine();
-				bool			parseHeaders();
-
 				virtual void	serializeMessageLine(std::string& dst) const = 0;
 				void			serializeHeaders(std::string& dst) const;
 
 			private:
 				std::unordered_map<std::string, std::string>	mHeaders;
-				std::string mBody;
-
-				unsigned	mRequiredBodyLength = 0;
-				ParseState	mState = ParseState::MessageLine;
-
+				std::shared_ptr<const void>		mBodyOwner;
+				std::string_view				mBody;
+				std::shared_ptr<const OpenFile>	mBodyFile;
+				size_t							mBodyFileOffset = 0;
+				size_t							mBodySize = 0;
+				bool							mComplete = false;
 			};
 
 }	}	}	// namespace rev::net::http
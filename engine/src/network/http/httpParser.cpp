@@ -0,0 +1,380 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "httpParser.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace rev {
+	namespace net {
+		namespace http {
+
+			//----------------------------------------------------------------------------------------------------------
+			namespace {
+				char lowerCase(char c) {
+					return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+				}
+
+				bool equalsNoCase(std::string_view a, std::string_view b) {
+					if (a.size() != b.size())
+						return false;
+					for (size_t i = 0; i < a.size(); ++i)
+						if (lowerCase(a[i]) != lowerCase(b[i]))
+							return false;
+					return true;
+				}
+
+				std::string_view trim(std::string_view s) {
+					while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+						s.remove_prefix(1);
+					while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+						s.remove_suffix(1);
+					return s;
+				}
+
+				// Whether a comma separated header value contains the given token
+				bool hasToken(std::string_view _list, std::string_view _token) {
+					while (!_list.empty()) {
+						size_t comma = _list.find(',');
+						if (equalsNoCase(trim(_list.substr(0, comma)), _token))
+							return true;
+						if (comma == std::string_view::npos)
+							break;
+						_list.remove_prefix(comma + 1);
+					}
+					return false;
+				}
+
+				// Strictly decimal digits, so "12abc" or "-1" are rejected
+				bool parseSize(std::string_view _text, size_t _max, size_t& _value) {
+					if (_text.empty())
+						return false;
+					_value = 0;
+					for (char c : _text) {
+						if (c < '0' || c > '9')
+							return false;
+						_value = _value * 10 + (c - '0');
+						if (_value > _max)
+							_value = _max + 1; // Saturate instead of overflowing
+					}
+					return true;
+				}
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			Parser::Result Parser::parse(std::string_view _buffer) {
+				assert(_buffer.size() >= mCursor); // The buffer can only grow
+				mBase = _buffer.data();
+				for (;;) {
+					switch (mState) {
+					case State::StartLine:
+					case State::Headers:
+					case State::ChunkSize:
+					case State::ChunkEnd:
+					case State::Trailers: {
+						Span line;
+						if (!nextLine(_buffer, line)) {
+							if (_buffer.size() - mCursor > cMaxHeaderSize)
+								return fail(Error::HeaderTooLarge);
+							return Result::Incomplete;
+						}
+						auto result = parseLine(line);
+						if (result != Result::Incomplete)
+							return result;
+						break;
+					}
+					case State::Body:
+					case State::ChunkData: {
+						size_t available = std::min(_buffer.size() - mCursor, mRemaining);
+						mCursor += available;
+						mRemaining -= available;
+						mScanned = mCursor;
+						if (mRemaining)
+							return Result::Incomplete;
+						mState = mState == State::Body ? State::Complete : State::ChunkEnd;
+						break;
+					}
+					case State::UntilClose:
+						mCursor = mScanned = _buffer.size();
+						if (mCursor - mBodyChunks.back().begin > cMaxBodySize)
+							return fail(Error::BodyTooLarge);
+						return Result::Incomplete;
+					case State::Complete:
+						return Result::Complete;
+					case State::Error:
+						return Result::Error;
+					}
+				}
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			Parser::Result Parser::finish(std::string_view _buffer) {
+				auto result = parse(_buffer);
+				if (mState == State::UntilClose) {
+					mBodyChunks.back().size = uint32_t(mCursor - mBodyChunks.back().begin);
+					mBodySize = mBodyChunks.back().size;
+					mState = State::Complete;
+					return Result::Complete;
+				}
+				if (result == Result::Incomplete) // Truncated
+					return fail(Error::Malformed);
+				return result;
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			void Parser::reset() {
+				mBase = nullptr;
+				mState = State::StartLine;
+				mError = Error::None;
+				mCursor = 0;
+				mScanned = 0;
+				mTrailersBegin = 0;
+				for (auto& part : mStartLine)
+					part = Span();
+				mStatusCode = 0;
+				mNumHeaders = 0;
+				mBodyChunks.clear();
+				mBodySize = 0;
+				mContentLength = 0;
+				mRemaining = 0;
+				mHasLength = false;
+				mChunked = false;
+				mKeepAlive = true;
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			Parser::Result Parser::result() const {
+				if (mState == State::Complete)
+					return Result::Complete;
+				if (mState == State::Error)
+					return Result::Error;
+				return Result::Incomplete;
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			std::string_view Parser::header(std::string_view _name) const {
+				for (size_t i = 0; i < mNumHeaders; ++i)
+					if (equalsNoCase(headerName(i), _name))
+						return headerValue(i);
+				return std::string_view();
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			bool Parser::nextLine(std::string_view _buffer, Span& _line) {
+				size_t searchStart = std::max(mCursor, mScanned);
+				auto lineEnd = (const char*)memchr(_buffer.data() + searchStart, '\n', _buffer.size() - searchStart);
+				if (!lineEnd) {
+					mScanned = _buffer.size();
+					return false;
+				}
+				size_t end = lineEnd - _buffer.data();
+				_line.begin = uint32_t(mCursor);
+				_line.size = uint32_t(end - mCursor);
+				if (_line.size && _buffer[end - 1] == '\r')
+					--_line.size;
+				mCursor = mScanned = end + 1;
+				return true;
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			Parser::Result Parser::parseLine(Span _line) {
+				switch (mState) {
+				case State::StartLine:
+					if (mCursor > cMaxHeaderSize)
+						return fail(Error::HeaderTooLarge);
+					if (!_line.size) // Tolerate empty lines between messages
+						return Result::Incomplete;
+					if (!parseStartLine(_line))
+						return fail(Error::Malformed);
+					mState = State::Headers;
+					return Result::Incomplete;
+				case State::Headers:
+					if (mCursor > cMaxHeaderSize)
+						return fail(Error::HeaderTooLarge);
+					return _line.size ? parseHeader(_line) : endHeaders();
+				case State::ChunkSize:
+					return parseChunkSize(_line);
+				case State::ChunkEnd:
+					if (_line.size)
+						return fail(Error::Malformed);
+					mState = State::ChunkSize;
+					return Result::Incomplete;
+				case State::Trailers: // Trailing headers are accepted, but not stored
+					if (mCursor - mTrailersBegin > cMaxHeaderSize)
+						return fail(Error::HeaderTooLarge);
+					if (!_line.size) {
+						mState = State::Complete;
+						return Result::Complete;
+					}
+					return Result::Incomplete;
+				default:
+					assert(false);
+					return fail(Error::Malformed);
+				}
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			bool Parser::parseStartLine(Span _line) {
+				// Requests: method SP url SP version. Responses: version SP code SP reason, where reason can have spaces
+				std::string_view line = view(_line);
+				size_t firstSpace = line.find(' ');
+				if (firstSpace == std::string_view::npos || firstSpace == 0)
+					return false;
+				size_t secondSpace = line.find(' ', firstSpace + 1);
+				mStartLine[0] = { _line.begin, uint32_t(firstSpace) };
+				if (secondSpace == std::string_view::npos) {
+					if (mType == Type::Request)
+						return false;
+					secondSpace = line.size(); // Responses can have no reason phrase
+				}
+				mStartLine[1] = { uint32_t(_line.begin + firstSpace + 1), uint32_t(secondSpace - firstSpace - 1) };
+				size_t lastStart = std::min(line.size(), secondSpace + 1);
+				mStartLine[2] = { uint32_t(_line.begin + lastStart), uint32_t(line.size() - lastStart) };
+				if (!mStartLine[1].size)
+					return false;
+
+				if (mType == Type::Request) {
+					auto method = view(mStartLine[0]);
+					for (char c : method)
+						if (c < 'A' || c > 'Z')
+							return false;
+					if (view(mStartLine[2]).find(' ') != std::string_view::npos)
+						return false;
+				}
+				else {
+					size_t code;
+					if (!parseSize(view(mStartLine[1]), 999, code) || code < 100 || code > 999)
+						return false;
+					mStatusCode = unsigned(code);
+				}
+				auto version = this->version();
+				if (version.substr(0, 5) != "HTTP/")
+					return false;
+				mKeepAlive = version != "HTTP/1.0"; // Persistent unless told otherwise, since 1.1
+				return true;
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			Parser::Result Parser::parseHeader(Span _line) {
+				std::string_view line = view(_line);
+				if (line.front() == ' ' || line.front() == '\t') // Folded lines are obsolete
+					return fail(Error::Malformed);
+				size_t colon = line.find(':');
+				if (colon == std::string_view::npos || colon == 0)
+					return fail(Error::Malformed);
+				std::string_view name = line.substr(0, colon);
+				if (name.find_first_of(" \t") != std::string_view::npos)
+					return fail(Error::Malformed);
+				std::string_view value = trim(line.substr(colon + 1));
+				if (mNumHeaders == cMaxHeaders)
+					return fail(Error::TooManyHeaders);
+				auto& header = mHeaders[mNumHeaders++];
+				header.name = { _line.begin, uint32_t(colon) };
+				header.value = { uint32_t(value.data() - mBase), uint32_t(value.size()) };
+
+				// Headers that decide how the message is framed
+				if (equalsNoCase(name, "content-length")) {
+					size_t length;
+					if (!parseSize(value, cMaxBodySize, length) || (mHasLength && length != mContentLength))
+						return fail(Error::Malformed);
+					if (length > cMaxBodySize)
+						return fail(Error::BodyTooLarge);
+					mContentLength = length;
+					mHasLength = true;
+				}
+				else if (equalsNoCase(name, "transfer-encoding")) {
+					// Chunked must be the last encoding applied, or there's no way to tell where the body ends
+					size_t lastComma = value.rfind(',');
+					auto lastCoding = trim(lastComma == std::string_view::npos ? value : value.substr(lastComma + 1));
+					if (!equalsNoCase(lastCoding, "chunked"))
+						return fail(Error::Malformed);
+					mChunked = true;
+				}
+				else if (equalsNoCase(name, "connection")) {
+					if (hasToken(value, "close"))
+						mKeepAlive = false;
+					else if (hasToken(value, "keep-alive"))
+						mKeepAlive = true;
+				}
+				return Result::Incomplete;
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			Parser::Result Parser::parseChunkSize(Span _line) {
+				std::string_view line = view(_line);
+				line = trim(line.substr(0, line.find(';'))); // Ignore chunk extensions
+				if (line.empty())
+					return fail(Error::Malformed);
+				size_t size = 0;
+				for (char c : line) {
+					int digit = (c >= '0' && c <= '9') ? c - '0' : (lowerCase(c) >= 'a' && lowerCase(c) <= 'f') ? lowerCase(c) - 'a' + 10 : -1;
+					if (digit < 0)
+						return fail(Error::Malformed);
+					size = size * 16 + digit;
+					if (size > cMaxBodySize)
+						return fail(Error::BodyTooLarge);
+				}
+				if (size == 0) {
+					mState = State::Trailers;
+					mTrailersBegin = mCursor;
+					return Result::Incomplete;
+				}
+				mBodySize += size;
+				if (mBodySize > cMaxBodySize)
+					return fail(Error::BodyTooLarge);
+				mBodyChunks.push_back({ uint32_t(mCursor), uint32_t(size) });
+				mRemaining = size;
+				mState = State::ChunkData;
+				return Result::Incomplete;
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			Parser::Result Parser::endHeaders() {
+				if (mChunked) {
+					if (mHasLength) // Ambiguous framing, a classic for request smuggling
+						return fail(Error::Malformed);
+					mState = State::ChunkSize;
+					return Result::Incomplete;
+				}
+				bool noBody = mType == Type::Request || mStatusCode < 200 || mStatusCode == 204 || mStatusCode == 304;
+				if (mHasLength || noBody) {
+					mBodySize = mHasLength ? mContentLength : 0;
+					if (mBodySize)
+						mBodyChunks.push_back({ uint32_t(mCursor), uint32_t(mBodySize) });
+					mRemaining = mBodySize;
+					mState = mBodySize ? State::Body : State::Complete;
+					return mBodySize ? Result::Incomplete : Result::Complete;
+				}
+				// Responses without a length end with the connection
+				mBodyChunks.push_back({ uint32_t(mCursor), 0 });
+				mKeepAlive = false;
+				mState = State::UntilClose;
+				return Result::Incomplete;
+			}
+
+			//----------------------------------------------------------------------------------------------------------
+			Parser::Result Parser::fail(Error _error) {
+				mError = _error;
+				mState = State::Error;
+				return Result::Error;
+			}
+
+}	}	}	// namespace rev::net::http
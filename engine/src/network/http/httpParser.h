@@ -0,0 +1,151 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace rev {
+	namespace net {
+		namespace http {
+
+			/// Incremental http/1.1 message parser, over a buffer owned by the caller.
+			/// The buffer must start at the first byte of the message, and can grow between calls to parse() as data
+			/// arrives. Each call only looks at the bytes that weren't parsed before.
+			/// Nothing is copied: the parser keeps offsets into the buffer, and the views it returns point into
+			/// the buffer passed to the last call to parse(). Calling parse() on a complete message just moves the
+			/// views to the new buffer.
+			class Parser {
+			public:
+				enum class Type {
+					Request,
+					Response
+				};
+
+				enum class Result {
+					Incomplete,
+					Complete,
+					Error
+				};
+
+				enum class Error {
+					None,
+					Malformed,
+					TooManyHeaders,
+					HeaderTooLarge,
+					BodyTooLarge
+				};
+
+				static constexpr size_t cMaxHeaders = 32;
+				static constexpr size_t cMaxHeaderSize = 64 * 1024;
+				static constexpr size_t cMaxBodySize = 16 * 1024 * 1024;
+
+				explicit Parser(Type _type = Type::Request) : mType(_type) {}
+
+				Result	parse(std::string_view _buffer);
+				/// Responses without a known length last until the connection is closed. Call this when that happens.
+				Result	finish(std::string_view _buffer);
+				/// Get ready for the next message. Keeps the memory allocated for body chunks.
+				void	reset();
+
+				Result	result() const;
+				Error	error() const { return mError; }
+				/// Bytes of the buffer taken by the message. Anything after them belongs to the next one.
+				size_t	messageSize() const { return mCursor; }
+				/// Whether the connection can be used for more messages after this one
+				bool	keepAlive() const { return mKeepAlive; }
+
+				// Start line
+				std::string_view	method() const { return view(mStartLine[0]); }
+				std::string_view	url() const { return view(mStartLine[1]); }
+				std::string_view	version() const { return view(mStartLine[mType == Type::Request ? 2 : 0]); }
+				unsigned			statusCode() const { return mStatusCode; }
+				std::string_view	reason() const { return view(mStartLine[2]); }
+
+				// Headers, in order of appearance
+				size_t				numHeaders() const { return mNumHeaders; }
+				std::string_view	headerName(size_t i) const { return view(mHeaders[i].name); }
+				std::string_view	headerValue(size_t i) const { return view(mHeaders[i].value); }
+				/// Value of the first header with the given name, compared case insensitively. Empty if there's none.
+				std::string_view	header(std::string_view _name) const;
+
+				// Body. Chunked bodies are split in as many views as chunks were sent, others take a single view.
+				size_t				bodySize() const { return mBodySize; }
+				size_t				numBodyChunks() const { return mBodyChunks.size(); }
+				std::string_view	bodyChunk(size_t i) const { return view(mBodyChunks[i]); }
+
+			private:
+				struct Span {
+					uint32_t begin = 0;
+					uint32_t size = 0;
+				};
+
+				struct HeaderSpan {
+					Span name;
+					Span value;
+				};
+
+				enum class State {
+					StartLine,
+					Headers,
+					Body,
+					ChunkSize,
+					ChunkData,
+					ChunkEnd,
+					Trailers,
+					UntilClose,
+					Complete,
+					Error
+				};
+
+				std::string_view	view(Span _s) const { return std::string_view(mBase + _s.begin, _s.size); }
+				bool				nextLine(std::string_view _buffer, Span& _line);
+				Result				parseLine(Span _line);
+				bool				parseStartLine(Span _line);
+				Result				parseHeader(Span _line);
+				Result				parseChunkSize(Span _line);
+				Result				endHeaders();
+				Result				fail(Error);
+
+				const char*	mBase = nullptr;
+				Type		mType;
+				State		mState = State::StartLine;
+				Error		mError = Error::None;
+				size_t		mCursor = 0; // Everything before this has been parsed
+				size_t		mScanned = 0; // Searched for a line end without finding one up to here
+				size_t		mTrailersBegin = 0;
+
+				Span		mStartLine[3];
+				unsigned	mStatusCode = 0;
+				std::array<HeaderSpan, cMaxHeaders>	mHeaders;
+				size_t		mNumHeaders = 0;
+
+				std::vector<Span>	mBodyChunks;
+				size_t		mBodySize = 0;
+				size_t		mContentLength = 0;
+				size_t		mRemaining = 0; // Left to receive from the body or the current chunk
+				bool		mHasLength = false;
+				bool		mChunked = false;
+				bool		mKeepAlive = true;
+			};
+
+}	}	}	// namespace rev::net::http
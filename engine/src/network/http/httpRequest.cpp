@@ -5,8 +5,9 @@
 #include "httpRequest.h"
 
 #include <cassert>
+#include <cctype>
+#include <cstring>
 #include <iostream>
-#include <sstream>
 
 using namespace std;
 
@@ -14,75 +15,153 @@ namespace rev {
 	namespace net {
 		namespace http {
 
+			//----------------------------------------------------------------------------------------------------------------------
+			namespace {
+				const char* methodName(Request::METHOD _method) {
+					switch (_method)
+					{
+					case Request::Get:
+						return "GET";
+					case Request::Post:
+						return "POST";
+					case Request::Put:
+						return "PUT";
+					default:
+						assert(false);
+						return "GET";
+					}
+				}
+			}
+
 			//----------------------------------------------------------------------------------------------------------------------
 			Request::Request(METHOD _method, const string& _url, // Status line
 				const string& _body) // Body
-				:mMethod(_method)
-				, mUrl(_url)
+				: Request(_method, _url, "", _body)
 			{
-				setBody(_body);
-				setReady();
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
-			Request::Request(const string& _raw) {
-				// Break the string into parts
-				this->operator<<(_raw);
+			Request::Request(METHOD _method, const string& _url, const string& _headers, const string& _body) {
+				mBuffer = string(methodName(_method)) + " " + _url + " HTTP/1.1\r\n"
+					+ _headers
+					+ "Content-Length: " + to_string(_body.size()) + "\r\n\r\n"
+					+ _body;
+				mParser.parse(mBuffer);
+				assert(isComplete());
+				finishParsing();
+			}
+
+			//----------------------------------------------------------------------------------------------------------------------
+			Request::Request(const string& _raw)
+				: mBuffer(_raw)
+			{
+				// Incomplete requests keep an empty body, so nothing points past the end of the buffer
+				if (mParser.parse(mBuffer) != Parser::Result::Complete) {
+					cout << "Error: Unable to parse http request\n";
+					return;
+				}
+				finishParsing();
+			}
+
+			//----------------------------------------------------------------------------------------------------------------------
+			Request::Request(std::string&& _buffer, Parser&& _parsed)
+				: mBuffer(std::move(_buffer))
+				, mParser(std::move(_parsed))
+			{
+				assert(mParser.result() == Parser::Result::Complete);
+				rebind(); // Moving a short string moves its contents too
+				finishParsing();
+			}
+
+			//----------------------------------------------------------------------------------------------------------------------
+			Request::Request(const Request& _other)
+				: mBuffer(_other.mBuffer)
+				, mParser(_other.mParser)
+				, mMethod(_other.mMethod)
+				, mBodyBegin(_other.mBodyBegin)
+				, mBodySize(_other.mBodySize)
+			{
+				rebind();
+			}
+
+			//----------------------------------------------------------------------------------------------------------------------
+			Request::Request(Request&& _other)
+				: mBuffer(std::move(_other.mBuffer))
+				, mParser(std::move(_other.mParser))
+				, mMethod(_other.mMethod)
+				, mBodyBegin(_other.mBodyBegin)
+				, mBodySize(_other.mBodySize)
+			{
+				rebind();
+			}
+
+			//----------------------------------------------------------------------------------------------------------------------
+			Request& Request::operator=(const Request& _other) {
+				mBuffer = _other.mBuffer;
+				mParser = _other.mParser;
+				mMethod = _other.mMethod;
+				mBodyBegin = _other.mBodyBegin;
+				mBodySize = _other.mBodySize;
+				rebind();
+				return *this;
+			}
+
+			//----------------------------------------------------------------------------------------------------------------------
+			Request& Request::operator=(Request&& _other) {
+				mBuffer = std::move(_other.mBuffer);
+				mParser = std::move(_other.mParser);
+				mMethod = _other.mMethod;
+				mBodyBegin = _other.mBodyBegin;
+				mBodySize = _other.mBodySize;
+				rebind();
+				return *this;
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
 			Request Request::jsonRequest(METHOD _method, const std::string& _url, const Json& _payload) {
-				Request r(_method, _url, "");
-				r.headers()["Content-Type"] = "application/json; charset=UTF-8";
-				r.setBody(_payload.dump());
-				return r;
+				return Request(_method, _url, "Content-Type: application/json; charset=UTF-8\r\n", _payload.dump());
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
-			int Request::processMessageLine(const std::string& _requestLine) {
-				unsigned methodLen = _requestLine.find(" ");
-				string method = _requestLine.substr(0, methodLen);
-				if (method == "GET")
-					mMethod = Get;
-				else if (method == "POST")
-					mMethod = Post;
-				else if (method == "PUT")
-					mMethod = Put;
-				else {
-					cout << "Error: Unsupported method parsing http request\n"
-						<< method << "\n";
-					return -1;
+			string Request::serialize() const {
+				bool chunked = !mParser.header("Transfer-Encoding").empty();
+				string serial;
+				serial.reserve(mParser.messageSize());
+				serial.append(mParser.method()).append(" ").append(mParser.url()).append(" ").append(mParser.version()).append("\r\n");
+				for (size_t i = 0; i < mParser.numHeaders(); ++i) {
+					auto name = mParser.headerName(i);
+					string lowerName(name);
+					for (auto& c : lowerName)
+						c = (char)tolower((unsigned char)c);
+					if (chunked && lowerName == "transfer-encoding")
+						continue;
+					serial.append(name).append(": ").append(mParser.headerValue(i)).append("\r\n");
 				}
-
-				unsigned urlEnd = _requestLine.find(" ", methodLen + 1);
-				if (urlEnd == string::npos)
-					return -1;
-				mUrl = _requestLine.substr(methodLen + 1, urlEnd - methodLen - 1);
-				if (mUrl.empty())
-					return -1;
-				return _requestLine.size();
+				if (chunked)
+					serial.append("Content-Length: ").append(to_string(mBodySize)).append("\r\n");
+				serial.append("\r\n");
+				serial.append(body());
+				return serial;
 			}
 
 			//----------------------------------------------------------------------------------------------------------------------
-			void Request::serializeMessageLine(string& _dst) const {
-				stringstream statusLine;
-				switch (mMethod)
-				{
-				case Get:
-					statusLine << "GET";
-					break;
-				case Post:
-					statusLine << "POST";
-					break;
-				case Put:
-					statusLine << "PUT";
-					break;
-				default:
-					assert(false);
-					break;
+			void Request::finishParsing() {
+				auto method = mParser.method();
+				mMethod = method == "GET" ? Get : method == "POST" ? Post : method == "PUT" ? Put : Other;
+
+				// Chunked bodies are joined in place, so handlers get a single view
+				size_t numChunks = mParser.numBodyChunks();
+				if (!numChunks)
+					return;
+				char* dst = mBuffer.data() + (mParser.bodyChunk(0).data() - mBuffer.data());
+				mBodyBegin = dst - mBuffer.data();
+				mBodySize = mParser.bodySize();
+				for (size_t i = 0; i < numChunks; ++i) {
+					auto chunk = mParser.bodyChunk(i);
+					if (chunk.data() != dst)
+						memmove(dst, chunk.data(), chunk.size());
+					dst += chunk.size();
 				}
-				statusLine << " " << mUrl << " HTTP/1.1\r\n";
-				_dst.append(statusLine.str());
 			}
 
 }	}	}	// namespace rev::net::http
\ No newline at end of file
@@ -5,42 +5,64 @@
 #pragma once
 
 #include <string>
-#include <unordered_map>
-#include <vector>
-#include "httpMessage.h"
+#include <string_view>
+#include "httpParser.h"
 #include <nlohmann/json.hpp>
 
 namespace rev {
 	namespace net {
 		namespace http {
 
-			class Request : public Message {
+			/// Requests keep the raw message, and access its parts through views into it.
+			class Request {
 			public:
 				using Json = nlohmann::json;
 
 				enum METHOD {
 					Get,
 					Post,
-					Put
+					Put,
+					Other
 				};
 				// Construction
 				Request(METHOD, const std::string& _url, // Status line
 					const std::string& _body); // Body
 				Request(const std::string& _rawRequest);
-				virtual ~Request() = default;
+				/// Take over a buffer holding a complete request that has already been parsed. Nothing is copied.
+				/// The buffer can hold more data after the request. It will be ignored.
+				Request(std::string&& _buffer, Parser&& _parsed);
 
-				// Accessors
+				Request(const Request&);
+				Request(Request&&);
+				Request& operator=(const Request&);
+				Request& operator=(Request&&);
+
+				// Accessors. Views are valid as long as the request is.
+				bool				isComplete() const { return mParser.result() == Parser::Result::Complete; }
 				METHOD				method() const { return mMethod; }
-				const std::string&	url() const { return mUrl; }
+				std::string_view	url() const { return mParser.url(); }
+				std::string_view	header(std::string_view _name) const { return mParser.header(_name); }
+				std::string_view	body() const { return std::string_view(mBuffer.data() + mBodyBegin, mBodySize); }
+				/// All headers, in order. Body chunks are no longer valid, use body() instead.
+				const Parser&		parser() const { return mParser; }
+				// Wether this message specifies that the connection must be closed.
+				bool				requiresClose() const { return !mParser.keepAlive(); }
+				/// Rebuilt from the parsed message, so data after it in the buffer is left out.
+				/// Chunked bodies are joined, and delimited by Content-Length instead.
+				std::string			serialize() const;
 
 				static Request		jsonRequest(METHOD, const std::string& _url, const Json& _payload);
 
 			private:
-				int		processMessageLine(const std::string& _raw) override;
-				void	serializeMessageLine(std::string& _dst) const override;
+				Request(METHOD, const std::string& _url, const std::string& _headers, const std::string& _body);
+				void	finishParsing();
+				void	rebind() { mParser.parse(mBuffer); }
 
 			private:
-				METHOD mMethod;
-				std::string mUrl;
+				std::string	mBuffer;
+				Parser		mParser;
+				METHOD		mMethod = Other;
+				size_t		mBodyBegin = 0;
+				size_t		mBodySize = 0;
 			};
 }}}
\ No newline at end of file
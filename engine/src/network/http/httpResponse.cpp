@@ -3,11 +3,11 @@
 // Created by Carmelo J. Fdez-Agera Tortosa (a.k.a. Technik)
 //----------------------------------------------------------------------------------------------------------------------
 #include "httpResponse.h"
+#include "httpParser.h"
 
 #include <cstdlib>
 #include <cassert>
 #include <sstream>
-#include <core/platform/fileSystem/file.h>
 
 using namespace std;
 
@@ -17,10 +17,11 @@ namespace rev {
 
 			//----------------------------------------------------------------------------------------------------------
 			Response::Response(const string& _rawResponse) {
-				if(_rawResponse.size() >= 2 && _rawResponse.back() == '\n' && _rawResponse[_rawResponse.size()-2] == '\r')
-					this->operator<<(_rawResponse);
-				else
-					this->operator<<(_rawResponse+"\r\n");
+				Parser parser(Parser::Type::Response);
+				if (parse(_rawResponse, parser)) {
+					mStatusCode = parser.statusCode();
+					mStatusDesc = parser.reason();
+				}
 			}
 
 			//------------------------------------------------------------------------------------------------------------------
@@ -49,21 +50,24 @@ namespace rev {
 			Response Response::jsonResponse(const Json& _payload, unsigned _code) {
 				Response r(_code, shortDesc(_code));
 				r.setBody(_payload.dump());
-				r.headers()["Content-type"] = "application/json";
+				r.headers()["Content-Type"] = "application/json";
 				return r;
 			}
 
 			//------------------------------------------------------------------------------------------------------------------
 			Response Response::htmlResponse(const string& _fileName, unsigned _code) {
-				// Open file
-				auto pageFile = core::File::manager()->get(_fileName);
-				if (pageFile) {
-					Response r(_code, shortDesc(_code));
-					r.setBody(pageFile->bufferAsText());
-					r.headers()["Content-type"] = "text/html";
-					return r;
-				}
-				else return response404();
+				return fileResponse(_fileName, "text/html", _code);
+			}
+
+			//------------------------------------------------------------------------------------------------------------------
+			Response Response::fileResponse(const string& _fileName, const string& _contentType, unsigned _code) {
+				auto file = OpenFile::open(_fileName);
+				if (!file)
+					return response404();
+				Response r(_code, shortDesc(_code));
+				r.setBody(file, 0, file->size());
+				r.headers()["Content-Type"] = _contentType;
+				return r;
 			}
 
 			//------------------------------------------------------------------------------------------------------------------
@@ -71,25 +75,20 @@ namespace rev {
 				switch (_code) {
 				case 200:
 					return "Ok";
+				case 400:
+					return "Bad Request";
 				case 404:
 					return "Not Found";
+				case 413:
+					return "Payload Too Large";
+				case 431:
+					return "Request Header Fields Too Large";
 				default:
 					assert(false);
 					return "";
 				}
 			}
 
-			//------------------------------------------------------------------------------------------------------------------
-			int Response::processMessageLine(const string& _status) {
-				const string separators = " \t\n\r";
-				unsigned versionEnd = _status.find_first_of(separators);
-				unsigned codeStart = _status.find_first_not_of(separators, versionEnd + 1);
-				mStatusCode = (unsigned)atoi(_status.substr(codeStart).c_str());
-				unsigned codeEnd = _status.find_first_of(separators, codeStart + 1);
-				mStatusDesc = _status.substr(codeEnd + 1);
-				return _status.size();
-			}
-
 			//------------------------------------------------------------------------------------------------------------------
 			void Response::serializeMessageLine(std::string& _serial) const {
 				std::stringstream serial;
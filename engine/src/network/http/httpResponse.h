@@ -29,13 +29,14 @@ namespace rev {
 				static Response		response404(const std::string& _custimMessage = "Error 404: Not found");
 				static Response		jsonResponse(const Json& _payload, unsigned _code = 200);
 				static Response		htmlResponse(const std::string& _fileName, unsigned _code = 200);
+				/// The file is sent straight from disk when responding, it's never loaded into memory
+				static Response		fileResponse(const std::string& _fileName, const std::string& _contentType, unsigned _code = 200);
 
 			private:
 				static	std::string	shortDesc(unsigned _code);
-				int		processMessageLine(const std::string& _raw) override;
 				void	serializeMessageLine(std::string& dst) const override;
 
-				unsigned mStatusCode;
+				unsigned mStatusCode = 0;
 				std::string mStatusDesc;
 			};
 
@@ -5,6 +5,7 @@
 #include "httpServer.h"
 
 #include <cassert>
+#include <core/tasks/jobSystem.h>
 #include <network/socket/socketServer.h>
 
 #include "httpRequest.h"
@@ -20,17 +21,18 @@ namespace rev {
 		namespace http {
 
 			//----------------------------------------------------------------------------------------------------------
-			void Server::init(unsigned _port) {
+			void Server::init(unsigned _port, core::JobSystem* _jobs) {
 				if(mSocket)
 					delete mSocket;
-				mSocket = new SocketServer(_port);
+				mJobs = _jobs;
+				SocketServer::Handlers handlers;
+				handlers.onConnect = [this](unsigned _conId) { onNewConnection(_conId); };
+				handlers.onData = [this](unsigned _conId, const char* _data, size_t _size) { onData(_conId, _data, _size); };
+				handlers.onClose = [this](unsigned _conId) { onClose(_conId); };
+				handlers.onPeerClosed = [this](unsigned _conId) { onPeerClosed(_conId); };
+				mSocket = new SocketServer(_port, handlers);
 				assert(mSocket);
-				std::cout << "Http server listening on port " << _port << "\n";
-
-				// Set default responder to http requests
-				mSocket->setConnectionHandler([this](Socket* _connection) {
-					onNewConnection(_connection);
-				});
+				std::cout << "Http server listening on port " << mSocket->port() << "\n";
 			}
 
 			//------------------------------------------------------------------------------------------------------------------
@@ -39,70 +41,200 @@ namespace rev {
 					delete mSocket;
 			}
 
+			//------------------------------------------------------------------------------------------------------------------
+			unsigned Server::port() const {
+				return mSocket ? mSocket->port() : 0;
+			}
+
 			//------------------------------------------------------------------------------------------------------------------
 			void Server::respond(unsigned _conId, const Response& _response) {
-				mConnections[_conId]->write(_response.serialize());
+				// Persistent connections need every response to state its length
+				Payload payload;
+				if (_response.headers().count(Message::cContentLengthLabel))
+					payload = _response.payload();
+				else {
+					Response sized = _response;
+					sized.headers()[Message::cContentLengthLabel] = to_string(_response.bodySize());
+					payload = sized.payload();
+				}
+
+				{
+					lock_guard<mutex> guard(mLock);
+					auto iter = mConnections.find(_conId);
+					if (iter == mConnections.end()) // The client went away
+						return;
+					// Sent while locked, so the response to the next pipelined request can't overtake this one
+					mSocket->send(_conId, std::move(payload));
+					Connection& con = iter->second;
+					con.busy = false;
+					if (con.closeAfterResponse) {
+						mSocket->close(_conId);
+						mConnections.erase(iter);
+						return;
+					}
+					if (con.dispatching) // That thread will pick up the next request
+						return;
+				}
+				processInput(_conId);
 			}
 
 			//------------------------------------------------------------------------------------------------------------------
 			void Server::setResponder(const std::string& _url, UrlHandler _handler) {
 				assert(_url[0] == '/');
+				lock_guard<mutex> guard(mLock);
 				mHandlers[_url] = _handler;
 			}
 			
 			//------------------------------------------------------------------------------------------------------------------
 			void Server::setResponder(const std::string& _url, const http::Response& _handler) {
-				assert(_url[0] == '/');
 				http::Response response = _handler;
-				mHandlers[_url] = [=](Server* _srv, unsigned _conId, const http::Request&) {
+				setResponder(_url, [=](Server* _srv, unsigned _conId, const http::Request&) {
 					_srv->respond(_conId, response);
-				};
+				});
+			}
+
+			//------------------------------------------------------------------------------------------------------------------
+			void Server::onNewConnection(unsigned _conId) {
+				lock_guard<mutex> guard(mLock);
+				mConnections[_conId] = Connection();
+			}
+
+			//------------------------------------------------------------------------------------------------------------------
+			void Server::onData(unsigned _conId, const char* _data, size_t _size) {
+				{
+					lock_guard<mutex> guard(mLock);
+					auto iter = mConnections.find(_conId);
+					if (iter == mConnections.end())
+						return;
+					Connection& con = iter->second;
+					if (con.discardInput)
+						return;
+					// The parser bounds the request being read, but nothing consumes input while a request is being
+					// handled. A client that keeps pipelining without reading its responses would grow it forever.
+					if (con.busy && con.input.size() + _size > cMaxBufferedInput) {
+						con.input.clear();
+						con.discardInput = true;
+						con.closeAfterResponse = true;
+						return;
+					}
+					con.input.append(_data, _size);
+				}
+				processInput(_conId);
+			}
+
+			//------------------------------------------------------------------------------------------------------------------
+			void Server::onClose(unsigned _conId) {
+				lock_guard<mutex> guard(mLock);
+				mConnections.erase(_conId);
 			}
 
 			//------------------------------------------------------------------------------------------------------------------
-			void Server::onNewConnection(Socket* _connection) {
-				// Generate a connection identifier
-				unsigned conId = unsigned(long(_connection));
-				mConnections[conId] = _connection;
-				// Retrieve request
-				std::string message;
-				const unsigned buffSize = 2 * 1024;
-				char buffer[buffSize];
-				unsigned len = _connection->read(buffer, buffSize);
-				if (len > 0) {
-					message.append(buffer, len);
-					Request petition = Request(message);
-
-					// Locate proper responder
-					if (!dispatchPetition(this, petition.url(), conId, petition))
-						sendError404(_connection);
+			void Server::onPeerClosed(unsigned _conId) {
+				{
+					lock_guard<mutex> guard(mLock);
+					auto iter = mConnections.find(_conId);
+					if (iter == mConnections.end())
+						return;
+					iter->second.peerClosed = true;
 				}
-				// Clean up
-				_connection->close();
-				mConnections.erase(mConnections.find(conId));
-				delete _connection;
+				processInput(_conId); // Closes the connection once the requests already received are answered
 			}
 
 			//------------------------------------------------------------------------------------------------------------------
-			void Server::sendError404(Socket* _connection) const {
-				std::string notFound = "HTTP/1.1 404 Not Found\r\n\r\nThe Url you are requesting is not available\r\n";
-				_connection->write(notFound.size(), notFound.c_str());
+			void Server::processInput(unsigned _conId) {
+				unique_lock<mutex> guard(mLock);
+				auto iter = mConnections.find(_conId);
+				if (iter == mConnections.end() || iter->second.dispatching)
+					return;
+				iter->second.dispatching = true;
+				for (;;) {
+					Connection& con = iter->second;
+					if (con.busy)
+						break;
+					auto result = con.parser.parse(con.input);
+					if (result == Parser::Result::Incomplete) {
+						if (con.peerClosed) { // Nothing else will arrive
+							mSocket->close(_conId);
+							mConnections.erase(iter);
+							return;
+						}
+						break;
+					}
+
+					// Only take the request out while locked. Handling it can happen without blocking other connections
+					con.busy = true;
+					shared_ptr<Request> request;
+					auto error = con.parser.error();
+					if (result == Parser::Result::Complete) {
+						con.closeAfterResponse = !con.parser.keepAlive();
+						// The request keeps the buffer it was parsed from. Only pipelined data after it, or the request
+						// itself if that's smaller, needs to be copied.
+						size_t requestSize = con.parser.messageSize();
+						string buffer;
+						if (con.input.size() - requestSize <= requestSize) {
+							buffer.swap(con.input);
+							con.input.assign(buffer, requestSize, string::npos);
+						}
+						else {
+							buffer.assign(con.input, 0, requestSize);
+							con.input.erase(0, requestSize);
+						}
+						request = make_shared<Request>(std::move(buffer), std::move(con.parser));
+					}
+					else { // Nothing else on this connection can be trusted
+						con.closeAfterResponse = true;
+						con.input.clear();
+					}
+					con.parser.reset();
+					guard.unlock();
+
+					if (request) {
+						if (mJobs)
+							mJobs->schedule([this, _conId, request]() { handleRequest(_conId, *request); });
+						else
+							handleRequest(_conId, *request);
+					}
+					else if (error == Parser::Error::BodyTooLarge)
+						respond(_conId, Response(413, "Payload Too Large"));
+					else if (error == Parser::Error::HeaderTooLarge || error == Parser::Error::TooManyHeaders)
+						respond(_conId, Response(431, "Request Header Fields Too Large"));
+					else
+						respond(_conId, Response(400, "Bad Request"));
+					guard.lock();
+
+					iter = mConnections.find(_conId);
+					if (iter == mConnections.end())
+						return;
+				}
+				iter->second.dispatching = false;
 			}
 
 			//------------------------------------------------------------------------------------------------------------------
-			bool Server::dispatchPetition(Server* _server, const std::string& _url, unsigned _conId, const Request& _petition) {
+			void Server::handleRequest(unsigned _conId, const Request& _request) {
+				if (!dispatchPetition(this, _request.url(), _conId, _request))
+					respond(_conId, Response::response404("The Url you are requesting is not available"));
+			}
+
+			//------------------------------------------------------------------------------------------------------------------
+			bool Server::dispatchPetition(Server* _server, std::string_view _url, unsigned _conId, const Request& _petition) {
 				if (_url.empty())
 					return false;
-				string key = _url[0] == '/' ? _url : (string("/") + _url); // Always start with a slash
+				string key = _url[0] == '/' ? string(_url) : (string("/") + string(_url)); // Always start with a slash
 				while (!key.empty()) {
 					// Try key
-					auto iter = mHandlers.find(key);
-					if (iter != mHandlers.end()) {
-						iter->second(_server, _conId, _petition); // Invoke handler
+					UrlHandler handler;
+					{
+						lock_guard<mutex> guard(mLock);
+						auto iter = mHandlers.find(key);
+						if (iter != mHandlers.end())
+							handler = iter->second;
+					}
+					if (handler) {
+						handler(_server, _conId, _petition); // Invoke handler
 						return true;
 					}
 					// Not found, keep decomposing the url
-					unsigned lastSlash = key.find_last_of('/');
+					size_t lastSlash = key.find_last_of('/');
 					key = key.substr(0, lastSlash);
 				}
 				return false;
@@ -5,15 +5,19 @@
 #pragma once
 
 #include <functional>
-#include <string>
-
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include "httpParser.h"
 
 namespace rev {
+	namespace core {
+		class JobSystem;
+	}
+
 	namespace net {
 
-		class Socket;
 		class SocketServer;
 
 		namespace http {
@@ -21,29 +25,56 @@ namespace rev {
 			class Request;
 			class Response;
 
+			/// HTTP/1.1 server with keep-alive and pipelining.
+			/// Requests are parsed as data arrives, and rejected once they exceed the parser's limits. Valid ones are
+			/// handed to their responders either on the socket's event loop, or on the job system when one is provided.
+			/// Requests pipelined on the same connection are handled one at a time, so responses go out in order.
 			class Server {
 			public:
 				~Server();
 
-				void init(unsigned _port);
+				/// Port 0 binds to any free port. See port()
+				void init(unsigned _port, core::JobSystem* _jobs = nullptr);
+				unsigned port() const;
 
-				/// Send response to an active connection
+				/// Send response to an active connection. Every request must be responded exactly once,
+				/// either from inside its handler or later on, from any thread.
 				void respond(unsigned _connection, const Response&);
 
 				typedef std::function<void(Server*, unsigned _conId, const Request&)> UrlHandler;
 				void setResponder(const std::string& _url, UrlHandler _responder);
 				void setResponder(const std::string& _url, const http::Response&); // Sets static response for an url
 
+				/// Data a connection can buffer while its current request is being handled.
+				/// Clients that pipeline past this without reading their responses are disconnected after the current one.
+				static constexpr size_t cMaxBufferedInput = Parser::cMaxHeaderSize + Parser::cMaxBodySize;
+
 			private:
-				void onNewConnection(Socket* _socket);
-				void sendError404(Socket* _connection) const;
-				bool dispatchPetition(Server*, const std::string& _url, unsigned _conId, const Request& _petition);
+				struct Connection {
+					std::string	input; // Received data not consumed by any request yet
+					Parser		parser; // Incrementally parsing the request at the start of input
+					bool		busy = false; // Waiting for a response
+					bool		dispatching = false; // Some thread is inside processInput for this connection
+					bool		closeAfterResponse = false;
+					bool		peerClosed = false; // The client won't send more requests
+					bool		discardInput = false; // Buffered too much while busy. Closing after the current response
+				};
+
+				void onNewConnection(unsigned _conId);
+				void onData(unsigned _conId, const char* _data, size_t _size);
+				void onClose(unsigned _conId);
+				void onPeerClosed(unsigned _conId);
+				void processInput(unsigned _conId);
+				void handleRequest(unsigned _conId, const Request& _request);
+				bool dispatchPetition(Server*, std::string_view _url, unsigned _conId, const Request& _petition);
 
 			private:
-				SocketServer*	mSocket = nullptr;
+				SocketServer*		mSocket = nullptr;
+				core::JobSystem*	mJobs = nullptr;
 
+				std::mutex	mLock;
 				std::unordered_map<std::string, UrlHandler>	mHandlers;
-				std::unordered_map<unsigned, Socket*>		mConnections;
+				std::unordered_map<unsigned, Connection>	mConnections;
 			};
 
 		}	// namespace http
@@ -0,0 +1,225 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "payload.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#else
+#include <vector>
+#endif // __linux__
+#ifdef _WIN32
+#include <io.h>
+#endif // _WIN32
+
+namespace rev {
+	namespace net {
+
+		//------------------------------------------------------------------------------------------------------------------
+		std::shared_ptr<const OpenFile> OpenFile::open(const std::string& _path) {
+			// Keep the descriptor out of child processes
+#ifdef _WIN32
+			int desc = ::_open(_path.c_str(), _O_RDONLY | _O_BINARY | _O_NOINHERIT);
+#else
+			int desc = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif // _WIN32
+			if (desc < 0)
+				return nullptr;
+			struct stat fileStats;
+			if (fstat(desc, &fileStats) < 0 || !S_ISREG(fileStats.st_mode)) {
+				::close(desc);
+				return nullptr;
+			}
+			return std::shared_ptr<const OpenFile>(new OpenFile(desc, (size_t)fileStats.st_size));
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		OpenFile::~OpenFile() {
+			::close(mDesc);
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		bool OpenFile::read(size_t _offset, size_t _size, char* _dst) const {
+			if (_offset + _size > mSize)
+				return false;
+#ifdef __linux__
+			while (_size) {
+				auto len = pread(mDesc, _dst, _size, (off_t)_offset);
+				if (len < 0 && errno == EINTR)
+					continue;
+				if (len <= 0)
+					return false;
+				_dst += len;
+				_offset += (size_t)len;
+				_size -= (size_t)len;
+			}
+			return true;
+#else
+			if (lseek(mDesc, (long)_offset, SEEK_SET) < 0)
+				return false;
+			return ::read(mDesc, _dst, (unsigned)_size) == (int)_size;
+#endif // __linux__
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void Payload::append(std::string _data) {
+			if (_data.empty())
+				return;
+			Piece piece;
+			piece.size = _data.size();
+			piece.owned = std::move(_data);
+			mSize += piece.size;
+			mPieces.push_back(std::move(piece));
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void Payload::append(std::shared_ptr<const void> _owner, std::string_view _data) {
+			assert(_owner);
+			if (_data.empty())
+				return;
+			Piece piece;
+			piece.owner = std::move(_owner);
+			piece.data = _data.data();
+			piece.size = _data.size();
+			mSize += piece.size;
+			mPieces.push_back(std::move(piece));
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void Payload::append(std::shared_ptr<const OpenFile> _file, size_t _offset, size_t _size) {
+			assert(_file && _offset + _size <= _file->size());
+			if (!_size)
+				return;
+			Piece piece;
+			piece.file = std::move(_file);
+			piece.offset = _offset;
+			piece.size = _size;
+			mSize += piece.size;
+			mPieces.push_back(std::move(piece));
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void Payload::append(Payload&& _other) {
+			if (_other.empty())
+				return;
+			// Trim what was already sent from its first piece
+			auto& front = _other.mPieces.front();
+			if (front.file)
+				front.offset += _other.mFrontOffset;
+			else if (front.owner)
+				front.data += _other.mFrontOffset;
+			else
+				front.owned.erase(0, _other.mFrontOffset);
+			front.size -= _other.mFrontOffset;
+			for (auto& piece : _other.mPieces)
+				mPieces.push_back(std::move(piece));
+			mSize += _other.mSize;
+			_other.mPieces.clear();
+			_other.mFrontOffset = 0;
+			_other.mSize = 0;
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		Payload::Progress Payload::sendTo(Socket::SocketDesc _socket) {
+			while (!mPieces.empty()) {
+				const Piece& front = mPieces.front();
+				long sent;
+#ifdef __linux__
+				if (front.file) {
+					// Straight from the page cache to the socket
+					off_t offset = off_t(front.offset + mFrontOffset);
+					sent = sendfile(_socket, front.file->desc(), &offset, front.size - mFrontOffset);
+					if (sent == 0) // The file was truncated under our feet
+						return Progress::Error;
+				}
+				else {
+					// Gather every piece in memory up to the next file
+					constexpr size_t cMaxVectors = 64;
+					iovec vectors[cMaxVectors];
+					size_t numVectors = 0;
+					for (auto& piece : mPieces) {
+						if (piece.file || numVectors == cMaxVectors)
+							break;
+						size_t skip = numVectors ? 0 : mFrontOffset;
+						vectors[numVectors].iov_base = const_cast<char*>(piece.bytes() + skip);
+						vectors[numVectors].iov_len = piece.size - skip;
+						++numVectors;
+					}
+					msghdr message = {};
+					message.msg_iov = vectors;
+					message.msg_iovlen = numVectors;
+					sent = sendmsg(_socket, &message, MSG_NOSIGNAL); // Like writev, without raising SIGPIPE on closed sockets
+				}
+#else
+				// No vectored writes or sendfile. Files go through a user space buffer.
+				if (front.file) {
+					std::vector<char> buffer(std::min<size_t>(front.size - mFrontOffset, 64 * 1024));
+					if (!front.file->read(front.offset + mFrontOffset, buffer.size(), buffer.data()))
+						return Progress::Error;
+					sent = send(_socket, buffer.data(), (int)buffer.size(), 0);
+				}
+				else
+					sent = send(_socket, front.bytes() + mFrontOffset, (int)(front.size - mFrontOffset), 0);
+#endif // __linux__
+				if (sent < 0) {
+#ifdef _WIN32
+					// Winsock doesn't set errno
+					int error = WSAGetLastError();
+					if (error == WSAEINTR)
+						continue;
+					if (error == WSAEWOULDBLOCK)
+						return Progress::WouldBlock;
+#else
+					if (errno == EINTR)
+						continue;
+					if (errno == EAGAIN || errno == EWOULDBLOCK)
+						return Progress::WouldBlock;
+#endif // _WIN32
+					return Progress::Error;
+				}
+				consume((size_t)sent);
+			}
+			return Progress::Done;
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void Payload::consume(size_t _bytes) {
+			assert(_bytes <= mSize);
+			mSize -= _bytes;
+			while (_bytes) {
+				size_t left = mPieces.front().size - mFrontOffset;
+				if (_bytes < left) {
+					mFrontOffset += _bytes;
+					return;
+				}
+				_bytes -= left;
+				mPieces.pop_front();
+				mFrontOffset = 0;
+			}
+		}
+
+	}	// namespace net
+}	// namespace rev
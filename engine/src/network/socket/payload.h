@@ -0,0 +1,96 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include "socket.h"
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace rev {
+	namespace net {
+
+		/// Read only file, kept open so its contents can be sent straight from the page cache
+		class OpenFile {
+		public:
+			/// Returns null if the file can't be opened
+			static std::shared_ptr<const OpenFile> open(const std::string& _path);
+			~OpenFile();
+
+			OpenFile(const OpenFile&) = delete;
+			OpenFile& operator=(const OpenFile&) = delete;
+
+			int		desc() const { return mDesc; }
+			size_t	size() const { return mSize; }
+			/// Copy part of the file into memory. For when it can't be sent directly.
+			bool	read(size_t _offset, size_t _size, char* _dst) const;
+
+		private:
+			OpenFile(int _desc, size_t _size) : mDesc(_desc), mSize(_size) {}
+
+			int		mDesc;
+			size_t	mSize;
+		};
+
+		/// Data waiting to be sent through a socket, as a sequence of pieces that are never copied on the way.
+		/// A piece can be a string owned by the payload, bytes kept alive by someone else, or a region of a file.
+		/// Consecutive pieces in memory go out in a single vectored write, and files through sendfile.
+		class Payload {
+		public:
+			enum class Progress {
+				Done,
+				WouldBlock, // Non blocking sockets only. Wait until the socket is writable and try again.
+				Error
+			};
+
+			void	append(std::string _data);
+			/// _owner keeps _data alive until it's sent
+			void	append(std::shared_ptr<const void> _owner, std::string_view _data);
+			void	append(std::shared_ptr<const OpenFile> _file, size_t _offset, size_t _size);
+			void	append(Payload&& _other);
+
+			size_t	size() const { return mSize; }
+			bool	empty() const { return mPieces.empty(); }
+
+			/// Send as much as the socket takes. Sent data is removed from the payload.
+			Progress sendTo(Socket::SocketDesc _socket);
+
+		private:
+			struct Piece {
+				std::string						owned;
+				std::shared_ptr<const void>		owner; // When set, data points to memory it keeps alive
+				const char*						data = nullptr;
+				std::shared_ptr<const OpenFile>	file;
+				size_t							offset = 0; // Into the file
+				size_t							size = 0;
+
+				const char* bytes() const { return owner ? data : owned.data(); }
+			};
+
+			void	consume(size_t _bytes);
+
+			std::deque<Piece>	mPieces;
+			size_t				mFrontOffset = 0; // Already sent from the first piece
+			size_t				mSize = 0; // Left to send
+		};
+
+	}	// namespace net
+}	// namespace rev
@@ -3,6 +3,7 @@
 // Created by Carmelo J. Fdez-Agera Tortosa (a.k.a. Technik)
 //----------------------------------------------------------------------------------------------------------------------
 #include "socket.h"
+#include "payload.h"
 
 #include <cassert>
 #include <fcntl.h>
@@ -45,8 +46,8 @@ namespace rev {
 						break; // Connected
 					}
 					else {
-						mSocket = INVALID_SOCKET;
 						closesocket(mSocket); // Unable to connect
+						mSocket = INVALID_SOCKET;
 					}
 				}
 				else { // UDP doesn't need a connection
@@ -58,16 +59,28 @@ namespace rev {
 
 		//------------------------------------------------------------------------------------------------------------------
 		void Socket::close() {
-			// if(mSystemAddress) {
-			// 	freeaddrinfo(mSystemAddress);
-			// 	mSystemAddress = nullptr;
-			// }
+			if(mSystemAddress) {
+				freeaddrinfo(mSystemAddress);
+				mSystemAddress = nullptr;
+			}
 			if (mSocket == INVALID_SOCKET)
 				return; // Nothing to do here
 			closesocket(mSocket);
 			mSocket = INVALID_SOCKET;
 		}
 
+		//------------------------------------------------------------------------------------------------------------------
+		void Socket::shutdownWrite() {
+			if (mSocket == INVALID_SOCKET)
+				return;
+#ifdef _WIN32
+			shutdown(mSocket, SD_SEND);
+#endif // _WIN32
+#ifdef __linux__
+			shutdown(mSocket, SHUT_WR);
+#endif // __linux__
+		}
+
 		//------------------------------------------------------------------------------------------------------------------
 		bool Socket::isOpen() const {
 			return (SOCKET_ERROR != mSocket);
@@ -86,6 +99,12 @@ namespace rev {
 				return SOCKET_ERROR != send(mSocket, (const char*)_data, _length, 0);
 		}
 
+		//------------------------------------------------------------------------------------------------------------------
+		bool Socket::write(Payload& _payload) {
+			assert(!connectionLess());
+			return _payload.sendTo(mSocket) == Payload::Progress::Done;
+		}
+
 		//------------------------------------------------------------------------------------------------------------------
 		int Socket::read(void* _data, unsigned _maxLength) {
 			int nBytes = recv(mSocket, reinterpret_cast<char*>(_data), _maxLength, 0);
@@ -30,6 +30,8 @@ const int SOCKET_ERROR = -1;
 namespace rev {
 	namespace net {
 
+		class Payload;
+
 		class Socket : private SocketBase {
 		public:
 			typedef SocketBase::SocketDesc	SocketDesc;
@@ -45,10 +47,13 @@ namespace rev {
 
 			bool open(const std::string& _url, unsigned _port, Protocol = Protocol::TCP);
 			void close();
+			/// Tell the peer nothing else will be sent. Data can still be read.
+			void shutdownWrite();
 
 			bool isOpen() const;
 
 			bool			write(unsigned _length, const void* _data);
+			bool			write(Payload&); // Blocks until everything is sent, and leaves the payload empty
 			bool			write(const std::string&); // Sugar for writing strings
 													   // Returns the number of bytes actually read
 			int		read(void* _dstbuffer, unsigned _maxLen);
@@ -61,8 +66,8 @@ namespace rev {
 
 			SocketDesc mSocket = INVALID_SOCKET;
 			bool mMustClose = false;
-			struct addrinfo* mAddress;
-			struct addrinfo* mSystemAddress;
+			struct addrinfo* mAddress = nullptr;
+			struct addrinfo* mSystemAddress = nullptr;
 			std::string mInBuffer;
 
 			Protocol		mProtocol;
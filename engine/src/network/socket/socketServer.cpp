@@ -4,43 +4,51 @@
 //----------------------------------------------------------------------------------------------------------------------
 #include "socketServer.h"
 
+#ifndef __linux__
+#error "SocketServer's event loop is built on epoll, and only available on linux"
+#endif // __linux__
+
 #include <cassert>
+#include <cerrno>
+#include <cstdio>
 #include <cstring> // memset
 #include <iostream>
 #include <sstream>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 namespace rev {
 	namespace net {
 
 		//------------------------------------------------------------------------------------------------------------------
 		namespace {
-			void initSocketLib() {
-#ifdef _WIN32
-				WSADATA wsaData;
+			// Bound the work done for a single client before serving others
+			constexpr size_t cReadBufferSize = 64 * 1024;
+			constexpr int cMaxReadsPerEvent = 16;
+			constexpr int cMaxEvents = 64;
 
-				// Initialize Winsock
-				int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
-				assert(!iResult);
-#endif // _WIN32
+			void watchSocket(int _epoll, int _op, Socket::SocketDesc _socket, uint64_t _id, uint32_t _events) {
+				epoll_event event = {};
+				event.events = _events;
+				event.data.u64 = _id;
+				epoll_ctl(_epoll, _op, _socket, &event);
 			}
 		}
 
 		//------------------------------------------------------------------------------------------------------------------
-		SocketServer::SocketServer(unsigned _port) {
-			// Start listening thread
-			assert(0 != _port);	// Ensure data integrity
-			initSocketLib();
-
+		SocketServer::SocketServer(unsigned _port, Handlers _handlers)
+			: mHandlers(std::move(_handlers))
+		{
 			addrinfo * socketAddress = buildAddresInfo(_port);
-			mListener = socket(socketAddress->ai_family, socketAddress->ai_socktype, socketAddress->ai_protocol);
-			//delete socketAddress;
-			// assert(mListener != INVALID_SOCKET);
+			mListener = socket(socketAddress->ai_family, socketAddress->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, socketAddress->ai_protocol);
 			if (mListener == INVALID_SOCKET) {
 				std::cout << "Error: Unable to create socket server at port " << _port << "\n";
 			}
 			else {
 				startListening(socketAddress);
 			}
+			freeaddrinfo(socketAddress);
 		}
 
 		//------------------------------------------------------------------------------------------------------------------
@@ -49,68 +57,276 @@ namespace rev {
 		}
 
 		//------------------------------------------------------------------------------------------------------------------
-		void SocketServer::setConnectionHandler(Handler _handler) {
-			mConHandler = _handler;
+		void SocketServer::send(ConnectionId _connection, Payload _data) {
+			postCommand({ _connection, std::move(_data), false });
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void SocketServer::send(ConnectionId _connection, std::string _data) {
+			Payload payload;
+			payload.append(std::move(_data));
+			send(_connection, std::move(payload));
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void SocketServer::close(ConnectionId _connection) {
+			postCommand({ _connection, Payload(), true });
 		}
 
 		//------------------------------------------------------------------------------------------------------------------
 		void SocketServer::startListening(addrinfo* _addr) {// Setup the TCP listening socket
+			int reuse = 1;
+			setsockopt(mListener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
 			int res = ::bind(mListener, _addr->ai_addr, (int)_addr->ai_addrlen);
 			if (res == SOCKET_ERROR) {
 				std::cout << "Error: Unable to bind socket server\n";
 				close();
+				return;
 			}
 			res = listen(mListener, SOMAXCONN);
 			if (res == SOCKET_ERROR) {
 				std::cout << "Error: Unable to set socket server listening\n";
 				close();
+				return;
 			}
+			sockaddr_in boundAddress = {};
+			socklen_t addressLen = sizeof(boundAddress);
+			getsockname(mListener, (sockaddr*)&boundAddress, &addressLen);
+			mPort = ntohs(boundAddress.sin_port);
+
+			mEpoll = epoll_create1(EPOLL_CLOEXEC);
+			mWakeUp = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (mEpoll < 0 || mWakeUp < 0) {
+				std::cout << "Error: Unable to create socket server's event queue\n";
+				close();
+				return;
+			}
+			watchSocket(mEpoll, EPOLL_CTL_ADD, mListener, cListenerEvent, EPOLLIN);
+			watchSocket(mEpoll, EPOLL_CTL_ADD, mWakeUp, cWakeUpEvent, EPOLLIN);
 
-			// Start listening thread
 			mListenThread = std::thread([this]() {
-				for (;;) {
-					if (mMustClose)
-						return;
-					Socket::SocketDesc conn = accept(mListener, nullptr, nullptr);
-					if (INVALID_SOCKET == conn) {
-						closesocket(mListener);
-						assert(false);
-						return;
+				eventLoop();
+			});
+			mIsListening = true;
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void SocketServer::eventLoop() {
+			// mListenThread may not be assigned yet when handlers start calling send or close
+			mLoopThread = std::this_thread::get_id();
+			mReadBuffer.resize(cReadBufferSize);
+			epoll_event events[cMaxEvents];
+			while (!mMustClose) {
+				int nEvents = epoll_wait(mEpoll, events, cMaxEvents, -1);
+				if (nEvents < 0) {
+					if (errno == EINTR)
+						continue;
+					perror("epoll_wait");
+					return;
+				}
+				for (int i = 0; i < nEvents; ++i) {
+					auto id = (ConnectionId)events[i].data.u64;
+					if (id == cListenerEvent)
+						acceptConnections();
+					else if (id == cWakeUpEvent) {
+						uint64_t counter; // Reading resets it
+						auto res = read(mWakeUp, &counter, sizeof(counter));
+						(void)res;
+						{
+							std::lock_guard<std::mutex> guard(mCommandLock);
+							mPendingCommands.swap(mCommands);
+						}
 					}
 					else {
-						std::cout << "Accepting connection on socket " << conn << "\n";
-						dispatchConnection(conn);
+						if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+							readConnection(id);
+						if (events[i].events & EPOLLOUT)
+							flushConnection(id);
 					}
+					// Commands posted from this thread, and those picked up after a wake up
+					for (size_t c = 0; c < mPendingCommands.size(); ++c) {
+						Command command = std::move(mPendingCommands[c]); // Running it can queue more commands
+						runCommand(command);
+					}
+					mPendingCommands.clear();
 				}
-			});
-			mIsListening = true;
+			}
 		}
 
 		//------------------------------------------------------------------------------------------------------------------
-		void SocketServer::dispatchConnection(Socket::SocketDesc _socketDesc) {
-			// 666 TODO: Do this in a separate thread in order to prevent collapsing the listening thread
-			//std::thread([this,_socketDesc](){
-			Socket* conn = new Socket(_socketDesc);
-			mConHandler(conn);
-			// });
+		void SocketServer::acceptConnections() {
+			for (;;) {
+				Socket::SocketDesc socket = accept4(mListener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+				if (socket == INVALID_SOCKET) {
+					if (errno == EINTR)
+						continue;
+					if (errno != EAGAIN && errno != EWOULDBLOCK)
+						perror("accept");
+					return;
+				}
+				// Skip ids reserved for the listener and the wake up event, and those still in use after wrapping around
+				ConnectionId id = mNextConnection++;
+				while (id < cFirstConnection || mConnections.count(id))
+					id = mNextConnection++;
+				// Responses are usually small and written one by one. Don't let Nagle hold them back.
+				int noDelay = 1;
+				setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+				Connection& connection = mConnections[id];
+				connection.socket = socket;
+				watchSocket(mEpoll, EPOLL_CTL_ADD, socket, id, EPOLLIN | EPOLLRDHUP);
+				if (mHandlers.onConnect)
+					mHandlers.onConnect(id);
+			}
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void SocketServer::readConnection(ConnectionId _id) {
+			auto iter = mConnections.find(_id);
+			if (iter == mConnections.end())
+				return;
+			Connection& con = iter->second;
+			if (con.peerClosed) { // Not reading anymore, so only a hang up or an error can get here
+				destroyConnection(_id);
+				return;
+			}
+			Socket::SocketDesc socket = con.socket;
+			// Level triggered, so data left in the socket will be picked up again on the next wait
+			for (int i = 0; i < cMaxReadsPerEvent; ++i) {
+				auto len = recv(socket, mReadBuffer.data(), mReadBuffer.size(), 0);
+				if (len > 0) {
+					if (mHandlers.onData)
+						mHandlers.onData(_id, mReadBuffer.data(), (size_t)len);
+					if ((size_t)len < mReadBuffer.size())
+						return;
+				}
+				else if (len < 0 && errno == EINTR)
+					continue;
+				else if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+					return;
+				else if (len == 0) { // The peer is done sending, but responses to what it sent may still be on their way
+					con.peerClosed = true;
+					updateEvents(_id, con);
+					if (mHandlers.onPeerClosed)
+						mHandlers.onPeerClosed(_id);
+					else {
+						con.mustClose = true;
+						if (!con.waitingWritable)
+							flushConnection(_id);
+					}
+					return;
+				}
+				else { // Broken
+					destroyConnection(_id);
+					return;
+				}
+			}
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void SocketServer::flushConnection(ConnectionId _id) {
+			auto iter = mConnections.find(_id);
+			if (iter == mConnections.end())
+				return;
+			Connection& con = iter->second;
+			auto progress = con.output.sendTo(con.socket);
+			if (progress == Payload::Progress::WouldBlock) {
+				// Wait until the socket can take more data
+				if (!con.waitingWritable) {
+					con.waitingWritable = true;
+					updateEvents(_id, con);
+				}
+				return;
+			}
+			if (progress == Payload::Progress::Error) {
+				destroyConnection(_id);
+				return;
+			}
+			if (con.waitingWritable) {
+				con.waitingWritable = false;
+				updateEvents(_id, con);
+			}
+			if (con.mustClose)
+				destroyConnection(_id);
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void SocketServer::updateEvents(ConnectionId _id, const Connection& _con) {
+			uint32_t events = _con.peerClosed ? 0 : EPOLLIN | EPOLLRDHUP;
+			if (_con.waitingWritable)
+				events |= EPOLLOUT;
+			watchSocket(mEpoll, EPOLL_CTL_MOD, _con.socket, _id, events); // Hang ups and errors are always reported
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void SocketServer::destroyConnection(ConnectionId _id) {
+			auto iter = mConnections.find(_id);
+			if (iter == mConnections.end())
+				return;
+			epoll_ctl(mEpoll, EPOLL_CTL_DEL, iter->second.socket, nullptr);
+			closesocket(iter->second.socket);
+			mConnections.erase(iter);
+			if (mHandlers.onClose)
+				mHandlers.onClose(_id);
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void SocketServer::runCommand(Command& _command) {
+			auto iter = mConnections.find(_command.connection);
+			if (iter == mConnections.end()) // Already closed
+				return;
+			Connection& con = iter->second;
+			con.output.append(std::move(_command.data));
+			con.mustClose |= _command.close;
+			// While waiting for the socket to be writable, the loop will flush everything at once
+			if (!con.waitingWritable)
+				flushConnection(_command.connection);
+		}
+
+		//------------------------------------------------------------------------------------------------------------------
+		void SocketServer::postCommand(Command&& _command) {
+			// Handlers running on the loop thread get their commands executed after they return,
+			// so connections never go away under their feet
+			if (std::this_thread::get_id() == mLoopThread.load()) {
+				mPendingCommands.push_back(std::move(_command));
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> guard(mCommandLock);
+				mCommands.push_back(std::move(_command));
+			}
+			uint64_t one = 1;
+			auto res = write(mWakeUp, &one, sizeof(one));
+			(void)res;
 		}
 
 		//------------------------------------------------------------------------------------------------------------------
 		void SocketServer::close() {
 			assert(mListenThread.get_id() != std::this_thread::get_id()); // Ensure it's not this thread trying to delete itself
-			if (mListener != INVALID_SOCKET) {
-				assert(mListenThread.joinable());
+			if (mListenThread.joinable()) {
 				mMustClose = true;
-				closesocket(mListener);
+				uint64_t one = 1;
+				auto res = write(mWakeUp, &one, sizeof(one));
+				(void)res;
 				mListenThread.join();
-				mListener = INVALID_SOCKET;
 			}
+			for (auto& con : mConnections)
+				closesocket(con.second.socket);
+			mConnections.clear();
+			if (mListener != INVALID_SOCKET)
+				closesocket(mListener);
+			if (mEpoll >= 0)
+				::close(mEpoll);
+			if (mWakeUp >= 0)
+				::close(mWakeUp);
+			mListener = INVALID_SOCKET;
+			mEpoll = -1;
+			mWakeUp = -1;
+			mIsListening = false;
 		}
 
 		//------------------------------------------------------------------------------------------------------------------
 		addrinfo* SocketServer::buildAddresInfo(unsigned _port) {
 			// Translate port into a string
-			assert(0 != _port);
 			std::stringstream portName;
 			portName << _port;
 
@@ -4,32 +4,98 @@
 //----------------------------------------------------------------------------------------------------------------------
 #pragma once
 
+#include "payload.h"
 #include "socket.h"
+#include <atomic>
 #include <functional>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace rev {
 	namespace net {
 
+		/// Non blocking tcp server.
+		/// A single thread waits on epoll for new connections, incoming data and sockets that can take more output,
+		/// so a slow client never stalls the rest. Handlers run on that thread and must return quickly.
 		class SocketServer {
 		public:
-			SocketServer(unsigned _port);
+			typedef unsigned ConnectionId;
+
+			struct Handlers {
+				std::function<void(ConnectionId)>								onConnect;
+				std::function<void(ConnectionId, const char* _data, size_t _size)>	onData;
+				std::function<void(ConnectionId)>								onClose; // Connection broke, or close() finished flushing
+				/// The peer won't send anything else, but may still be waiting for data. Call close() when done with it.
+				/// Without this handler, such connections are closed as soon as their queued data is sent.
+				std::function<void(ConnectionId)>								onPeerClosed;
+			};
+
+			/// Port 0 binds to any free port. See port()
+			SocketServer(unsigned _port, Handlers _handlers);
 			~SocketServer();
 
-			typedef std::function<void(Socket*)>	Handler;
-			void setConnectionHandler(Handler _handler);
+			bool		isListening() const { return mIsListening; }
+			unsigned	port() const { return mPort; }
+
+			/// Queue data to be sent through a connection. Safe to call from any thread.
+			void		send(ConnectionId, Payload _data);
+			void		send(ConnectionId, std::string _data);
+			/// Close a connection once all its queued data has been sent. Safe to call from any thread.
+			void		close(ConnectionId);
 
 		private:
+			struct Connection {
+				Socket::SocketDesc	socket;
+				Payload				output;
+				bool				waitingWritable = false;
+				bool				peerClosed = false; // Nothing left to read
+				bool				mustClose = false;
+			};
+
+			struct Command {
+				ConnectionId	connection;
+				Payload			data;
+				bool			close;
+			};
+
 			void		startListening(addrinfo*);
-			void		dispatchConnection(Socket::SocketDesc);
+			void		eventLoop();
+			void		acceptConnections();
+			void		readConnection(ConnectionId);
+			void		flushConnection(ConnectionId);
+			void		updateEvents(ConnectionId, const Connection&);
+			void		destroyConnection(ConnectionId);
+			void		runCommand(Command&);
+			void		postCommand(Command&&);
 			void		close();
 
 			addrinfo*	buildAddresInfo(unsigned _port);
-			Socket::SocketDesc		mListener;
+			Socket::SocketDesc		mListener = INVALID_SOCKET;
+			int			mEpoll = -1;
+			int			mWakeUp = -1;
+			unsigned	mPort = 0;
 			bool		mIsListening = false;
-			bool		mMustClose = false;
+			std::atomic<bool>	mMustClose = false;
 			std::thread	mListenThread;
-			Handler	mConHandler;
+			std::atomic<std::thread::id>	mLoopThread; // Set by the loop itself, before any handler runs
+			Handlers	mHandlers;
+
+			// Only touched by the event loop thread
+			std::unordered_map<ConnectionId, Connection>	mConnections;
+			ConnectionId	mNextConnection = cFirstConnection;
+			std::vector<char>	mReadBuffer;
+
+			// Requests from other threads, picked up by the loop after mWakeUp is signaled
+			std::mutex				mCommandLock;
+			std::vector<Command>	mCommands;
+			std::vector<Command>	mPendingCommands;
+
+			static constexpr ConnectionId cListenerEvent = 0;
+			static constexpr ConnectionId cWakeUpEvent = 1;
+			static constexpr ConnectionId cFirstConnection = 2;
 		};
 	}
-}
+}
\ No newline at end of file
@@ -36,7 +36,7 @@ void initCamera(rev::game::SceneNode*& camNode, rev::game::FlyBy*& player, rev::
 	const float camAngSpeed = 1.f;
 	auto xform = camNode->addComponent<rev::game::Transform>();
 	player = camNode->addComponent<rev::game::FlyBy>(camSpeed, camAngSpeed);
-	xform->xForm.position() = rev::math::Vec3f{0.f, 1.7f, 8.f };
+	xform->xForm().position() = rev::math::Vec3f{0.f, 1.7f, 8.f };
 	gfxCam = &*camNode->addComponent<rev::game::Camera>(rev::math::Pi/4, 0.1f, 1000.f)->cam();
 
 	camNode->init();
@@ -101,6 +101,8 @@ int main(int _argc, const char** _argv) {
 			break;
 
 		camNode->update(1.f/60);
+		rev::game::Transform::hierarchy().update();
+		camNode->lateUpdate(1.f/60);
 		// Modify the uniform command
 		//Vec3f color = Vec3f(t,t,t);
 		//timeUniform.vec3s.push_back({0, color});
@@ -36,8 +36,22 @@ layout(location = 2) in vec4 msTangent;
 layout(location = 3) in vec2 texCoord;
 #endif
 
+#ifdef INDIRECT_INSTANCES
+struct InstanceData
+{
+	mat4 worldViewProjection;
+	mat4 world;
+};
+
+layout(std430, binding = 0) buffer InstanceSSBO
+{
+	InstanceData instances[];
+};
+
+#else
 layout(location = 0) uniform mat4 uWorldViewProjection;
 layout(location = 1) uniform mat4 uWorld;
+#endif
 
 //------------------------------------------------------------------------------
 // Per vertex output
@@ -53,6 +67,11 @@ out vec4 vtxTangent;
 //------------------------------------------------------------------------------
 void main ( void )
 {
+#ifdef INDIRECT_INSTANCES
+	int instanceId = gl_BaseInstanceARB + gl_InstanceID; // baseInstance of the draw is the group's first instance
+	mat4 uWorldViewProjection = instances[instanceId].worldViewProjection;
+	mat4 uWorld = instances[instanceId].world;
+#endif
 	// Textures
 #ifdef VTX_UV_FLOAT
 	vTexCoord = texCoord;
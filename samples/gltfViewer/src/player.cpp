@@ -7,6 +7,7 @@
 #include <math/algebra/vector.h>
 #include <core/platform/fileSystem/file.h>
 #include <core/platform/cmdLineParser.h>
+#include <core/tasks/jobSystem.h>
 #include <core/time/time.h>
 #include <core/tools/log.h>
 #include <game/scene/camera.h>
@@ -96,9 +97,13 @@ namespace rev {
 		mGameScene.root()->addChild(m_gltfRoot);
 
 		std::vector<std::shared_ptr<Animation>> animations;
-		std::vector<std::shared_ptr<SceneNode>> animNodes;
+		std::vector<std::shared_ptr<Skeleton>> skeletons;
 		GltfLoader gltfLoader(gfxDevice());
-		gltfLoader.load(*m_gltfRoot, scene, mGraphicsScene, animNodes, animations);
+		gltfLoader.load(*m_gltfRoot, scene, mGraphicsScene, skeletons, animations);
+
+		// Loop the first animation on the nodes it drives
+		if(!animations.empty())
+			m_gltfRoot->addComponent<Animator>(skeletons[0])->playAnimation(animations[0], true);
 	}
 
 	//------------------------------------------------------------------------------------------------------------------
@@ -118,7 +123,7 @@ namespace rev {
 
 		// Re-center scene
 		auto xForm = m_gltfRoot->component<Transform>();
-		xForm->xForm.position() = -m_globalBBox.center();
+		xForm->xForm().position() = -m_globalBBox.center();
 	}
 
 	//------------------------------------------------------------------------------------------------------------------
@@ -127,7 +132,7 @@ namespace rev {
 		// Create flyby camera
 		auto cameraNode = mGameScene.root()->createChild("Flyby cam");
 		m_flyby = cameraNode->addComponent<FlyBy>(2.f, 1.f);
-		cameraNode->addComponent<Transform>()->xForm.position() = math::Vec3f { 0.0f, 0.f, 9.f };
+		cameraNode->addComponent<Transform>()->xForm().position() = math::Vec3f { 0.0f, 0.f, 9.f };
 		auto camComponent = cameraNode->addComponent<game::Camera>(math::Pi/5, 0.01f, 5000.f);
 		mFlybyCam = &*camComponent->cam();
 	}
@@ -138,9 +143,9 @@ namespace rev {
 		auto floorNode = mGameScene.root()->createChild("floor");
 		auto sceneSize = m_globalBBox.size();
 		auto floorXForm = floorNode->addComponent<Transform>();
-		floorXForm->xForm.rotate(Quatf({1.f,0.f,0.f}, -math::Constants<float>::halfPi));
-		floorXForm->xForm.position() = m_globalBBox.center();
-		floorXForm->xForm.position().y() = m_globalBBox.min().y();
+		floorXForm->xForm().rotate(Quatf({1.f,0.f,0.f}, -math::Constants<float>::halfPi));
+		floorXForm->xForm().position() = m_globalBBox.center();
+		floorXForm->xForm().position().y() = m_globalBBox.min().y();
 
 		const float floorScale = 4.f;
 		auto floorMesh = std::make_shared<gfx::RenderGeom>(RenderGeom::quad(floorScale * Vec2f(sceneSize.x(), sceneSize.z())));
@@ -163,7 +168,10 @@ namespace rev {
 	//------------------------------------------------------------------------------------------------------------------
 	bool Player::updateLogic(float dt)
 	{
+		// Logic moves local transforms, then world transforms are consumed by cameras, lights and renderables
 		mGameScene.root()->update(dt);
+		Transform::hierarchy().update(core::JobSystem::get());
+		mGameScene.root()->lateUpdate(dt);
 		return true;
 	}
 
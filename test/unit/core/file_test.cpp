@@ -0,0 +1,114 @@
+//----------------------------------------------------------------------------------------------------------------------
+// File loading unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <core/platform/fileSystem/file.h>
+#include <core/tasks/jobSystem.h>
+
+using namespace rev::core;
+
+const char* kTestFile = "file_test.bin";
+const char* kEmptyFile = "file_test_empty.bin";
+
+// Binary contents, with embedded zeros
+std::string testContents()
+{
+	std::string contents;
+	for(int i = 0; i < 100000; ++i)
+		contents.push_back(char(i * 31 % 256));
+	return contents;
+}
+
+void assertSameContents(const File& a, const File& b)
+{
+	assert(a.size() == b.size());
+	assert(a.size() == 0 || std::memcmp(a.buffer(), b.buffer(), a.size()) == 0);
+}
+
+void testBuffered()
+{
+	auto contents = testContents();
+	File file(kTestFile, File::LoadMode::Buffered);
+	assert(!file.isMapped());
+	assert(file.size() == contents.size());
+	assert(std::memcmp(file.buffer(), contents.data(), contents.size()) == 0);
+	assert(file.buffer<char>()[file.size()] == '\0'); // Buffered reads are null terminated
+
+	File missing("file_test_missing.bin", File::LoadMode::Buffered);
+	assert(missing.size() == 0);
+}
+
+void testMapped()
+{
+	File buffered(kTestFile, File::LoadMode::Buffered);
+	File mapped(kTestFile, File::LoadMode::Mapped);
+#if defined(__linux__) && !defined(ANDROID)
+	assert(mapped.isMapped());
+#endif
+	assertSameContents(mapped, buffered);
+
+	// Mappings are private, so writing to them never reaches the file
+	mapped.buffer<char>()[0] = ~mapped.buffer<char>()[0];
+	File reloaded(kTestFile, File::LoadMode::Buffered);
+	assertSameContents(reloaded, buffered);
+
+	// Streams read through the mapping too
+	File streamed(kTestFile, File::LoadMode::Mapped);
+	std::vector<char> fromStream(streamed.size());
+	streamed.asStream().read(fromStream.data(), fromStream.size());
+	assert(streamed.asStream().gcount() == (std::streamsize)buffered.size());
+	assert(std::memcmp(fromStream.data(), buffered.buffer(), buffered.size()) == 0);
+
+	// Empty files can't be mapped, and fall back to a buffered read
+	File empty(kEmptyFile, File::LoadMode::Mapped);
+	assert(empty.size() == 0);
+	assert(!empty.isMapped());
+
+	File missing("file_test_missing.bin", File::LoadMode::Mapped);
+	assert(missing.size() == 0);
+}
+
+void testReadAsync()
+{
+	JobSystem::init(1);
+	auto jobs = JobSystem::get();
+	File buffered(kTestFile, File::LoadMode::Buffered);
+
+	std::unique_ptr<File> mapped, copied, missing;
+	std::vector<JobSystem::JobHandle> reads = {
+		File::readAsync(kTestFile, File::LoadMode::Mapped, [&](std::unique_ptr<File> file) { mapped = std::move(file); }),
+		File::readAsync(kTestFile, File::LoadMode::Buffered, [&](std::unique_ptr<File> file) { copied = std::move(file); }),
+		File::readAsync("file_test_missing.bin", File::LoadMode::Mapped, [&](std::unique_ptr<File> file) { missing = std::move(file); })
+	};
+	jobs->wait(reads);
+	assert(mapped && copied && missing);
+	assertSameContents(*mapped, buffered);
+	assertSameContents(*copied, buffered);
+	assert(missing->size() == 0);
+
+	// Reads can be waited for from inside a job
+	std::unique_ptr<File> nested;
+	auto outer = jobs->schedule([&]() {
+		jobs->wait(File::readAsync(kTestFile, File::LoadMode::Mapped, [&](std::unique_ptr<File> file) { nested = std::move(file); }));
+	});
+	jobs->wait(outer);
+	assert(nested);
+	assertSameContents(*nested, buffered);
+
+	JobSystem::end();
+}
+
+int main()
+{
+	std::ofstream(kTestFile, std::ios::binary) << testContents();
+	std::ofstream(kEmptyFile, std::ios::binary);
+
+	testBuffered();
+	testMapped();
+	testReadAsync();
+	return 0;
+}
@@ -0,0 +1,116 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Job system unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <vector>
+#include <core/tasks/jobSystem.h>
+
+using namespace rev::core;
+
+void testDependencies()
+{
+	JobSystem::init(4);
+	auto jobs = JobSystem::get();
+
+	for(int iteration = 0; iteration < 100; ++iteration)
+	{
+		std::mutex orderLock;
+		std::vector<int> order;
+		auto record = [&](int step) {
+			std::lock_guard lock(orderLock);
+			order.push_back(step);
+		};
+
+		// Diamond: 0 -> {1, 2} -> 3, and 4 only after 3
+		auto root = jobs->schedule([&]() { record(0); });
+		auto left = jobs->schedule([&]() { record(1); }, { root });
+		auto right = jobs->schedule([&]() { record(2); }, { root });
+		auto join = jobs->schedule([&]() { record(3); }, { left, right });
+		auto last = jobs->schedule([&]() { record(4); }, std::vector<JobSystem::JobHandle>{ join });
+		jobs->wait(last);
+
+		assert(root->finished() && left->finished() && right->finished() && join->finished());
+		assert(order.size() == 5);
+		assert(order[0] == 0);
+		assert((order[1] == 1 && order[2] == 2) || (order[1] == 2 && order[2] == 1));
+		assert(order[3] == 3);
+		assert(order[4] == 4);
+	}
+
+	// Depending on a job that already finished doesn't stall
+	auto done = jobs->schedule([]() {});
+	jobs->wait(done);
+	std::atomic<bool> ran = false;
+	jobs->wait(jobs->schedule([&]() { ran = true; }, { done }));
+	assert(ran);
+
+	JobSystem::end();
+}
+
+void testNestedWait()
+{
+	// A single worker can only make progress if waiting jobs run the jobs they wait for
+	JobSystem::init(1);
+	auto jobs = JobSystem::get();
+	assert(jobs->numWorkers() == 1);
+
+	std::atomic<int> leafCount = 0;
+	std::vector<JobSystem::JobHandle> outer;
+	for(int i = 0; i < 8; ++i)
+	{
+		outer.push_back(jobs->schedule([&]() {
+			std::vector<JobSystem::JobHandle> inner;
+			for(int j = 0; j < 4; ++j)
+			{
+				inner.push_back(jobs->schedule([&]() {
+					auto leaf = jobs->schedule([&]() { ++leafCount; });
+					jobs->wait(leaf);
+				}));
+			}
+			jobs->wait(inner);
+		}));
+	}
+	jobs->wait(outer);
+	assert(leafCount == 32);
+
+	JobSystem::end();
+}
+
+void testParallelFor()
+{
+	JobSystem::init(4);
+	auto jobs = JobSystem::get();
+
+	const size_t begin = 3;
+	const size_t end = 10003;
+	for(size_t grainSize : { size_t(0), size_t(1), size_t(7), size_t(64), size_t(20000) })
+	{
+		std::vector<std::atomic<int>> hits(end);
+		jobs->parallel_for(begin, end, grainSize, [&](size_t i) { ++hits[i]; });
+		for(size_t i = 0; i < end; ++i)
+			assert(hits[i] == (i < begin ? 0 : 1));
+	}
+
+	// Empty ranges never call the op
+	jobs->parallel_for(5, 5, 1, [](size_t) { assert(false); });
+
+	// Nested parallel_for from inside the job system
+	std::vector<std::atomic<int>> hits(64 * 64);
+	jobs->parallel_for(0, 64, 1, [&](size_t row) {
+		jobs->parallel_for(0, 64, 8, [&](size_t col) { ++hits[row * 64 + col]; });
+	});
+	for(auto& hit : hits)
+		assert(hit == 1);
+
+	JobSystem::end();
+}
+
+int main()
+{
+	testDependencies();
+	testNestedWait();
+	testParallelFor();
+	return 0;
+}
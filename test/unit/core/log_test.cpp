@@ -0,0 +1,105 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Asynchronous log unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <core/tools/log.h>
+
+using namespace rev::core;
+
+// Log output is redirected here, so written messages can be counted
+const char* kOutputPath = "log_test.txt";
+const char* kErrorPath = "log_test_errors.txt";
+
+size_t countLines(const std::string& prefix, const char* path = kOutputPath)
+{
+	fflush(stdout);
+	fflush(stderr);
+	std::ifstream output(path);
+	size_t count = 0;
+	std::string line;
+	while(std::getline(output, line))
+		if(line.compare(0, prefix.size(), prefix) == 0)
+			++count;
+	return count;
+}
+
+void testErrorsAreNeverDropped()
+{
+	size_t droppedBefore = Log::droppedMessages();
+	size_t linesBefore = countLines("Error: ", kErrorPath);
+	Log::init();
+	// Far more than a thread's queue can hold
+	for(int i = 0; i < 5000; ++i)
+		Log::error("error ", i);
+	Log::end();
+	assert(Log::droppedMessages() == droppedBefore);
+	// Errors go to stderr only
+	assert(countLines("Error: ", kErrorPath) - linesBefore == 5000);
+	assert(countLines("Error: ") == 0);
+}
+
+void testDropsAreCounted()
+{
+	size_t droppedBefore = Log::droppedMessages();
+	size_t linesBefore = countLines("Warning: ");
+	Log::init();
+	for(int i = 0; i < 5000; ++i)
+		Log::warning("warning ", i);
+	Log::end();
+	size_t written = countLines("Warning: ") - linesBefore;
+	assert(written + Log::droppedMessages() - droppedBefore == 5000);
+}
+
+void testEndWhileOtherThreadsLog()
+{
+	size_t droppedBefore = Log::droppedMessages();
+	size_t linesBefore = countLines("Warning: ");
+	std::atomic<bool> stop = false;
+	std::atomic<size_t> numPushed = 0;
+	std::vector<std::thread> producers;
+	for(int t = 0; t < 4; ++t)
+	{
+		producers.emplace_back([&, t]() {
+			while(!stop)
+			{
+				Log::warning("thread ", t);
+				++numPushed;
+			}
+		});
+	}
+	// Writers come and go under the producers' feet
+	for(int i = 0; i < 20; ++i)
+	{
+		Log::init();
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		Log::end();
+	}
+	stop = true;
+	for(auto& t : producers)
+		t.join();
+
+	// Every message is either written, or accounted for
+	size_t written = countLines("Warning: ") - linesBefore;
+	assert(written + Log::droppedMessages() - droppedBefore == numPushed);
+}
+
+int main()
+{
+	if(!freopen(kOutputPath, "w", stdout) || !freopen(kErrorPath, "w", stderr))
+		return -1;
+	testErrorsAreNeverDropped();
+	testDropsAreCounted();
+	testEndWhileOtherThreadsLog();
+	fclose(stdout);
+	fclose(stderr);
+	remove(kOutputPath);
+	remove(kErrorPath);
+	return 0;
+}
@@ -0,0 +1,172 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Cpu profiler unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <core/tools/profiler.h>
+
+using namespace rev::core;
+
+// Count heap allocations, to check the steady state of endFrame
+std::atomic<size_t> gNumAllocations = 0;
+
+void* operator new(size_t size)
+{
+	gNumAllocations.fetch_add(1, std::memory_order_relaxed);
+	if(void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+void recordNestedMarkers()
+{
+	REV_PROFILE_SCOPE("Outer");
+	{
+		REV_PROFILE_SCOPE("Inner");
+		REV_PROFILE_SCOPE("Innermost");
+	}
+	REV_PROFILE_SCOPE("Inner");
+}
+
+void testNesting()
+{
+	Profiler::init();
+	auto profiler = Profiler::get();
+
+	recordNestedMarkers();
+	profiler->endFrame();
+
+	auto frame = profiler->lastFrame();
+	assert(frame);
+	assert(frame->events.size() == 4);
+	size_t numInner = 0;
+	for(auto& [threadNdx, event] : frame->events)
+	{
+		std::string name = event.name;
+		if(name == "Outer")
+			assert(event.depth == 0);
+		else if(name == "Inner")
+		{
+			assert(event.depth == 1);
+			++numInner;
+		}
+		else
+		{
+			assert(name == "Innermost");
+			assert(event.depth == 2);
+		}
+		assert(event.start <= event.end);
+		assert(frame->start <= event.start && event.end <= frame->end);
+	}
+	assert(numInner == 2);
+
+	// Both hits of a marker add up to a single frame sample
+	recordNestedMarkers();
+	profiler->endFrame();
+	assert(profiler->stats("Outer").numFrames == 2);
+	assert(profiler->stats("Inner").numFrames == 2);
+	assert(profiler->stats("Frame").numFrames == 2);
+	assert(profiler->stats("Missing").numFrames == 0);
+	assert(profiler->droppedEvents() == 0);
+
+	Profiler::end();
+}
+
+void testOverflowDropsNewEvents()
+{
+	Profiler::init();
+	auto profiler = Profiler::get();
+
+	const size_t extraEvents = 100;
+	for(size_t i = 0; i < Profiler::kRingSize + extraEvents; ++i)
+	{
+		REV_PROFILE_SCOPE("Spam");
+	}
+	profiler->endFrame();
+	assert(profiler->lastFrame()->events.size() == Profiler::kRingSize);
+	assert(profiler->droppedEvents() == extraEvents);
+
+	// Collecting the frame makes room again
+	{
+		REV_PROFILE_SCOPE("Spam");
+	}
+	profiler->endFrame();
+	assert(profiler->lastFrame()->events.size() == 1);
+	assert(profiler->droppedEvents() == extraEvents);
+
+	Profiler::end();
+}
+
+void testConcurrentProducer()
+{
+	Profiler::init();
+	auto profiler = Profiler::get();
+
+	std::atomic<bool> done = false;
+	std::thread producer([&]() {
+		Profiler::setThreadName("Producer");
+		for(int i = 0; i < 200000; ++i)
+		{
+			REV_PROFILE_SCOPE("Work");
+		}
+		done = true;
+	});
+
+	size_t numCollected = 0;
+	while(!done)
+	{
+		profiler->endFrame();
+		for(auto& [threadNdx, event] : profiler->lastFrame()->events)
+		{
+			assert(std::string(event.name) == "Work");
+			assert(event.start <= event.end);
+			++numCollected;
+		}
+	}
+	producer.join();
+	profiler->endFrame();
+	numCollected += profiler->lastFrame()->events.size();
+
+	// Every event is either collected intact or counted as dropped
+	assert(numCollected + profiler->droppedEvents() == 200000);
+
+	Profiler::end();
+}
+
+void testEndFrameDoesNotAllocateOnceWarm()
+{
+	Profiler::init();
+	auto profiler = Profiler::get();
+
+	for(size_t i = 0; i < 2 * Profiler::kTraceFrames; ++i)
+	{
+		recordNestedMarkers();
+		profiler->endFrame();
+	}
+
+	auto allocationsBefore = gNumAllocations.load();
+	for(size_t i = 0; i < Profiler::kTraceFrames; ++i)
+	{
+		recordNestedMarkers();
+		profiler->endFrame();
+	}
+	assert(gNumAllocations.load() == allocationsBefore);
+
+	Profiler::end();
+}
+
+int main()
+{
+	testNesting();
+	testOverflowDropsNewEvents();
+	testConcurrentProducer();
+	testEndFrameDoesNotAllocateOnceWarm();
+	return 0;
+}
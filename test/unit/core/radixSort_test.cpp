@@ -0,0 +1,106 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Radix sort unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <core/tasks/jobSystem.h>
+#include <core/tasks/radixSort.h>
+
+using namespace rev::core;
+
+std::default_random_engine rng(42);
+
+// Keys limited to keyMask, so some passes get skipped and there are plenty of repeated keys
+std::vector<SortItem> randomItems(size_t n, uint64_t keyMask)
+{
+	std::uniform_int_distribution<uint64_t> dist;
+	std::vector<SortItem> items(n);
+	for(uint32_t i = 0; i < n; ++i)
+		items[i] = { dist(rng) & keyMask, i };
+	return items;
+}
+
+void checkSort(size_t n, uint64_t keyMask, JobSystem* jobs)
+{
+	auto items = randomItems(n, keyMask);
+	auto expected = items;
+	std::stable_sort(expected.begin(), expected.end(), [](const SortItem& a, const SortItem& b) {
+		return a.key < b.key;
+	});
+
+	RadixSortScratch scratch;
+	radixSort(items, scratch, jobs);
+	assert(items.size() == n);
+	for(size_t i = 0; i < n; ++i)
+	{
+		assert(items[i].key == expected[i].key);
+		assert(items[i].index == expected[i].index); // Stable
+	}
+}
+
+void testEdgeCases()
+{
+	std::vector<SortItem> items;
+	RadixSortScratch scratch;
+	radixSort(items, scratch);
+	assert(items.empty());
+
+	items = { { 3, 0 }, { 3, 1 }, { 3, 2 } };
+	radixSort(items, scratch);
+	assert(items[0].index == 0 && items[1].index == 1 && items[2].index == 2);
+
+	// Only the top digit varies
+	items = { { 1ull << 63, 0 }, { 0, 1 } };
+	radixSort(items, scratch);
+	assert(items[0].index == 1 && items[1].index == 0);
+}
+
+void testSerial()
+{
+	checkSort(1000, ~0ull, nullptr);
+	checkSort(1000, 0xff, nullptr); // Single pass: result ends up in scratch
+	checkSort(1000, 0xf0f000000000ff00ull, nullptr);
+}
+
+void testParallel()
+{
+	auto jobs = JobSystem::get();
+	checkSort(100000, ~0ull, jobs);
+	checkSort(100000, 0xffff, jobs);
+	checkSort(100000, 0xe0000000ffff0000ull, jobs);
+	checkSort(100, ~0ull, jobs); // Too small to split
+}
+
+void testScratchIsReused()
+{
+	auto jobs = JobSystem::get();
+	RadixSortScratch scratch;
+	auto items = randomItems(100000, ~0ull);
+	radixSort(items, scratch, jobs);
+	auto histogramCapacity = scratch.histograms.capacity();
+	assert(histogramCapacity > 1);
+
+	// Sorting the same amount again doesn't grow the buffers
+	for(int i = 0; i < 3; ++i)
+	{
+		items = randomItems(100000, ~0ull);
+		auto histograms = scratch.histograms.data();
+		radixSort(items, scratch, jobs);
+		assert(scratch.histograms.data() == histograms);
+		assert(scratch.histograms.capacity() == histogramCapacity);
+		for(size_t j = 1; j < items.size(); ++j)
+			assert(items[j-1].key <= items[j].key);
+	}
+}
+
+int main()
+{
+	JobSystem::init(4);
+	testEdgeCases();
+	testSerial();
+	testParallel();
+	testScratchIsReused();
+	JobSystem::end();
+	return 0;
+}
@@ -0,0 +1,83 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Animator unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <game/animation/animator.h>
+#include <game/scene/sceneNode.h>
+#include <game/scene/transform/transform.h>
+
+using namespace rev::game;
+using namespace rev::gfx;
+using namespace rev::math;
+
+bool near(const Vec3f& a, const Vec3f& b)
+{
+	return norm(a - b) < 1e-5f;
+}
+
+template<class T>
+Animation::Channel<T> channel(float t0, const T& v0, float t1, const T& v1)
+{
+	Animation::Channel<T> c;
+	c.t = { t0, t1 };
+	c.values = { v0, v1 };
+	return c;
+}
+
+void testWholeSkeleton()
+{
+	// Three joints with different rest poses
+	std::vector<std::shared_ptr<SceneNode>> joints;
+	for(int i = 0; i < 3; ++i)
+	{
+		auto node = std::make_shared<SceneNode>();
+		node->addComponent<Transform>()->xForm().position() = Vec3f(float(i), 0.f, 0.f);
+		joints.push_back(node);
+	}
+	auto skeleton = std::make_shared<Skeleton>(joints);
+	assert(skeleton->numJoints() == 3);
+
+	// Joint 0 only rotates, joint 1 only translates, joint 2 translates and scales
+	auto halfTurn = Quatf(Vec3f(0.f, 0.f, 1.f), 3.14159265f);
+	std::vector<Animation::Channel<Vec3f>> translations(3);
+	translations[1] = channel(0.f, Vec3f(0.f, 0.f, 0.f), 1.f, Vec3f(0.f, 2.f, 0.f));
+	translations[2] = channel(0.f, Vec3f(0.f, 0.f, 0.f), 1.f, Vec3f(0.f, 0.f, 4.f));
+	std::vector<Animation::Channel<Quatf>> rotations(1);
+	rotations[0] = channel(0.f, Quatf::identity(), 1.f, halfTurn);
+	std::vector<Animation::Channel<Vec3f>> scales(3);
+	scales[2] = channel(0.f, Vec3f(1.f, 1.f, 1.f), 1.f, Vec3f(3.f, 3.f, 3.f));
+	auto anim = std::make_shared<Animation>(translations, rotations, scales);
+
+	SceneNode animNode;
+	auto animator = animNode.addComponent<Animator>(skeleton);
+	animNode.init();
+	animator->playAnimation(anim, false);
+
+	animNode.update(0.5f);
+	auto& x0 = joints[0]->component<Transform>()->xForm();
+	auto& x1 = joints[1]->component<Transform>()->xForm();
+	auto& x2 = joints[2]->component<Transform>()->xForm();
+	// Unkeyed properties keep the rest pose
+	assert(near(x0.position(), Vec3f(0.f, 0.f, 0.f)));
+	assert(near(x0.rotateDirection(Vec3f(1.f, 0.f, 0.f)), Vec3f(0.f, 1.f, 0.f)));
+	assert(near(x1.position(), Vec3f(0.f, 1.f, 0.f)));
+	assert(near(x1.rotateDirection(Vec3f(1.f, 0.f, 0.f)), Vec3f(1.f, 0.f, 0.f)));
+	assert(near(x2.position(), Vec3f(0.f, 0.f, 2.f)));
+	assert(near(x2.rotateDirection(Vec3f(1.f, 0.f, 0.f)), Vec3f(2.f, 0.f, 0.f)));
+
+	// Past the end of a clip that doesn't loop, every joint holds its last key
+	animNode.update(1.f);
+	assert(near(x0.rotateDirection(Vec3f(1.f, 0.f, 0.f)), Vec3f(-1.f, 0.f, 0.f)));
+	assert(near(x1.position(), Vec3f(0.f, 2.f, 0.f)));
+	assert(near(x2.position(), Vec3f(0.f, 0.f, 4.f)));
+	assert(near(x2.rotateDirection(Vec3f(1.f, 0.f, 0.f)), Vec3f(3.f, 0.f, 0.f)));
+}
+
+int main()
+{
+	testWholeSkeleton();
+	return 0;
+}
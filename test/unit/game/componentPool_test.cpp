@@ -0,0 +1,86 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Component pool unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <game/scene/sceneNode.h>
+
+using namespace rev::game;
+
+struct ComponentA : Component
+{
+	ComponentA(int _value = 0) : value(_value) {}
+	int value;
+};
+
+struct ComponentB : Component
+{
+};
+
+void testLookup()
+{
+	auto& poolA = ComponentPool<ComponentA>::get();
+	auto& poolB = ComponentPool<ComponentB>::get();
+	{
+		SceneNode n0, n1, n2;
+		auto a0 = n0.addComponent<ComponentA>(0);
+		auto a1 = n1.addComponent(std::make_unique<ComponentA>(1));
+		auto b1 = n1.addComponent<ComponentB>();
+		assert(a0->node() == &n0 && a1->node() == &n1);
+
+		assert(n0.component<ComponentA>() == a0);
+		assert(n1.component<ComponentA>() == a1);
+		assert(n1.component<ComponentB>() == b1);
+		assert(!n0.component<ComponentB>());
+		assert(!n2.component<ComponentA>());
+
+		// The first component of each type wins
+		n0.addComponent<ComponentA>(2);
+		assert(n0.component<ComponentA>()->value == 0);
+		assert(n0.components().size() == 2);
+
+		// Components added as a plain Component can't be found by type
+		std::unique_ptr<Component> untyped = std::make_unique<ComponentB>();
+		n2.addComponent(std::move(untyped));
+		assert(!n2.component<ComponentB>());
+
+		// Per type iteration
+		assert(poolA.size() == 2);
+		int sum = 0;
+		for(auto a : poolA)
+			sum += a->value;
+		assert(sum == 1);
+		assert(poolB.size() == 1);
+		assert(poolB.owners()[0] == n1.handle());
+	}
+	// Destroyed nodes leave their pools
+	assert(poolA.size() == 0);
+	assert(poolB.size() == 0);
+}
+
+void testRemovalKeepsOthers()
+{
+	auto node0 = std::make_unique<SceneNode>();
+	auto node1 = std::make_unique<SceneNode>();
+	auto node2 = std::make_unique<SceneNode>();
+	node0->addComponent<ComponentA>(0);
+	node1->addComponent<ComponentA>(1);
+	node2->addComponent<ComponentA>(2);
+
+	auto handle0 = node0->handle();
+	node0.reset();
+	assert(ComponentPool<ComponentA>::get().size() == 2);
+	assert(node1->component<ComponentA>()->value == 1);
+	assert(node2->component<ComponentA>()->value == 2);
+
+	// Handles are recycled, and don't inherit components
+	SceneNode recycled;
+	assert(recycled.handle() == handle0);
+	assert(!recycled.component<ComponentA>());
+}
+
+int main()
+{
+	testLookup();
+	testRemovalKeepsOthers();
+	return 0;
+}
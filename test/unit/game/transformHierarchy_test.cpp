@@ -0,0 +1,219 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Transform hierarchy unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <core/tasks/jobSystem.h>
+#include <game/scene/sceneNode.h>
+#include <game/scene/transform/transform.h>
+#include <game/scene/transform/transformHierarchy.h>
+
+using namespace rev::core;
+using namespace rev::game;
+using namespace rev::math;
+
+using Id = TransformHierarchy::Id;
+
+std::default_random_engine rng(42);
+
+AffineTransform randomTransform()
+{
+	std::uniform_real_distribution<float> dist(-1.f, 1.f);
+	auto x = AffineTransform::identity();
+	x.setRotation(Quatf(normalize(Vec3f(dist(rng), dist(rng), 1.f)), dist(rng)));
+	x.position() = Vec3f(dist(rng), dist(rng), dist(rng));
+	return x;
+}
+
+bool equal(const AffineTransform& a, const AffineTransform& b)
+{
+	return std::memcmp(&a.matrix(), &b.matrix(), sizeof(Mat44f)) == 0;
+}
+
+// Same product order as the hierarchy, so results must match bit for bit
+AffineTransform referenceWorld(const TransformHierarchy& hierarchy, Id node)
+{
+	auto parent = hierarchy.parent(node);
+	if(parent == TransformHierarchy::cInvalid)
+		return hierarchy.local(node);
+	return referenceWorld(hierarchy, parent) * hierarchy.local(node);
+}
+
+// Random forest, where children are always added after their parents
+std::vector<Id> randomForest(TransformHierarchy& hierarchy, size_t numNodes)
+{
+	std::vector<Id> nodes;
+	for(size_t i = 0; i < numNodes; ++i)
+	{
+		Id parent = TransformHierarchy::cInvalid;
+		if(i > 0 && rng() % 8)
+			parent = nodes[rng() % nodes.size()];
+		nodes.push_back(hierarchy.add(randomTransform(), parent));
+	}
+	return nodes;
+}
+
+void checkWorlds(const TransformHierarchy& hierarchy, const std::vector<Id>& nodes)
+{
+	for(auto node : nodes)
+		assert(equal(hierarchy.world(node), referenceWorld(hierarchy, node)));
+}
+
+void testChain()
+{
+	TransformHierarchy hierarchy;
+	auto offset = AffineTransform::identity();
+	offset.position() = Vec3f(1.f, 0.f, 0.f);
+	// Added in reverse, so the arrays start out of order
+	auto c = hierarchy.add(offset);
+	auto b = hierarchy.add(offset);
+	auto a = hierarchy.add(offset);
+	hierarchy.setParent(c, b);
+	hierarchy.setParent(b, a);
+	hierarchy.update();
+	assert(hierarchy.numLevels() == 3);
+	assert(hierarchy.numUpdated() == 3);
+	assert(hierarchy.world(c).position().x() == 3.f);
+
+	// Only the changed subtree is updated
+	hierarchy.local(b).position().x() = 2.f;
+	hierarchy.update();
+	assert(hierarchy.numUpdated() == 2);
+	assert(hierarchy.world(a).position().x() == 1.f);
+	assert(hierarchy.world(c).position().x() == 4.f);
+
+	hierarchy.update();
+	assert(hierarchy.numUpdated() == 0);
+
+	// Removing b hooks c up to a
+	hierarchy.remove(b);
+	assert(hierarchy.parent(c) == a);
+	hierarchy.update();
+	assert(hierarchy.size() == 2);
+	assert(hierarchy.numLevels() == 2);
+	assert(hierarchy.world(c).position().x() == 2.f);
+
+	// Ids are recycled
+	assert(hierarchy.add(offset, c) == b);
+}
+
+void testRandomForest()
+{
+	TransformHierarchy hierarchy;
+	auto nodes = randomForest(hierarchy, 5000);
+	hierarchy.update();
+	assert(hierarchy.numUpdated() == nodes.size());
+	checkWorlds(hierarchy, nodes);
+
+	for(int i = 0; i < 50; ++i)
+		hierarchy.setLocal(nodes[rng() % nodes.size()], randomTransform());
+	hierarchy.update();
+	assert(hierarchy.numUpdated() >= 50 && hierarchy.numUpdated() < nodes.size());
+	checkWorlds(hierarchy, nodes);
+
+	// Reparent towards a root, which can't create cycles
+	for(int i = 0; i < 50; ++i)
+	{
+		auto node = nodes[rng() % nodes.size()];
+		auto root = node;
+		while(hierarchy.parent(root) != TransformHierarchy::cInvalid)
+			root = hierarchy.parent(root);
+		if(root != node)
+			hierarchy.setParent(node, root);
+	}
+	hierarchy.update();
+	checkWorlds(hierarchy, nodes);
+}
+
+void testParallelUpdate()
+{
+	TransformHierarchy serial, parallel;
+	auto seed = rng();
+	rng.seed(seed);
+	auto nodes = randomForest(serial, 100000);
+	rng.seed(seed);
+	randomForest(parallel, 100000);
+
+	serial.update();
+	parallel.update(JobSystem::get());
+	assert(parallel.numUpdated() == serial.numUpdated());
+	for(auto node : nodes)
+		assert(equal(parallel.world(node), serial.world(node)));
+
+	for(size_t i = 0; i < nodes.size(); i += 10)
+	{
+		auto x = randomTransform();
+		serial.setLocal(nodes[i], x);
+		parallel.setLocal(nodes[i], x);
+	}
+	serial.update();
+	parallel.update(JobSystem::get());
+	assert(parallel.numUpdated() == serial.numUpdated());
+	for(auto node : nodes)
+		assert(equal(parallel.world(node), serial.world(node)));
+	checkWorlds(parallel, nodes);
+}
+
+// Moves its node during the logic update, like FlyBy or the animator do
+struct Mover : Component
+{
+	void update(float _dt) override
+	{
+		node()->component<Transform>()->xForm().position().x() += _dt;
+	}
+};
+
+// Consumes the world transform, like cameras or mesh renderers do
+struct Reader : Component
+{
+	void lateUpdate(float) override
+	{
+		seen = node()->component<Transform>()->absoluteXForm().position().x();
+	}
+	float seen = -1.f;
+};
+
+void testComponentsSeeThisFramesTransforms()
+{
+	auto root = std::make_shared<SceneNode>();
+	auto child = std::make_shared<SceneNode>();
+	root->addChild(child);
+	root->addComponent<Transform>();
+	root->addComponent<Mover>();
+	child->addComponent<Transform>();
+	auto reader = child->addComponent<Reader>();
+	root->init();
+
+	for(int frame = 1; frame <= 3; ++frame)
+	{
+		root->update(1.f);
+		Transform::hierarchy().update();
+		root->lateUpdate(1.f);
+		assert(reader->seen == float(frame));
+	}
+}
+
+// Destroyed during static destruction, after statics first used inside main
+std::unique_ptr<Transform> gStaticTransform;
+
+void testTransformsOutliveMain()
+{
+	gStaticTransform = std::make_unique<Transform>();
+	gStaticTransform->xForm().position().x() = 1.f;
+	Transform::hierarchy().update();
+	assert(gStaticTransform->absoluteXForm().position().x() == 1.f);
+}
+
+int main()
+{
+	JobSystem::init(4);
+	testChain();
+	testRandomForest();
+	testParallelUpdate();
+	testComponentsSeeThisFramesTransforms();
+	testTransformsOutliveMain();
+	JobSystem::end();
+	return 0;
+}
@@ -0,0 +1,185 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Keyframe animation unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cstring>
+#include <random>
+#include <graphics/scene/animation/animation.h>
+
+using namespace rev::gfx;
+using namespace rev::math;
+
+std::default_random_engine rng(42);
+
+template<class T>
+bool bitwiseEqual(const T& a, const T& b)
+{
+	return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+std::vector<float> randomTimes(size_t numKeys)
+{
+	std::uniform_real_distribution<float> step(0.01f, 0.1f);
+	std::vector<float> times;
+	float t = step(rng);
+	for(size_t i = 0; i < numKeys; ++i)
+	{
+		times.push_back(t);
+		t += step(rng);
+	}
+	return times;
+}
+
+Vec3f randomVec3()
+{
+	std::uniform_real_distribution<float> dist(-1.f, 1.f);
+	return Vec3f(dist(rng), dist(rng), dist(rng));
+}
+
+Quatf randomQuat()
+{
+	std::uniform_real_distribution<float> dist(-1.f, 1.f);
+	return Quatf(normalize(Vec3f(dist(rng), dist(rng), 1.f)), dist(rng));
+}
+
+template<class T, class Gen>
+Animation::Channel<T> randomChannel(size_t numKeys, Gen gen)
+{
+	Animation::Channel<T> channel;
+	channel.t = randomTimes(numKeys);
+	for(size_t i = 0; i < numKeys; ++i)
+		channel.values.push_back(gen());
+	return channel;
+}
+
+Vec3f lerp(const Vec3f& a, const Vec3f& b, float f) { return a * (1 - f) + b * f; }
+Quatf lerp(const Quatf& a, const Quatf& b, float f) { return Quatf::lerp(a, b, f); }
+
+// Linear scan over every key, the way clips used to be sampled
+template<class T>
+T referenceSample(const Animation::Channel<T>& channel, float t)
+{
+	if(t <= channel.t.front())
+		return channel.values.front();
+	if(t >= channel.t.back())
+		return channel.values.back();
+	size_t i = 0;
+	while(channel.t[i+1] <= t)
+		++i;
+	auto f = (t - channel.t[i]) / (channel.t[i+1] - channel.t[i]);
+	return lerp(channel.values[i], channel.values[i+1], f);
+}
+
+struct Clip
+{
+	std::vector<Animation::Channel<Vec3f>> translations;
+	std::vector<Animation::Channel<Quatf>> rotations;
+	std::vector<Animation::Channel<Vec3f>> scales;
+};
+
+Clip randomClip(size_t numJoints)
+{
+	Clip clip;
+	for(size_t i = 0; i < numJoints; ++i)
+	{
+		clip.translations.push_back(randomChannel<Vec3f>(1 + rng() % 40, randomVec3));
+		clip.rotations.push_back(randomChannel<Quatf>(1 + rng() % 40, randomQuat));
+		clip.scales.push_back(randomChannel<Vec3f>(1 + rng() % 40, randomVec3));
+	}
+	return clip;
+}
+
+void checkPose(const Clip& clip, const Pose& pose, float t)
+{
+	for(size_t i = 0; i < pose.joints.size(); ++i)
+	{
+		assert(bitwiseEqual(pose.joints[i].translation, referenceSample(clip.translations[i], t)));
+		assert(bitwiseEqual(pose.joints[i].rotation, referenceSample(clip.rotations[i], t)));
+		assert(bitwiseEqual(pose.joints[i].scale, referenceSample(clip.scales[i], t)));
+	}
+}
+
+void testRandomAccess()
+{
+	auto clip = randomClip(20);
+	Animation animation(clip.translations, clip.rotations, clip.scales);
+	assert(animation.numJoints() == 20);
+
+	float duration = 0.f;
+	for(auto& c : clip.rotations) duration = std::max(duration, c.t.back());
+	for(auto& c : clip.translations) duration = std::max(duration, c.t.back());
+	for(auto& c : clip.scales) duration = std::max(duration, c.t.back());
+	assert(animation.duration() == duration);
+
+	std::uniform_real_distribution<float> time(-0.5f, duration + 0.5f);
+	Pose pose;
+	for(int i = 0; i < 1000; ++i)
+	{
+		float t = time(rng);
+		animation.getPose(t, pose);
+		checkPose(clip, pose, t);
+	}
+	// Exactly on keys
+	for(auto t : clip.rotations[3].t)
+	{
+		animation.getPose(t, pose);
+		checkPose(clip, pose, t);
+	}
+}
+
+void testCursorPlayback()
+{
+	auto clip = randomClip(20);
+	Animation animation(clip.translations, clip.rotations, clip.scales);
+	Animation::Cursor cursor;
+	Pose pose;
+
+	// Small steps, large steps and loops, with the same cursor
+	for(float dt : { 0.001f, 0.03f, 0.7f })
+	{
+		for(int loop = 0; loop < 3; ++loop)
+		{
+			for(float t = 0.f; t < animation.duration(); t += dt)
+			{
+				animation.getPose(t, cursor, pose);
+				checkPose(clip, pose, t);
+			}
+		}
+	}
+
+	// Single joints share the cursor with whole poses
+	Pose::JointPose joint;
+	animation.getJointPose(5, 0.1f, cursor, joint);
+	assert(bitwiseEqual(joint.rotation, referenceSample(clip.rotations[5], 0.1f)));
+}
+
+void testMissingChannelsAreUntouched()
+{
+	Clip clip;
+	clip.rotations.push_back(randomChannel<Quatf>(4, randomQuat));
+	clip.rotations.push_back({});
+	Animation animation(clip.translations, clip.rotations, clip.scales);
+	assert(animation.numJoints() == 2);
+
+	Pose pose;
+	pose.joints.resize(2);
+	for(auto& joint : pose.joints)
+	{
+		joint.translation = Vec3f(1.f, 2.f, 3.f);
+		joint.scale = Vec3f::ones();
+		joint.rotation = Quatf::identity();
+	}
+	animation.getPose(0.1f, pose);
+	assert(bitwiseEqual(pose.joints[0].rotation, referenceSample(clip.rotations[0], 0.1f)));
+	assert(pose.joints[0].translation == Vec3f(1.f, 2.f, 3.f));
+	assert(pose.joints[1].rotation == Quatf::identity());
+	assert(pose.joints[1].scale == Vec3f::ones());
+}
+
+int main()
+{
+	testRandomAccess();
+	testCursorPlayback();
+	testMissingChannelsAreUntouched();
+	return 0;
+}
@@ -0,0 +1,175 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Command buffer recording benchmark
+//----------------------------------------------------------------------------------------------------------------------
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <graphics/backend/commandBuffer.h>
+
+using namespace rev::gfx;
+using namespace rev::math;
+
+// Count every heap allocation in the process
+std::atomic<size_t> gNumAllocations = 0;
+
+void* operator new(size_t size)
+{
+	++gNumAllocations;
+	if(void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+constexpr size_t kNumDraws = 10000;
+
+// Record a frame similar to a geometry pass: a few pipelines and meshes, and per draw uniforms
+void recordFrame(CommandBuffer& commands, CommandBuffer::UniformBucket& uniforms)
+{
+	commands.clear();
+	commands.bindFrameBuffer(FrameBuffer(1));
+	commands.setViewport(Vec2u::zero(), Vec2u(1920, 1080));
+	commands.setScissor(Vec2u::zero(), Vec2u(1920, 1080));
+	commands.clearColor(Vec4f::zero());
+	commands.clearDepth(0.f);
+	commands.clear(Clear::All);
+
+	Pipeline pipeline;
+	for(size_t i = 0; i < kNumDraws; ++i)
+	{
+		if(i % 100 == 0)
+		{
+			pipeline.id = int32_t(1 + i / 100);
+			commands.setPipeline(pipeline);
+		}
+		if(i % 10 == 0)
+			commands.setVertexData(unsigned(1 + i / 10));
+
+		uniforms.clear();
+		Mat44f world = Mat44f::identity();
+		world(0,3) = float(i);
+		uniforms.addParam(0, world);
+		uniforms.addParam(1, world);
+		uniforms.addParam(2, Vec4f(1.f, 0.5f, 0.25f, 1.f));
+		uniforms.addParam(3, Texture2d(int32_t(1 + i % 16)));
+		commands.setUniformData(uniforms);
+
+		commands.drawTriangles(3 * 1024, CommandBuffer::IndexType::U16, nullptr);
+	}
+}
+
+// Recording in chunks and appending them must produce the same commands as recording serially
+void testAppend()
+{
+	CommandBuffer serial;
+	CommandBuffer chunks[4];
+	CommandBuffer::UniformBucket uniforms;
+	Mat44f palette[3] = { Mat44f::identity(), Mat44f::identity(), Mat44f::identity() };
+	for(int i = 0; i < 400; ++i)
+	{
+		auto& chunk = chunks[i / 100];
+		uniforms.clear();
+		palette[1](1,3) = float(i);
+		uniforms.addParam(0, float(i));
+		uniforms.addParam(1, palette, 3);
+		serial.setUniformData(uniforms);
+		chunk.setUniformData(uniforms);
+		serial.drawTriangles(i, CommandBuffer::IndexType::U32, nullptr);
+		chunk.drawTriangles(i, CommandBuffer::IndexType::U32, nullptr);
+	}
+	CommandBuffer merged;
+	merged.clearDepth(1.f); // Misalign the payload stream
+	for(auto& chunk : chunks)
+		merged.append(chunk);
+
+	auto& commands = merged.commands();
+	assert(commands.size() == serial.commands().size() + 1);
+	assert(merged.metrics().numDraws == serial.metrics().numDraws);
+	assert(merged.metrics().numTriangles == serial.metrics().numTriangles);
+	for(size_t i = 0; i < serial.commands().size(); ++i)
+	{
+		auto& a = serial.commands()[i];
+		auto& b = commands[i+1];
+		assert(a.command == b.command);
+		switch(a.command)
+		{
+			case CommandBuffer::Command::SetUniformFloat:
+				assert(serial.getUniform<float>(a.payload).value == merged.getUniform<float>(b.payload).value);
+				break;
+			case CommandBuffer::Command::SetUniformMat4Array:
+				assert(merged.getPayload<CommandBuffer::UniformArray>(b.payload).count == 3);
+				assert(std::memcmp(serial.getMatrices(a.payload), merged.getMatrices(b.payload), 3 * sizeof(Mat44f)) == 0);
+				break;
+			case CommandBuffer::Command::DrawTriangles:
+				assert(serial.getDraw(a.payload).nIndices == merged.getDraw(b.payload).nIndices);
+				break;
+			default:
+				assert(false);
+		}
+	}
+}
+
+int main()
+{
+	testAppend();
+
+	CommandBuffer commands;
+	CommandBuffer::UniformBucket uniforms;
+
+	// Warm up
+	for(int i = 0; i < 3; ++i)
+		recordFrame(commands, uniforms);
+
+	constexpr size_t kNumFrames = 50;
+	size_t allocationsBefore = gNumAllocations;
+	auto start = std::chrono::high_resolution_clock::now();
+	for(size_t i = 0; i < kNumFrames; ++i)
+		recordFrame(commands, uniforms);
+	auto end = std::chrono::high_resolution_clock::now();
+	size_t allocationsPerFrame = (gNumAllocations - allocationsBefore) / kNumFrames;
+
+	auto metrics = commands.metrics();
+	assert(metrics.numDraws == kNumDraws);
+	assert(metrics.numUniforms == 4 * kNumDraws);
+	assert(metrics.numUniformBuckets == kNumDraws);
+
+	// Payloads must be readable back with the values recorded
+	size_t numDraws = 0;
+	for(auto& cmd : commands.commands())
+	{
+		if(cmd.command == CommandBuffer::Command::SetUniformMat4)
+		{
+			auto& uniform = commands.getUniform<Mat44f>(cmd.payload);
+			assert(uniform.value(0,3) == float(numDraws));
+		}
+		if(cmd.command == CommandBuffer::Command::DrawTriangles)
+		{
+			assert(commands.getDraw(cmd.payload).nIndices == 3 * 1024);
+			++numDraws;
+		}
+	}
+	assert(numDraws == kNumDraws);
+
+	double ns = std::chrono::duration<double, std::nano>(end - start).count();
+	printf("%zu draws, %zu commands, %zu bytes per frame\n", kNumDraws, metrics.numCommands, commands.memoryUsage());
+	printf("%.2f ns/command, %.2f us/frame, %zu allocations/frame\n",
+		ns / (kNumFrames * metrics.numCommands),
+		ns / (kNumFrames * 1000),
+		allocationsPerFrame);
+
+	// Once warmed up, recording must not touch the heap
+	assert(allocationsPerFrame == 0);
+	return allocationsPerFrame == 0 ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Headless device unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <string>
+#include <vector>
+#include <graphics/backend/Null/deviceNull.h>
+
+using namespace rev::gfx;
+using namespace rev::math;
+
+void testBufferBookkeeping()
+{
+	DeviceNull device;
+	float data[4] = { 1.f, 2.f, 3.f, 4.f };
+	auto buffer = device.allocateTypedBuffer<float>(4, Device::BufferUpdateFrequency::Static, Device::BufferUsageTarget::Vertex, data);
+	assert(device.resources().numBuffers == 1);
+	assert(device.resources().bufferBytes == sizeof(data));
+	assert(device.resources().uploadedBytes == sizeof(data));
+
+	// Mapped memory is real, and keeps its contents
+	auto mapped = device.mapTypedBuffer<float>(buffer, Device::BufferUsageTarget::Vertex, 0, 4);
+	assert(mapped[2] == 3.f);
+	mapped[2] = 5.f;
+	device.unmapBuffer(buffer, Device::BufferUsageTarget::Vertex);
+	assert(reinterpret_cast<const float*>(device.bufferContents(buffer).data())[2] == 5.f);
+
+	// Handles are recycled
+	device.deallocateBuffer(buffer);
+	assert(device.resources().numBuffers == 0);
+	assert(device.resources().bufferBytes == 0);
+	auto other = device.allocateBuffer(16, Device::BufferUpdateFrequency::Static, Device::BufferUsageTarget::Vertex);
+	assert(other.id() == buffer.id());
+}
+
+void testIndirectDrawsAreCounted()
+{
+	DeviceNull device;
+	CommandBuffer::BatchCommand batches[3];
+	for(uint32_t i = 0; i < 3; ++i)
+	{
+		batches[i].count = 300;
+		batches[i].instanceCount = i + 1;
+		batches[i].baseInstance = i;
+	}
+	auto batchBuffer = device.allocateTypedBuffer(3, Device::BufferUpdateFrequency::Streamming, Device::BufferUsageTarget::DrawIndirect, batches);
+
+	CommandBuffer commands;
+	commands.drawTrianglesBatch(2, CommandBuffer::IndexType::U16, batchBuffer, 1);
+	commands.drawTriangles(30, CommandBuffer::IndexType::U16, nullptr);
+
+	auto& queue = static_cast<RenderQueueNull&>(device.renderQueue());
+	queue.submitCommandBuffer(commands);
+	auto& counters = queue.counters();
+	assert(counters.numDraws == 2);
+	assert(counters.numIndirectDraws == 2);
+	assert(counters.numInstances == 2 + 3 + 1);
+	assert(counters.numTriangles == 100 * (2 + 3) + 10);
+}
+
+void testRecycledComputeShadersDontInheritUniforms()
+{
+	DeviceNull device;
+	auto& queue = static_cast<RenderQueueNull&>(device.renderQueue());
+	CommandBuffer::UniformBucket uniforms;
+	uniforms.addParam(0, 1.f);
+	auto submitWith = [&](ComputeShader shader) {
+		CommandBuffer commands;
+		commands.setComputeProgram(shader);
+		commands.setUniformData(uniforms);
+		queue.submitCommandBuffer(commands);
+	};
+
+	const std::vector<std::string> code = { "void main() {}" };
+	auto shader = device.createComputeShader(code);
+	submitWith(shader);
+	submitWith(shader);
+	auto elided = queue.counters().numElidedStateChanges;
+	assert(elided > 0);
+
+	// Same handle, but a different program. Its uniform must be set again.
+	device.destroyComputeShader(shader);
+	auto recycled = device.createComputeShader(code);
+	assert(recycled.id() == shader.id());
+	submitWith(recycled);
+	assert(queue.counters().numElidedStateChanges == elided);
+}
+
+int main()
+{
+	testBufferBookkeeping();
+	testIndirectDrawsAreCounted();
+	testRecycledComputeShadersDontInheritUniforms();
+	return 0;
+}
@@ -0,0 +1,113 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Indirect geometry packing unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <core/platform/fileSystem/fileSystem.h>
+#include <graphics/backend/Null/deviceNull.h>
+#include <graphics/renderer/material/Effect.h>
+#include <graphics/renderer/material/material.h>
+#include <graphics/renderer/renderPass/geometryPass.h>
+#include <graphics/scene/renderGeom.h>
+#include <graphics/shaders/shaderCodeFragment.h>
+
+using namespace rev;
+using namespace rev::gfx;
+using namespace rev::math;
+
+const char* kEffectFile = "geometryPass_test.fx";
+
+RenderItem item(const RenderGeom& geom, const Material& material, float x)
+{
+	RenderItem result;
+	result.world = Mat44f::identity();
+	result.world(0,3) = x;
+	result.geom = &geom;
+	result.material = &material;
+	return result;
+}
+
+float instanceX(const GeometryPass::IndirectBatches::InstanceData& instance)
+{
+	auto world = Mat44f::is_col_major ? instance.world : instance.world.transpose();
+	return world(0,3);
+}
+
+void testPackIndirect()
+{
+	DeviceNull device;
+	auto effect = std::make_shared<Effect>(kEffectFile);
+	Material::Descriptor materialDesc;
+	materialDesc.effect = effect;
+	Material materialA(materialDesc);
+	Material materialB(materialDesc);
+	RenderGeom geomA{};
+	RenderGeom geomB{};
+
+	ShaderCodeFragment passCode("// Pass code\n");
+	GeometryPass pass(device, &passCode);
+	GeometryPass::IndirectBatches batches(device);
+
+	// Sorted by material, then geometry, then depth, the way the deferred renderer does it.
+	// The last item shares state with the first ones, but must not be moved in front of the items between them.
+	std::vector<RenderItem> items = {
+		item(geomA, materialA, 0.f),
+		item(geomA, materialA, 1.f),
+		item(geomB, materialA, 2.f),
+		item(geomA, materialB, 3.f),
+		item(geomA, materialB, 4.f),
+		item(geomA, materialB, 5.f),
+		item(geomA, materialA, 6.f),
+	};
+	pass.packIndirect(Mat44f::identity(), Mat44f::identity(), items, Pipeline::RasterOptions(), batches);
+
+	auto& groups = batches.groups();
+	auto& commands = batches.commands();
+	assert(groups.size() == 4);
+	assert(commands.size() == groups.size());
+	const uint32_t expectedFirst[] = { 0, 2, 3, 6 };
+	const uint32_t expectedCount[] = { 2, 1, 3, 1 };
+	for(size_t i = 0; i < groups.size(); ++i)
+	{
+		assert(groups[i].pipeline.isValid());
+		assert(groups[i].firstInstance == expectedFirst[i]);
+		assert(commands[i].baseInstance == expectedFirst[i]);
+		assert(commands[i].instanceCount == expectedCount[i]);
+		auto& firstItem = items[expectedFirst[i]];
+		assert(groups[i].geom == firstItem.geom && groups[i].material == firstItem.material);
+	}
+	assert(groups[0].pipeline.id == groups[1].pipeline.id); // Same code, so the pipeline is shared
+
+	// Instances keep the order of the list
+	assert(batches.numInstances() == items.size());
+	for(size_t i = 0; i < batches.numInstances(); ++i)
+		assert(instanceX(batches.instances()[i]) == float(i));
+
+	// One indirect draw per group reaches the device
+	CommandBuffer commandBuffer;
+	pass.renderIndirect(batches, Material::Flags::Shading, commandBuffer);
+	auto& queue = static_cast<RenderQueueNull&>(device.renderQueue());
+	queue.submitCommandBuffer(commandBuffer);
+	auto& counters = queue.counters();
+	assert(counters.numDraws == groups.size());
+	assert(counters.numIndirectDraws == groups.size());
+	assert(counters.numInstances == items.size());
+	assert(counters.numPipelineChanges == 1);
+
+	// Packing again reuses the buffers
+	auto buffersBefore = device.resources().numBuffers;
+	pass.packIndirect(Mat44f::identity(), Mat44f::identity(), items, Pipeline::RasterOptions(), batches);
+	assert(batches.groups().size() == 4);
+	assert(device.resources().numBuffers == buffersBefore);
+}
+
+int main()
+{
+	std::ofstream(kEffectFile) << "// Empty effect\n";
+	core::FileSystem::init();
+	testPackIndirect();
+	core::FileSystem::end();
+	return 0;
+}
@@ -0,0 +1,244 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Render graph unit testing, on a headless device
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <vector>
+#include <core/tasks/jobSystem.h>
+#include <graphics/backend/Null/deviceNull.h>
+#include <graphics/debug/imgui.h>
+#include <graphics/renderGraph/frameBufferCache.h>
+#include <graphics/renderGraph/renderGraph.h>
+
+using namespace rev::gfx;
+using namespace rev::math;
+
+constexpr int kDrawsPerPass = 100;
+
+// The graph draws its debug window during build, so it needs a gui frame to draw into
+void beginGuiFrame()
+{
+	auto& io = ImGui::GetIO();
+	io.DisplaySize = ImVec2(1280.f, 720.f);
+	io.DeltaTime = 1.f / 60;
+	ImGui::NewFrame();
+}
+
+void endGuiFrame()
+{
+	ImGui::Render();
+}
+
+// Chain of passes, each one reading the output of the previous one.
+// Pass definitions run during build, so outputs must outlive this call.
+void addChain(RenderGraph& graph, std::vector<RenderGraph::BufferResource>& outputs, FrameBuffer backBuffer)
+{
+	auto size = Vec2u(256, 128);
+	int numPasses = (int)outputs.size();
+	for(int i = 0; i < numPasses; ++i)
+	{
+		graph.addPass("pass", size,
+			[&outputs, i, numPasses, backBuffer](RenderGraph::IPassBuilder& builder) {
+				if(i > 0)
+					builder.read(outputs[i-1], 0);
+				if(i == numPasses-1)
+					outputs[i] = builder.write(backBuffer);
+				else
+					outputs[i] = builder.write(BufferFormat::RGBA8);
+			},
+			[](const Texture2d*, size_t, CommandBuffer& dst) {
+				for(int j = 0; j < kDrawsPerPass; ++j)
+					dst.drawTriangles(3, CommandBuffer::IndexType::U16, nullptr);
+			});
+	}
+}
+
+void testTransientTargetsAreAliased()
+{
+	DeviceNull device;
+	FrameBufferCache cache(device);
+	RenderGraph graph(device);
+
+	std::vector<RenderGraph::BufferResource> outputs(4);
+	beginGuiFrame();
+	addChain(graph, outputs, device.defaultFrameBuffer());
+	graph.build(cache);
+	endGuiFrame();
+
+	// Three transient targets, but the first one is dead by the time the third is written
+	auto& memory = graph.memoryReport();
+	assert(memory.numVirtualTextures == 3);
+	assert(memory.numPhysicalTextures == 2);
+	assert(memory.peakBytes == 2 * 256 * 128 * 4);
+	assert(memory.aliasedBytes == 256 * 128 * 4);
+	assert(device.resources().numTextures == memory.numPhysicalTextures);
+	assert(device.resources().textureBytes == memory.peakBytes);
+
+	// Resources are returned to the device without leaks or double frees
+	cache.deallocateResources();
+	assert(device.resources().numTextures == 0);
+	assert(device.resources().numFrameBuffers == 0);
+	assert(device.resources().textureBytes == 0);
+}
+
+void testRebuildsDontAllocate()
+{
+	DeviceNull device;
+	FrameBufferCache cache(device);
+	RenderGraph graph(device);
+
+	std::vector<RenderGraph::BufferResource> outputs(4);
+	for(int frame = 0; frame < 10; ++frame)
+	{
+		beginGuiFrame();
+		graph.reset();
+		addChain(graph, outputs, device.defaultFrameBuffer());
+		graph.build(cache);
+		endGuiFrame();
+
+		assert(graph.buildStats().numCompilations == 1);
+		assert(graph.buildStats().cached == (frame > 0));
+		assert(device.resources().numTextures == 2);
+	}
+}
+
+void testSubmission()
+{
+	DeviceNull device;
+	FrameBufferCache cache(device);
+	RenderGraph graph(device);
+
+	std::vector<RenderGraph::BufferResource> outputs(4);
+	beginGuiFrame();
+	addChain(graph, outputs, device.defaultFrameBuffer());
+	graph.build(cache);
+	endGuiFrame();
+
+	CommandBuffer commands;
+	graph.evaluate(commands);
+	auto& queue = static_cast<RenderQueueNull&>(device.renderQueue());
+	queue.submitCommandBuffer(commands);
+
+	auto& counters = queue.counters();
+	assert(counters.numSubmissions == 1);
+	assert(counters.numCommands == commands.commands().size());
+	assert(counters.commandBytes == commands.memoryUsage());
+	assert(counters.numDraws == 4 * kDrawsPerPass);
+	assert(counters.numTriangles == 4 * kDrawsPerPass);
+
+	queue.present();
+	assert(queue.counters().numCommands == 0);
+	assert(queue.numPresentedFrames() == 1);
+}
+
+// Same chain, but every other pass is recorded in parallel, and each pass draws a different number of indices
+void addMixedChain(RenderGraph& graph, std::vector<RenderGraph::BufferResource>& outputs, FrameBuffer backBuffer)
+{
+	auto size = Vec2u(256, 128);
+	int numPasses = (int)outputs.size();
+	for(int i = 0; i < numPasses; ++i)
+	{
+		graph.addPass("pass", size,
+			[&outputs, i, numPasses, backBuffer](RenderGraph::IPassBuilder& builder) {
+				if(i % 2 == 0)
+					builder.recordInParallel();
+				if(i > 0)
+					builder.read(outputs[i-1], 0);
+				if(i == numPasses-1)
+					outputs[i] = builder.write(backBuffer);
+				else
+					outputs[i] = builder.write(BufferFormat::RGBA8);
+			},
+			[i](const Texture2d*, size_t, CommandBuffer& dst) {
+				for(int j = 0; j < kDrawsPerPass; ++j)
+					dst.drawTriangles(3 * (i + 1), CommandBuffer::IndexType::U16, nullptr);
+			});
+	}
+}
+
+// Payload offsets change when buffers are merged, so compare what they point to
+void assertSameCommands(const CommandBuffer& a, const CommandBuffer& b)
+{
+	assert(a.commands().size() == b.commands().size());
+	for(size_t i = 0; i < a.commands().size(); ++i)
+	{
+		auto& cmdA = a.commands()[i];
+		auto& cmdB = b.commands()[i];
+		assert(cmdA.command == cmdB.command);
+		switch(cmdA.command)
+		{
+			case CommandBuffer::Command::DrawTriangles:
+			{
+				auto& drawA = a.getDraw(cmdA.payload);
+				auto& drawB = b.getDraw(cmdB.payload);
+				assert(drawA.nIndices == drawB.nIndices);
+				assert(drawA.indexType == drawB.indexType);
+				assert(drawA.offset == drawB.offset);
+				break;
+			}
+			case CommandBuffer::Command::SetViewport:
+			case CommandBuffer::Command::SetScissor:
+			{
+				auto& rectA = a.getRect(cmdA.payload);
+				auto& rectB = b.getRect(cmdB.payload);
+				assert(rectA.pos.x() == rectB.pos.x() && rectA.pos.y() == rectB.pos.y());
+				assert(rectA.size.x() == rectB.size.x() && rectA.size.y() == rectB.size.y());
+				break;
+			}
+			default:
+				assert(!CommandBuffer::hasPayload(cmdA.command));
+				assert(cmdA.payload == cmdB.payload);
+		}
+	}
+}
+
+void testParallelEvaluationMatchesSerial()
+{
+	rev::core::JobSystem::init(3);
+	DeviceNull device;
+	FrameBufferCache cache(device);
+	RenderGraph graph(device);
+
+	std::vector<RenderGraph::BufferResource> outputs(6);
+	beginGuiFrame();
+	addMixedChain(graph, outputs, device.defaultFrameBuffer());
+	graph.build(cache);
+	endGuiFrame();
+
+	CommandBuffer serial;
+	graph.evaluate(serial);
+	size_t expectedIndices = 0;
+	for(size_t i = 0; i < outputs.size(); ++i)
+		expectedIndices += 3 * (i + 1) * kDrawsPerPass;
+
+	// Evaluate a few times, so a lucky schedule doesn't hide ordering bugs
+	for(int frame = 0; frame < 20; ++frame)
+	{
+		CommandBuffer parallel;
+		graph.evaluate(parallel, rev::core::JobSystem::get());
+		assertSameCommands(serial, parallel);
+
+		auto& queue = static_cast<RenderQueueNull&>(device.renderQueue());
+		queue.submitCommandBuffer(parallel);
+		assert(queue.counters().numDraws == outputs.size() * kDrawsPerPass);
+		assert(queue.counters().numTriangles == expectedIndices / 3);
+		queue.present();
+	}
+
+	rev::core::JobSystem::end();
+}
+
+int main()
+{
+	ImGui::GetIO().IniFilename = nullptr; // Don't leave settings files around
+	unsigned char* pixels;
+	int width, height;
+	ImGui::GetIO().Fonts->GetTexDataAsAlpha8(&pixels, &width, &height);
+
+	testTransientTargetsAreAliased();
+	testRebuildsDontAllocate();
+	testSubmission();
+	testParallelEvaluationMatchesSerial();
+
+	ImGui::Shutdown();
+	return 0;
+}
@@ -0,0 +1,188 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Redundant state filtering unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <map>
+#include <graphics/backend/commandBuffer.h>
+#include <graphics/backend/stateCache.h>
+
+using namespace rev::gfx;
+using namespace rev::math;
+
+// Replays command buffers the same way the OpenGL queue does, but only counts the backend calls
+struct MockBackend
+{
+	StateCache state;
+	std::map<int,int> textureSlots;
+	size_t numCalls = 0;
+	size_t numPipelineChanges = 0;
+
+	void bindTexture(int pos, Texture2d texture)
+	{
+		auto slot = textureSlots.emplace(pos, (int)textureSlots.size()).first->second;
+		if(state.bindTexture(slot, texture.id()))
+			numCalls += 2;
+		if(state.setUniform(pos, slot))
+			numCalls++;
+	}
+
+	template<class T>
+	void setUniform(const CommandBuffer& commands, int32_t payload)
+	{
+		auto& uniform = commands.getUniform<T>(payload);
+		if(state.setUniform(uniform.pos, uniform.value))
+			numCalls++;
+	}
+
+	void submit(const CommandBuffer& commands)
+	{
+		state.invalidate();
+		for(auto& cmd : commands.commands())
+		{
+			switch(cmd.command)
+			{
+				case CommandBuffer::Command::BeginPass:
+					state.invalidate();
+					numCalls++;
+					break;
+				case CommandBuffer::Command::SetPipeline:
+					if(state.setPipeline(cmd.payload))
+					{
+						numCalls++;
+						numPipelineChanges++;
+					}
+					break;
+				case CommandBuffer::Command::SetVtxData:
+					if(state.setVertexArray(cmd.payload))
+						numCalls++;
+					break;
+				case CommandBuffer::Command::SetUniformFloat: setUniform<float>(commands, cmd.payload); break;
+				case CommandBuffer::Command::SetUniformVec4: setUniform<Vec4f>(commands, cmd.payload); break;
+				case CommandBuffer::Command::SetUniformMat4: setUniform<Mat44f>(commands, cmd.payload); break;
+				case CommandBuffer::Command::SetUniformTexture:
+				{
+					auto& uniform = commands.getUniform<Texture2d>(cmd.payload);
+					bindTexture(uniform.pos, uniform.value);
+					break;
+				}
+				default:
+					numCalls++;
+			}
+		}
+	}
+};
+
+void testRedundantStateIsElided()
+{
+	StateCache state;
+	assert(state.setPipeline(1));
+	assert(!state.setPipeline(1));
+	assert(state.setComputeProgram(1)); // Different key space than pipelines
+	assert(state.setPipeline(1));
+	assert(state.setVertexArray(3));
+	assert(!state.setVertexArray(3));
+	assert(state.bindTexture(2, 7));
+	assert(!state.bindTexture(2, 7));
+	assert(state.bindTexture(2, 8));
+	assert(state.numElidedCalls() == 3);
+
+	state.invalidate();
+	assert(state.setPipeline(1));
+	assert(state.setVertexArray(3));
+	assert(state.bindTexture(2, 8));
+	state.resetCounters();
+	assert(state.numElidedCalls() == 0);
+}
+
+void testUniformsArePerProgram()
+{
+	StateCache state;
+	assert(state.setUniform(0, 1.f)); // No program bound, can't be cached
+	assert(state.setUniform(0, 1.f));
+
+	state.setPipeline(1);
+	assert(state.setUniform(0, 1.f));
+	assert(!state.setUniform(0, 1.f));
+	assert(state.setUniform(0, 2.f));
+	assert(state.setUniform(1, 2.f));
+	assert(state.setUniform(0, Vec4f(2.f, 0.f, 0.f, 0.f))); // Same bytes prefix, different type
+
+	// Values live in the program, so they survive switching programs
+	state.setPipeline(2);
+	assert(state.setUniform(1, 2.f));
+	state.setPipeline(1);
+	assert(!state.setUniform(1, 2.f));
+
+	// ... and invalidating the bound state
+	state.invalidate();
+	state.setPipeline(1);
+	assert(!state.setUniform(1, 2.f));
+
+	state.invalidateUniforms();
+	assert(state.setUniform(1, 2.f));
+
+	// Clearing resets depth writes, so the pipeline must be bound again
+	state.invalidatePipeline();
+	assert(state.setPipeline(1));
+}
+
+void testDestroyedProgramsForgetTheirUniforms()
+{
+	StateCache state;
+	state.setPipeline(1);
+	assert(state.setUniform(0, 1.f));
+	state.setComputeProgram(1); // Doesn't alias pipeline 1
+	assert(state.setUniform(0, 1.f));
+	assert(!state.setUniform(0, 1.f));
+
+	// A new program with the same id starts with no uniforms set
+	state.forgetComputeProgram(1);
+	assert(state.setComputeProgram(1));
+	assert(state.setUniform(0, 1.f));
+
+	// ... while other programs keep theirs
+	state.setPipeline(1);
+	assert(!state.setUniform(0, 1.f));
+}
+
+void testReplayElidesCalls()
+{
+	CommandBuffer commands;
+	CommandBuffer::UniformBucket uniforms;
+	Pipeline pipeline;
+	pipeline.id = 1;
+	for(int i = 0; i < 100; ++i)
+	{
+		commands.setPipeline(pipeline); // Redundant after the first draw
+		commands.setVertexData(unsigned(1 + i / 10));
+		uniforms.clear();
+		uniforms.addParam(0, Mat44f::identity());
+		uniforms.addParam(1, Vec4f(1.f, float(i / 50), 0.f, 1.f));
+		uniforms.addParam(2, Texture2d(1 + i % 2));
+		commands.setUniformData(uniforms);
+		commands.drawTriangles(3, CommandBuffer::IndexType::U16, nullptr);
+	}
+
+	MockBackend backend;
+	backend.submit(commands);
+	assert(backend.numPipelineChanges == 1);
+	// Pipeline: 1, vao: 10, matrix: 1, color: 2, textures: 2 per change + 1 sampler uniform, draws: 100
+	assert(backend.numCalls == 1 + 10 + 1 + 2 + 2*100 + 1 + 100);
+	assert(backend.state.numElidedCalls() == 99 + 90 + 99 + 98 + 99);
+
+	// Resubmitting must bind everything again, but uniform values are still stored in the program.
+	// Only the color changes, because the last value set doesn't match the first draw.
+	backend.numCalls = 0;
+	backend.state.resetCounters();
+	backend.submit(commands);
+	assert(backend.numCalls == 1 + 10 + 0 + 2 + 2*100 + 0 + 100);
+}
+
+int main()
+{
+	testRedundantStateIsElided();
+	testUniformsArePerProgram();
+	testDestroyedProgramsForgetTheirUniforms();
+	testReplayElidesCalls();
+	return 0;
+}
@@ -2,6 +2,7 @@
 // Math unit testing
 //----------------------------------------------------------------------------------------------------------------------
 #include <cassert>
+#include <cmath>
 #include <math/algebra/matrix.h>
 #include <math/algebra/vector.h>
 #include <math/algebra/quaternion.h>
@@ -115,8 +116,8 @@ void testQuaternions()
 		const Quatf id = Quatf({0.f,0.f,1.f}, HalfPi);
 		assert(id.x() == 0.f);
 		assert(id.y() == 0.f);
-		assert(id.z() == sqrt(2.f)*0.5f);
-		assert(id.w() == sqrt(2.f)*0.5f);
+		assert(std::abs(id.z() - sqrt(2.f)*0.5f) < 1e-6f);
+		assert(std::abs(id.w() - sqrt(2.f)*0.5f) < 1e-6f);
 	}
 	{
 		const Quatf id = Quatf({0.f,0.f,1.f}, Pi);
@@ -0,0 +1,223 @@
+//----------------------------------------------------------------------------------------------------------------------
+// BVH unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <core/tasks/jobSystem.h>
+#include <math/geometry/bvh.h>
+
+using namespace rev;
+using namespace rev::math;
+
+std::default_random_engine rng(1234);
+
+struct Mesh
+{
+	std::vector<Vec3f> vertices;
+	std::vector<uint32_t> indices;
+};
+
+Vec3f randomPoint(float range)
+{
+	std::uniform_real_distribution<float> dist(-range, range);
+	return Vec3f(dist(rng), dist(rng), dist(rng));
+}
+
+Mesh randomTriangles(size_t n)
+{
+	Mesh mesh;
+	for(size_t i = 0; i < n; ++i)
+	{
+		Vec3f center = randomPoint(20.f);
+		for(int v = 0; v < 3; ++v)
+		{
+			mesh.indices.push_back(uint32_t(mesh.vertices.size()));
+			mesh.vertices.push_back(center + randomPoint(1.f));
+		}
+	}
+	return mesh;
+}
+
+Ray randomRay()
+{
+	Vec3f origin = randomPoint(30.f);
+	Vec3f target = randomPoint(10.f);
+	return Ray(origin, normalize(Vec3f(target - origin)));
+}
+
+// Reference: test every triangle
+bool bruteForceHit(const Mesh& mesh, const Ray& ray, float tMax, BVH::Hit& hit)
+{
+	BVH single; // One triangle at a time
+	bool found = false;
+	hit.t = tMax;
+	for(size_t t = 0; t < mesh.indices.size() / 3; ++t)
+	{
+		std::vector<Vec3f> vertices = {
+			mesh.vertices[mesh.indices[3*t]],
+			mesh.vertices[mesh.indices[3*t+1]],
+			mesh.vertices[mesh.indices[3*t+2]] };
+		single.build(vertices, { 0, 1, 2 });
+		BVH::Hit triHit;
+		if(single.closestHit(ray, hit.t, triHit))
+		{
+			hit = triHit;
+			hit.primitive = uint32_t(t);
+			found = true;
+		}
+	}
+	return found;
+}
+
+void testEmpty()
+{
+	BVH bvh;
+	bvh.build(std::vector<AABB>());
+	assert(bvh.empty());
+	BVH::Hit hit;
+	assert(!bvh.closestHit(randomRay(), 100.f, hit));
+	assert(!bvh.anyHit(randomRay(), 100.f));
+}
+
+void testTriangles(core::JobSystem* jobs)
+{
+	Mesh mesh = randomTriangles(5000);
+	BVH bvh;
+	bvh.build(mesh.vertices, mesh.indices, jobs);
+
+	// Structure: every primitive in exactly one leaf, and every node contains its children
+	auto& nodes = bvh.nodes();
+	size_t primitivesInLeaves = 0;
+	for(size_t i = 0; i < nodes.size(); ++i)
+	{
+		auto& node = nodes[i];
+		AABB box(node.min, node.max);
+		if(node.isLeaf())
+		{
+			primitivesInLeaves += node.count;
+			continue;
+		}
+		for(auto child : { uint32_t(i+1), node.offset })
+		{
+			assert(child > i && child < nodes.size());
+			assert(box.contains(nodes[child].min) && box.contains(nodes[child].max));
+		}
+	}
+	assert(primitivesInLeaves == 5000);
+
+	size_t numHits = 0;
+	for(int i = 0; i < 200; ++i)
+	{
+		Ray ray = randomRay();
+		BVH::Hit hit, reference;
+		bool found = bvh.closestHit(ray, 100.f, hit);
+		assert(found == bruteForceHit(mesh, ray, 100.f, reference));
+		assert(found == bvh.anyHit(ray, 100.f));
+		if(found)
+		{
+			numHits++;
+			assert(hit.primitive == reference.primitive);
+			assert(hit.t == reference.t);
+		}
+	}
+	assert(numHits > 0);
+
+	// Packets must agree with single rays
+	for(int i = 0; i < 100; ++i)
+	{
+		Ray rays[4] = { randomRay(), randomRay(), randomRay(), randomRay() };
+		BVH::Hit hits[4];
+		int mask = bvh.closestHit(rays, 100.f, hits);
+		for(int lane = 0; lane < 4; ++lane)
+		{
+			BVH::Hit hit;
+			bool found = bvh.closestHit(rays[lane], 100.f, hit);
+			assert(found == bool(mask & (1 << lane)));
+			if(found)
+			{
+				assert(hits[lane].primitive == hit.primitive);
+				assert(hits[lane].t == hit.t);
+			}
+		}
+	}
+}
+
+void testBoxes(core::JobSystem* jobs)
+{
+	std::vector<AABB> boxes;
+	for(int i = 0; i < 3000; ++i)
+	{
+		Vec3f center = randomPoint(50.f);
+		Vec3f halfSize = abs(randomPoint(2.f));
+		boxes.push_back(AABB(center - halfSize, center + halfSize));
+	}
+	BVH bvh;
+	bvh.build(boxes, jobs);
+
+	for(int i = 0; i < 200; ++i)
+	{
+		Ray ray = randomRay();
+		auto implicit = ray.implicit();
+		float tRef = 200.f;
+		uint32_t refNdx = ~0u;
+		for(uint32_t b = 0; b < boxes.size(); ++b)
+		{
+			float tEnter;
+			if(boxes[b].intersect(implicit, tRef, tEnter) && tEnter < tRef)
+			{
+				tRef = tEnter;
+				refNdx = b;
+			}
+		}
+		BVH::Hit hit;
+		bool found = bvh.closestHit(ray, 200.f, hit);
+		assert(found == (refNdx != ~0u));
+		if(found)
+			assert(hit.t == tRef);
+	}
+
+	for(int i = 0; i < 50; ++i)
+	{
+		Vec3f center = randomPoint(50.f);
+		AABB query(center - 5.f * Vec3f::ones(), center + 5.f * Vec3f::ones());
+		std::vector<uint32_t> result;
+		bvh.overlaps(query, result);
+		size_t expected = 0;
+		for(auto& box : boxes)
+			expected += query.intersect(box) ? 1 : 0;
+		assert(result.size() == expected);
+		for(auto ndx : result)
+			assert(query.intersect(boxes[ndx]));
+	}
+}
+
+void testParallelBuildMatchesSerial(core::JobSystem* jobs)
+{
+	Mesh mesh = randomTriangles(20000);
+	BVH serial, parallel;
+	serial.build(mesh.vertices, mesh.indices);
+	parallel.build(mesh.vertices, mesh.indices, jobs);
+	assert(serial.nodes().size() == parallel.nodes().size());
+	for(size_t i = 0; i < serial.nodes().size(); ++i)
+	{
+		assert(serial.nodes()[i].offset == parallel.nodes()[i].offset);
+		assert(serial.nodes()[i].count == parallel.nodes()[i].count);
+	}
+}
+
+int main()
+{
+	core::JobSystem::init(3);
+	auto jobs = core::JobSystem::get();
+
+	testEmpty();
+	testTriangles(nullptr);
+	testTriangles(jobs);
+	testBoxes(nullptr);
+	testBoxes(jobs);
+	testParallelBuildMatchesSerial(jobs);
+
+	core::JobSystem::end();
+	return 0;
+}
@@ -0,0 +1,71 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Batched culling unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <random>
+#include <math/geometry/culling.h>
+
+using namespace rev::math;
+
+void testMatchesSingleBoxIntersection()
+{
+	std::default_random_engine rng(7);
+	std::uniform_real_distribution<float> position(-60.f, 60.f);
+	std::uniform_real_distribution<float> extent(0.f, 8.f);
+
+	Frustum frustum(16.f/9.f, 1.f, 0.1f, 50.f);
+	for(size_t n : { 0, 1, 3, 4, 5, 8, 1001 })
+	{
+		AABBSoA boxes;
+		std::vector<AABB> reference;
+		for(size_t i = 0; i < n; ++i)
+		{
+			Vec3f center(position(rng), position(rng), -std::abs(position(rng)));
+			Vec3f halfSize(extent(rng), extent(rng), extent(rng));
+			reference.push_back(AABB(center - halfSize, center + halfSize));
+			boxes.push_back(reference.back());
+		}
+
+		std::vector<uint32_t> visible;
+		cull(frustum, boxes, visible);
+
+		size_t next = 0;
+		for(size_t i = 0; i < n; ++i)
+		{
+			if(intersect(frustum, reference[i]))
+			{
+				assert(next < visible.size());
+				assert(visible[next++] == i);
+			}
+		}
+		assert(next == visible.size());
+	}
+}
+
+void testTransformedBounds()
+{
+	Frustum frustum(1.f, 1.f, 0.1f, 10.f);
+	AABB unitBox(-Vec3f::ones(), Vec3f::ones());
+	auto inFront = AffineTransform::identity();
+	inFront.position() = Vec3f(0.f, 0.f, -5.f);
+	auto behind = AffineTransform::identity();
+	behind.position() = Vec3f(0.f, 0.f, 5.f);
+
+	AABBSoA boxes;
+	boxes.push_back(behind.matrix(), unitBox);
+	boxes.push_back(inFront.matrix(), unitBox);
+	assert(boxes[1].center() == Vec3f(0.f, 0.f, -5.f));
+
+	std::vector<uint32_t> visible = { 42 };
+	cull(frustum, boxes, visible);
+	assert(visible.size() == 2); // Appends to existing results
+	assert(visible[0] == 42);
+	assert(visible[1] == 1);
+}
+
+int main()
+{
+	testMatchesSingleBoxIntersection();
+	testTransformedBounds();
+	return 0;
+}
@@ -0,0 +1,168 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Simd math unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <math/algebra/vector.h>
+#include <math/algebra/matrix.h>
+#include <math/algebra/affineTransform.h>
+#include <math/geometry/aabb.h>
+
+using namespace rev::math;
+
+std::default_random_engine rng(42);
+
+Mat44f randomMatrix()
+{
+	std::uniform_real_distribution<float> dist(-10.f, 10.f);
+	Mat44f m;
+	for(int i = 0; i < 16; ++i)
+		m.data()[i] = dist(rng);
+	return m;
+}
+
+Vec4f randomVector()
+{
+	std::uniform_real_distribution<float> dist(-10.f, 10.f);
+	return Vec4f(dist(rng), dist(rng), dist(rng), dist(rng));
+}
+
+template<class A, class B>
+bool bitwiseEqual(const A& a, const B& b)
+{
+	static_assert(sizeof(A) == sizeof(B));
+	return std::memcmp(&a, &b, sizeof(A)) == 0;
+}
+
+bool approx(const Mat44f& a, const Mat44f& b, float tolerance)
+{
+	for(int i = 0; i < 16; ++i)
+		if(std::abs(a.data()[i] - b.data()[i]) > tolerance * std::max(1.f, std::abs(b.data()[i])))
+			return false;
+	return true;
+}
+
+void testMatrixProduct()
+{
+	for(int i = 0; i < 100; ++i)
+	{
+		Mat44f a = randomMatrix();
+		Mat44f b = randomMatrix();
+		Mat44f generic = operator*<float,4,4,4>(a, b);
+		assert(bitwiseEqual(a*b, generic));
+	}
+}
+
+void testMatrixVectorProduct()
+{
+	for(int i = 0; i < 100; ++i)
+	{
+		Mat44f a = randomMatrix();
+		Vec4f v = randomVector();
+		Vec4f generic = MatrixProduct<float,4,4,1,Mat44f,Vec4f>(a, v);
+		assert(bitwiseEqual(a*v, generic));
+	}
+}
+
+void testTranspose()
+{
+	Mat44f a = randomMatrix();
+	Mat44f generic = a.transpose();
+	assert(bitwiseEqual(transpose(a), generic));
+	assert(bitwiseEqual(transpose(transpose(a)), a));
+}
+
+void testInverse()
+{
+	assert(approx(inverse(Mat44f::identity()), Mat44f::identity(), 0.f));
+	for(int i = 0; i < 100; ++i)
+	{
+		Mat44f a = randomMatrix();
+		Mat44f generic = inverse<float>(a);
+		Mat44f fast = inverse(a);
+		assert(approx(fast, generic, 1e-3f));
+		assert(approx(a * fast, Mat44f::identity(), 1e-3f));
+	}
+}
+
+void testVectorOps()
+{
+	for(int i = 0; i < 100; ++i)
+	{
+		Vec4f a = randomVector();
+		Vec4f b = randomVector();
+		Vec4f sum = a.cwiseProduct(Vec4f::ones()) + b.cwiseProduct(Vec4f::ones()); // Generic path
+		assert(bitwiseEqual(a + b, sum));
+		Vec4f difference = a.cwiseProduct(Vec4f::ones()) - b.cwiseProduct(Vec4f::ones());
+		assert(bitwiseEqual(a - b, difference));
+		for(int j = 0; j < 4; ++j)
+		{
+			assert(min(a, b)[j] == std::min(a[j], b[j]));
+			assert(max(a, b)[j] == std::max(a[j], b[j]));
+		}
+		float genericDot = a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3];
+		assert(std::abs(dot(a, b) - genericDot) < 1e-4f * std::max(1.f, std::abs(genericDot)));
+	}
+}
+
+void testAffineComposition()
+{
+	AffineTransform a = AffineTransform::identity();
+	a.setRotation(Quatf(Vec3f(0.f, 0.f, 1.f), 0.7f));
+	a.position() = Vec3f(1.f, 2.f, 3.f);
+	AffineTransform b = AffineTransform::identity();
+	b.setRotation(Quatf(Vec3f(1.f, 0.f, 0.f), -1.3f));
+	b.position() = Vec3f(-4.f, 0.5f, 2.f);
+
+	Mat44f generic = operator*<float,4,4,4>(a.matrix(), b.matrix());
+	assert(bitwiseEqual((a*b).matrix(), generic));
+	Mat44f ab = (a*b).matrix();
+	assert(ab(3,0) == 0.f && ab(3,1) == 0.f && ab(3,2) == 0.f && ab(3,3) == 1.f);
+}
+
+void testAABBTransform()
+{
+	for(int i = 0; i < 100; ++i)
+	{
+		Mat44f xform = randomMatrix();
+		Vec4f a = randomVector();
+		Vec4f b = randomVector();
+		AABB aabb(min(a, b).block<3,1,0,0>(), max(a, b).block<3,1,0,0>());
+		AABB result = xform * aabb;
+
+		// Scalar reference, accumulating in the same order
+		for(int row = 0; row < 3; ++row)
+		{
+			float lo = xform(row, 3);
+			float hi = xform(row, 3);
+			float accumMin = 0.f, accumMax = 0.f;
+			for(int col = 0; col < 3; ++col)
+			{
+				float p0 = xform(row, col) * aabb.min()[col];
+				float p1 = xform(row, col) * aabb.max()[col];
+				float pMin = p0 < p1 ? p0 : p1;
+				float pMax = p0 > p1 ? p0 : p1;
+				accumMin = col ? accumMin + pMin : pMin;
+				accumMax = col ? accumMax + pMax : pMax;
+			}
+			lo = accumMin + lo;
+			hi = accumMax + hi;
+			assert(result.min()[row] == lo);
+			assert(result.max()[row] == hi);
+		}
+	}
+}
+
+int main()
+{
+	testMatrixProduct();
+	testMatrixVectorProduct();
+	testTranspose();
+	testInverse();
+	testVectorOps();
+	testAffineComposition();
+	testAABBTransform();
+	return 0;
+}
@@ -0,0 +1,147 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Http parsing benchmark
+//----------------------------------------------------------------------------------------------------------------------
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include <network/http/httpParser.h>
+#include <network/http/httpRequest.h>
+
+using namespace rev::net::http;
+using Clock = std::chrono::high_resolution_clock;
+
+// Count every heap allocation in the process
+std::atomic<size_t> gNumAllocations = 0;
+
+void* operator new(size_t size)
+{
+	++gNumAllocations;
+	if(void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+// Requests similar to what browsers and scripts send to the telemetry endpoint
+const char* kSmallRequests[] = {
+	"GET /stats/frame HTTP/1.1\r\nHost: localhost:8080\r\nUser-Agent: Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101 Firefox/91.0\r\n"
+	"Accept: application/json\r\nAccept-Language: en-US,en;q=0.5\r\nAccept-Encoding: gzip, deflate\r\nConnection: keep-alive\r\n"
+	"Cache-Control: max-age=0\r\n\r\n",
+	"GET /graph HTTP/1.1\r\nHost: localhost:8080\r\nUser-Agent: curl/7.74.0\r\nAccept: */*\r\n\r\n",
+	"POST /control/pause HTTP/1.1\r\nHost: localhost:8080\r\nContent-Type: application/json\r\nContent-Length: 16\r\n\r\n{\"paused\": true}",
+};
+
+std::string largeRequest(size_t bodySize)
+{
+	return "POST /capture HTTP/1.1\r\nHost: localhost\r\nContent-Length: " + std::to_string(bodySize) + "\r\n\r\n"
+		+ std::string(bodySize, 'x');
+}
+
+std::string chunkedRequest(size_t bodySize, size_t chunkSize)
+{
+	std::string request = "POST /capture HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n";
+	char sizeLine[32];
+	snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", chunkSize);
+	for(size_t i = 0; i < bodySize / chunkSize; ++i)
+		request += sizeLine + std::string(chunkSize, 'x') + "\r\n";
+	return request + "0\r\n\r\n";
+}
+
+// Many small requests pipelined in a single buffer
+void benchSmallRequests()
+{
+	std::string buffer;
+	constexpr size_t kNumRequests = 30000;
+	for(size_t i = 0; i < kNumRequests; ++i)
+		buffer += kSmallRequests[i % 3];
+
+	Parser parser;
+	auto parseAll = [&]() {
+		std::string_view input = buffer;
+		size_t numHeaders = 0;
+		while(!input.empty())
+		{
+			auto result = parser.parse(input);
+			assert(result == Parser::Result::Complete);
+			(void)result;
+			numHeaders += parser.numHeaders();
+			input.remove_prefix(parser.messageSize());
+			parser.reset();
+		}
+		return numHeaders;
+	};
+	parseAll(); // Warm up
+
+	size_t allocationsBefore = gNumAllocations;
+	auto start = Clock::now();
+	size_t numHeaders = parseAll();
+	float seconds = std::chrono::duration<float>(Clock::now() - start).count();
+	size_t numAllocations = gNumAllocations - allocationsBefore;
+	assert(numAllocations == 0);
+	assert(numHeaders == kNumRequests / 3 * (7 + 3 + 3));
+
+	printf("Small requests: %.0f ns/request, %.0f MB/s, %zu allocations\n",
+		seconds * 1e9f / kNumRequests, buffer.size() / seconds / (1 << 20), numAllocations);
+}
+
+// Large bodies arriving through 64KB reads, the way the server receives them
+void benchLargeRequest(const char* name, const std::string& message, size_t bodySize)
+{
+	constexpr size_t kReadSize = 64 * 1024;
+	constexpr int kNumRepetitions = 10;
+	std::string buffer;
+	buffer.reserve(message.size());
+	Parser parser;
+
+	float seconds = 0.f;
+	for(int i = 0; i < kNumRepetitions; ++i)
+	{
+		buffer.clear();
+		parser.reset();
+		auto result = Parser::Result::Incomplete;
+		for(size_t offset = 0; offset < message.size(); offset += kReadSize)
+		{
+			buffer.append(message, offset, kReadSize); // Not timed, stands for the socket read
+			auto start = Clock::now();
+			result = parser.parse(buffer);
+			seconds += std::chrono::duration<float>(Clock::now() - start).count();
+		}
+		assert(result == Parser::Result::Complete);
+		assert(parser.bodySize() == bodySize);
+	}
+
+	// Handing it to a request joins chunks in place, but never copies the message
+	const char* data = buffer.data();
+	size_t allocationsBefore = gNumAllocations;
+	Request request(std::move(buffer), std::move(parser));
+	assert(request.body().size() == bodySize);
+	assert(request.body().data() > data && request.body().data() < data + message.size());
+	assert(gNumAllocations == allocationsBefore);
+	(void)data;
+
+	printf("%s: %.2f ms/request, %.0f MB/s\n", name,
+		seconds * 1e3f / kNumRepetitions, float(message.size()) * kNumRepetitions / seconds / (1 << 20));
+}
+
+int main()
+{
+	benchSmallRequests();
+	constexpr size_t kBodySize = 8 * 1024 * 1024;
+	benchLargeRequest("Large request", largeRequest(kBodySize), kBodySize);
+	benchLargeRequest("Large chunked request", chunkedRequest(kBodySize, 4096), kBodySize);
+	return 0;
+}
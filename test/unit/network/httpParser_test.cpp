@@ -0,0 +1,248 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Http parser unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <string>
+#include <network/http/httpParser.h>
+#include <network/http/httpRequest.h>
+#include <network/http/httpResponse.h>
+
+using namespace rev::net::http;
+
+const std::string kGet =
+	"GET /stats/frame?id=3 HTTP/1.1\r\n"
+	"Host: localhost:8080\r\n"
+	"user-agent: test\r\n"
+	"Accept:   */*  \r\n"
+	"\r\n";
+
+const std::string kChunked =
+	"POST /upload HTTP/1.1\r\n"
+	"Transfer-Encoding: chunked\r\n"
+	"\r\n"
+	"4\r\nWiki\r\n"
+	"5;name=value\r\npedia\r\n"
+	"0\r\n"
+	"Checksum: 1234\r\n"
+	"\r\n";
+
+// Feed the message one byte at a time, the way a slow connection would.
+// Views point into the buffer, so it must outlive the parser's results.
+Parser::Result parseByteByByte(Parser& parser, const std::string& message, std::string& buffer)
+{
+	for(size_t i = 0; i < message.size(); ++i)
+	{
+		buffer.push_back(message[i]);
+		auto result = parser.parse(buffer);
+		if(result != Parser::Result::Incomplete)
+			return result;
+	}
+	return Parser::Result::Incomplete;
+}
+
+void testRequestLine()
+{
+	Parser parser;
+	assert(parser.parse(kGet) == Parser::Result::Complete);
+	assert(parser.method() == "GET");
+	assert(parser.url() == "/stats/frame?id=3");
+	assert(parser.version() == "HTTP/1.1");
+	assert(parser.keepAlive());
+	assert(parser.messageSize() == kGet.size());
+	assert(parser.numHeaders() == 3);
+	assert(parser.headerName(1) == "user-agent");
+	assert(parser.header("User-Agent") == "test");
+	assert(parser.header("accept") == "*/*"); // Trimmed
+	assert(parser.header("Missing").empty());
+	assert(parser.bodySize() == 0);
+
+	// Same results when data comes in small pieces
+	Parser incremental;
+	std::string buffer;
+	assert(parseByteByByte(incremental, kGet, buffer) == Parser::Result::Complete);
+	assert(incremental.messageSize() == kGet.size());
+	assert(incremental.header("host") == "localhost:8080");
+}
+
+void testBodyIsNotCopied()
+{
+	std::string body(100000, 'b');
+	std::string buffer = "PUT /data HTTP/1.1\r\nContent-Length: 100000\r\n\r\n" + body;
+	Parser parser;
+	assert(parser.parse(std::string_view(buffer).substr(0, 1000)) == Parser::Result::Incomplete);
+	assert(parser.parse(buffer) == Parser::Result::Complete);
+	assert(parser.numBodyChunks() == 1);
+	assert(parser.bodyChunk(0) == body);
+	assert(parser.bodyChunk(0).data() == buffer.data() + buffer.size() - body.size());
+
+	// Requests take over the buffer and keep pointing into it
+	const char* bodyData = parser.bodyChunk(0).data();
+	Request request(std::move(buffer), std::move(parser));
+	assert(request.method() == Request::Put);
+	assert(request.url() == "/data");
+	assert(request.body().data() == bodyData);
+	Request copy = request;
+	assert(copy.body() == body);
+	assert(copy.body().data() != bodyData);
+}
+
+void testPipelining()
+{
+	std::string buffer = kGet + "\r\n" + kChunked + kGet;
+	std::string_view input = buffer;
+	Parser parser;
+	for(const char* method : { "GET", "POST", "GET" })
+	{
+		assert(parser.parse(input) == Parser::Result::Complete);
+		assert(parser.method() == method);
+		input.remove_prefix(parser.messageSize());
+		parser.reset();
+	}
+	assert(input.empty());
+
+	// Requests serialize only their own message
+	parser.reset();
+	const std::string simpleGet = "GET /a HTTP/1.1\r\nHost: localhost\r\n\r\n";
+	std::string twoRequests = simpleGet + simpleGet;
+	assert(parser.parse(twoRequests) == Parser::Result::Complete);
+	Request request(std::move(twoRequests), std::move(parser));
+	assert(request.serialize() == simpleGet);
+}
+
+void testChunkedBody()
+{
+	Parser parser;
+	std::string buffer;
+	assert(parseByteByByte(parser, kChunked, buffer) == Parser::Result::Complete);
+	assert(parser.bodyChunk(0) == "Wiki" && parser.bodyChunk(1) == "pedia");
+	assert(parser.numBodyChunks() == 2);
+	assert(parser.bodySize() == 9);
+	assert(parser.messageSize() == kChunked.size());
+
+	// Joined when the request takes the buffer
+	Request request(kChunked);
+	assert(request.isComplete());
+	assert(request.method() == Request::Post);
+	assert(request.body() == "Wikipedia");
+	assert(request.serialize() == "POST /upload HTTP/1.1\r\nContent-Length: 9\r\n\r\nWikipedia");
+	assert(Request(request.serialize()).body() == "Wikipedia");
+
+	// ... and when copying to an owning response
+	Response response("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n");
+	assert(response.isComplete());
+	assert(response.body() == "abc");
+	assert(response.headers().count("Transfer-Encoding") == 0);
+	assert(response.headers().at(Message::cContentLengthLabel) == "3");
+}
+
+void testResponses()
+{
+	Parser parser(Parser::Type::Response);
+	std::string buffer = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n\r\nnothing";
+	assert(parser.parse(buffer) == Parser::Result::Incomplete); // Runs until the connection closes
+	assert(parser.finish(buffer) == Parser::Result::Complete);
+	assert(parser.statusCode() == 404);
+	assert(parser.reason() == "Not Found");
+	assert(parser.bodyChunk(0) == "nothing");
+	assert(!parser.keepAlive());
+
+	parser.reset();
+	assert(parser.parse("HTTP/1.1 204 No Content\r\n\r\n") == Parser::Result::Complete);
+	assert(parser.keepAlive());
+
+	Response response(Response::response200("hello").serialize());
+	assert(response.isComplete());
+	assert(response.statusCode() == 200);
+	assert(response.body() == "hello");
+
+	// Header names are stored with one casing, so round trips don't duplicate them
+	Response lowerCase("HTTP/1.1 200 OK\r\ncontent-length: 2\r\ncONNECTION: close\r\n\r\nhi");
+	assert(lowerCase.isComplete());
+	assert(lowerCase.headers().size() == 2);
+	assert(lowerCase.headers().at(Message::cContentLengthLabel) == "2");
+	assert(lowerCase.requiresClose());
+	auto serial = lowerCase.serialize();
+	assert(serial.find("Content-Length: 2\r\n") != std::string::npos);
+	assert(serial.find("Content-Length", serial.find("Content-Length") + 1) == std::string::npos);
+	assert(Message::canonicalHeaderName("x-FORWARDED-for") == "X-Forwarded-For");
+}
+
+Parser::Error parseError(const std::string& message)
+{
+	Parser parser;
+	auto result = parser.parse(message);
+	assert(result == Parser::Result::Error);
+	(void)result;
+	return parser.error();
+}
+
+void testErrors()
+{
+	assert(parseError("GET /\r\n\r\n") == Parser::Error::Malformed);
+	assert(parseError("get / HTTP/1.1\r\n\r\n") == Parser::Error::Malformed);
+	assert(parseError("GET / FTP/1.1\r\n\r\n") == Parser::Error::Malformed);
+	assert(parseError("GET / HTTP/1.1\r\nNo colon\r\n\r\n") == Parser::Error::Malformed);
+	assert(parseError("GET / HTTP/1.1\r\nA: b\r\n folded\r\n\r\n") == Parser::Error::Malformed);
+	assert(parseError("GET / HTTP/1.1\r\nContent-Length: 12a\r\n\r\n") == Parser::Error::Malformed);
+	assert(parseError("GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n") == Parser::Error::Malformed);
+	assert(parseError("GET / HTTP/1.1\r\nContent-Length: 1\r\nTransfer-Encoding: chunked\r\n\r\n") == Parser::Error::Malformed);
+	assert(parseError("GET / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n") == Parser::Error::Malformed);
+	assert(parseError("GET / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n") == Parser::Error::Malformed);
+	assert(parseError("GET / HTTP/1.1\r\nContent-Length: 99999999999999999999\r\n\r\n") == Parser::Error::BodyTooLarge);
+	assert(parseError("GET / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nffffffff\r\n") == Parser::Error::BodyTooLarge);
+
+	std::string manyHeaders = "GET / HTTP/1.1\r\n";
+	for(size_t i = 0; i <= Parser::cMaxHeaders; ++i)
+		manyHeaders += "X-Header: value\r\n";
+	assert(parseError(manyHeaders + "\r\n") == Parser::Error::TooManyHeaders);
+
+	// Detected before the end of the line arrives
+	std::string longLine = "GET /" + std::string(Parser::cMaxHeaderSize, 'a');
+	assert(parseError(longLine) == Parser::Error::HeaderTooLarge);
+
+	// Lines that are tolerated but not stored still count against the limit
+	std::string blankLines;
+	while(blankLines.size() <= Parser::cMaxHeaderSize)
+		blankLines += "\r\n";
+	assert(parseError(blankLines + kGet) == Parser::Error::HeaderTooLarge);
+	std::string trailers = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n";
+	for(size_t i = 0; i <= Parser::cMaxHeaderSize / 16; ++i)
+		trailers += "X-Trailer: value\r\n";
+	assert(parseError(trailers + "\r\n") == Parser::Error::HeaderTooLarge);
+
+	// Requests that don't parse have no body, even if they announce one
+	Request truncated("POST / HTTP/1.1\r\nContent-Length: 1000\r\n\r\nshort");
+	assert(!truncated.isComplete());
+	assert(truncated.body().empty());
+	assert(truncated.method() == Request::Other);
+	Request invalid("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n");
+	assert(!invalid.isComplete());
+	assert(invalid.body().empty());
+	Request copy = truncated;
+	assert(copy.body().empty());
+}
+
+void testConnectionPersistence()
+{
+	Parser parser;
+	assert(parser.parse("GET / HTTP/1.0\r\n\r\n") == Parser::Result::Complete);
+	assert(!parser.keepAlive());
+	parser.reset();
+	assert(parser.parse("GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n") == Parser::Result::Complete);
+	assert(parser.keepAlive());
+	parser.reset();
+	assert(parser.parse("GET / HTTP/1.1\r\nconnection: upgrade, close\r\n\r\n") == Parser::Result::Complete);
+	assert(!parser.keepAlive());
+}
+
+int main()
+{
+	testRequestLine();
+	testBodyIsNotCopied();
+	testPipelining();
+	testChunkedBody();
+	testResponses();
+	testErrors();
+	testConnectionPersistence();
+	return 0;
+}
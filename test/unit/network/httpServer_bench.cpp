@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Http server load test, over the loopback interface
+// Usage: httpServerBench [connections] [requests per connection] [pipeline depth]
+//----------------------------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <core/tasks/jobSystem.h>
+#include <network/http/httpRequest.h>
+#include <network/http/httpResponse.h>
+#include <network/http/httpServer.h>
+#include "httpTestClient.h"
+
+using namespace rev;
+using namespace rev::net;
+using Clock = std::chrono::high_resolution_clock;
+
+// Each client keeps its connection alive, and sends batches of pipelined requests.
+// Latency is measured from the moment a batch is sent to the arrival of each response.
+void runClient(unsigned port, size_t numRequests, size_t depth, std::vector<float>& latencies)
+{
+	TestClient client;
+	bool connected = client.connect(port);
+	assert(connected);
+	std::string batch;
+	for(size_t i = 0; i < depth; ++i)
+		batch += TestClient::get("/stats/frame");
+
+	latencies.reserve(numRequests);
+	std::string body;
+	for(size_t sent = 0; sent < numRequests; sent += depth)
+	{
+		auto start = Clock::now();
+		client.send(batch);
+		for(size_t i = 0; i < depth; ++i)
+		{
+			int status = client.readResponse(&body);
+			assert(status == 200);
+			(void)status;
+			latencies.push_back(std::chrono::duration<float, std::micro>(Clock::now() - start).count());
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t numConnections = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+	size_t requestsPerConnection = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+	size_t depth = std::max<size_t>(1, argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1);
+	requestsPerConnection = std::max(depth, requestsPerConnection - requestsPerConnection % depth);
+
+	core::JobSystem::init();
+	{
+		// Something similar to what the telemetry endpoint serves
+		http::Server server;
+		server.init(0, core::JobSystem::get());
+		http::Response::Json stats;
+		stats["frame"] = 1234;
+		stats["cpuMs"] = 5.5f;
+		stats["gpuMs"] = 7.25f;
+		server.setResponder("/stats", [&stats](http::Server* srv, unsigned conId, const http::Request&) {
+			srv->respond(conId, http::Response::jsonResponse(stats));
+		});
+
+		std::vector<std::vector<float>> latencies(numConnections);
+		std::vector<std::thread> clients;
+		auto start = Clock::now();
+		for(size_t i = 0; i < numConnections; ++i)
+			clients.emplace_back(runClient, server.port(), requestsPerConnection, depth, std::ref(latencies[i]));
+		for(auto& client : clients)
+			client.join();
+		float seconds = std::chrono::duration<float>(Clock::now() - start).count();
+
+		std::vector<float> all;
+		for(auto& l : latencies)
+			all.insert(all.end(), l.begin(), l.end());
+		assert(all.size() == numConnections * requestsPerConnection);
+		std::sort(all.begin(), all.end());
+		auto percentile = [&all](float p) { return all[std::min(all.size() - 1, size_t(p * all.size()))]; };
+
+		printf("%zu connections, %zu requests each, pipeline depth %zu, %zu workers\n",
+			numConnections, requestsPerConnection, depth, core::JobSystem::get()->numWorkers());
+		printf("%.0f requests/s\n", all.size() / seconds);
+		printf("latency (us): p50 %.1f, p99 %.1f, max %.1f\n", percentile(0.5f), percentile(0.99f), all.back());
+	}
+	core::JobSystem::end();
+	return 0;
+}
@@ -0,0 +1,278 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Http server unit testing, over the loopback interface
+//----------------------------------------------------------------------------------------------------------------------
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <core/tasks/jobSystem.h>
+#include <network/http/httpRequest.h>
+#include <network/http/httpResponse.h>
+#include <network/http/httpServer.h>
+#include "httpTestClient.h"
+
+using namespace rev;
+using namespace rev::net;
+
+// Responses sent from outside their handlers
+std::mutex gDeferredLock;
+std::vector<std::thread> gDeferred;
+
+// Responses to /hold wait until this is set
+std::atomic<bool> gReleaseHold = false;
+
+// Served straight from disk
+const char* gFilePath = "httpServer_test.tmp";
+std::string gFileContents;
+
+void makeFile()
+{
+	gFileContents.resize(4 * 1024 * 1024);
+	for(size_t i = 0; i < gFileContents.size(); ++i)
+		gFileContents[i] = char('a' + i % 26);
+	FILE* file = fopen(gFilePath, "wb");
+	assert(file);
+	fwrite(gFileContents.data(), 1, gFileContents.size(), file);
+	fclose(file);
+}
+
+void setupResponders(http::Server& server)
+{
+	server.setResponder("/echo", [](http::Server* srv, unsigned conId, const http::Request& request) {
+		srv->respond(conId, http::Response::response200(std::string(request.url())));
+	});
+	server.setResponder("/size", [](http::Server* srv, unsigned conId, const http::Request& request) {
+		srv->respond(conId, http::Response::response200(std::to_string(request.body().size())));
+	});
+	server.setResponder("/later", [](http::Server* srv, unsigned conId, const http::Request& request) {
+		std::string url(request.url());
+		std::lock_guard<std::mutex> guard(gDeferredLock);
+		gDeferred.emplace_back([=]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			srv->respond(conId, http::Response::response200(url));
+		});
+	});
+	server.setResponder("/hold", [](http::Server* srv, unsigned conId, const http::Request&) {
+		std::lock_guard<std::mutex> guard(gDeferredLock);
+		gDeferred.emplace_back([=]() {
+			while(!gReleaseHold)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			srv->respond(conId, http::Response::response200("held"));
+		});
+	});
+	server.setResponder("/static", http::Response::response200("static"));
+	server.setResponder("/file", [](http::Server* srv, unsigned conId, const http::Request&) {
+		srv->respond(conId, http::Response::fileResponse(gFilePath, "text/plain"));
+	});
+	server.setResponder("/shared", [](http::Server* srv, unsigned conId, const http::Request&) {
+		// The response references the bytes instead of copying them
+		static auto shared = std::make_shared<const std::string>(64 * 1024, 's');
+		http::Response response(200, "OK");
+		response.setBody(shared, *shared);
+		srv->respond(conId, response);
+	});
+}
+
+void testKeepAlive(unsigned port)
+{
+	TestClient client;
+	assert(client.connect(port));
+	std::string body;
+	for(int i = 0; i < 3; ++i)
+	{
+		assert(client.send(TestClient::get("/echo/" + std::to_string(i))));
+		assert(client.readResponse(&body) == 200);
+		assert(body == "/echo/" + std::to_string(i));
+	}
+	assert(client.send(TestClient::get("/static")));
+	assert(client.readResponse(&body) == 200);
+	assert(body == "static");
+	assert(client.send(TestClient::get("/missing")));
+	assert(client.readResponse() == 404);
+}
+
+void testPipelining(unsigned port)
+{
+	TestClient client;
+	assert(client.connect(port));
+	// The slow one in the middle must not be overtaken
+	assert(client.send(TestClient::get("/echo/1") + TestClient::get("/later/2") + TestClient::get("/echo/3")));
+	std::string body;
+	for(int i = 1; i <= 3; ++i)
+	{
+		assert(client.readResponse(&body) == 200);
+		assert(body.back() == '0' + i);
+	}
+}
+
+void testFragmentedRequest(unsigned port)
+{
+	TestClient client;
+	assert(client.connect(port));
+	std::string body(1024 * 1024, 'x');
+	std::string request = "POST /size HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+	// Headers trickle in one byte at a time, and the body comes in a single go
+	for(char c : request)
+	{
+		assert(client.send(std::string(1, c)));
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	assert(client.send(body));
+	std::string response;
+	assert(client.readResponse(&response) == 200);
+	assert(response == std::to_string(body.size()));
+}
+
+void testSlowClientDoesntStall(unsigned port)
+{
+	TestClient slow, fast;
+	assert(slow.connect(port));
+	assert(fast.connect(port));
+	std::string request = TestClient::get("/echo/slow");
+	assert(slow.send(request.substr(0, 10)));
+
+	std::string body;
+	assert(fast.send(TestClient::get("/echo/fast")));
+	assert(fast.readResponse(&body) == 200);
+	assert(body == "/echo/fast");
+
+	assert(slow.send(request.substr(10)));
+	assert(slow.readResponse(&body) == 200);
+	assert(body == "/echo/slow");
+}
+
+void testConnectionClose(unsigned port)
+{
+	TestClient client;
+	assert(client.connect(port));
+	assert(client.send(TestClient::get("/echo", "Connection: close\r\n") + TestClient::get("/echo")));
+	assert(client.readResponse() == 200);
+	assert(client.readResponse() == 0); // Anything after close is ignored
+
+	TestClient legacy;
+	assert(legacy.connect(port));
+	assert(legacy.send("GET /echo HTTP/1.0\r\n\r\n"));
+	assert(legacy.readResponse() == 200);
+	assert(legacy.readResponse() == 0);
+}
+
+void testHalfClosedClient(unsigned port)
+{
+	TestClient client;
+	assert(client.connect(port));
+	// Done sending, but still waiting for both responses, one of which comes late
+	assert(client.send(TestClient::get("/echo/1") + TestClient::get("/later/2")));
+	client.socket.shutdownWrite();
+	std::string body;
+	assert(client.readResponse(&body) == 200);
+	assert(body == "/echo/1");
+	assert(client.readResponse(&body) == 200);
+	assert(body == "/later/2");
+	assert(client.readResponse() == 0); // Then the server closes
+}
+
+void testMalformedRequest(unsigned port)
+{
+	TestClient client;
+	assert(client.connect(port));
+	assert(client.send("GET /echo HTTP/1.1\r\nNo colon here\r\n\r\n"));
+	assert(client.readResponse() == 400);
+	assert(client.readResponse() == 0);
+
+	TestClient huge;
+	assert(huge.connect(port));
+	assert(huge.send("POST /size HTTP/1.1\r\nContent-Length: 1000000000\r\n\r\n"));
+	assert(huge.readResponse() == 413);
+}
+
+void testPipeliningPastTheInputLimit(unsigned port)
+{
+	gReleaseHold = false;
+	TestClient client;
+	assert(client.connect(port));
+	assert(client.send(TestClient::get("/hold")));
+
+	// Keeps pipelining while the first request is being handled, without reading any response.
+	// Twice the limit, so the server has read past it by the time send returns, whatever the kernel buffers.
+	std::string request = TestClient::get("/echo/pipelined");
+	std::string pipelined;
+	while(pipelined.size() <= 2 * http::Server::cMaxBufferedInput)
+		pipelined += request;
+	assert(client.send(pipelined));
+
+	// The request already taken is still answered, then the connection goes away
+	gReleaseHold = true;
+	std::string body;
+	assert(client.readResponse(&body) == 200);
+	assert(body == "held");
+	assert(client.readResponse() == 0);
+}
+
+void testBodiesAreNotCopied(unsigned port)
+{
+	TestClient client;
+	assert(client.connect(port));
+	// Small responses on both sides of the big ones, sharing the same connection
+	assert(client.send(TestClient::get("/echo/1") + TestClient::get("/file") + TestClient::get("/shared") + TestClient::get("/echo/2")));
+	std::string body;
+	assert(client.readResponse(&body) == 200);
+	assert(body == "/echo/1");
+	assert(client.readResponse(&body) == 200);
+	assert(body == gFileContents);
+	assert(client.readResponse(&body) == 200);
+	assert(body == std::string(64 * 1024, 's'));
+	assert(client.readResponse(&body) == 200);
+	assert(body == "/echo/2");
+
+	assert(client.send(TestClient::get("/file")));
+	assert(client.readResponse(&body) == 200);
+	assert(body == gFileContents);
+}
+
+void runTests(http::Server& server)
+{
+	setupResponders(server);
+	unsigned port = server.port();
+	assert(port != 0);
+	testKeepAlive(port);
+	testPipelining(port);
+	testFragmentedRequest(port);
+	testSlowClientDoesntStall(port);
+	testConnectionClose(port);
+	testHalfClosedClient(port);
+	testMalformedRequest(port);
+	testPipeliningPastTheInputLimit(port);
+	testBodiesAreNotCopied(port);
+
+	for(auto& t : gDeferred)
+		t.join();
+	gDeferred.clear();
+}
+
+int main()
+{
+	makeFile();
+
+	// Handlers running on the socket thread
+	{
+		http::Server server;
+		server.init(0);
+		runTests(server);
+	}
+
+	// Handlers running on worker threads
+	core::JobSystem::init(2);
+	{
+		http::Server server;
+		server.init(0, core::JobSystem::get());
+		runTests(server);
+	}
+	core::JobSystem::end();
+	remove(gFilePath);
+	return 0;
+}
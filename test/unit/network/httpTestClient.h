@@ -0,0 +1,58 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Blocking http client, just enough to drive the server from tests
+//----------------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <string>
+#include <network/http/httpParser.h>
+#include <network/socket/socket.h>
+
+struct TestClient
+{
+	rev::net::Socket socket;
+	std::string input; // Received, but not yet consumed by readResponse
+
+	bool connect(unsigned port)
+	{
+		return socket.open("127.0.0.1", port);
+	}
+
+	bool send(const std::string& data)
+	{
+		return socket.write(data);
+	}
+
+	static std::string get(const std::string& url, const std::string& headers = "")
+	{
+		return "GET " + url + " HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n";
+	}
+
+	// Returns the status code of the next response, or 0 if the connection was closed before it arrived
+	int readResponse(std::string* body = nullptr)
+	{
+		rev::net::http::Parser parser(rev::net::http::Parser::Type::Response);
+		for(;;)
+		{
+			auto result = parser.parse(input);
+			if(result == rev::net::http::Parser::Result::Error)
+				return 0;
+			if(result == rev::net::http::Parser::Result::Complete)
+			{
+				int status = parser.statusCode();
+				if(body)
+				{
+					body->clear();
+					for(size_t i = 0; i < parser.numBodyChunks(); ++i)
+						body->append(parser.bodyChunk(i));
+				}
+				input.erase(0, parser.messageSize());
+				return status;
+			}
+			char buffer[16 * 1024];
+			int len = socket.read(buffer, sizeof(buffer));
+			if(len <= 0)
+				return 0;
+			input.append(buffer, len);
+		}
+	}
+};
@@ -0,0 +1,168 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Socket payload unit testing, over a local socket pair
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cstdio>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <network/socket/payload.h>
+
+using namespace rev::net;
+
+std::string gFilePath = "payload_test.tmp";
+
+std::string makeFile(size_t size)
+{
+	std::string contents(size, '\0');
+	for(size_t i = 0; i < size; ++i)
+		contents[i] = char('a' + i % 26);
+	FILE* file = fopen(gFilePath.c_str(), "wb");
+	assert(file);
+	fwrite(contents.data(), 1, contents.size(), file);
+	fclose(file);
+	return contents;
+}
+
+std::string readAll(int desc)
+{
+	std::string received;
+	char buffer[64 * 1024];
+	for(;;)
+	{
+		auto len = read(desc, buffer, sizeof(buffer));
+		if(len <= 0)
+			return received;
+		received.append(buffer, (size_t)len);
+	}
+}
+
+void testPiecesKeepTheirOrder()
+{
+	std::string contents = makeFile(100 * 1000);
+	auto file = OpenFile::open(gFilePath);
+	assert(file && file->size() == contents.size());
+	assert(fcntl(file->desc(), F_GETFD) & FD_CLOEXEC); // Not leaked into child processes
+	auto shared = std::make_shared<std::string>("shared bytes");
+
+	Payload payload;
+	payload.append("head ");
+	payload.append(shared, *shared);
+	payload.append(file, 10, 5000);
+	payload.append(std::string()); // Empty pieces are dropped
+	payload.append(" tail");
+	assert(payload.size() == 5 + shared->size() + 5000 + 5);
+
+	int pair[2];
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	assert(payload.sendTo(pair[0]) == Payload::Progress::Done);
+	assert(payload.empty() && payload.size() == 0);
+	close(pair[0]);
+	assert(readAll(pair[1]) == "head " + *shared + contents.substr(10, 5000) + " tail");
+	close(pair[1]);
+}
+
+void testPartialWrites()
+{
+	std::string contents = makeFile(1024 * 1024);
+	std::string big(300 * 1000, 'x');
+	Payload payload;
+	payload.append(big);
+	payload.append(OpenFile::open(gFilePath), 0, contents.size());
+	payload.append("end");
+	size_t total = payload.size();
+
+	int pair[2];
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	int sendBuffer = 16 * 1024;
+	setsockopt(pair[0], SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+	fcntl(pair[0], F_SETFL, O_NONBLOCK);
+
+	// A full socket leaves the rest of the payload waiting, and it resumes where it stopped
+	assert(payload.sendTo(pair[0]) == Payload::Progress::WouldBlock);
+	assert(payload.size() < total);
+	std::string received;
+	char buffer[64 * 1024];
+	for(;;)
+	{
+		auto progress = payload.sendTo(pair[0]);
+		auto len = read(pair[1], buffer, sizeof(buffer));
+		assert(len > 0);
+		received.append(buffer, (size_t)len);
+		if(progress == Payload::Progress::Done)
+			break;
+		assert(progress == Payload::Progress::WouldBlock);
+	}
+	close(pair[0]);
+	received += readAll(pair[1]);
+	close(pair[1]);
+	assert(received == big + contents + "end");
+}
+
+void testMergingHalfSentPayloads()
+{
+	Payload first;
+	first.append(std::string(200 * 1000, 'a'));
+	first.append(std::make_shared<int>(0), "bc");
+
+	int pair[2];
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	int sendBuffer = 16 * 1024;
+	setsockopt(pair[0], SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+	fcntl(pair[0], F_SETFL, O_NONBLOCK);
+	assert(first.sendTo(pair[0]) == Payload::Progress::WouldBlock);
+	size_t sent = 200 * 1000 + 2 - first.size();
+
+	// Whatever went out already must not be sent again
+	Payload merged;
+	merged.append("x");
+	merged.append(std::move(first));
+	assert(first.empty());
+	assert(merged.size() == 1 + 200 * 1000 + 2 - sent);
+	close(pair[0]);
+	close(pair[1]);
+
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	std::string received;
+	char buffer[64 * 1024];
+	fcntl(pair[0], F_SETFL, O_NONBLOCK);
+	for(;;)
+	{
+		auto progress = merged.sendTo(pair[0]);
+		auto len = read(pair[1], buffer, sizeof(buffer));
+		assert(len > 0);
+		received.append(buffer, (size_t)len);
+		if(progress == Payload::Progress::Done)
+			break;
+	}
+	close(pair[0]);
+	received += readAll(pair[1]);
+	close(pair[1]);
+	assert(received == "x" + std::string(200 * 1000 - sent, 'a') + "bc");
+}
+
+void testErrors()
+{
+	assert(!OpenFile::open("this/file/does/not/exist"));
+	assert(!OpenFile::open(".")); // Not a regular file
+
+	Payload payload;
+	payload.append("nobody listening");
+	int pair[2];
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	close(pair[1]);
+	assert(payload.sendTo(pair[0]) == Payload::Progress::Error); // And no SIGPIPE
+	close(pair[0]);
+}
+
+int main()
+{
+	testPiecesKeepTheirOrder();
+	testPartialWrites();
+	testMergingHalfSentPayloads();
+	testErrors();
+	remove(gFilePath.c_str());
+	return 0;
+}
@@ -2,12 +2,15 @@
 // Revolution Engine
 // Created by Carmelo J. Fdez-Agera Tortosa (a.k.a. Technik)
 //----------------------------------------------------------------------------------------------------------------------
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <math/algebra/simd.h>
 #include <math/algebra/vector.h>
 #include <math/numericTraits.h>
 #include <math/noise.h>
@@ -15,6 +18,7 @@
 
 #include <core/platform/osHandler.h>
 #include <core/platform/cmdLineParser.h>
+#include <core/tasks/jobSystem.h>
 #include <graphics/backend/OpenGL/deviceOpenGLWindows.h>
 #include <graphics/driver/shader.h>
 #include <graphics/scene/renderGeom.h>
@@ -34,6 +38,7 @@ struct Params {
 	std::string in;
 	std::string out;
 	bool generateBRDFLUT = false;
+	bool cpuBake = false;
 
 #ifdef _WIN32
 	static constexpr size_t arg0 = 1;
@@ -47,6 +52,7 @@ struct Params {
 		parser.addOption("in", &in);
 		parser.addOption("out", &out);
 		parser.addFlag("brdfLut", generateBRDFLUT);
+		parser.addFlag("cpu", cpuBake); // Bake probes without a gpu
 		parser.parse(_argc, _argv);
 
 		if (in.empty() && !generateBRDFLUT)
@@ -90,6 +96,107 @@ Vec2f sphere2LatLong(const Vec3f& dir)
 	return {u, v};
 }
 
+float RadicalInverse_VdC(uint32_t bits) 
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return float(bits) * 2.3283064365386963e-10f; // / 0x100000000
+}
+
+Vec3f ImportanceSampleGGX( Vec2f Xi, float Roughness )
+{
+	float a = Roughness * Roughness;
+	float Phi = 2 * Pi * Xi.x();
+	float CosTheta = sqrt( (1 - Xi.y()) / ( 1 + (a*a - 1) * Xi.y() ) );
+	float SinTheta = sqrt( 1 - CosTheta * CosTheta );
+	Vec3f H;
+	H.x() = SinTheta * cos( Phi );
+	H.y() = SinTheta * sin( Phi );
+	H.z() = CosTheta;
+
+	return H;
+}
+
+// Pixar's method for orthonormal basis generation
+void branchlessONB(const Vec3f &n, Vec3f &b1, Vec3f &b2)
+{
+	float sign = copysignf(1.0f, n.z());
+	const float a = -1.0f / (sign + n.z());
+	const float b = n.x() * n.y() * a;
+	b1 = Vec3f(1.0f + sign * n.x() * n.x() * a, sign * b, -sign * n.x());
+	b2 = Vec3f(b, sign + n.y() * n.y() * a, -n.y());
+}
+
+// Weighted sample directions in tangent space (z along the normal).
+// Stored as separate arrays, so they can be rotated into world space four at a time.
+struct SampleSet
+{
+	std::vector<float> x, y, z, weight;
+	float totalWeight = 0.f;
+
+	size_t size() const { return x.size(); }
+
+	void add(const Vec3f& dir, float w)
+	{
+		x.push_back(dir.x());
+		y.push_back(dir.y());
+		z.push_back(dir.z());
+		weight.push_back(w);
+		totalWeight += w;
+	}
+
+	// Pad with null samples to a multiple of the simd width
+	void pad()
+	{
+		while(size() % 4)
+			add(Vec3f(0.f, 0.f, 1.f), 0.f);
+	}
+
+	// Cosine weighted hemisphere, jittered inside an n x n grid of strata.
+	// The cosine term is in the sample density, so every sample has the same weight.
+	static SampleSet cosineStratified(size_t n)
+	{
+		SampleSet samples;
+		RandomGenerator random;
+		for(size_t i = 0; i < n; ++i)
+		{
+			for(size_t j = 0; j < n; ++j)
+			{
+				float u1 = (i + random.scalar()) / n;
+				float u2 = (j + random.scalar()) / n;
+				float r = sqrt(u1);
+				float phi = TwoPi * u2;
+				samples.add(Vec3f(r * cos(phi), r * sin(phi), sqrt(1.f - u1)), 1.f);
+			}
+		}
+		samples.pad();
+		return samples;
+	}
+
+	// GGX importance samples of the reflected direction, for view direction = normal.
+	// L = 2 * dot(V,H) * H - V doesn't depend on the texel in tangent space, so it's only computed once.
+	static SampleSet ggx(size_t nSamples, float roughness)
+	{
+		SampleSet samples;
+		if(roughness == 0.f)
+			nSamples = 1; // A perfect mirror only reflects along the normal
+		const float deltaX0 = 1.f/nSamples;
+		for(size_t i = 0; i < nSamples; ++i)
+		{
+			Vec3f h = ImportanceSampleGGX(Vec2f(i*deltaX0, RadicalInverse_VdC(uint32_t(i))), roughness);
+			Vec3f L = Vec3f(2 * h.z() * h.x(), 2 * h.z() * h.y(), 2 * h.z() * h.z() - 1);
+			float NoL = min(1.f, L.z());
+			if(NoL > 0)
+				samples.add(L, NoL);
+		}
+		samples.pad();
+		return samples;
+	}
+};
+
 struct Image
 {
 	Image(int sx, int sy)
@@ -225,106 +332,67 @@ struct Image
 		return mips;
 	}
 
-	Vec3f convolveRadiance(RandomGenerator& random, size_t nSamples, const Vec3f& normal) const
+	// Weighted average of the radiance coming from the sample directions around normal
+	Vec3f integrate(const SampleSet& samples, const Vec3f& normal) const
 	{
-		Vec3f accum = Vec3f(0.f, 0.f, 0.f);
-		for(size_t n = 0; n < nSamples;)
+		using namespace rev::math::simd;
+		Vec3f tangent, bitangent;
+		branchlessONB(normal, tangent, bitangent);
+		float4 tx = splat(tangent.x()), ty = splat(tangent.y()), tz = splat(tangent.z());
+		float4 bx = splat(bitangent.x()), by = splat(bitangent.y()), bz = splat(bitangent.z());
+		float4 nx = splat(normal.x()), ny = splat(normal.y()), nz = splat(normal.z());
+
+		float4 accum = splat(0.f);
+		float dirX[4], dirY[4], dirZ[4];
+		for(size_t i = 0; i < samples.size(); i += 4)
 		{
-			// Sample on the hemisphere of incomming radiance
-			auto sampleDir = random.unit_vector();
-			auto ndv = dot(sampleDir, normal);
-			if(ndv > 0)
+			// Rotate four samples into world space
+			float4 sx = load(&samples.x[i]);
+			float4 sy = load(&samples.y[i]);
+			float4 sz = load(&samples.z[i]);
+			store(dirX, add(add(mul(tx, sx), mul(bx, sy)), mul(nx, sz)));
+			store(dirY, add(add(mul(ty, sx), mul(by, sy)), mul(ny, sz)));
+			store(dirZ, add(add(mul(tz, sx), mul(bz, sy)), mul(nz, sz)));
+
+			for(size_t lane = 0; lane < 4; ++lane)
 			{
-				++n;
-				accum = accum + sampleSpherical(sampleDir) * ndv;
+				auto& color = sampleSpherical(Vec3f(dirX[lane], dirY[lane], dirZ[lane]));
+				accum = add(accum, mul(set(color.x(), color.y(), color.z(), 0.f), splat(samples.weight[i+lane])));
 			}
 		}
-		return accum * (TwoPi/nSamples);
-	}
-
-	float RadicalInverse_VdC(size_t bits) 
-	{
-		bits = (bits << 16u) | (bits >> 16u);
-		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
-		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
-		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
-		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
-		return float(bits) * 2.3283064365386963e-10f; // / 0x100000000
-	}
-
-	// Precompute random samples
-	void pregenerateRandomSamples(size_t nSamples)
-	{
-		randomSamples.resize(nSamples);
-		const float deltaX0 = 1.f/nSamples;
-		for(size_t i = 0; i < nSamples; ++i)
-		{
-			randomSamples[i] = Vec2f(i*deltaX0, RadicalInverse_VdC(i));
-		}
-	}
-
-	// Precompute random samples
-	void pregenerateRandomVectors(size_t nSamples)
-	{
-		RandomGenerator random;
-		randomVectors.resize(nSamples);
 
-		for(size_t i = 0; i < nSamples; ++i)
-		{
-			randomVectors[i] = random.unit_vector();
-		}
+		float result[4];
+		store(result, accum);
+		float k = 1.f / samples.totalWeight;
+		return Vec3f(result[0]*k, result[1]*k, result[2]*k);
 	}
 
+	// Evaluate op(direction) for every texel of a latlong image, splitting the rows across the job system
 	template<class Op>
-	Image* traverseLatLongRand(const Op& op) const
+	static Image* traverseLatLong(int dstNx, int dstNy, const Op& op)
 	{
-		RandomGenerator random;
-		// Actual traverse
-		auto resultImage = new Image(nx, ny);
-		for(int i = 0; i < ny; ++i)
-		{
-			float v = 1-float(i)/ny;
-			for(int j = 0; j < nx; ++j)
+		auto resultImage = new Image(dstNx, dstNy);
+		rev::core::JobSystem::get()->parallel_for(0, dstNy, 1, [&](size_t i) {
+			float v = 1-float(i)/dstNy;
+			for(int j = 0; j < dstNx; ++j)
 			{
-				float u = float(j)/nx;
+				float u = float(j)/dstNx;
 				auto dir = latLong2Sphere(u, v);
-				resultImage->at(j,i) = op(random, dir);
+				resultImage->at(j,int(i)) = op(dir);
 			}
-		}
+		});
 		return resultImage;
 	}
 
-	Image* irradianceLambert(int nSamples)
+	// Irradiance / Pi, i.e. the radiance reflected by a white lambertian surface. Same as the gpu path.
+	Image* irradianceLambert(size_t nStrata, int dstNx, int dstNy) const
 	{
-		return traverseLatLongRand([this,nSamples](auto& random, auto& irradianceDir){
-			return convolveRadiance(random, nSamples, irradianceDir);
+		auto samples = SampleSet::cosineStratified(nStrata);
+		return traverseLatLong(dstNx, dstNy, [&](const Vec3f& normal){
+			return integrate(samples, normal);
 		});
 	}
 
-	// Pixar's method for orthonormal basis generation
-	void branchlessONB(const Vec3f &n, Vec3f &b1, Vec3f &b2)
-	{
-		float sign = copysignf(1.0f, n.z());
-		const float a = -1.0f / (sign + n.z());
-		const float b = n.x() * n.y() * a;
-		b1 = Vec3f(1.0f + sign * n.x() * n.x() * a, sign * b, -sign * n.x());
-		b2 = Vec3f(b, sign + n.y() * n.y() * a, -n.y());
-	}
-
-	Vec3f ImportanceSampleGGX( Vec2f Xi, float Roughness, Vec3f N )
-	{
-		float a = Roughness * Roughness;
-		float Phi = 2 * Pi * Xi.x();
-		float CosTheta = sqrt( (1 - Xi.y()) / ( 1 + (a*a - 1) * Xi.y() ) );
-		float SinTheta = sqrt( 1 - CosTheta * CosTheta );
-		Vec3f H;
-		H.x() = SinTheta * cos( Phi );
-		H.y() = SinTheta * sin( Phi );
-		H.z() = CosTheta;
-
-		return H;
-	}
-
 	const Vec3f& sampleSpherical(const Vec3f& dir) const
 	{
 		auto uv = sphere2LatLong(dir);
@@ -333,57 +401,16 @@ struct Image
 		return at((int)sx, (int)sy);
 	}
 
-	Vec3f PrefilterEnvMap(size_t numSamples, float Roughness, Vec3f R )
-	{
-		Vec3f V = R;
-		Vec3f N = R;
-		// Compute an orthonormal basis
-		Vec3f tangent, bitangent;
-		branchlessONB(N, tangent, bitangent);
-
-		// Convolve filter
-		Vec3f PrefilteredColor = Vec3f(0.f, 0.f, 0.f);
-		float TotalWeight = 0.f;
-		for( size_t i = 0; i < numSamples; i++ )
-		{
-			Vec2f Xi = randomSamples[i];
-			Vec3f h = ImportanceSampleGGX( Xi, Roughness, N );
-			Vec3f H = tangent * h.x() + bitangent * h.y() + N * h.z();
-			Vec3f L = 2 * dot(V,H) * H - V;
-			float NoL = min(1.f, dot(N,L) );
-			if( NoL > 0 )
-			{
-				PrefilteredColor = PrefilteredColor + sampleSpherical(L) * NoL;
-				TotalWeight += NoL;
-			}
-		}
-		return PrefilteredColor * (1/TotalWeight);
-	}
-
-	Image* radianceGGX(size_t nSamples, float r, int dstNx, int dstNy)
+	Image* radianceGGX(size_t nSamples, float r, int dstNx, int dstNy) const
 	{
-		pregenerateRandomSamples(nSamples);
-
-		// Actual traverse
-		auto resultImage = new Image(dstNx, dstNy);
-		for(int i = 0; i < dstNy; ++i)
-		{
-			float v = 1-float(i)/dstNy;
-			for(int j = 0; j < dstNx; ++j)
-			{
-				float u = float(j)/dstNx;
-				auto dir = latLong2Sphere(u, v);
-				resultImage->at(j,i) = PrefilterEnvMap(nSamples, r, dir);
-			}
-		}
-
-		return resultImage;
+		auto samples = SampleSet::ggx(nSamples, r);
+		return traverseLatLong(dstNx, dstNy, [&](const Vec3f& normal){
+			return integrate(samples, normal);
+		});
 	}
 
 	Vec3f* m;
 	int nx, ny;
-	std::vector<Vec2f> randomSamples;
-	std::vector<Vec3f> randomVectors;
 };
 
 string commonPBRCode = R"(
@@ -804,6 +831,79 @@ void main (void) {
 	ofstream(params.out + ".json") << mipsDesc.dump(4);
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// Bake the same probe levels as generateProbeFromImage, on the cpu
+void generateProbeOnCpu(const Params& params, const rev::gfx::Image& srcImg)
+{
+	using Clock = std::chrono::high_resolution_clock;
+	auto bakeStart = Clock::now();
+	size_t totalTexels = 0;
+	auto reportThroughput = [](const std::string& name, size_t nTexels, Clock::time_point start) {
+		float seconds = std::chrono::duration<float>(Clock::now() - start).count();
+		cout << name << ": " << nTexels << " texels in " << seconds << "s (" << size_t(nTexels / seconds) << " texels/s)\n";
+	};
+
+	// Convert the source into linear float rgb
+	auto size = srcImg.size();
+	auto src = new ::Image(size.x(), size.y());
+	auto nChannels = srcImg.format().numChannels;
+	for(int i = 0; i < src->nPixels(); ++i)
+	{
+		for(int c = 0; c < 3; ++c)
+		{
+			auto channel = nChannels > 1 ? c : 0;
+			src->at(i)[c] = srcImg.format().channel == rev::gfx::Image::ChannelFormat::Float32 ?
+				srcImg.data<float>()[nChannels*i + channel] :
+				srcImg.data<uint8_t>()[nChannels*i + channel] / 255.f;
+		}
+	}
+	auto srcMips = src->generateMipMaps();
+	if(srcMips.empty())
+		srcMips.push_back(src);
+
+	Json mipsDesc = Json::array();
+	constexpr size_t nRadianceMips = 4;
+	constexpr size_t radianceSize = 16;
+	constexpr size_t nRadianceSamples = 1024;
+	constexpr size_t nIrradianceStrata = 32; // 32x32 samples
+	for(size_t i = 0; i < nRadianceMips; ++i)
+	{
+		auto levelStart = Clock::now();
+		int baseSize = (radianceSize<<(nRadianceMips-i)); // The size of a face in an equivalent cubemap
+		float roughness = i/(nRadianceMips-1.f);
+		// Sample from blurrier mips for rougher levels, like the gpu path does
+		auto srcMip = std::min(srcMips.size()-1, size_t(roughness*(1.7f-0.7f*roughness) * nRadianceMips));
+		auto level = srcMips[srcMip]->radianceGGX(nRadianceSamples, roughness, 4*baseSize, 2*baseSize);
+
+		stringstream ss;
+		ss << params.out << i << ".hdr";
+		auto name = ss.str();
+		level->saveHDR(name);
+		mipsDesc.push_back({ {"size", { level->nx, level->ny }}, {"name", name} });
+
+		reportThroughput("Radiance " + std::to_string(i), level->nPixels(), levelStart);
+		totalTexels += level->nPixels();
+		delete level;
+	}
+
+	auto irradianceStart = Clock::now();
+	auto irradiance = srcMips[std::min<size_t>(srcMips.size()-1, 3)]->irradianceLambert(nIrradianceStrata, 4*radianceSize, 2*radianceSize);
+	stringstream ss;
+	ss << params.out << nRadianceMips << ".hdr";
+	auto name = ss.str();
+	irradiance->saveHDR(name);
+	mipsDesc.push_back({ {"size", { irradiance->nx, irradiance->ny }}, {"name", name} });
+	reportThroughput("Irradiance", irradiance->nPixels(), irradianceStart);
+	totalTexels += irradiance->nPixels();
+	delete irradiance;
+
+	for(auto mip : srcMips)
+		delete mip;
+
+	reportThroughput("Total", totalTexels, bakeStart);
+	ofstream(params.out + ".json") << mipsDesc.dump(4);
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 void generateIblLut(const Params& params, Device& device)
 {
@@ -912,6 +1012,21 @@ int main(int _argc, const char** _argv) {
 	if (!params.parseArguments(_argc, _argv))
 		return -1;
 
+	if(params.cpuBake && !params.generateBRDFLUT)
+	{
+		// Headless bake. No graphics device needed
+		auto srcImg = rev::gfx::Image::load(params.in, 3);
+		if(!srcImg)
+		{
+			cout << "Error: Unable to load input image\n";
+			return -1;
+		}
+		rev::core::JobSystem::init();
+		generateProbeOnCpu(params, *srcImg);
+		rev::core::JobSystem::end();
+		return 0;
+	}
+
 	// Create a grapics device, so we can use all openGL features
 	rev::core::OSHandler::startUp();
 	rev::gfx::DeviceOpenGLWindows device;